@@ -0,0 +1,37 @@
+#include "common/base64.h"
+
+namespace nvr
+{
+
+static const char *KBase64Table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Base64Encode(const uint8_t *data, size_t len)
+{
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < len; i += 3)
+    {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out.push_back(KBase64Table[(v >> 18) & 0x3f]);
+        out.push_back(KBase64Table[(v >> 12) & 0x3f]);
+        out.push_back(KBase64Table[(v >> 6) & 0x3f]);
+        out.push_back(KBase64Table[v & 0x3f]);
+    }
+
+    if (i < len)
+    {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < len)
+            v |= data[i + 1] << 8;
+        out.push_back(KBase64Table[(v >> 18) & 0x3f]);
+        out.push_back(KBase64Table[(v >> 12) & 0x3f]);
+        out.push_back(i + 1 < len ? KBase64Table[(v >> 6) & 0x3f] : '=');
+        out.push_back('=');
+    }
+
+    return out;
+}
+
+} // namespace nvr
@@ -0,0 +1,13 @@
+#ifndef BASE64_H_
+#define BASE64_H_
+
+#include <string>
+
+namespace nvr
+{
+
+std::string Base64Encode(const uint8_t *data, size_t len);
+
+} // namespace nvr
+
+#endif
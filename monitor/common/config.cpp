@@ -103,6 +103,67 @@ int32_t Config::ReadConfigFile(const std::string &config_file)
         return static_cast<int>(KSystemError);
     }
 
+    //websocket(可选)
+    if (root.isMember("websocket"))
+    {
+        Json::Value websocket = root["websocket"];
+        if (!websocket.isObject() ||
+            !websocket.isMember("enable") ||
+            !websocket["enable"].isBool() ||
+            !websocket.isMember("url") ||
+            !websocket["url"].isString())
+        {
+            log_e("parse websocket config failed");
+            return static_cast<int>(KSystemError);
+        }
+        this->websocket.enable = websocket["enable"].asBool();
+        this->websocket.url = websocket["url"].asString();
+    }
+
+    //rtp组播(可选)
+    if (root.isMember("rtp"))
+    {
+        Json::Value rtp = root["rtp"];
+        if (!rtp.isObject() ||
+            !rtp.isMember("enable") ||
+            !rtp["enable"].isBool() ||
+            !rtp.isMember("url") ||
+            !rtp["url"].isString() ||
+            !rtp.isMember("ttl") ||
+            !rtp["ttl"].isInt() ||
+            !rtp.isMember("sdp_path") ||
+            !rtp["sdp_path"].isString())
+        {
+            log_e("parse rtp config failed");
+            return static_cast<int>(KSystemError);
+        }
+        this->rtp.enable = rtp["enable"].asBool();
+        this->rtp.url = rtp["url"].asString();
+        this->rtp.ttl = rtp["ttl"].asInt();
+        this->rtp.sdp_path = rtp["sdp_path"].asString();
+    }
+
+    //录像回放(可选)
+    if (root.isMember("playback"))
+    {
+        Json::Value playback = root["playback"];
+        if (!playback.isObject() ||
+            !playback.isMember("enable") ||
+            !playback["enable"].isBool() ||
+            !playback.isMember("url") ||
+            !playback["url"].isString())
+        {
+            log_e("parse playback config failed");
+            return static_cast<int>(KSystemError);
+        }
+        this->playback.enable = playback["enable"].asBool();
+        this->playback.url = playback["url"].asString();
+        if (playback.isMember("rate_limit") && playback["rate_limit"].isInt())
+            this->playback.rate_limit = playback["rate_limit"].asInt();
+        if (playback.isMember("token") && playback["token"].isString())
+            this->playback.token = playback["token"].asString();
+    }
+
     //video
     this->video.frame_rate = video["frame_rate"].asInt();
     this->video.width = video["width"].asInt();
@@ -111,11 +172,106 @@ int32_t Config::ReadConfigFile(const std::string &config_file)
     this->video.codec_profile = video["codec_profile"].asInt();
     //detect
     this->detect.trigger_thresh = detect["trigger_thresh"].asInt();
+    if (detect.isMember("frame_rate") && detect["frame_rate"].isInt())
+        this->detect.frame_rate = detect["frame_rate"].asInt();
+    if (detect.isMember("width") && detect["width"].isInt())
+        this->detect.width = detect["width"].asInt();
+    if (detect.isMember("height") && detect["height"].isInt())
+        this->detect.height = detect["height"].asInt();
+    if (detect.isMember("idle_frame_rate") && detect["idle_frame_rate"].isInt())
+        this->detect.idle_frame_rate = detect["idle_frame_rate"].asInt();
+    if (detect.isMember("active_frame_rate") && detect["active_frame_rate"].isInt())
+        this->detect.active_frame_rate = detect["active_frame_rate"].asInt();
+    if (detect.isMember("active_hold") && detect["active_hold"].isInt())
+        this->detect.active_hold = detect["active_hold"].asInt();
+    if (detect.isMember("min_area") && detect["min_area"].isInt())
+        this->detect.min_area = detect["min_area"].asInt();
+    if (detect.isMember("confirm_frames") && detect["confirm_frames"].isInt())
+        this->detect.confirm_frames = detect["confirm_frames"].asInt();
+    if (detect.isMember("confirm_window") && detect["confirm_window"].isInt())
+        this->detect.confirm_window = detect["confirm_window"].asInt();
+    if (detect.isMember("cooldown") && detect["cooldown"].isInt())
+        this->detect.cooldown = detect["cooldown"].asInt();
+    if (detect.isMember("tamper") && detect["tamper"].isBool())
+        this->detect.tamper = detect["tamper"].asBool();
+    if (detect.isMember("tamper_hold") && detect["tamper_hold"].isInt())
+        this->detect.tamper_hold = detect["tamper_hold"].asInt();
+    if (detect.isMember("tamper_covered") && detect["tamper_covered"].isInt())
+        this->detect.tamper_covered = detect["tamper_covered"].asInt();
+    if (detect.isMember("tamper_defocus") && detect["tamper_defocus"].isInt())
+        this->detect.tamper_defocus = detect["tamper_defocus"].asInt();
+    if (detect.isMember("tamper_moved") && detect["tamper_moved"].isInt())
+        this->detect.tamper_moved = detect["tamper_moved"].asInt();
+    if (detect.isMember("illum_compensate") && detect["illum_compensate"].isBool())
+        this->detect.illum_compensate = detect["illum_compensate"].asBool();
+    if (detect.isMember("illum_ratio") && detect["illum_ratio"].isInt())
+        this->detect.illum_ratio = detect["illum_ratio"].asInt();
+    if (detect.isMember("engine") && detect["engine"].isString())
+        this->detect.engine = detect["engine"].asString();
+    //IVE的背景模型在硬件中,没有办法先补偿亮度
+    if (this->detect.illum_compensate && "software" != this->detect.engine)
+    {
+        log_w("illum_compensate is only supported by the software engine,disabled for engine %s", this->detect.engine.c_str());
+        this->detect.illum_compensate = false;
+    }
+    if (detect.isMember("sad_thresh") && detect["sad_thresh"].isInt())
+        this->detect.sad_thresh = detect["sad_thresh"].asInt();
+    if (detect.isMember("block_size") && detect["block_size"].isInt())
+        this->detect.block_size = detect["block_size"].asInt();
+    if (detect.isMember("area_thresh") && detect["area_thresh"].isInt())
+        this->detect.area_thresh = detect["area_thresh"].asInt();
+    if (detect.isMember("zones") && detect["zones"].isArray())
+    {
+        for (const Json::Value &item : detect["zones"])
+        {
+            if (!item.isObject() || !item.isMember("points") || !item["points"].isArray())
+            {
+                log_e("parse detect zone failed");
+                return static_cast<int>(KSystemError);
+            }
+            Detect::Zone zone;
+            zone.name = item.isMember("name") && item["name"].isString() ? item["name"].asString() : std::to_string(this->detect.zones.size());
+            zone.exclude = item.isMember("type") && item["type"].isString() && "exclude" == item["type"].asString();
+            zone.trigger_thresh = item.isMember("trigger_thresh") && item["trigger_thresh"].isInt() ? item["trigger_thresh"].asInt() : 0;
+            for (const Json::Value &point : item["points"])
+            {
+                if (!point.isArray() || point.size() != 2 || !point[0].isInt() || !point[1].isInt())
+                {
+                    log_e("parse detect zone %s point failed", zone.name.c_str());
+                    return static_cast<int>(KSystemError);
+                }
+                zone.points.push_back(std::make_pair(point[0].asInt(), point[1].asInt()));
+            }
+            this->detect.zones.push_back(zone);
+        }
+    }
     //record
     this->record.segment_duration =record["segment_duration"].asInt();
     this->record.path = record["path"].asString();
     this->record.use_md = record["use_md"].asBool();
     this->record.md_duration = record["md_duration"].asInt();
+    if (record.isMember("format") && record["format"].isString())
+        this->record.format = record["format"].asString();
+    if (record.isMember("pre_record") && record["pre_record"].isInt())
+        this->record.pre_record = record["pre_record"].asInt();
+    if (record.isMember("pre_record_size") && record["pre_record_size"].isInt())
+        this->record.pre_record_size = record["pre_record_size"].asInt();
+    if (record.isMember("chunk_size") && record["chunk_size"].isInt())
+        this->record.chunk_size = record["chunk_size"].asInt();
+    if (record.isMember("prealloc_size") && record["prealloc_size"].isInt())
+        this->record.prealloc_size = record["prealloc_size"].asInt();
+    if (record.isMember("sync_interval") && record["sync_interval"].isInt())
+        this->record.sync_interval = record["sync_interval"].asInt();
+    if (record.isMember("align_size") && record["align_size"].isInt())
+        this->record.align_size = record["align_size"].asInt();
+    if (record.isMember("quota") && record["quota"].isInt())
+        this->record.quota = record["quota"].asInt();
+    if (record.isMember("high_water") && record["high_water"].isInt())
+        this->record.high_water = record["high_water"].asInt();
+    if (record.isMember("low_water") && record["low_water"].isInt())
+        this->record.low_water = record["low_water"].asInt();
+    if (record.isMember("event_keep") && record["event_keep"].isInt())
+        this->record.event_keep = record["event_keep"].asInt();
     //rtmp
     this->rtmp.url = rtmp["url"].asString();
 
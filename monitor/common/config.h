@@ -2,6 +2,7 @@
 #define CONFIG_H_
 
 #include <string>
+#include <vector>
 #include "video_codec/video_codec_define.h"
 
 namespace nvr
@@ -30,11 +31,61 @@ struct Config
 
     struct Detect
     {
+        struct Zone
+        {
+            std::string name;
+            bool exclude;
+            std::vector<std::pair<int32_t, int32_t>> points; //检测分辨率坐标
+            int32_t trigger_thresh;                           //0使用全局阈值
+        };
         Detect()
         {
             trigger_thresh = 1;
+            frame_rate = 5;
+            width = DETECT_WIDTH;
+            height = DETECT_HEIGHT;
+            idle_frame_rate = 0;
+            active_frame_rate = 12;
+            active_hold = 5000;
+            min_area = 0;
+            confirm_frames = 1;
+            confirm_window = 1;
+            cooldown = 0;
+            engine = "ive";
+            sad_thresh = 200;
+            block_size = 4;
+            area_thresh = 16;
+            tamper = false;
+            tamper_hold = 10000;
+            tamper_covered = 12;
+            tamper_defocus = 40;
+            tamper_moved = 50;
+            illum_compensate = false;
+            illum_ratio = 0;
         }
         int32_t trigger_thresh;
+        int32_t frame_rate;        //固定检测帧率,idle_frame_rate为0时使用
+        int32_t width;             //检测分辨率,不超过DETECT_WIDTH x DETECT_HEIGHT
+        int32_t height;
+        int32_t idle_frame_rate;   //自适应检测帧率:空闲帧率,0为关闭
+        int32_t active_frame_rate; //有运动时的帧率
+        int32_t active_hold;       //运动停止后保持高帧率的时间(ms)
+        int32_t min_area;          //参与触发的最小区域面积(像素)
+        int32_t confirm_frames;    //最近confirm_window帧中命中confirm_frames帧才开始事件
+        int32_t confirm_window;
+        int32_t cooldown;          //事件结束前的冷却时间(ms)
+        std::string engine; //ive/software
+        int32_t sad_thresh;
+        int32_t block_size;
+        int32_t area_thresh;
+        std::vector<Zone> zones;
+        bool tamper;            //遮挡/失焦/移位检测
+        int32_t tamper_hold;    //条件持续时间(ms)才报警
+        int32_t tamper_covered; //亮度标准差低于该值视为遮挡
+        int32_t tamper_defocus; //边缘能量低于参考的百分比视为失焦
+        int32_t tamper_moved;   //场景与参考的相关系数(x100)低于该值视为移位
+        bool illum_compensate;  //补偿整体亮度变化后再计算SAD,仅软件实现
+        int32_t illum_ratio;    //过滤后的运动面积超过检测范围的该百分比视为整体亮度变化,0为关闭
     };
     struct Record
     {
@@ -44,12 +95,34 @@ struct Config
             path = "/app/record";
             use_md = true;
             md_duration = 60; //second
+            format = "mp4";
+            pre_record = 0;          //second
+            pre_record_size = 4096; //KB
+            chunk_size = 1024;      //KB
+            prealloc_size = 0;      //MB
+            sync_interval = 0;      //ms
+            align_size = 64;        //KB
+            quota = 0;              //MB
+            high_water = 90;        //%
+            low_water = 80;         //%
+            event_keep = 0;         //day
         };
 
         int32_t segment_duration;
         std::string path;
         bool use_md;
         int32_t md_duration;
+        std::string format; //mp4:mp4v2封装,关闭时写moov;fmp4:按GOP分片写入,掉电安全;es:裸码流+关键帧索引,导出时再封装
+        int32_t pre_record;
+        int32_t pre_record_size;
+        int32_t chunk_size;    //单次写盘大小,写入磁盘的块越大,SD卡/NFS效率越高
+        int32_t prealloc_size; //预分配extent,减少文件碎片
+        int32_t sync_interval; //fdatasync周期,决定掉电时最多丢失的时长;fmp4在周期到达后的分片边界同步,0为每个分片都同步
+        int32_t align_size;    //写入对齐单位,设为SD卡页大小,同步时不重写同一页(fmp4分片用free box补齐);chunk_size和prealloc_size设为擦除块大小的整数倍
+        int32_t quota;         //录像配额,超过高水位时删除最旧的录像到低水位
+        int32_t high_water;
+        int32_t low_water;
+        int32_t event_keep; //移动侦测录像优先保留的天数
     };
 
     struct Rtmp
@@ -62,10 +135,57 @@ struct Config
         std::string url;
     };
 
+    struct WebSocket
+    {
+        WebSocket()
+        {
+            enable = false;
+            url = "ws://0.0.0.0:8080/live";
+        }
+
+        bool enable;
+        std::string url;
+    };
+
+    struct Rtp
+    {
+        Rtp()
+        {
+            enable = false;
+            url = "rtp://239.255.0.1:5004";
+            ttl = 1;
+            sdp_path = "/tmp/monitor.sdp";
+        }
+
+        bool enable;
+        std::string url; //rtp://组播地址:端口,可加?iface=本地地址指定发送组播的网卡
+        int32_t ttl;
+        std::string sdp_path;
+    };
+
+    struct Playback
+    {
+        Playback()
+        {
+            enable = false;
+            url = "http://0.0.0.0:8081";
+            rate_limit = 0; //KB/s
+            token = "";
+        }
+
+        bool enable;
+        std::string url;
+        int32_t rate_limit; //回放总带宽上限,避免占满上行带宽和磁盘读
+        std::string token;  //请求需带?token=或Authorization: Bearer,为空时不校验
+    };
+
     Video video;
     Detect detect;
     Rtmp rtmp;
     Record record;
+    WebSocket websocket;
+    Rtp rtp;
+    Playback playback;
 
     static Config *Instance()
     {
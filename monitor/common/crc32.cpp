@@ -0,0 +1,30 @@
+#include "common/crc32.h"
+
+namespace nvr
+{
+
+//CRC-32(IEEE 802.3)
+uint32_t Crc32(const void *data, size_t len)
+{
+    static uint32_t table[256];
+    static bool init = false;
+    if (!init)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        init = true;
+    }
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffff;
+}
+
+} // namespace nvr
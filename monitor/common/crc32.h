@@ -0,0 +1,14 @@
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace nvr
+{
+
+uint32_t Crc32(const void *data, size_t len);
+
+} // namespace nvr
+
+#endif
@@ -0,0 +1,366 @@
+#include "common/fmp4.h"
+
+namespace nvr
+{
+
+static const uint32_t KMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+BoxWriter::BoxWriter(std::string &out) : out_(out)
+{
+}
+
+size_t BoxWriter::Begin(const char *type)
+{
+    size_t pos = out_.size();
+    U32(0);
+    Bytes(type, 4);
+    return pos;
+}
+
+size_t BoxWriter::BeginFull(const char *type, uint8_t version, uint32_t flags)
+{
+    size_t pos = Begin(type);
+    U8(version);
+    U24(flags);
+    return pos;
+}
+
+void BoxWriter::End(size_t pos)
+{
+    Patch32(pos, static_cast<uint32_t>(out_.size() - pos));
+}
+
+void BoxWriter::U8(uint8_t v)
+{
+    out_.push_back(static_cast<char>(v));
+}
+
+void BoxWriter::U16(uint16_t v)
+{
+    U8(v >> 8);
+    U8(v & 0xff);
+}
+
+void BoxWriter::U24(uint32_t v)
+{
+    U8((v >> 16) & 0xff);
+    U8((v >> 8) & 0xff);
+    U8(v & 0xff);
+}
+
+void BoxWriter::U32(uint32_t v)
+{
+    U8((v >> 24) & 0xff);
+    U8((v >> 16) & 0xff);
+    U8((v >> 8) & 0xff);
+    U8(v & 0xff);
+}
+
+void BoxWriter::U64(uint64_t v)
+{
+    U32(static_cast<uint32_t>(v >> 32));
+    U32(static_cast<uint32_t>(v & 0xffffffff));
+}
+
+void BoxWriter::Bytes(const void *data, size_t len)
+{
+    out_.append(static_cast<const char *>(data), len);
+}
+
+void BoxWriter::Zero(size_t len)
+{
+    out_.append(len, '\0');
+}
+
+void BoxWriter::Patch32(size_t pos, uint32_t v)
+{
+    out_[pos] = static_cast<char>((v >> 24) & 0xff);
+    out_[pos + 1] = static_cast<char>((v >> 16) & 0xff);
+    out_[pos + 2] = static_cast<char>((v >> 8) & 0xff);
+    out_[pos + 3] = static_cast<char>(v & 0xff);
+}
+
+size_t BoxWriter::Size() const
+{
+    return out_.size();
+}
+
+FMP4Packager::FMP4Packager() : width_(0),
+                               height_(0),
+                               frame_rate_(0),
+                               sequence_(0)
+{
+}
+
+void FMP4Packager::Initialize(int width, int height, int frame_rate)
+{
+    width_ = width;
+    height_ = height;
+    frame_rate_ = frame_rate > 0 ? frame_rate : 25;
+    Reset();
+}
+
+void FMP4Packager::Reset()
+{
+    sequence_ = 0;
+    sps_.clear();
+    pps_.clear();
+}
+
+bool FMP4Packager::SetParameterSet(const uint8_t *nalu, uint32_t len)
+{
+    if (len < 1)
+        return false;
+
+    std::string *dst;
+    switch (nalu[0] & 0x1f)
+    {
+    case 7:
+        if (len < 4)
+            return false;
+        dst = &sps_;
+        break;
+    case 8:
+        dst = &pps_;
+        break;
+    default:
+        return false;
+    }
+
+    if (dst->size() == len && memcmp(dst->data(), nalu, len) == 0)
+        return false;
+
+    dst->assign(reinterpret_cast<const char *>(nalu), len);
+    return true;
+}
+
+bool FMP4Packager::Ready() const
+{
+    return !sps_.empty() && !pps_.empty();
+}
+
+std::string FMP4Packager::Codec() const
+{
+    char buf[32];
+    if (sps_.size() < 4)
+        return "avc1.42e01f";
+    snprintf(buf, sizeof(buf), "avc1.%02x%02x%02x",
+             static_cast<uint8_t>(sps_[1]),
+             static_cast<uint8_t>(sps_[2]),
+             static_cast<uint8_t>(sps_[3]));
+    return buf;
+}
+
+uint32_t FMP4Packager::SampleDuration() const
+{
+    return KTimeScale / frame_rate_;
+}
+
+void FMP4Packager::BuildSampleEntry(BoxWriter &w) const
+{
+    size_t stsd = w.BeginFull("stsd", 0, 0);
+    w.U32(1);
+    size_t avc1 = w.Begin("avc1");
+    w.Zero(6);
+    w.U16(1); //data_reference_index
+    w.Zero(16);
+    w.U16(width_);
+    w.U16(height_);
+    w.U32(0x00480000);
+    w.U32(0x00480000);
+    w.U32(0);
+    w.U16(1); //frame_count
+    w.Zero(32);
+    w.U16(0x0018);
+    w.U16(0xffff);
+
+    size_t avcc = w.Begin("avcC");
+    w.U8(1);
+    w.U8(sps_.size() > 3 ? sps_[1] : 0x42);
+    w.U8(sps_.size() > 3 ? sps_[2] : 0xe0);
+    w.U8(sps_.size() > 3 ? sps_[3] : 0x1f);
+    w.U8(0xff); //lengthSizeMinusOne = 3
+    w.U8(0xe1);
+    w.U16(sps_.size());
+    w.Bytes(sps_.data(), sps_.size());
+    w.U8(1);
+    w.U16(pps_.size());
+    w.Bytes(pps_.data(), pps_.size());
+    w.End(avcc);
+
+    w.End(avc1);
+    w.End(stsd);
+}
+
+void FMP4Packager::BuildInitSegment(std::string &out) const
+{
+    BoxWriter w(out);
+
+    size_t ftyp = w.Begin("ftyp");
+    w.Bytes("isom", 4);
+    w.U32(0x200);
+    w.Bytes("isom", 4);
+    w.Bytes("iso6", 4);
+    w.Bytes("avc1", 4);
+    w.Bytes("mp41", 4);
+    w.End(ftyp);
+
+    size_t moov = w.Begin("moov");
+    {
+        size_t mvhd = w.BeginFull("mvhd", 0, 0);
+        w.U32(0);          //creation_time
+        w.U32(0);          //modification_time
+        w.U32(1000);       //timescale
+        w.U32(0);          //duration
+        w.U32(0x00010000); //rate
+        w.U16(0x0100);     //volume
+        w.Zero(10);
+        for (int i = 0; i < 9; i++)
+            w.U32(KMatrix[i]);
+        w.Zero(24);
+        w.U32(2); //next_track_ID
+        w.End(mvhd);
+
+        size_t trak = w.Begin("trak");
+        {
+            size_t tkhd = w.BeginFull("tkhd", 0, 0x3);
+            w.U32(0);
+            w.U32(0);
+            w.U32(1); //track_ID
+            w.U32(0);
+            w.U32(0); //duration
+            w.Zero(8);
+            w.U16(0); //layer
+            w.U16(0); //alternate_group
+            w.U16(0); //volume
+            w.U16(0);
+            for (int i = 0; i < 9; i++)
+                w.U32(KMatrix[i]);
+            w.U32(width_ << 16);
+            w.U32(height_ << 16);
+            w.End(tkhd);
+
+            size_t mdia = w.Begin("mdia");
+            {
+                size_t mdhd = w.BeginFull("mdhd", 0, 0);
+                w.U32(0);
+                w.U32(0);
+                w.U32(KTimeScale);
+                w.U32(0);
+                w.U16(0x55c4); //und
+                w.U16(0);
+                w.End(mdhd);
+
+                size_t hdlr = w.BeginFull("hdlr", 0, 0);
+                w.U32(0);
+                w.Bytes("vide", 4);
+                w.Zero(12);
+                w.Bytes("VideoHandler", 13);
+                w.End(hdlr);
+
+                size_t minf = w.Begin("minf");
+                {
+                    size_t vmhd = w.BeginFull("vmhd", 0, 1);
+                    w.Zero(8);
+                    w.End(vmhd);
+
+                    size_t dinf = w.Begin("dinf");
+                    size_t dref = w.BeginFull("dref", 0, 0);
+                    w.U32(1);
+                    size_t url = w.BeginFull("url ", 0, 1);
+                    w.End(url);
+                    w.End(dref);
+                    w.End(dinf);
+
+                    size_t stbl = w.Begin("stbl");
+                    {
+                        BuildSampleEntry(w);
+
+                        size_t stts = w.BeginFull("stts", 0, 0);
+                        w.U32(0);
+                        w.End(stts);
+
+                        size_t stsc = w.BeginFull("stsc", 0, 0);
+                        w.U32(0);
+                        w.End(stsc);
+
+                        size_t stsz = w.BeginFull("stsz", 0, 0);
+                        w.U32(0);
+                        w.U32(0);
+                        w.End(stsz);
+
+                        size_t stco = w.BeginFull("stco", 0, 0);
+                        w.U32(0);
+                        w.End(stco);
+                    }
+                    w.End(stbl);
+                }
+                w.End(minf);
+            }
+            w.End(mdia);
+        }
+        w.End(trak);
+
+        size_t mvex = w.Begin("mvex");
+        size_t trex = w.BeginFull("trex", 0, 0);
+        w.U32(1); //track_ID
+        w.U32(1); //default_sample_description_index
+        w.U32(0);
+        w.U32(0);
+        w.U32(0);
+        w.End(trex);
+        w.End(mvex);
+    }
+    w.End(moov);
+}
+
+void FMP4Packager::BuildFragmentHeader(const Sample *samples, uint32_t count, std::string &out)
+{
+    BoxWriter w(out);
+    size_t moof = w.Begin("moof");
+
+    size_t mfhd = w.BeginFull("mfhd", 0, 0);
+    w.U32(++sequence_);
+    w.End(mfhd);
+
+    size_t traf = w.Begin("traf");
+
+    size_t tfhd = w.BeginFull("tfhd", 0, 0x020000); //default-base-is-moof
+    w.U32(1);
+    w.End(tfhd);
+
+    size_t tfdt = w.BeginFull("tfdt", 1, 0);
+    w.U64(count ? samples[0].dts : 0);
+    w.End(tfdt);
+
+    //data-offset,sample-duration,sample-size,sample-flags
+    size_t trun = w.BeginFull("trun", 0, 0x000701);
+    w.U32(count);
+    size_t data_offset = w.Size();
+    w.U32(0);
+    uint64_t mdat_size = 8;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        w.U32(samples[i].duration);
+        w.U32(samples[i].len);
+        w.U32(samples[i].key ? 0x02000000 : 0x01010000);
+        mdat_size += samples[i].len;
+    }
+    w.End(trun);
+    w.End(traf);
+    w.End(moof);
+
+    w.Patch32(data_offset, static_cast<uint32_t>(w.Size() - moof + 8));
+
+    w.U32(static_cast<uint32_t>(mdat_size));
+    w.Bytes("mdat", 4);
+}
+
+void FMP4Packager::BuildFragment(const Sample *samples, uint32_t count, std::string &out)
+{
+    BuildFragmentHeader(samples, count, out);
+    for (uint32_t i = 0; i < count; i++)
+        out.append(reinterpret_cast<const char *>(samples[i].data), samples[i].len);
+}
+
+} // namespace nvr
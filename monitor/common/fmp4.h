@@ -0,0 +1,100 @@
+#ifndef FMP4_H_
+#define FMP4_H_
+
+#include <string>
+#include <vector>
+
+namespace nvr
+{
+
+//mp4 box序列化工具,所有字段按大端写入
+class BoxWriter
+{
+public:
+    explicit BoxWriter(std::string &out);
+
+    size_t Begin(const char *type);
+
+    size_t BeginFull(const char *type, uint8_t version, uint32_t flags);
+
+    void End(size_t pos);
+
+    void U8(uint8_t v);
+
+    void U16(uint16_t v);
+
+    void U24(uint32_t v);
+
+    void U32(uint32_t v);
+
+    void U64(uint64_t v);
+
+    void Bytes(const void *data, size_t len);
+
+    void Zero(size_t len);
+
+    void Patch32(size_t pos, uint32_t v);
+
+    size_t Size() const;
+
+private:
+    std::string &out_;
+};
+
+class FMP4Packager
+{
+public:
+    struct Sample
+    {
+        const uint8_t *data; //AVCC格式(4字节长度前缀)
+        uint32_t len;
+        uint64_t dts; //以timescale为单位
+        uint32_t duration;
+        bool key;
+    };
+
+    enum
+    {
+        KTimeScale = 90000
+    };
+
+    FMP4Packager();
+
+    void Initialize(int width, int height, int frame_rate);
+
+    //输入不带起始码的SPS/PPS,参数集发生变化时返回true
+    bool SetParameterSet(const uint8_t *nalu, uint32_t len);
+
+    bool Ready() const;
+
+    //MSE使用的codec字符串,如avc1.64001f
+    std::string Codec() const;
+
+    uint32_t SampleDuration() const;
+
+    //ftyp + moov
+    void BuildInitSegment(std::string &out) const;
+
+    //stsd(avc1/avcC),普通mp4的moov也使用
+    void BuildSampleEntry(BoxWriter &w) const;
+
+    //moof + mdat头部,调用者随后按顺序写入各sample数据
+    void BuildFragmentHeader(const Sample *samples, uint32_t count, std::string &out);
+
+    //moof + mdat
+    void BuildFragment(const Sample *samples, uint32_t count, std::string &out);
+
+    void Reset();
+
+private:
+    int width_;
+    int height_;
+    int frame_rate_;
+    uint32_t sequence_;
+    std::string sps_;
+    std::string pps_;
+};
+
+} // namespace nvr
+
+#endif
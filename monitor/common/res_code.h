@@ -11,7 +11,8 @@ enum err_code
     KVIChnError = 0x4,
     KThirdPartyError = 0x5,
     KUnInitialize = 0x6,
-    KSystemError = 0x7
+    KSystemError = 0x7,
+    KNotFound = 0x8
 };
 
 class NVRErrorCategory : public std::error_category
@@ -36,6 +37,8 @@ class NVRErrorCategory : public std::error_category
             return "not initialize";
         case err_code::KSystemError:
             return "system error";
+        case err_code::KNotFound:
+            return "not found";
         default:
             return "unknow";
         }
@@ -24,6 +24,10 @@ struct System
 
     static uint64_t GetSteadyMilliSeconds();
 
+    static uint64_t GetSteadyMicroSeconds();
+
+    static uint64_t GetRealMicroSeconds();
+
     static int32_t VIBindVPSS();
 
     static int32_t VIUnBindVPSS();
@@ -0,0 +1,29 @@
+#include "common/url.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+namespace nvr
+{
+
+bool ParseUrl(const std::string &url, std::string &host, int &port)
+{
+    size_t pos = url.find("://");
+    pos = (pos == std::string::npos) ? 0 : pos + 3;
+    size_t end = url.find_first_of("/?", pos);
+    std::string addr = url.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    size_t colon = addr.find(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 >= addr.size() || addr.size() - colon > 6)
+        return false;
+    for (size_t i = colon + 1; i < addr.size(); i++)
+    {
+        if (!isdigit(static_cast<unsigned char>(addr[i])))
+            return false;
+    }
+
+    host = addr.substr(0, colon);
+    port = atoi(addr.c_str() + colon + 1);
+    return port > 0 && port < 65536;
+}
+
+} // namespace nvr
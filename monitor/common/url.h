@@ -0,0 +1,14 @@
+#ifndef URL_H_
+#define URL_H_
+
+#include <string>
+
+namespace nvr
+{
+
+//解析scheme://host:port[/path][?query]中的地址和端口,scheme可以省略,host不能为空,端口为1-65535
+bool ParseUrl(const std::string &url, std::string &host, int &port);
+
+} // namespace nvr
+
+#endif
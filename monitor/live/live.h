@@ -17,6 +17,11 @@ public:
     struct Params
     {
         std::string url;
+        int32_t frame_rate;
+        int32_t width;
+        int32_t height;
+        std::string sdp_path; //rtp组播使用
+        int32_t ttl;          //rtp组播使用
     };
 
     virtual int32_t Initialize(const Params &params) = 0;
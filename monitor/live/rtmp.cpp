@@ -1,9 +1,12 @@
 #include "live/rtmp.h"
 #include "common/res_code.h"
 #include "live/rtmp_streamer.h"
+#include "common/system.h"
 
 #include <base/ref_counted_object.h>
 
+#define RTMP_STATS_INTERVAL 10000 //10s
+
 namespace nvr
 {
 
@@ -34,7 +37,9 @@ int32_t RtmpLiveImpl::Initialize(const Params &params)
         err_code code;
         RTMPStreamer rtmp_streamer;
         VideoFrame frame;
-        bool wait_sps;
+        uint64_t enqueue_time = 0;
+        uint64_t report_time = System::GetSteadyMilliSeconds();
+        bool wait_sps = true;
 
         bool init = false;
 
@@ -62,6 +67,7 @@ int32_t RtmpLiveImpl::Initialize(const Params &params)
                 std::unique_lock<std::mutex> lock(mux_);
                 if (buffer_.Get((uint8_t *)&frame, sizeof(frame)))
                 {
+                    buffer_.Get((uint8_t *)&enqueue_time, sizeof(enqueue_time));
                     memcpy(temp_buf, buffer_.GetCurrentPos(), frame.len);
                     frame.data = temp_buf;
                     if (!buffer_.Consume(frame.len))
@@ -75,6 +81,11 @@ int32_t RtmpLiveImpl::Initialize(const Params &params)
                     cond_.wait(lock);
                     continue;
                 }
+                else
+                {
+                    //关闭时没有取到帧,不能再发送上一帧
+                    break;
+                }
             }
 
             if (frame.type == H264Frame::NaluType::SPS)
@@ -88,8 +99,34 @@ int32_t RtmpLiveImpl::Initialize(const Params &params)
                     log_w("rtmp connection break,try to reconnect...");
                     rtmp_streamer.Close();
                     init = false;
+                    std::unique_lock<std::mutex> lock(stats_mux_);
+                    stats_.reconnects++;
+                    report_.reconnects++;
+                }
+                else
+                {
+                    UpdateStats(frame, enqueue_time);
                 }
             }
+            else
+            {
+                drops_++;
+                report_drops_++;
+            }
+
+            if (System::GetSteadyMilliSeconds() - report_time >= RTMP_STATS_INTERVAL)
+            {
+                uint64_t elapsed = System::GetSteadyMilliSeconds() - report_time;
+                Stats stats = TakeStats(report_, report_drops_);
+                log_i("rtmp stats: %.1f nalu/s,%llu kbps,latency avg %llu us max %llu us,drops %llu,reconnects %llu",
+                      stats.frames * 1000.0 / elapsed,
+                      (unsigned long long)(stats.bytes * 8 / elapsed),
+                      (unsigned long long)(stats.frames ? stats.latency_sum_us / stats.frames : 0),
+                      (unsigned long long)stats.latency_max_us,
+                      (unsigned long long)stats.drops,
+                      (unsigned long long)stats.reconnects);
+                report_time += elapsed;
+            }
         }
 
         rtmp_streamer.Close();
@@ -107,17 +144,50 @@ void RtmpLiveImpl::OnFrame(const VideoFrame &frame)
 
     mux_.lock();
 
-    if (buffer_.FreeSpace() < sizeof(frame) + frame.len)
+    if (buffer_.FreeSpace() < sizeof(frame) + sizeof(uint64_t) + frame.len)
     {
         mux_.unlock();
+        drops_++;
+        report_drops_++;
         return;
     }
+    uint64_t enqueue_time = System::GetSteadyMicroSeconds();
     buffer_.Append((uint8_t *)&frame, sizeof(frame));
+    buffer_.Append((uint8_t *)&enqueue_time, sizeof(enqueue_time));
     buffer_.Append(frame.data, frame.len);
     cond_.notify_one();
     mux_.unlock();
 }
 
+void RtmpLiveImpl::UpdateStats(const VideoFrame &frame, uint64_t enqueue_time)
+{
+    uint64_t latency = System::GetSteadyMicroSeconds() - enqueue_time;
+
+    std::unique_lock<std::mutex> lock(stats_mux_);
+    for (Stats *stats : {&stats_, &report_})
+    {
+        stats->frames++;
+        stats->bytes += frame.len;
+        stats->latency_sum_us += latency;
+        if (latency > stats->latency_max_us)
+            stats->latency_max_us = latency;
+    }
+}
+
+RtmpLiveImpl::Stats RtmpLiveImpl::TakeStats()
+{
+    return TakeStats(stats_, drops_);
+}
+
+RtmpLiveImpl::Stats RtmpLiveImpl::TakeStats(Stats &stats, std::atomic<uint64_t> &drops)
+{
+    std::unique_lock<std::mutex> lock(stats_mux_);
+    Stats result = stats;
+    result.drops = drops.exchange(0);
+    memset(&stats, 0, sizeof(stats));
+    return result;
+}
+
 void RtmpLiveImpl::Close()
 {
     if (!init_)
@@ -132,10 +202,14 @@ void RtmpLiveImpl::Close()
     init_ = false;
 }
 
-RtmpLiveImpl::RtmpLiveImpl() : run_(false),
+RtmpLiveImpl::RtmpLiveImpl() : drops_(0),
+                               report_drops_(0),
+                               run_(false),
                                thread_(nullptr),
                                init_(false)
 {
+    memset(&stats_, 0, sizeof(stats_));
+    memset(&report_, 0, sizeof(report_));
 }
 
 RtmpLiveImpl::~RtmpLiveImpl()
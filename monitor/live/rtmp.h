@@ -8,6 +8,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 
 namespace nvr
 {
@@ -22,13 +23,36 @@ public:
 
     void OnFrame(const VideoFrame &frame) override;
 
+    struct Stats
+    {
+        uint64_t frames;         //发送成功的NALU数
+        uint64_t bytes;          //发送成功的字节数
+        uint64_t latency_sum_us; //入队到发送完成的耗时总和
+        uint64_t latency_max_us;
+        uint64_t drops;     //缓存满或等待SPS丢弃的NALU数
+        uint64_t reconnects;
+    };
+
+    //获取并清零统计数据,与定时日志分开计数,调用方读取不受日志影响
+    Stats TakeStats();
+
 protected:
     RtmpLiveImpl();
 
     ~RtmpLiveImpl() override;
 
+private:
+    void UpdateStats(const VideoFrame &frame, uint64_t enqueue_time);
+
+    Stats TakeStats(Stats &stats, std::atomic<uint64_t> &drops);
+
 private:
     Buffer<> buffer_;
+    std::mutex stats_mux_;
+    Stats stats_;  //TakeStats读取
+    Stats report_; //定时日志读取,与TakeStats互不清零
+    std::atomic<uint64_t> drops_;
+    std::atomic<uint64_t> report_drops_;
     std::mutex mux_;
     std::condition_variable cond_;
     bool run_;
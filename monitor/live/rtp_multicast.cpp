@@ -0,0 +1,379 @@
+#include "live/rtp_multicast.h"
+#include "common/res_code.h"
+#include "common/system.h"
+#include "common/base64.h"
+#include "common/url.h"
+
+#include <fstream>
+
+#include <base/ref_counted_object.h>
+
+#define RTP_HEADER_SIZE 12
+#define RTP_MTU 1400 //RTP负载最大长度
+#define RTP_PACKET_SIZE (RTP_HEADER_SIZE + RTP_MTU)
+#define RTP_MAX_PACKETS (BUFFER_LEN / (RTP_MTU - 2) + 1)
+#define RTP_PAYLOAD_TYPE 96
+#define RTP_PACING_RATIO 0.8    //在帧间隔的80%内发送完一帧
+#define RTP_PACING_STEP_US 1000 //每次休眠至少1ms,小于该值时合并为一组发送
+
+namespace nvr
+{
+
+rtc::scoped_refptr<LiveModule> RtpLiveImpl::Create(const Params &params)
+{
+    err_code code;
+
+    rtc::scoped_refptr<RtpLiveImpl> implemention = new rtc::RefCountedObject<RtpLiveImpl>();
+
+    code = static_cast<err_code>(implemention->Initialize(params));
+
+    if (KSuccess != code)
+    {
+        log_e("error:%s", make_error_code(code).message().c_str());
+        return nullptr;
+    }
+
+    return implemention;
+}
+
+int32_t RtpLiveImpl::OpenSocket(const std::string &url)
+{
+    if (!ParseUrl(url, group_, port_))
+    {
+        log_e("invalid rtp url %s", url.c_str());
+        return static_cast<int>(KSystemError);
+    }
+
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0)
+    {
+        log_e("socket failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = inet_addr(group_.c_str());
+
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr)))
+    {
+        unsigned char ttl = params_.ttl > 0 ? params_.ttl : 1;
+        unsigned char loop = 1;
+        setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+        //rtp://group:port?iface=本地地址,指定发送组播的网卡,默认按路由表选择
+        size_t iface = url.find("?iface=");
+        if (iface != std::string::npos)
+        {
+            in_addr local;
+            local.s_addr = inet_addr(url.c_str() + iface + 7);
+            if (setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) != 0)
+                log_w("set multicast interface %s failed,%s", url.c_str() + iface + 7, strerror(errno));
+        }
+    }
+
+    int sndbuf = 256 * 1024;
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    if (connect(fd_, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        log_e("connect %s:%d failed,%s", group_.c_str(), port_, strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return static_cast<int>(KSystemError);
+    }
+
+    log_i("rtp live send to %s:%d", group_.c_str(), port_);
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RtpLiveImpl::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+
+    params_ = params;
+    if (params_.frame_rate <= 0)
+        params_.frame_rate = 25;
+
+    code = static_cast<err_code>(OpenSocket(params.url));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    packets_ = (uint8_t *)malloc(RTP_MAX_PACKETS * RTP_PACKET_SIZE);
+    if (!packets_)
+    {
+        log_e("malloc packet buffer failed");
+        close(fd_);
+        fd_ = -1;
+        return static_cast<int>(KSystemError);
+    }
+    packet_lens_.resize(RTP_MAX_PACKETS);
+
+    uint64_t seed = System::GetSteadyMicroSeconds() ^ (static_cast<uint64_t>(getpid()) << 16);
+    ssrc_ = static_cast<uint32_t>(seed * 2654435761u);
+    ts_offset_ = static_cast<uint32_t>((seed >> 7) * 40503u);
+    seq_ = static_cast<uint16_t>(seed >> 3);
+
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
+        VideoFrame frame;
+        uint64_t frame_interval = 1000000 / params_.frame_rate;
+
+        uint8_t *temp_buf = (uint8_t *)malloc(BUFFER_LEN);
+        if (!temp_buf)
+        {
+            log_e("malloc buffer failed");
+            return;
+        }
+
+        while (run_)
+        {
+            bool backlog;
+            {
+                std::unique_lock<std::mutex> lock(mux_);
+                if (buffer_.Get((uint8_t *)&frame, sizeof(frame)))
+                {
+                    memcpy(temp_buf, buffer_.GetCurrentPos(), frame.len);
+                    frame.data = temp_buf;
+                    if (!buffer_.Consume(frame.len))
+                    {
+                        log_e("consme data from buffer failed,rest data not enough");
+                        return;
+                    }
+                    backlog = buffer_.Size() > 0;
+                }
+                else if (run_)
+                {
+                    cond_.wait(lock);
+                    continue;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            if (frame.len <= 4)
+                continue;
+
+            const uint8_t *nalu = frame.data + 4;
+            uint32_t nalu_len = frame.len - 4;
+            bool slice = false;
+
+            switch (frame.type)
+            {
+            case H264Frame::NaluType::SPS:
+                if (sps_.size() != nalu_len || memcmp(sps_.data(), nalu, nalu_len) != 0)
+                {
+                    sps_.assign(reinterpret_cast<const char *>(nalu), nalu_len);
+                    WriteSDP();
+                }
+                break;
+            case H264Frame::NaluType::PPS:
+                if (pps_.size() != nalu_len || memcmp(pps_.data(), nalu, nalu_len) != 0)
+                {
+                    pps_.assign(reinterpret_cast<const char *>(nalu), nalu_len);
+                    WriteSDP();
+                }
+                break;
+            case H264Frame::NaluType::ISLICE:
+            case H264Frame::NaluType::PSLICE:
+                slice = true;
+                break;
+            default:
+                break;
+            }
+
+            uint32_t timestamp = ts_offset_ + static_cast<uint32_t>(frame.ts * 9 / 100); //us -> 90kHz
+            uint32_t num = Packetize(nalu, nalu_len, timestamp, slice);
+
+            //积压时不再平滑发送,尽快追上
+            SendPackets(0, num, (slice && !backlog) ? frame_interval * RTP_PACING_RATIO : 0);
+        }
+
+        free(temp_buf);
+    }));
+
+    init_ = true;
+    return static_cast<int>(KSuccess);
+}
+
+uint32_t RtpLiveImpl::Packetize(const uint8_t *nalu, uint32_t len, uint32_t timestamp, bool marker)
+{
+    uint32_t num = 0;
+    uint32_t offset = 0;
+    uint8_t nalu_header = nalu[0];
+    bool fragmented = len > RTP_MTU;
+
+    if (fragmented)
+        offset = 1; //FU-A不携带原始NALU头
+
+    while (offset < len && num < RTP_MAX_PACKETS)
+    {
+        uint8_t *pkt = packets_ + num * RTP_PACKET_SIZE;
+        uint32_t payload = fragmented ? RTP_MTU - 2 : len;
+        if (payload > len - offset)
+            payload = len - offset;
+        bool last = offset + payload >= len;
+
+        pkt[0] = 0x80;
+        pkt[1] = ((marker && last) ? 0x80 : 0x00) | RTP_PAYLOAD_TYPE;
+        pkt[2] = (seq_ >> 8) & 0xff;
+        pkt[3] = seq_ & 0xff;
+        pkt[4] = (timestamp >> 24) & 0xff;
+        pkt[5] = (timestamp >> 16) & 0xff;
+        pkt[6] = (timestamp >> 8) & 0xff;
+        pkt[7] = timestamp & 0xff;
+        pkt[8] = (ssrc_ >> 24) & 0xff;
+        pkt[9] = (ssrc_ >> 16) & 0xff;
+        pkt[10] = (ssrc_ >> 8) & 0xff;
+        pkt[11] = ssrc_ & 0xff;
+        seq_++;
+
+        uint8_t *p = pkt + RTP_HEADER_SIZE;
+        if (fragmented)
+        {
+            *p++ = (nalu_header & 0xe0) | 28; //FU indicator
+            *p++ = (offset == 1 ? 0x80 : 0x00) | (last ? 0x40 : 0x00) | (nalu_header & 0x1f);
+        }
+        memcpy(p, nalu + offset, payload);
+
+        packet_lens_[num] = (p - pkt) + payload;
+        offset += payload;
+        num++;
+    }
+
+    return num;
+}
+
+void RtpLiveImpl::SendPackets(uint32_t begin, uint32_t end, uint64_t window_us)
+{
+    uint32_t count = end - begin;
+    uint64_t spacing = count > 1 ? window_us / count : 0;
+    uint32_t burst = 1;
+    if (spacing > 0 && spacing < RTP_PACING_STEP_US)
+        burst = (RTP_PACING_STEP_US + spacing - 1) / spacing;
+    uint64_t start = System::GetSteadyMicroSeconds();
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        uint32_t n = i - begin;
+        if (spacing > 0 && n > 0 && n % burst == 0)
+        {
+            uint64_t deadline = start + n * spacing;
+            uint64_t now = System::GetSteadyMicroSeconds();
+            if (deadline > now)
+                usleep(deadline - now);
+        }
+
+        if (send(fd_, packets_ + i * RTP_PACKET_SIZE, packet_lens_[i], 0) < 0)
+        {
+            if (drops_++ % 100 == 0)
+                log_w("rtp send failed,%s,drops %u", strerror(errno), drops_);
+        }
+    }
+}
+
+void RtpLiveImpl::WriteSDP()
+{
+    if (params_.sdp_path.empty() || sps_.size() < 4 || pps_.empty())
+        return;
+
+    char profile_level_id[8];
+    snprintf(profile_level_id, sizeof(profile_level_id), "%02x%02x%02x",
+             static_cast<uint8_t>(sps_[1]), static_cast<uint8_t>(sps_[2]), static_cast<uint8_t>(sps_[3]));
+
+    std::string tmp = params_.sdp_path + ".tmp";
+    {
+        std::ofstream ofs(tmp.c_str(), std::ios::trunc);
+        if (!ofs.is_open())
+        {
+            log_e("open sdp file %s failed", tmp.c_str());
+            return;
+        }
+
+        ofs << "v=0\r\n"
+            << "o=- " << ssrc_ << " 1 IN IP4 0.0.0.0\r\n"
+            << "s=hisi_monitor\r\n"
+            << "c=IN IP4 " << group_ << "/" << (params_.ttl > 0 ? params_.ttl : 1) << "\r\n"
+            << "t=0 0\r\n"
+            << "m=video " << port_ << " RTP/AVP " << RTP_PAYLOAD_TYPE << "\r\n"
+            << "a=rtpmap:" << RTP_PAYLOAD_TYPE << " H264/90000\r\n"
+            << "a=fmtp:" << RTP_PAYLOAD_TYPE << " packetization-mode=1;profile-level-id=" << profile_level_id
+            << ";sprop-parameter-sets="
+            << Base64Encode(reinterpret_cast<const uint8_t *>(sps_.data()), sps_.size()) << ","
+            << Base64Encode(reinterpret_cast<const uint8_t *>(pps_.data()), pps_.size()) << "\r\n"
+            << "a=framerate:" << params_.frame_rate << "\r\n";
+    }
+
+    if (rename(tmp.c_str(), params_.sdp_path.c_str()) != 0)
+    {
+        log_e("rename sdp file failed,%s", strerror(errno));
+        return;
+    }
+    log_i("write sdp file %s", params_.sdp_path.c_str());
+}
+
+void RtpLiveImpl::OnFrame(const VideoFrame &frame)
+{
+    if (!init_)
+        return;
+
+    mux_.lock();
+    if (buffer_.FreeSpace() < sizeof(frame) + frame.len)
+    {
+        mux_.unlock();
+        return;
+    }
+    buffer_.Append((uint8_t *)&frame, sizeof(frame));
+    buffer_.Append(frame.data, frame.len);
+    cond_.notify_one();
+    mux_.unlock();
+}
+
+void RtpLiveImpl::Close()
+{
+    if (!init_)
+        return;
+
+    run_ = false;
+    cond_.notify_all();
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+
+    close(fd_);
+    fd_ = -1;
+    free(packets_);
+    packets_ = nullptr;
+    packet_lens_.clear();
+    sps_.clear();
+    pps_.clear();
+    buffer_.Clear();
+    init_ = false;
+}
+
+RtpLiveImpl::RtpLiveImpl() : fd_(-1),
+                             port_(0),
+                             seq_(0),
+                             ssrc_(0),
+                             ts_offset_(0),
+                             packets_(nullptr),
+                             drops_(0),
+                             run_(false),
+                             thread_(nullptr),
+                             init_(false)
+{
+}
+
+RtpLiveImpl::~RtpLiveImpl()
+{
+    Close();
+}
+}; // namespace nvr
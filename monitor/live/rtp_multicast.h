@@ -0,0 +1,64 @@
+#ifndef RTP_MULTICAST_H_
+#define RTP_MULTICAST_H_
+
+#include "live/live.h"
+#include "common/buffer.h"
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace nvr
+{
+//RFC6184打包一次,发送到组播组,观看者数量不影响上行负载
+class RtpLiveImpl : public LiveModule
+{
+public:
+    static rtc::scoped_refptr<LiveModule> Create(const Params &params);
+
+    int32_t Initialize(const Params &params) override;
+
+    void Close() override;
+
+    void OnFrame(const VideoFrame &frame) override;
+
+protected:
+    RtpLiveImpl();
+
+    ~RtpLiveImpl() override;
+
+private:
+    int32_t OpenSocket(const std::string &url);
+
+    //打包一个NALU(不含起始码),返回打包后的包数
+    uint32_t Packetize(const uint8_t *nalu, uint32_t len, uint32_t timestamp, bool marker);
+
+    void SendPackets(uint32_t begin, uint32_t end, uint64_t window_us);
+
+    void WriteSDP();
+
+private:
+    Buffer<> buffer_;
+    std::mutex mux_;
+    std::condition_variable cond_;
+    Params params_;
+    int fd_;
+    std::string group_;
+    int port_;
+    uint16_t seq_;
+    uint32_t ssrc_;
+    uint32_t ts_offset_;
+    std::string sps_;
+    std::string pps_;
+    uint8_t *packets_;
+    std::vector<uint32_t> packet_lens_;
+    uint32_t drops_;
+    bool run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,789 @@
+#include "live/websocket.h"
+#include "common/res_code.h"
+#include "common/base64.h"
+#include "common/url.h"
+
+#include <poll.h>
+
+#include <base/ref_counted_object.h>
+
+#define WS_MAX_CLIENTS 8
+#define WS_MAX_REQUEST_SIZE 4096
+#define WS_MAX_CLIENT_QUEUE_BYTES (2 * 1024 * 1024) //2MB
+#define WS_MAX_GOP_CACHE_BYTES (4 * 1024 * 1024)    //4MB
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+namespace nvr
+{
+
+static const char *KPlayerPage =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>monitor</title></head>"
+    "<body style=\"margin:0;background:#000\"><video id=\"v\" autoplay muted style=\"width:100%\"></video><script>"
+    "var v=document.getElementById('v'),ms=new MediaSource(),sb=null,q=[],codec=null;"
+    "v.src=URL.createObjectURL(ms);"
+    "function feed(){if(sb&&!sb.updating&&q.length)sb.appendBuffer(q.shift());}"
+    "function open(){if(sb||!codec||ms.readyState!='open')return;"
+    "sb=ms.addSourceBuffer('video/mp4; codecs=\"'+codec+'\"');sb.mode='sequence';"
+    "sb.addEventListener('updateend',function(){var b=v.buffered;"
+    "if(b.length&&b.end(b.length-1)-v.currentTime>1)v.currentTime=b.end(b.length-1)-0.2;feed();});feed();}"
+    "ms.addEventListener('sourceopen',open);"
+    "var ws=new WebSocket('ws://'+location.host+'/live');ws.binaryType='arraybuffer';"
+    "ws.onmessage=function(e){if(typeof e.data=='string'){codec=JSON.parse(e.data).codec;open();}"
+    "else{q.push(e.data);feed();}};"
+    "</script></body></html>";
+
+static inline uint32_t Rol(uint32_t v, int bits)
+{
+    return (v << bits) | (v >> (32 - bits));
+}
+
+static void SHA1(const uint8_t *data, size_t len, uint8_t digest[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg(reinterpret_cast<const char *>(data), len);
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56)
+        msg.push_back('\0');
+    uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (int i = 7; i >= 0; i--)
+        msg.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64)
+    {
+        uint32_t w[80];
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(msg.data()) + chunk;
+        for (int i = 0; i < 16; i++)
+            w[i] = (p[i * 4] << 24) | (p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+        for (int i = 16; i < 80; i++)
+            w[i] = Rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = Rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = Rol(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        digest[i * 4] = (h[i] >> 24) & 0xff;
+        digest[i * 4 + 1] = (h[i] >> 16) & 0xff;
+        digest[i * 4 + 2] = (h[i] >> 8) & 0xff;
+        digest[i * 4 + 3] = h[i] & 0xff;
+    }
+}
+
+static std::string GetHeader(const std::string &request, const std::string &name)
+{
+    size_t pos = 0;
+    while ((pos = request.find("\r\n", pos)) != std::string::npos)
+    {
+        pos += 2;
+        if (strncasecmp(request.c_str() + pos, name.c_str(), name.size()) == 0 &&
+            request[pos + name.size()] == ':')
+        {
+            size_t begin = request.find_first_not_of(' ', pos + name.size() + 1);
+            size_t end = request.find("\r\n", pos);
+            if (begin == std::string::npos || end == std::string::npos || begin > end)
+                return "";
+            return request.substr(begin, end - begin);
+        }
+    }
+    return "";
+}
+
+static void SetNonBlock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+rtc::scoped_refptr<LiveModule> WebSocketLiveImpl::Create(const Params &params)
+{
+    err_code code;
+
+    rtc::scoped_refptr<WebSocketLiveImpl> implemention = new rtc::RefCountedObject<WebSocketLiveImpl>();
+
+    code = static_cast<err_code>(implemention->Initialize(params));
+
+    if (KSuccess != code)
+    {
+        log_e("error:%s", make_error_code(code).message().c_str());
+        return nullptr;
+    }
+
+    return implemention;
+}
+
+int32_t WebSocketLiveImpl::Listen(const std::string &url)
+{
+    std::string host;
+    int port;
+    if (!ParseUrl(url, host, port))
+    {
+        log_e("invalid websocket url %s", url.c_str());
+        return static_cast<int>(KSystemError);
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+    {
+        log_e("socket failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = host.empty() ? htonl(INADDR_ANY) : inet_addr(host.c_str());
+
+    if (bind(listen_fd_, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        log_e("bind %s:%d failed,%s", host.c_str(), port, strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    if (listen(listen_fd_, WS_MAX_CLIENTS) != 0)
+    {
+        log_e("listen failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    SetNonBlock(listen_fd_);
+
+    if (pipe(wake_fd_) != 0)
+    {
+        log_e("pipe failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    SetNonBlock(wake_fd_[0]);
+    SetNonBlock(wake_fd_[1]);
+
+    log_i("websocket live listen on %s:%d", host.c_str(), port);
+    return static_cast<int>(KSuccess);
+}
+
+int32_t WebSocketLiveImpl::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+
+    params_ = params;
+    code = static_cast<err_code>(Listen(params.url));
+    if (KSuccess != code)
+    {
+        if (listen_fd_ >= 0)
+            close(listen_fd_);
+        listen_fd_ = -1;
+        return static_cast<int>(code);
+    }
+
+    packager_.Initialize(params.width, params.height, params.frame_rate);
+
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
+        Loop();
+    }));
+
+    init_ = true;
+    return static_cast<int>(KSuccess);
+}
+
+WebSocketLiveImpl::Message WebSocketLiveImpl::MakeMessage(uint8_t opcode, const std::string &header, const uint8_t *data, uint32_t len)
+{
+    uint64_t payload_len = header.size() + len;
+
+    std::string *msg = new std::string;
+    msg->reserve(payload_len + 10);
+    msg->push_back(static_cast<char>(0x80 | opcode));
+    if (payload_len < 126)
+    {
+        msg->push_back(static_cast<char>(payload_len));
+    }
+    else if (payload_len < 65536)
+    {
+        msg->push_back(126);
+        msg->push_back(static_cast<char>((payload_len >> 8) & 0xff));
+        msg->push_back(static_cast<char>(payload_len & 0xff));
+    }
+    else
+    {
+        msg->push_back(127);
+        for (int i = 7; i >= 0; i--)
+            msg->push_back(static_cast<char>((payload_len >> (i * 8)) & 0xff));
+    }
+    msg->append(header);
+    if (len)
+        msg->append(reinterpret_cast<const char *>(data), len);
+
+    return Message(msg);
+}
+
+void WebSocketLiveImpl::Loop()
+{
+    VideoFrame frame;
+    std::vector<pollfd> fds;
+    std::vector<std::list<Client>::iterator> polled;
+
+    uint8_t *temp_buf = (uint8_t *)malloc(BUFFER_LEN);
+    if (!temp_buf)
+    {
+        log_e("malloc buffer failed");
+        return;
+    }
+
+    while (run_)
+    {
+        fds.clear();
+        polled.clear();
+
+        pollfd pfd;
+        pfd.fd = listen_fd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        fds.push_back(pfd);
+        pfd.fd = wake_fd_[0];
+        fds.push_back(pfd);
+        for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it)
+        {
+            pfd.fd = it->fd;
+            pfd.events = POLLIN;
+            if (!it->queue.empty())
+                pfd.events |= POLLOUT;
+            fds.push_back(pfd);
+            polled.push_back(it);
+        }
+
+        int ret = poll(&fds[0], fds.size(), 500); //500ms
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            log_e("poll failed,%s", strerror(errno));
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            char drain[64];
+            while (read(wake_fd_[0], drain, sizeof(drain)) > 0)
+                ;
+
+            while (run_)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mux_);
+                    if (!buffer_.Get((uint8_t *)&frame, sizeof(frame)))
+                        break;
+                    memcpy(temp_buf, buffer_.GetCurrentPos(), frame.len);
+                    frame.data = temp_buf;
+                    if (!buffer_.Consume(frame.len))
+                    {
+                        log_e("consme data from buffer failed,rest data not enough");
+                        free(temp_buf);
+                        return;
+                    }
+                }
+                HandleFrame(frame);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+            AcceptClient();
+
+        for (size_t i = 0; i < polled.size(); i++)
+        {
+            Client &client = *polled[i];
+            short revents = fds[i + 2].revents;
+            if (client.closed)
+                continue;
+            if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                client.closed = true;
+            if (!client.closed && (revents & POLLIN))
+                ReadClient(client);
+            if (!client.closed && (revents & POLLOUT))
+                WriteClient(client);
+        }
+
+        for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end();)
+        {
+            if (it->closed)
+            {
+                log_i("websocket client %d disconnected", it->fd);
+                close(it->fd);
+                it = clients_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it)
+        close(it->fd);
+    clients_.clear();
+    free(temp_buf);
+}
+
+void WebSocketLiveImpl::HandleFrame(VideoFrame &frame)
+{
+    if (frame.len <= 4)
+        return;
+
+    uint8_t *nalu = frame.data + 4;
+    uint32_t nalu_len = frame.len - 4;
+
+    switch (frame.type)
+    {
+    case H264Frame::NaluType::SPS:
+    case H264Frame::NaluType::PPS:
+    {
+        if (!packager_.SetParameterSet(nalu, nalu_len) || !packager_.Ready())
+            return;
+
+        std::string init;
+        packager_.BuildInitSegment(init);
+        std::string codec = "{\"codec\":\"" + packager_.Codec() + "\"}";
+        codec_msg_ = MakeMessage(0x1, codec, nullptr, 0);
+        init_msg_ = MakeMessage(0x2, init, nullptr, 0);
+
+        gop_cache_.clear();
+        gop_cache_bytes_ = 0;
+        gop_cache_valid_ = false;
+
+        //参数集变化,所有客户端重新从初始化分片开始
+        for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it)
+        {
+            if (!it->upgraded || it->closed)
+                continue;
+            Enqueue(*it, codec_msg_);
+            Enqueue(*it, init_msg_);
+            it->wait_key = true;
+        }
+        break;
+    }
+    case H264Frame::NaluType::ISLICE:
+    case H264Frame::NaluType::PSLICE:
+    {
+        if (!packager_.Ready())
+            return;
+
+        bool key = frame.type == H264Frame::NaluType::ISLICE;
+        if (!has_base_ts_)
+        {
+            if (!key)
+                return;
+            base_ts_ = frame.ts;
+            has_base_ts_ = true;
+        }
+
+        frame.data[0] = (nalu_len >> 24) & 0xff;
+        frame.data[1] = (nalu_len >> 16) & 0xff;
+        frame.data[2] = (nalu_len >> 8) & 0xff;
+        frame.data[3] = nalu_len & 0xff;
+
+        FMP4Packager::Sample sample;
+        sample.data = frame.data;
+        sample.len = frame.len;
+        sample.dts = (frame.ts - base_ts_) * FMP4Packager::KTimeScale / 1000000;
+        sample.duration = packager_.SampleDuration();
+        sample.key = key;
+
+        std::string header;
+        packager_.BuildFragmentHeader(&sample, 1, header);
+        Message msg = MakeMessage(0x2, header, sample.data, sample.len);
+
+        if (key)
+        {
+            gop_cache_.clear();
+            gop_cache_bytes_ = 0;
+            gop_cache_valid_ = true;
+        }
+        if (gop_cache_valid_)
+        {
+            if (gop_cache_bytes_ + msg->size() > WS_MAX_GOP_CACHE_BYTES)
+            {
+                gop_cache_.clear();
+                gop_cache_bytes_ = 0;
+                gop_cache_valid_ = false;
+            }
+            else
+            {
+                gop_cache_.push_back(msg);
+                gop_cache_bytes_ += msg->size();
+            }
+        }
+
+        Broadcast(msg, key);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void WebSocketLiveImpl::Broadcast(const Message &msg, bool key)
+{
+    for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it)
+    {
+        Client &client = *it;
+        if (!client.upgraded || client.closed)
+            continue;
+
+        if (client.queued_bytes > WS_MAX_CLIENT_QUEUE_BYTES)
+        {
+            log_w("websocket client %d too slow,drop %u bytes", client.fd, static_cast<uint32_t>(client.queued_bytes));
+            DropPending(client);
+            client.wait_key = true;
+        }
+
+        if (client.wait_key)
+        {
+            if (!key)
+                continue;
+            client.wait_key = false;
+        }
+
+        Enqueue(client, msg);
+        WriteClient(client);
+    }
+}
+
+void WebSocketLiveImpl::Enqueue(Client &client, const Message &msg)
+{
+    client.queue.push_back(msg);
+    client.queued_bytes += msg->size();
+}
+
+void WebSocketLiveImpl::DropPending(Client &client)
+{
+    //正在发送的消息必须发完,否则websocket帧会错乱
+    Message sending;
+    if (client.offset > 0 && !client.queue.empty())
+        sending = client.queue.front();
+
+    client.queue.clear();
+    client.queued_bytes = 0;
+    if (sending)
+    {
+        client.queue.push_back(sending);
+        client.queued_bytes = sending->size() - client.offset;
+    }
+}
+
+void WebSocketLiveImpl::AcceptClient()
+{
+    while (true)
+    {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                log_e("accept failed,%s", strerror(errno));
+            return;
+        }
+
+        if (clients_.size() >= WS_MAX_CLIENTS)
+        {
+            log_w("too many websocket clients,reject");
+            close(fd);
+            continue;
+        }
+
+        SetNonBlock(fd);
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        Client client;
+        client.fd = fd;
+        client.upgraded = false;
+        client.wait_key = true;
+        client.close_after_write = false;
+        client.closed = false;
+        client.offset = 0;
+        client.queued_bytes = 0;
+        clients_.push_back(client);
+        log_i("websocket client %d connected", fd);
+    }
+}
+
+void WebSocketLiveImpl::ReadClient(Client &client)
+{
+    char buf[1024];
+    while (true)
+    {
+        ssize_t ret = recv(client.fd, buf, sizeof(buf), 0);
+        if (ret == 0)
+        {
+            client.closed = true;
+            return;
+        }
+        if (ret < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                client.closed = true;
+            break;
+        }
+        client.recv_buf.append(buf, ret);
+        if (client.recv_buf.size() > WS_MAX_REQUEST_SIZE)
+        {
+            log_w("websocket client %d request too large", client.fd);
+            client.closed = true;
+            return;
+        }
+    }
+
+    if (client.upgraded)
+        HandleWebSocketData(client);
+    else
+        HandleRequest(client);
+}
+
+void WebSocketLiveImpl::HandleRequest(Client &client)
+{
+    if (client.close_after_write || client.recv_buf.find("\r\n\r\n") == std::string::npos)
+        return;
+
+    std::string request;
+    request.swap(client.recv_buf);
+
+    std::string key = GetHeader(request, "Sec-WebSocket-Key");
+    if (strncasecmp(GetHeader(request, "Upgrade").c_str(), "websocket", 9) == 0 && !key.empty())
+    {
+        std::string accept = key + WS_GUID;
+        uint8_t digest[20];
+        SHA1(reinterpret_cast<const uint8_t *>(accept.data()), accept.size(), digest);
+
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                               "Upgrade: websocket\r\n"
+                               "Connection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " +
+                               Base64Encode(digest, sizeof(digest)) + "\r\n\r\n";
+        Enqueue(client, Message(new std::string(response)));
+        client.upgraded = true;
+        JoinStream(client);
+        WriteClient(client);
+        return;
+    }
+
+    std::string response;
+    if (request.compare(0, 6, "GET / ") == 0 || request.compare(0, 16, "GET /index.html ") == 0)
+    {
+        char head[128];
+        snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                 static_cast<uint32_t>(strlen(KPlayerPage)));
+        response = std::string(head) + KPlayerPage;
+    }
+    else
+    {
+        response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    Enqueue(client, Message(new std::string(response)));
+    client.close_after_write = true;
+    WriteClient(client);
+}
+
+void WebSocketLiveImpl::HandleWebSocketData(Client &client)
+{
+    std::string &buf = client.recv_buf;
+    while (buf.size() >= 2)
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(buf.data());
+        uint8_t opcode = p[0] & 0x0f;
+        bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7f;
+        size_t pos = 2;
+
+        if (len == 126)
+        {
+            if (buf.size() < 4)
+                return;
+            len = (p[2] << 8) | p[3];
+            pos = 4;
+        }
+        else if (len == 127)
+        {
+            //客户端不会发送大数据
+            client.closed = true;
+            return;
+        }
+
+        uint8_t mask[4] = {0, 0, 0, 0};
+        if (masked)
+        {
+            if (buf.size() < pos + 4)
+                return;
+            memcpy(mask, p + pos, 4);
+            pos += 4;
+        }
+
+        if (buf.size() < pos + len)
+            return;
+
+        std::string payload = buf.substr(pos, len);
+        for (size_t i = 0; i < payload.size(); i++)
+            payload[i] ^= mask[i % 4];
+        buf.erase(0, pos + len);
+
+        if (opcode == 0x8)
+        {
+            client.closed = true;
+            return;
+        }
+        else if (opcode == 0x9)
+        {
+            Enqueue(client, MakeMessage(0xA, payload, nullptr, 0));
+            WriteClient(client);
+        }
+    }
+}
+
+void WebSocketLiveImpl::JoinStream(Client &client)
+{
+    client.wait_key = true;
+    if (!codec_msg_ || !init_msg_)
+        return;
+
+    Enqueue(client, codec_msg_);
+    Enqueue(client, init_msg_);
+
+    //新加入的客户端从缓存的关键帧开始播放
+    if (gop_cache_valid_ && !gop_cache_.empty())
+    {
+        for (size_t i = 0; i < gop_cache_.size(); i++)
+            Enqueue(client, gop_cache_[i]);
+        client.wait_key = false;
+    }
+}
+
+void WebSocketLiveImpl::WriteClient(Client &client)
+{
+    while (!client.queue.empty())
+    {
+        const Message &msg = client.queue.front();
+        ssize_t ret = send(client.fd, msg->data() + client.offset, msg->size() - client.offset, MSG_NOSIGNAL);
+        if (ret < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                client.closed = true;
+            return;
+        }
+
+        client.offset += ret;
+        client.queued_bytes -= ret;
+        if (client.offset < msg->size())
+            return;
+
+        client.offset = 0;
+        client.queue.pop_front();
+    }
+
+    if (client.close_after_write)
+        client.closed = true;
+}
+
+void WebSocketLiveImpl::OnFrame(const VideoFrame &frame)
+{
+    if (!init_)
+        return;
+
+    mux_.lock();
+    if (buffer_.FreeSpace() < sizeof(frame) + frame.len)
+    {
+        mux_.unlock();
+        return;
+    }
+    buffer_.Append((uint8_t *)&frame, sizeof(frame));
+    buffer_.Append(frame.data, frame.len);
+    mux_.unlock();
+
+    char c = 0;
+    write(wake_fd_[1], &c, 1);
+}
+
+void WebSocketLiveImpl::Close()
+{
+    if (!init_)
+        return;
+
+    run_ = false;
+    char c = 0;
+    write(wake_fd_[1], &c, 1);
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+
+    close(listen_fd_);
+    close(wake_fd_[0]);
+    close(wake_fd_[1]);
+    listen_fd_ = -1;
+    wake_fd_[0] = -1;
+    wake_fd_[1] = -1;
+
+    buffer_.Clear();
+    packager_.Reset();
+    has_base_ts_ = false;
+    codec_msg_.reset();
+    init_msg_.reset();
+    gop_cache_.clear();
+    gop_cache_bytes_ = 0;
+    gop_cache_valid_ = false;
+    init_ = false;
+}
+
+WebSocketLiveImpl::WebSocketLiveImpl() : listen_fd_(-1),
+                                         has_base_ts_(false),
+                                         base_ts_(0),
+                                         gop_cache_bytes_(0),
+                                         gop_cache_valid_(false),
+                                         run_(false),
+                                         thread_(nullptr),
+                                         init_(false)
+{
+    wake_fd_[0] = -1;
+    wake_fd_[1] = -1;
+}
+
+WebSocketLiveImpl::~WebSocketLiveImpl()
+{
+    Close();
+}
+}; // namespace nvr
@@ -0,0 +1,97 @@
+#ifndef WEBSOCKET_H_
+#define WEBSOCKET_H_
+
+#include "live/live.h"
+#include "common/buffer.h"
+#include "common/fmp4.h"
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <list>
+#include <deque>
+#include <vector>
+
+namespace nvr
+{
+//通过websocket推送fmp4分片,浏览器端使用MSE直接播放
+class WebSocketLiveImpl : public LiveModule
+{
+public:
+    static rtc::scoped_refptr<LiveModule> Create(const Params &params);
+
+    int32_t Initialize(const Params &params) override;
+
+    void Close() override;
+
+    void OnFrame(const VideoFrame &frame) override;
+
+protected:
+    WebSocketLiveImpl();
+
+    ~WebSocketLiveImpl() override;
+
+private:
+    typedef std::shared_ptr<const std::string> Message;
+
+    struct Client
+    {
+        int fd;
+        bool upgraded;
+        bool wait_key;
+        bool close_after_write;
+        bool closed;
+        std::string recv_buf;
+        std::deque<Message> queue;
+        size_t offset;
+        size_t queued_bytes;
+    };
+
+    int32_t Listen(const std::string &url);
+
+    void Loop();
+
+    void HandleFrame(VideoFrame &frame);
+
+    void Broadcast(const Message &msg, bool key);
+
+    void Enqueue(Client &client, const Message &msg);
+
+    void DropPending(Client &client);
+
+    void AcceptClient();
+
+    void ReadClient(Client &client);
+
+    void WriteClient(Client &client);
+
+    void HandleRequest(Client &client);
+
+    void HandleWebSocketData(Client &client);
+
+    void JoinStream(Client &client);
+
+    static Message MakeMessage(uint8_t opcode, const std::string &header, const uint8_t *data, uint32_t len);
+
+private:
+    Buffer<> buffer_;
+    std::mutex mux_;
+    Params params_;
+    int listen_fd_;
+    int wake_fd_[2];
+    FMP4Packager packager_;
+    bool has_base_ts_;
+    uint64_t base_ts_;
+    Message codec_msg_;
+    Message init_msg_;
+    std::vector<Message> gop_cache_;
+    size_t gop_cache_bytes_;
+    bool gop_cache_valid_;
+    std::list<Client> clients_;
+    bool run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -4,9 +4,13 @@
 #include "video_capture/video_capture_impl.h"
 #include "video_process/video_process_impl.h"
 #include "video_detect/video_detect_impl.h"
+#include "video_detect/software_detect.h"
 #include "video_codec/video_codec_impl.h"
 #include "live/rtmp.h"
+#include "live/websocket.h"
+#include "live/rtp_multicast.h"
 #include "record/mp4_record.h"
+#include "playback/http_playback.h"
 
 using namespace nvr;
 
@@ -81,7 +85,10 @@ int main(int argc, char **argv)
 
     rtc::scoped_refptr<VideoProcessModule> video_process_module = VideoProcessImpl::Create({Config::Instance()->video.frame_rate,
                                                                                             Config::Instance()->video.width,
-                                                                                            Config::Instance()->video.height});
+                                                                                            Config::Instance()->video.height,
+                                                                                            Config::Instance()->detect.idle_frame_rate > 0 ? Config::Instance()->detect.idle_frame_rate : Config::Instance()->detect.frame_rate,
+                                                                                            Config::Instance()->detect.width,
+                                                                                            Config::Instance()->detect.height});
     NVR_CHECK(NULL != video_process_module)
 
     log_i("binding video capture and video process...");
@@ -90,11 +97,39 @@ int main(int argc, char **argv)
 
     //初始化运动侦测模块
     log_i("initializing video detect...");
-    rtc::scoped_refptr<VideoDetectModule> video_detect_module = VideoDetectImpl::Create({Config::Instance()->detect.trigger_thresh});
-    NVR_CHECK(NULL != video_process_module)
+    VideoDetectModule::Params detect_params = {Config::Instance()->detect.trigger_thresh,
+                                               Config::Instance()->detect.width,
+                                               Config::Instance()->detect.height,
+                                               Config::Instance()->detect.sad_thresh,
+                                               Config::Instance()->detect.block_size,
+                                               Config::Instance()->detect.area_thresh,
+                                               {},
+                                               Config::Instance()->detect.idle_frame_rate,
+                                               Config::Instance()->detect.active_frame_rate,
+                                               Config::Instance()->detect.active_hold,
+                                               Config::Instance()->detect.min_area,
+                                               Config::Instance()->detect.confirm_frames,
+                                               Config::Instance()->detect.confirm_window,
+                                               Config::Instance()->detect.cooldown,
+                                               Config::Instance()->detect.tamper,
+                                               Config::Instance()->detect.tamper_hold,
+                                               Config::Instance()->detect.tamper_covered,
+                                               Config::Instance()->detect.tamper_defocus,
+                                               Config::Instance()->detect.tamper_moved,
+                                               Config::Instance()->detect.illum_compensate,
+                                               Config::Instance()->detect.illum_ratio};
+    for (const Config::Detect::Zone &zone : Config::Instance()->detect.zones)
+        detect_params.zones.push_back({zone.name, zone.exclude, zone.points, zone.trigger_thresh});
+    rtc::scoped_refptr<VideoDetectModule> video_detect_module;
+    if ("software" == Config::Instance()->detect.engine)
+        video_detect_module = SoftwareVideoDetectImpl::Create(detect_params);
+    else
+        video_detect_module = VideoDetectImpl::Create(detect_params);
+    NVR_CHECK(NULL != video_detect_module)
 
     log_i("attach video detect to video process...");
     video_process_module->SetVideoSink(video_detect_module);
+    video_detect_module->SetRateControl(video_process_module);
 
     //初始化视频编码模块
     log_i("initializing video encode...");
@@ -112,12 +147,45 @@ int main(int argc, char **argv)
 
     // 初始化直播
     log_i("initializing live...");
-    rtc::scoped_refptr<LiveModule> live_module = RtmpLiveImpl::Create({Config::Instance()->rtmp.url});
+    rtc::scoped_refptr<LiveModule> live_module = RtmpLiveImpl::Create({Config::Instance()->rtmp.url,
+                                                                       Config::Instance()->video.frame_rate,
+                                                                       Config::Instance()->video.width,
+                                                                       Config::Instance()->video.height});
     NVR_CHECK(NULL != live_module);
 
     log_i("attach live to video encode...");
     video_codec_module->AddVideoSink(live_module);
 
+    rtc::scoped_refptr<LiveModule> ws_live_module;
+    if (Config::Instance()->websocket.enable)
+    {
+        log_i("initializing websocket live...");
+        ws_live_module = WebSocketLiveImpl::Create({Config::Instance()->websocket.url,
+                                                    Config::Instance()->video.frame_rate,
+                                                    Config::Instance()->video.width,
+                                                    Config::Instance()->video.height});
+        NVR_CHECK(NULL != ws_live_module);
+
+        log_i("attach websocket live to video encode...");
+        video_codec_module->AddVideoSink(ws_live_module);
+    }
+
+    rtc::scoped_refptr<LiveModule> rtp_live_module;
+    if (Config::Instance()->rtp.enable)
+    {
+        log_i("initializing rtp live...");
+        rtp_live_module = RtpLiveImpl::Create({Config::Instance()->rtp.url,
+                                               Config::Instance()->video.frame_rate,
+                                               Config::Instance()->video.width,
+                                               Config::Instance()->video.height,
+                                               Config::Instance()->rtp.sdp_path,
+                                               Config::Instance()->rtp.ttl});
+        NVR_CHECK(NULL != rtp_live_module);
+
+        log_i("attach rtp live to video encode...");
+        video_codec_module->AddVideoSink(rtp_live_module);
+    }
+
     log_i("initializing record...");
     rtc::scoped_refptr<RecordModule> record_module = MP4RecordImpl::Create({Config::Instance()->video.frame_rate,
                                                                             Config::Instance()->video.width,
@@ -125,7 +193,18 @@ int main(int argc, char **argv)
                                                                             Config::Instance()->record.path,
                                                                             Config::Instance()->record.segment_duration,
                                                                             Config::Instance()->record.use_md,
-                                                                            Config::Instance()->record.md_duration});
+                                                                            Config::Instance()->record.md_duration,
+                                                                            Config::Instance()->record.format,
+                                                                            Config::Instance()->record.pre_record,
+                                                                            Config::Instance()->record.pre_record_size,
+                                                                            Config::Instance()->record.chunk_size,
+                                                                            Config::Instance()->record.prealloc_size,
+                                                                            Config::Instance()->record.sync_interval,
+                                                                            Config::Instance()->record.align_size,
+                                                                            Config::Instance()->record.quota,
+                                                                            Config::Instance()->record.high_water,
+                                                                            Config::Instance()->record.low_water,
+                                                                            Config::Instance()->record.event_keep});
     NVR_CHECK(NULL != record_module);
 
     log_i("attach record to video encode...");
@@ -134,11 +213,28 @@ int main(int argc, char **argv)
     log_i("attact record to video detect...");
     video_detect_module->AddListener(record_module);
 
+    rtc::scoped_refptr<PlaybackModule> playback_module;
+    if (Config::Instance()->playback.enable)
+    {
+        log_i("initializing playback...");
+        playback_module = HttpPlaybackImpl::Create({Config::Instance()->playback.url,
+                                                    Config::Instance()->record.path,
+                                                    Config::Instance()->playback.rate_limit,
+                                                    Config::Instance()->playback.token});
+        NVR_CHECK(NULL != playback_module);
+    }
+
     while (KRun)
         sleep(1000);
 
+    if (playback_module)
+    {
+        log_i("closing playback...");
+        playback_module->Close();
+    }
+
     log_i("detch record and video detect...");
-    video_detect_module->AddListener(nullptr);
+    video_detect_module->RemoveListener(record_module);
 
     log_i("detch live/record and video encode...");
     video_codec_module->ClearVideoSink();
@@ -149,6 +245,18 @@ int main(int argc, char **argv)
     log_i("closing live...");
     live_module->Close();
 
+    if (ws_live_module)
+    {
+        log_i("closing websocket live...");
+        ws_live_module->Close();
+    }
+
+    if (rtp_live_module)
+    {
+        log_i("closing rtp live...");
+        rtp_live_module->Close();
+    }
+
     log_i("unbinding video process and video encode...");
     System::VPSSUnBindVENC();
 
@@ -156,6 +264,7 @@ int main(int argc, char **argv)
     video_codec_module->Close();
 
     log_i("detach video detect and video process...");
+    video_detect_module->SetRateControl(nullptr);
     video_process_module->SetVideoSink(nullptr);
 
     log_i("closing video detect...");
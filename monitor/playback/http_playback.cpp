@@ -0,0 +1,886 @@
+#include "playback/http_playback.h"
+#include "record/record_index.h"
+#include "record/event_index.h"
+#include "record/clip_export.h"
+#include "common/res_code.h"
+#include "common/system.h"
+#include "common/url.h"
+
+#include <ctype.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <base/ref_counted_object.h>
+
+#define PLAYBACK_MAX_CLIENTS 4
+#define PLAYBACK_MAX_REQUEST_SIZE 4096
+#define PLAYBACK_SEND_CHUNK (64 * 1024)
+#define PLAYBACK_SEND_TIMEOUT 10      //s
+#define PLAYBACK_MAX_DURATION 7200    //单次拼接的最大时长(s)
+#define PLAYBACK_MAX_BOX (1024 * 1024) //moof/emsg/moov的最大长度
+#define PLAYBACK_NICE 10
+#define PLAYBACK_EXPORT_TEMP "/.playback_XXXXXX" //裸码流录像封装的临时文件,在录像根目录下,隐藏文件不进入索引
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+namespace nvr
+{
+
+static std::string GetHeader(const std::string &request, const std::string &name)
+{
+    size_t pos = 0;
+    while ((pos = request.find("\r\n", pos)) != std::string::npos)
+    {
+        pos += 2;
+        if (strncasecmp(request.c_str() + pos, name.c_str(), name.size()) == 0 &&
+            request[pos + name.size()] == ':')
+        {
+            size_t begin = request.find_first_not_of(' ', pos + name.size() + 1);
+            size_t end = request.find("\r\n", pos);
+            if (begin == std::string::npos || end == std::string::npos || begin > end)
+                return "";
+            return request.substr(begin, end - begin);
+        }
+    }
+    return "";
+}
+
+static std::string GetQuery(const std::string &query, const std::string &name)
+{
+    size_t pos = 0;
+    while (pos < query.size())
+    {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos)
+            end = query.size();
+        if (query.compare(pos, name.size(), name) == 0 && query[pos + name.size()] == '=')
+            return query.substr(pos + name.size() + 1, end - pos - name.size() - 1);
+        pos = end + 1;
+    }
+    return "";
+}
+
+//逐字节比较全部长度,耗时与匹配位置无关
+static bool SafeEqual(const std::string &a, const std::string &b)
+{
+    if (a.size() != b.size())
+        return false;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        diff |= static_cast<uint8_t>(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+static bool HasSuffix(const std::string &str, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return str.size() > len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+//录像文件的相对路径:每一级都不能为空或以'.'开头(..,隐藏的预打开文件和索引),只允许录像后缀
+static bool IsRecordPath(const std::string &relative)
+{
+    size_t pos = 0;
+    while (pos <= relative.size())
+    {
+        size_t end = relative.find('/', pos);
+        if (end == std::string::npos)
+            end = relative.size();
+        if (end == pos || relative[pos] == '.')
+            return false;
+        pos = end + 1;
+    }
+    return HasSuffix(relative, ".mp4") || HasSuffix(relative, RECORD_ES_SUFFIX);
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t Read64(const uint8_t *p)
+{
+    return (static_cast<uint64_t>(Read32(p)) << 32) | Read32(p + 4);
+}
+
+static void Write32(uint8_t *p, uint32_t v)
+{
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static void Write64(uint8_t *p, uint64_t v)
+{
+    Write32(p, v >> 32);
+    Write32(p + 4, v & 0xffffffff);
+}
+
+//读取顶层box头,返回box长度,0表示读取失败或文件尾写了一半
+static uint64_t ReadBox(int fd, uint64_t pos, uint64_t file_size, char type[4])
+{
+    uint8_t head[16];
+    if (pos + 8 > file_size || pread(fd, head, sizeof(head), pos) < 8)
+        return 0;
+    uint64_t size = Read32(head);
+    if (size == 1)
+        size = Read64(&head[8]);
+    else if (size == 0)
+        size = file_size - pos;
+    if (size < 8 || pos + size > file_size)
+        return 0;
+    memcpy(type, &head[4], 4);
+    return size;
+}
+
+//修改moof的序号和解码时间,使多个文件的分片在同一时间轴上连续,返回原始解码时间
+static bool PatchFragment(std::string &moof, uint32_t sequence, int64_t shift, uint64_t &dts)
+{
+    uint8_t *data = reinterpret_cast<uint8_t *>(&moof[0]);
+    size_t size = moof.size();
+    bool found = false;
+    for (size_t i = 8; i + 8 <= size;)
+    {
+        uint32_t box = Read32(&data[i]);
+        if (box < 8 || i + box > size)
+            return false;
+        if (memcmp(&data[i + 4], "mfhd", 4) == 0 && box >= 16)
+            Write32(&data[i + 12], sequence);
+        else if (memcmp(&data[i + 4], "traf", 4) == 0)
+        {
+            for (size_t j = i + 8; j + 8 <= i + box;)
+            {
+                uint32_t sub = Read32(&data[j]);
+                if (sub < 8 || j + sub > i + box)
+                    return false;
+                if (memcmp(&data[j + 4], "tfdt", 4) == 0)
+                {
+                    if (data[j + 8] == 1 && sub >= 20)
+                    {
+                        dts = Read64(&data[j + 12]);
+                        Write64(&data[j + 12], dts + shift);
+                        found = true;
+                    }
+                    else if (sub >= 16)
+                    {
+                        dts = Read32(&data[j + 12]);
+                        Write32(&data[j + 12], static_cast<uint32_t>(dts + shift));
+                        found = true;
+                    }
+                }
+                j += sub;
+            }
+        }
+        i += box;
+    }
+    return found;
+}
+
+HttpPlaybackImpl::Response::~Response()
+{
+    for (int fd : fds)
+        close(fd);
+}
+
+void HttpPlaybackImpl::Response::AddData(const std::string &data)
+{
+    Part part;
+    part.data = data;
+    part.fd = -1;
+    part.offset = 0;
+    part.len = data.size();
+    parts.push_back(part);
+    size += part.len;
+}
+
+void HttpPlaybackImpl::Response::AddFile(int fd, uint64_t offset, uint64_t len)
+{
+    //相邻的文件区间合并,减少sendfile调用
+    if (!parts.empty() && parts.back().fd == fd && parts.back().offset + parts.back().len == offset)
+    {
+        parts.back().len += len;
+        size += len;
+        return;
+    }
+
+    Part part;
+    part.fd = fd;
+    part.offset = offset;
+    part.len = len;
+    parts.push_back(part);
+    size += len;
+}
+
+rtc::scoped_refptr<PlaybackModule> HttpPlaybackImpl::Create(const Params &params)
+{
+    err_code code;
+
+    rtc::scoped_refptr<HttpPlaybackImpl> implemention = new rtc::RefCountedObject<HttpPlaybackImpl>();
+
+    code = static_cast<err_code>(implemention->Initialize(params));
+
+    if (KSuccess != code)
+    {
+        log_e("error:%s", make_error_code(code).message().c_str());
+        return nullptr;
+    }
+
+    return implemention;
+}
+
+int32_t HttpPlaybackImpl::Listen(const std::string &url)
+{
+    std::string host;
+    int port;
+    if (!ParseUrl(url, host, port))
+    {
+        log_e("invalid playback url %s", url.c_str());
+        return static_cast<int>(KSystemError);
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+    {
+        log_e("socket failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = host.empty() ? htonl(INADDR_ANY) : inet_addr(host.c_str());
+
+    if (bind(listen_fd_, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        log_e("bind %s:%d failed,%s", host.c_str(), port, strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    if (listen(listen_fd_, PLAYBACK_MAX_CLIENTS) != 0)
+    {
+        log_e("listen failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    log_i("playback listen on %s:%d", host.c_str(), port);
+    return static_cast<int>(KSuccess);
+}
+
+int32_t HttpPlaybackImpl::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+
+    params_ = params;
+    if (params_.token.empty())
+        log_w("playback token is empty,requests are not authenticated");
+    code = static_cast<err_code>(Listen(params.url));
+    if (KSuccess != code)
+    {
+        if (listen_fd_ >= 0)
+            close(listen_fd_);
+        listen_fd_ = -1;
+        return static_cast<int>(code);
+    }
+
+    tokens_ = 0;
+    refill_time_ = System::GetSteadyMicroSeconds();
+
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
+        Loop();
+    }));
+
+    init_ = true;
+    return static_cast<int>(KSuccess);
+}
+
+void HttpPlaybackImpl::Loop()
+{
+    while (run_)
+    {
+        pollfd pfd;
+        pfd.fd = listen_fd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, 500); //500ms
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            log_e("poll failed,%s", strerror(errno));
+            break;
+        }
+        if (ret == 0)
+            continue;
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+
+        std::unique_lock<std::mutex> lock(mux_);
+        if (clients_.size() >= PLAYBACK_MAX_CLIENTS)
+        {
+            lock.unlock();
+            SendError(fd, 503, "Service Unavailable");
+            close(fd);
+            continue;
+        }
+        clients_.insert(fd);
+        lock.unlock();
+
+        //每个客户端一个线程,阻塞发送,退出时由Close等待全部结束
+        std::thread([this, fd]() {
+            HandleClient(fd);
+
+            std::unique_lock<std::mutex> lock(mux_);
+            clients_.erase(fd);
+            close(fd);
+            cond_.notify_all();
+        }).detach();
+    }
+}
+
+void HttpPlaybackImpl::HandleClient(int fd)
+{
+    //回放读盘让位于录像写盘:idle io优先级,降低调度优先级
+    pid_t tid = syscall(SYS_gettid);
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+        log_w("ioprio_set failed,%s", strerror(errno));
+    setpriority(PRIO_PROCESS, tid, PLAYBACK_NICE);
+
+    timeval timeout;
+    timeout.tv_sec = PLAYBACK_SEND_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buf[1024];
+    while (run_ && request.find("\r\n\r\n") == std::string::npos)
+    {
+        ssize_t ret = recv(fd, buf, sizeof(buf), 0);
+        if (ret <= 0)
+            return;
+        request.append(buf, ret);
+        if (request.size() > PLAYBACK_MAX_REQUEST_SIZE)
+        {
+            SendError(fd, 431, "Request Header Fields Too Large");
+            return;
+        }
+    }
+
+    if (run_)
+        HandleRequest(fd, request);
+}
+
+void HttpPlaybackImpl::HandleRequest(int fd, const std::string &request)
+{
+    //GET /list?begin=&end=      录像列表(json),时间为unix时间(s)
+    //GET /events?begin=&end=    移动侦测事件(json)
+    //GET /record/<day>/<file>   录像文件,支持Range,裸码流录像封装为fmp4
+    //GET /range?begin=&end=     拼接时间段内的fmp4录像,支持Range,包含裸码流录像时整段导出为fmp4
+    size_t method_end = request.find(' ');
+    size_t target_end = request.find(' ', method_end + 1);
+    if (method_end == std::string::npos || target_end == std::string::npos)
+    {
+        SendError(fd, 400, "Bad Request");
+        return;
+    }
+
+    std::string method = request.substr(0, method_end);
+    std::string target = request.substr(method_end + 1, target_end - method_end - 1);
+    if (method != "GET")
+    {
+        SendError(fd, 405, "Method Not Allowed");
+        return;
+    }
+
+    size_t mark = target.find('?');
+    std::string uri = target.substr(0, mark);
+    std::string query = mark == std::string::npos ? "" : target.substr(mark + 1);
+
+    //配置了令牌时,查询参数token或Authorization: Bearer二选一
+    if (!params_.token.empty())
+    {
+        std::string token = GetQuery(query, "token");
+        std::string auth = GetHeader(request, "Authorization");
+        if (token.empty() && auth.compare(0, 7, "Bearer ") == 0)
+            token = auth.substr(7);
+        if (!SafeEqual(token, params_.token))
+        {
+            SendError(fd, 401, "Unauthorized");
+            return;
+        }
+    }
+
+    uint64_t begin = strtoull(GetQuery(query, "begin").c_str(), nullptr, 10) * 1000000;
+    uint64_t end = strtoull(GetQuery(query, "end").c_str(), nullptr, 10) * 1000000;
+
+    err_code code;
+    Response response;
+    if (uri == "/list")
+    {
+        code = static_cast<err_code>(BuildList(begin, end, response));
+    }
+    else if (uri == "/events")
+    {
+        code = static_cast<err_code>(BuildEvents(begin, end, response));
+    }
+    else if (uri.compare(0, 8, "/record/") == 0)
+    {
+        code = static_cast<err_code>(BuildFile(uri.substr(8), response));
+    }
+    else if (uri == "/range")
+    {
+        if (begin == 0 || end <= begin || end - begin > static_cast<uint64_t>(PLAYBACK_MAX_DURATION) * 1000000)
+        {
+            SendError(fd, 400, "Bad Request");
+            return;
+        }
+        code = static_cast<err_code>(BuildRange(begin, end, response));
+    }
+    else
+    {
+        code = KNotFound;
+    }
+
+    if (KNotFound == code)
+    {
+        SendError(fd, 404, "Not Found");
+        return;
+    }
+    if (KSuccess != code)
+    {
+        SendError(fd, 500, "Internal Server Error");
+        return;
+    }
+
+    std::string range = GetHeader(request, "Range");
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+    bool ok = SendResponse(fd, response, range);
+    //不记录查询参数,避免令牌写入日志
+    log_d("playback %s %s,%llu bytes,%llu ms", uri.c_str(), ok ? "done" : "aborted",
+          (unsigned long long)response.size, (unsigned long long)(System::GetSteadyMilliSeconds() - start_time));
+}
+
+int32_t HttpPlaybackImpl::BuildList(uint64_t begin, uint64_t end, Response &response)
+{
+    std::vector<RecordIndex::Segment> segments;
+    if (end == 0)
+        end = UINT64_MAX;
+    RecordIndex::List(params_.path, begin, end, segments);
+
+    std::ostringstream oss;
+    oss << '[';
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (i)
+            oss << ',';
+        oss << "{\"path\":\"/record/" << segments[i].path << "\",\"start\":" << segments[i].start / 1000
+            << ",\"end\":" << segments[i].end / 1000 << ",\"event\":" << (segments[i].event ? "true" : "false") << '}';
+    }
+    oss << ']';
+
+    response.type = "application/json";
+    response.AddData(oss.str());
+    return static_cast<int>(KSuccess);
+}
+
+int32_t HttpPlaybackImpl::BuildEvents(uint64_t begin, uint64_t end, Response &response)
+{
+    std::vector<EventIndex::Event> events;
+    if (end == 0)
+        end = System::GetRealMicroSeconds();
+    EventIndex::Query(params_.path, begin, end, events);
+
+    std::ostringstream oss;
+    oss << '[';
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const EventIndex::Event &event = events[i];
+        if (i)
+            oss << ',';
+        oss << "{\"time\":" << event.time / 1000 << ",\"num\":" << event.num << ",\"width\":" << event.width
+            << ",\"height\":" << event.height << ",\"rects\":[";
+        for (int j = 0; j < event.count && j < RECORD_EVENT_MAX_RECTS; j++)
+        {
+            if (j)
+                oss << ',';
+            oss << '[' << event.rects[j].left << ',' << event.rects[j].top << ','
+                << event.rects[j].right << ',' << event.rects[j].bottom << ']';
+        }
+        oss << "]}";
+    }
+    oss << ']';
+
+    response.type = "application/json";
+    response.AddData(oss.str());
+    return static_cast<int>(KSuccess);
+}
+
+int32_t HttpPlaybackImpl::BuildFile(const std::string &relative, Response &response)
+{
+    //只允许访问录像根目录下的录像文件
+    if (!IsRecordPath(relative))
+        return static_cast<int>(KNotFound);
+
+    std::string filename = params_.path + '/' + relative;
+    if (HasSuffix(relative, RECORD_ES_SUFFIX))
+        return BuildExport(filename, 0, 0, response);
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return static_cast<int>(KNotFound);
+    response.fds.push_back(fd);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return static_cast<int>(KNotFound);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    response.type = "video/mp4";
+    response.AddFile(fd, 0, st.st_size);
+    return static_cast<int>(KSuccess);
+}
+
+int32_t HttpPlaybackImpl::BuildRange(uint64_t begin, uint64_t end, Response &response)
+{
+    std::vector<RecordIndex::Segment> segments;
+    RecordIndex::List(params_.path, begin, end, segments);
+
+    RecordIndex::Result first;
+    if (segments.empty() || KSuccess != RecordIndex::Lookup(params_.path, begin, first))
+        return static_cast<int>(KNotFound);
+
+    //裸码流录像没有分片可以直接拼接
+    for (const RecordIndex::Segment &segment : segments)
+    {
+        if (HasSuffix(segment.path, RECORD_ES_SUFFIX))
+            return BuildExport("", begin, end, response);
+    }
+
+    //以第一个GOP为时间零点,各文件的tfdt加上文件起始时间的差值
+    uint64_t base_time = first.time;
+    std::string init;
+    uint32_t sequence = 0;
+    bool done = false;
+    for (size_t i = 0; i < segments.size() && !done; i++)
+    {
+        const RecordIndex::Segment &segment = segments[i];
+        std::string filename = params_.path + '/' + segment.path;
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        response.fds.push_back(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        struct stat st;
+        fstat(fd, &st);
+        uint64_t file_size = st.st_size;
+
+        //ftyp + moov
+        char type[4];
+        uint64_t pos = 0, size;
+        while ((size = ReadBox(fd, pos, file_size, type)) != 0 &&
+               memcmp(type, "moof", 4) != 0 && memcmp(type, "emsg", 4) != 0)
+            pos += size;
+        if (pos == 0 || pos > PLAYBACK_MAX_BOX)
+        {
+            log_w("playback skip %s,not fragmented mp4", filename.c_str());
+            continue;
+        }
+
+        std::string header(pos, '\0');
+        if (pread(fd, &header[0], pos, 0) != static_cast<ssize_t>(pos))
+            continue;
+        if (init.empty())
+        {
+            init = header;
+            response.AddData(init);
+        }
+        else if (header != init)
+        {
+            //编码参数变化后无法共用一个初始化分片,在此截断
+            log_w("playback stop at %s,codec changed", filename.c_str());
+            break;
+        }
+
+        if (filename == first.path && first.offset > pos)
+            pos = first.offset;
+
+        int64_t shift = (static_cast<int64_t>(segment.start) - static_cast<int64_t>(base_time)) * 90000 / 1000000;
+        while ((size = ReadBox(fd, pos, file_size, type)) != 0)
+        {
+            if (memcmp(type, "mdat", 4) == 0)
+            {
+                response.AddFile(fd, pos, size);
+            }
+            else if ((memcmp(type, "moof", 4) == 0 || memcmp(type, "emsg", 4) == 0) && size <= PLAYBACK_MAX_BOX)
+            {
+                std::string box(size, '\0');
+                if (pread(fd, &box[0], size, pos) != static_cast<ssize_t>(size))
+                    break;
+
+                if (memcmp(type, "moof", 4) == 0)
+                {
+                    uint64_t dts = 0;
+                    if (!PatchFragment(box, sequence + 1, shift, dts))
+                        break;
+                    //第一个分片之前的时间在Lookup中已经跳过
+                    uint64_t time = segment.start + dts * 1000000 / 90000;
+                    if (time > end)
+                    {
+                        done = true;
+                        break;
+                    }
+                    sequence++;
+                }
+                else if (box.size() >= 24 && box[8] == 1)
+                {
+                    uint8_t *data = reinterpret_cast<uint8_t *>(&box[0]);
+                    Write64(&data[16], Read64(&data[16]) + shift); //presentation_time
+                }
+                response.AddData(box);
+            }
+            pos += size;
+        }
+    }
+
+    if (sequence == 0)
+        return static_cast<int>(KNotFound);
+
+    response.type = "video/mp4";
+    return static_cast<int>(KSuccess);
+}
+
+int32_t HttpPlaybackImpl::BuildExport(const std::string &input, uint64_t begin, uint64_t end, Response &response)
+{
+    //导出到临时文件后打开并删除,响应发送完关闭文件时释放空间
+    std::string temp = params_.path + PLAYBACK_EXPORT_TEMP;
+    int fd = mkstemp(&temp[0]);
+    if (fd < 0)
+    {
+        log_e("create %s failed,%s", temp.c_str(), strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    close(fd);
+
+    err_code code;
+    ClipExporter::Result result;
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+    if (input.empty())
+        code = static_cast<err_code>(ClipExporter::Export({params_.path, begin, end, temp, "fmp4"}, result));
+    else
+        code = static_cast<err_code>(ClipExporter::ExportFile(input, temp, "fmp4", result));
+    if (KSuccess != code)
+    {
+        unlink(temp.c_str());
+        return static_cast<int>(KNotFound == code ? KNotFound : KSystemError);
+    }
+
+    fd = open(temp.c_str(), O_RDONLY);
+    unlink(temp.c_str());
+    if (fd < 0)
+        return static_cast<int>(KSystemError);
+    response.fds.push_back(fd);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return static_cast<int>(KSystemError);
+    log_d("playback export %u frames,%llu ms", result.frames, (unsigned long long)(System::GetSteadyMilliSeconds() - start_time));
+
+    response.type = "video/mp4";
+    response.AddFile(fd, 0, st.st_size);
+    return static_cast<int>(KSuccess);
+}
+
+bool HttpPlaybackImpl::SendResponse(int fd, const Response &response, const std::string &range)
+{
+    //bytes=first-last / bytes=first- / bytes=-suffix
+    uint64_t first = 0, last = response.size ? response.size - 1 : 0;
+    bool partial = false;
+    if (!range.empty() && range.compare(0, 6, "bytes=") == 0 && response.size > 0)
+    {
+        const char *spec = range.c_str() + 6;
+        char *next;
+        if (*spec == '-')
+        {
+            uint64_t suffix = strtoull(spec + 1, nullptr, 10);
+            first = suffix >= response.size ? 0 : response.size - suffix;
+        }
+        else
+        {
+            first = strtoull(spec, &next, 10);
+            if (*next == '-' && isdigit(next[1]))
+                last = std::min(last, static_cast<uint64_t>(strtoull(next + 1, nullptr, 10)));
+        }
+        if (first > last)
+        {
+            std::ostringstream oss;
+            oss << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" << response.size
+                << "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            std::string header = oss.str();
+            SendData(fd, header.data(), header.size());
+            return false;
+        }
+        partial = true;
+    }
+
+    uint64_t length = response.size ? last - first + 1 : 0;
+    std::ostringstream oss;
+    oss << (partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n")
+        << "Content-Type: " << response.type << "\r\n"
+        << "Content-Length: " << length << "\r\n"
+        << "Accept-Ranges: bytes\r\n"
+        << "Access-Control-Allow-Origin: *\r\n"
+        << "Connection: close\r\n";
+    if (partial)
+        oss << "Content-Range: bytes " << first << '-' << last << '/' << response.size << "\r\n";
+    oss << "\r\n";
+    std::string header = oss.str();
+    if (!SendData(fd, header.data(), header.size()))
+        return false;
+
+    //逐个发送与请求区间相交的部分
+    uint64_t pos = 0;
+    for (const Part &part : response.parts)
+    {
+        if (length == 0)
+            break;
+        if (pos + part.len <= first)
+        {
+            pos += part.len;
+            continue;
+        }
+
+        uint64_t skip = first > pos ? first - pos : 0;
+        uint64_t len = std::min(part.len - skip, length);
+        bool ok = part.fd < 0 ? SendData(fd, part.data.data() + skip, len) : SendFile(fd, part.fd, part.offset + skip, len);
+        if (!ok)
+            return false;
+
+        pos += part.len;
+        first += len;
+        length -= len;
+    }
+    return true;
+}
+
+bool HttpPlaybackImpl::SendData(int fd, const char *data, size_t len)
+{
+    while (len > 0 && run_)
+    {
+        size_t chunk = std::min(len, static_cast<size_t>(PLAYBACK_SEND_CHUNK));
+        Throttle(chunk);
+        ssize_t ret = send(fd, data, chunk, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        data += ret;
+        len -= ret;
+    }
+    return len == 0;
+}
+
+bool HttpPlaybackImpl::SendFile(int fd, int file, uint64_t offset, uint64_t len)
+{
+    uint64_t begin = offset;
+    while (len > 0 && run_)
+    {
+        size_t chunk = std::min(len, static_cast<uint64_t>(PLAYBACK_SEND_CHUNK));
+        Throttle(chunk);
+        off_t off = offset;
+        ssize_t ret = sendfile(fd, file, &off, chunk);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        offset += ret;
+        len -= ret;
+    }
+
+    //已发送的数据不再需要,避免回放挤占录像文件的页缓存
+    posix_fadvise(file, begin, offset - begin, POSIX_FADV_DONTNEED);
+    return len == 0;
+}
+
+void HttpPlaybackImpl::SendError(int fd, int status, const char *reason)
+{
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status, reason);
+    send(fd, buf, len, MSG_NOSIGNAL);
+}
+
+void HttpPlaybackImpl::Throttle(size_t bytes)
+{
+    if (params_.rate_limit <= 0)
+        return;
+
+    //令牌桶,所有客户端共享带宽,最多积累1s的突发
+    double rate = params_.rate_limit * 1024.0;
+    uint64_t wait;
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        uint64_t now = System::GetSteadyMicroSeconds();
+        tokens_ = std::min(rate, tokens_ + (now - refill_time_) * rate / 1000000);
+        refill_time_ = now;
+        tokens_ -= bytes;
+        if (tokens_ >= 0)
+            return;
+        wait = static_cast<uint64_t>(-tokens_ * 1000000 / rate);
+    }
+    usleep(wait);
+}
+
+void HttpPlaybackImpl::Close()
+{
+    if (!init_)
+        return;
+
+    run_ = false;
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+
+    //打断阻塞中的发送,等待所有客户端线程退出
+    std::unique_lock<std::mutex> lock(mux_);
+    for (int fd : clients_)
+        shutdown(fd, SHUT_RDWR);
+    cond_.wait(lock, [this]() { return clients_.empty(); });
+    lock.unlock();
+
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    init_ = false;
+}
+
+HttpPlaybackImpl::HttpPlaybackImpl() : listen_fd_(-1),
+                                       tokens_(0),
+                                       refill_time_(0),
+                                       run_(false),
+                                       thread_(nullptr),
+                                       init_(false)
+{
+}
+
+HttpPlaybackImpl::~HttpPlaybackImpl()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,98 @@
+#ifndef HTTP_PLAYBACK_H_
+#define HTTP_PLAYBACK_H_
+
+#include "playback/playback.h"
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <vector>
+
+namespace nvr
+{
+//录像回放:按时间索引列出录像,sendfile发送文件并支持Range,按时间段拼接多个fmp4文件为一个响应
+//裸码流录像先用ClipExporter封装为fmp4再发送
+class HttpPlaybackImpl : public PlaybackModule
+{
+public:
+    static rtc::scoped_refptr<PlaybackModule> Create(const Params &params);
+
+    int32_t Initialize(const Params &params) override;
+
+    void Close() override;
+
+protected:
+    HttpPlaybackImpl();
+
+    ~HttpPlaybackImpl() override;
+
+private:
+    //响应由内存数据和文件区间依次拼接而成
+    struct Part
+    {
+        std::string data;
+        int fd;
+        uint64_t offset;
+        uint64_t len;
+    };
+
+    struct Response
+    {
+        Response() : size(0) {}
+        ~Response();
+
+        void AddData(const std::string &data);
+        void AddFile(int fd, uint64_t offset, uint64_t len);
+
+        std::vector<Part> parts;
+        std::vector<int> fds;
+        uint64_t size;
+        std::string type;
+    };
+
+    int32_t Listen(const std::string &url);
+
+    void Loop();
+
+    void HandleClient(int fd);
+
+    void HandleRequest(int fd, const std::string &request);
+
+    int32_t BuildList(uint64_t begin, uint64_t end, Response &response);
+
+    int32_t BuildEvents(uint64_t begin, uint64_t end, Response &response);
+
+    int32_t BuildFile(const std::string &relative, Response &response);
+
+    int32_t BuildRange(uint64_t begin, uint64_t end, Response &response);
+
+    //input不为空时导出单个文件,否则导出[begin,end]内的录像
+    int32_t BuildExport(const std::string &input, uint64_t begin, uint64_t end, Response &response);
+
+    bool SendResponse(int fd, const Response &response, const std::string &range);
+
+    bool SendData(int fd, const char *data, size_t len);
+
+    bool SendFile(int fd, int file, uint64_t offset, uint64_t len);
+
+    void SendError(int fd, int status, const char *reason);
+
+    void Throttle(size_t bytes);
+
+private:
+    Params params_;
+    int listen_fd_;
+    std::mutex mux_;
+    std::condition_variable cond_;
+    std::set<int> clients_;
+    double tokens_;
+    uint64_t refill_time_;
+    bool run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef PLAYBACK_MODULE_H_
+#define PLAYBACK_MODULE_H_
+
+#include <base/ref_count.h>
+#include <base/scoped_refptr.h>
+
+#include <string>
+
+namespace nvr
+{
+class PlaybackModule : public rtc::RefCountInterface
+{
+public:
+    struct Params
+    {
+        std::string url;
+        std::string path;   //录像根目录
+        int32_t rate_limit; //总带宽上限(KB/s),0不限制
+        std::string token;  //访问令牌,为空时不校验
+    };
+
+    virtual int32_t Initialize(const Params &params) = 0;
+
+    virtual void Close() = 0;
+
+protected:
+    ~PlaybackModule() override = default;
+};
+}; // namespace nvr
+
+#endif
@@ -0,0 +1,991 @@
+#include "record/clip_export.h"
+#include "record/record_index.h"
+#include "record/es_reader.h"
+#include "record/mp4_muxer.h"
+#include "record/fmp4_muxer.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#include <memory>
+#include <vector>
+
+#define CLIP_MAX_DURATION (24 * 3600)        //单次导出最大时长(s)
+#define CLIP_MAX_BOX (1024 * 1024)           //moov/moof/emsg的最大长度
+#define CLIP_MAX_SAMPLE (4 * 1024 * 1024)    //单个sample最大长度
+#define CLIP_DEFAULT_FRAME_RATE 25
+
+namespace nvr
+{
+
+static uint16_t Read16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t Read64(const uint8_t *p)
+{
+    return (static_cast<uint64_t>(Read32(p)) << 32) | Read32(p + 4);
+}
+
+static bool HasSuffix(const std::string &name, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return name.size() >= len && name.compare(name.size() - len, len, suffix) == 0;
+}
+
+//在[data,data+size)的同级box中查找type,返回box内容的偏移和长度
+static bool FindBox(const uint8_t *data, size_t size, const char *type, size_t &offset, size_t &len)
+{
+    size_t pos = 0;
+    while (pos + 8 <= size)
+    {
+        size_t box = Read32(data + pos);
+        if (box < 8 || pos + box > size)
+            return false;
+        if (memcmp(data + pos + 4, type, 4) == 0)
+        {
+            offset = pos + 8;
+            len = box - 8;
+            return true;
+        }
+        pos += box;
+    }
+    return false;
+}
+
+//按路径逐层查找,如"trak/mdia/mdhd"
+static bool FindPath(const uint8_t *data, size_t size, const char *path, size_t &offset, size_t &len)
+{
+    offset = 0;
+    len = size;
+    for (const char *p = path;; p += 5)
+    {
+        size_t sub_offset, sub_len;
+        if (!FindBox(data + offset, len, p, sub_offset, sub_len))
+            return false;
+        offset += sub_offset;
+        len = sub_len;
+        if (p[4] == '\0')
+            return true;
+    }
+}
+
+//单个录像文件的顺序读取,frame.ts为相对文件第一帧的时间(us),视频帧为起始码格式
+class ClipSource
+{
+public:
+    ClipSource() : param_index_(0), nal_pos_(0), nal_end_(0), sample_ts_(0) {}
+
+    virtual ~ClipSource() {}
+
+    virtual int32_t Open(const std::string &filename) = 0;
+
+    virtual int Width() const = 0;
+
+    virtual int Height() const = 0;
+
+    virtual int FrameRate() const = 0;
+
+    //定位到time之前最近的关键帧,之后先输出SPS/PPS
+    virtual int32_t Seek(uint64_t time) = 0;
+
+    //读取下一帧,meta为true时frame为元数据,读到文件尾返回KNotFound
+    virtual int32_t Next(VideoFrame &frame, bool &meta) = 0;
+
+protected:
+    void AddParam(const uint8_t *data, uint32_t len)
+    {
+        std::string param("\x00\x00\x00\x01", 4);
+        param.append(reinterpret_cast<const char *>(data), len);
+        params_.push_back(param);
+    }
+
+    bool NextParam(VideoFrame &frame)
+    {
+        if (param_index_ >= params_.size())
+            return false;
+        std::string &param = params_[param_index_++];
+        frame.data = reinterpret_cast<uint8_t *>(&param[0]);
+        frame.len = param.size();
+        frame.ts = 0;
+        frame.type = frame.data[4] & 0x1f;
+        return true;
+    }
+
+    //从buf_中的AVCC sample依次取出nalu,长度前缀原地改为起始码
+    bool NextNalu(VideoFrame &frame)
+    {
+        if (nal_pos_ + 5 > nal_end_)
+            return false;
+
+        uint32_t len = Read32(&buf_[nal_pos_]);
+        if (len == 0 || nal_pos_ + 4 + len > nal_end_)
+        {
+            nal_pos_ = nal_end_;
+            return false;
+        }
+
+        uint8_t *data = &buf_[nal_pos_];
+        nal_pos_ += 4 + len;
+        data[0] = 0;
+        data[1] = 0;
+        data[2] = 0;
+        data[3] = 1;
+        frame.data = data;
+        frame.len = 4 + len;
+        frame.ts = sample_ts_;
+        frame.type = data[4] & 0x1f;
+        return true;
+    }
+
+protected:
+    std::vector<std::string> params_;
+    size_t param_index_;
+    std::vector<uint8_t> buf_;
+    size_t nal_pos_;
+    size_t nal_end_;
+    uint64_t sample_ts_;
+};
+
+//裸码流录像,SPS/PPS随GOP保存
+class EsSource : public ClipSource
+{
+public:
+    int32_t Open(const std::string &filename) override
+    {
+        return reader_.Open(filename);
+    }
+
+    int Width() const override
+    {
+        return reader_.Width();
+    }
+
+    int Height() const override
+    {
+        return reader_.Height();
+    }
+
+    int FrameRate() const override
+    {
+        return reader_.FrameRate();
+    }
+
+    int32_t Seek(uint64_t time) override
+    {
+        return reader_.Seek(time);
+    }
+
+    int32_t Next(VideoFrame &frame, bool &meta) override
+    {
+        return reader_.Next(frame, meta);
+    }
+
+private:
+    EsReader reader_;
+};
+
+//mp4v2录像,sample表在moov中,按sample序号读取
+class MP4Source : public ClipSource
+{
+public:
+    MP4Source() : handle_(MP4_INVALID_FILE_HANDLE),
+                  track_(MP4_INVALID_TRACK_ID),
+                  text_track_(MP4_INVALID_TRACK_ID),
+                  samples_(0),
+                  sample_(1),
+                  text_samples_(0),
+                  text_sample_(1),
+                  timescale_(0),
+                  text_timescale_(0),
+                  width_(0),
+                  height_(0),
+                  frame_rate_(0)
+    {
+    }
+
+    ~MP4Source() override
+    {
+        if (handle_ != MP4_INVALID_FILE_HANDLE)
+            MP4Close(handle_);
+    }
+
+    int32_t Open(const std::string &filename) override
+    {
+        //没有moov的文件(正在录制或掉电未恢复)打开失败
+        handle_ = MP4Read(filename.c_str());
+        if (handle_ == MP4_INVALID_FILE_HANDLE)
+            return static_cast<int>(KThirdPartyError);
+
+        track_ = MP4FindTrackId(handle_, 0, MP4_VIDEO_TRACK_TYPE);
+        if (track_ == MP4_INVALID_TRACK_ID)
+            return static_cast<int>(KNotFound);
+        samples_ = MP4GetTrackNumberOfSamples(handle_, track_);
+        timescale_ = MP4GetTrackTimeScale(handle_, track_);
+        if (samples_ == 0 || timescale_ == 0)
+            return static_cast<int>(KNotFound);
+
+        width_ = MP4GetTrackVideoWidth(handle_, track_);
+        height_ = MP4GetTrackVideoHeight(handle_, track_);
+        MP4Duration duration = MP4GetSampleDuration(handle_, track_, 1);
+        frame_rate_ = duration ? static_cast<int>((timescale_ + duration / 2) / duration) : CLIP_DEFAULT_FRAME_RATE;
+
+        uint8_t **sps, **pps;
+        uint32_t *sps_len, *pps_len;
+        if (!MP4GetTrackH264SeqPictHeaders(handle_, track_, &sps, &sps_len, &pps, &pps_len))
+            return static_cast<int>(KNotFound);
+        for (int i = 0; sps[i] != nullptr; i++)
+            AddParam(sps[i], sps_len[i]);
+        for (int i = 0; pps[i] != nullptr; i++)
+            AddParam(pps[i], pps_len[i]);
+        MP4FreeH264SeqPictHeaders(sps, sps_len, pps, pps_len);
+        param_index_ = params_.size();
+
+        buf_.resize(MP4GetTrackMaxSampleSize(handle_, track_));
+
+        text_track_ = MP4FindTrackId(handle_, 0, MP4_SUBTITLE_TRACK_TYPE);
+        if (text_track_ != MP4_INVALID_TRACK_ID)
+        {
+            text_samples_ = MP4GetTrackNumberOfSamples(handle_, text_track_);
+            text_timescale_ = MP4GetTrackTimeScale(handle_, text_track_);
+            meta_.resize(MP4GetTrackMaxSampleSize(handle_, text_track_));
+            if (text_timescale_ == 0)
+                text_samples_ = 0;
+        }
+
+        return static_cast<int>(KSuccess);
+    }
+
+    int Width() const override
+    {
+        return width_;
+    }
+
+    int Height() const override
+    {
+        return height_;
+    }
+
+    int FrameRate() const override
+    {
+        return frame_rate_;
+    }
+
+    int32_t Seek(uint64_t time) override
+    {
+        //mp4v2按时间查找同步帧时返回之后的关键帧,这里向前回退到之前的关键帧
+        sample_ = MP4GetSampleIdFromTime(handle_, track_, time * timescale_ / 1000000, false);
+        if (sample_ == MP4_INVALID_SAMPLE_ID)
+            sample_ = time ? samples_ + 1 : 1;
+        while (sample_ > 1 && sample_ <= samples_ && MP4GetSampleSync(handle_, track_, sample_) != 1)
+            sample_--;
+
+        uint64_t video_ts = sample_ <= samples_ ? SampleTime(track_, sample_, timescale_) : UINT64_MAX;
+        text_sample_ = 1;
+        while (text_sample_ <= text_samples_ && SampleTime(text_track_, text_sample_, text_timescale_) < video_ts)
+            text_sample_++;
+
+        param_index_ = 0;
+        nal_pos_ = nal_end_ = 0;
+        return static_cast<int>(KSuccess);
+    }
+
+    int32_t Next(VideoFrame &frame, bool &meta) override
+    {
+        meta = false;
+        while (true)
+        {
+            if (NextParam(frame) || NextNalu(frame))
+                return static_cast<int>(KSuccess);
+
+            //文本轨道与视频按时间交错输出
+            if (text_sample_ <= text_samples_)
+            {
+                uint64_t text_ts = SampleTime(text_track_, text_sample_, text_timescale_);
+                if (sample_ > samples_ || text_ts <= SampleTime(track_, sample_, timescale_))
+                {
+                    uint8_t *data = meta_.data();
+                    uint32_t size = meta_.size();
+                    if (!MP4ReadSample(handle_, text_track_, text_sample_++, &data, &size))
+                        return static_cast<int>(KThirdPartyError);
+
+                    //tx3g样本:16位长度+UTF-8文本,长度为0的是事件之间的空样本
+                    if (size > 2 && Read16(data) > 0 && 2u + Read16(data) <= size)
+                    {
+                        frame.data = data + 2;
+                        frame.len = Read16(data);
+                        frame.ts = text_ts;
+                        frame.type = 0;
+                        meta = true;
+                        return static_cast<int>(KSuccess);
+                    }
+                    continue;
+                }
+            }
+
+            if (sample_ > samples_)
+                return static_cast<int>(KNotFound);
+
+            uint8_t *data = buf_.data();
+            uint32_t size = buf_.size();
+            MP4Timestamp start;
+            if (!MP4ReadSample(handle_, track_, sample_++, &data, &size, &start))
+                return static_cast<int>(KThirdPartyError);
+            nal_pos_ = 0;
+            nal_end_ = size;
+            sample_ts_ = start * 1000000 / timescale_;
+        }
+    }
+
+private:
+    uint64_t SampleTime(MP4TrackId track, MP4SampleId sample, uint32_t timescale)
+    {
+        return MP4GetSampleTime(handle_, track, sample) * 1000000 / timescale;
+    }
+
+private:
+    MP4FileHandle handle_;
+    MP4TrackId track_;
+    MP4TrackId text_track_;
+    MP4SampleId samples_;
+    MP4SampleId sample_;
+    MP4SampleId text_samples_;
+    MP4SampleId text_sample_;
+    uint32_t timescale_;
+    uint32_t text_timescale_;
+    int width_;
+    int height_;
+    int frame_rate_;
+    std::vector<uint8_t> meta_;
+};
+
+//fmp4录像,逐个读取moof得到sample位置,mdat中的数据按sample读取
+class FMP4Source : public ClipSource
+{
+public:
+    FMP4Source() : fd_(-1),
+                   size_(0),
+                   pos_(0),
+                   first_(0),
+                   sample_index_(0),
+                   timescale_(FMP4Packager::KTimeScale),
+                   width_(0),
+                   height_(0),
+                   frame_rate_(0)
+    {
+    }
+
+    ~FMP4Source() override
+    {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    //mdat在moov之前或者moov中没有mvex时不是fmp4,返回KNotFound
+    int32_t Open(const std::string &filename) override
+    {
+        fd_ = open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+        {
+            log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+            return static_cast<int>(KSystemError);
+        }
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0)
+            return static_cast<int>(KSystemError);
+        size_ = st.st_size;
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        bool moov = false;
+        uint64_t pos = 0, size;
+        char type[4];
+        while ((size = ReadBox(pos, type)) != 0)
+        {
+            if (memcmp(type, "moov", 4) == 0)
+            {
+                if (size > CLIP_MAX_BOX || !ReadPayload(pos, size) || !ParseMoov())
+                    return static_cast<int>(KNotFound);
+                moov = true;
+            }
+            else if (memcmp(type, "mdat", 4) == 0 && !moov)
+            {
+                return static_cast<int>(KNotFound);
+            }
+            else if (memcmp(type, "moof", 4) == 0 || memcmp(type, "emsg", 4) == 0)
+            {
+                break;
+            }
+            pos += size;
+        }
+        if (!moov)
+            return static_cast<int>(KNotFound);
+        first_ = pos;
+        pos_ = pos;
+
+        //init segment中没有帧率,取第一个分片的sample时长
+        frame_rate_ = CLIP_DEFAULT_FRAME_RATE;
+        while ((size = ReadBox(pos, type)) != 0)
+        {
+            if (memcmp(type, "moof", 4) == 0)
+            {
+                if (size <= CLIP_MAX_BOX && ReadPayload(pos, size) && ParseFragment(pos) &&
+                    !samples_.empty() && samples_[0].duration)
+                    frame_rate_ = (timescale_ + samples_[0].duration / 2) / samples_[0].duration;
+                break;
+            }
+            pos += size;
+        }
+        samples_.clear();
+
+        return static_cast<int>(KSuccess);
+    }
+
+    int Width() const override
+    {
+        return width_;
+    }
+
+    int Height() const override
+    {
+        return height_;
+    }
+
+    int FrameRate() const override
+    {
+        return frame_rate_;
+    }
+
+    int32_t Seek(uint64_t time) override
+    {
+        //只读取moof,找到dts<=time的最后一个关键帧分片,分片之前的emsg一并输出
+        uint64_t target = time * timescale_ / 1000000;
+        uint64_t pos = first_, start = first_, candidate = first_, size;
+        bool emsg = false;
+        char type[4];
+        while ((size = ReadBox(pos, type)) != 0)
+        {
+            if (memcmp(type, "emsg", 4) == 0)
+            {
+                if (!emsg)
+                    start = pos;
+                emsg = true;
+            }
+            else if (memcmp(type, "moof", 4) == 0)
+            {
+                if (!emsg)
+                    start = pos;
+                emsg = false;
+                if (size <= CLIP_MAX_BOX && ReadPayload(pos, size) && ParseFragment(pos) && !samples_.empty())
+                {
+                    if (samples_[0].dts > target)
+                        break;
+                    if (samples_[0].key)
+                        candidate = start;
+                }
+            }
+            else
+            {
+                emsg = false;
+            }
+            pos += size;
+        }
+
+        pos_ = candidate;
+        samples_.clear();
+        sample_index_ = 0;
+        param_index_ = 0;
+        nal_pos_ = nal_end_ = 0;
+        return static_cast<int>(KSuccess);
+    }
+
+    int32_t Next(VideoFrame &frame, bool &meta) override
+    {
+        meta = false;
+        while (true)
+        {
+            if (NextParam(frame) || NextNalu(frame))
+                return static_cast<int>(KSuccess);
+
+            if (sample_index_ < samples_.size())
+            {
+                const Sample &sample = samples_[sample_index_++];
+                //文件尾写了一半的分片
+                if (sample.size < 5 || sample.size > CLIP_MAX_SAMPLE || sample.offset + sample.size > size_)
+                    return static_cast<int>(KNotFound);
+                buf_.resize(sample.size);
+                if (pread(fd_, buf_.data(), sample.size, sample.offset) != static_cast<ssize_t>(sample.size))
+                    return static_cast<int>(KSystemError);
+                nal_pos_ = 0;
+                nal_end_ = sample.size;
+                sample_ts_ = sample.dts * 1000000 / timescale_;
+                continue;
+            }
+
+            char type[4];
+            uint64_t pos = pos_;
+            uint64_t size = ReadBox(pos, type);
+            if (size == 0)
+                return static_cast<int>(KNotFound);
+            pos_ += size;
+
+            if (memcmp(type, "moof", 4) == 0)
+            {
+                if (size > CLIP_MAX_BOX || !ReadPayload(pos, size) || !ParseFragment(pos))
+                    return static_cast<int>(KNotFound);
+                sample_index_ = 0;
+            }
+            else if (memcmp(type, "emsg", 4) == 0)
+            {
+                if (size <= CLIP_MAX_BOX && ReadPayload(pos, size) && ParseEmsg(frame))
+                {
+                    meta = true;
+                    return static_cast<int>(KSuccess);
+                }
+            }
+        }
+    }
+
+private:
+    struct Sample
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t duration;
+        uint64_t dts;
+        bool key;
+    };
+
+    //返回box总长度,文件尾或者box不完整时返回0
+    uint64_t ReadBox(uint64_t pos, char type[4])
+    {
+        uint8_t header[16];
+        if (pos + 8 > size_ || pread(fd_, header, sizeof(header), pos) < 8)
+            return 0;
+        memcpy(type, header + 4, 4);
+
+        uint64_t size = Read32(header);
+        if (size == 1)
+        {
+            if (pos + 16 > size_)
+                return 0;
+            size = Read64(header + 8);
+        }
+        else if (size == 0)
+        {
+            size = size_ - pos;
+        }
+        if (size < 8 || pos + size > size_)
+            return 0;
+        return size;
+    }
+
+    //box内容读入box_,不含8字节头
+    bool ReadPayload(uint64_t pos, uint64_t size)
+    {
+        box_.resize(size - 8);
+        return pread(fd_, box_.data(), box_.size(), pos + 8) == static_cast<ssize_t>(box_.size());
+    }
+
+    bool ParseMoov()
+    {
+        const uint8_t *data = box_.data();
+        size_t offset, len, sub_offset, sub_len;
+        if (!FindBox(data, box_.size(), "mvex", offset, len))
+            return false;
+
+        if (FindPath(data, box_.size(), "trak/mdia/mdhd", offset, len) && len >= 16)
+            timescale_ = Read32(data + offset + (data[offset] == 1 ? 20 : 12));
+        if (timescale_ == 0)
+            return false;
+
+        //stsd:版本(4)+数量(4)+avc1,avc1内容中视觉参数占78字节,之后是avcC
+        if (!FindPath(data, box_.size(), "trak/mdia/minf/stbl/stsd", offset, len) || len < 8 + 8 + 78)
+            return false;
+        const uint8_t *avc1 = data + offset + 8;
+        size_t avc1_len = Read32(avc1);
+        if (memcmp(avc1 + 4, "avc1", 4) != 0 || avc1_len > len - 8 || avc1_len < 8 + 78)
+            return false;
+        width_ = Read16(avc1 + 8 + 24);
+        height_ = Read16(avc1 + 8 + 26);
+        if (!FindBox(avc1 + 8 + 78, avc1_len - 8 - 78, "avcC", sub_offset, sub_len) || sub_len < 7)
+            return false;
+
+        const uint8_t *avcc = avc1 + 8 + 78 + sub_offset;
+        const uint8_t *end = avcc + sub_len;
+        const uint8_t *p = avcc + 5;
+        for (int set = 0; set < 2; set++)
+        {
+            if (p >= end)
+                return false;
+            int count = set == 0 ? (*p & 0x1f) : *p;
+            p++;
+            for (int i = 0; i < count; i++)
+            {
+                if (p + 2 > end || p + 2 + Read16(p) > end)
+                    return false;
+                AddParam(p + 2, Read16(p));
+                p += 2 + Read16(p);
+            }
+        }
+        param_index_ = params_.size();
+        return !params_.empty();
+    }
+
+    //解析moof中的tfhd/tfdt/trun,得到各sample在文件中的位置
+    bool ParseFragment(uint64_t moof)
+    {
+        samples_.clear();
+
+        const uint8_t *data = box_.data();
+        size_t traf, traf_len, offset, len;
+        if (!FindBox(data, box_.size(), "traf", traf, traf_len))
+            return false;
+
+        if (!FindBox(data + traf, traf_len, "tfhd", offset, len) || len < 8)
+            return false;
+        const uint8_t *p = data + traf + offset;
+        const uint8_t *end = p + len;
+        uint32_t flags = Read32(p) & 0xffffff;
+        p += 8;
+        uint64_t base = moof;
+        uint32_t default_duration = 0, default_size = 0, default_flags = 0;
+        if (flags & 0x01)
+        {
+            if (p + 8 > end)
+                return false;
+            base = Read64(p);
+            p += 8;
+        }
+        if (flags & 0x02)
+            p += 4;
+        if ((flags & 0x08) && p + 4 <= end)
+        {
+            default_duration = Read32(p);
+            p += 4;
+        }
+        if ((flags & 0x10) && p + 4 <= end)
+        {
+            default_size = Read32(p);
+            p += 4;
+        }
+        if ((flags & 0x20) && p + 4 <= end)
+            default_flags = Read32(p);
+
+        uint64_t dts = 0;
+        if (FindBox(data + traf, traf_len, "tfdt", offset, len) && len >= 8)
+            dts = data[traf + offset] == 1 && len >= 12 ? Read64(data + traf + offset + 4) : Read32(data + traf + offset + 4);
+
+        if (!FindBox(data + traf, traf_len, "trun", offset, len) || len < 8)
+            return false;
+        p = data + traf + offset;
+        end = p + len;
+        flags = Read32(p) & 0xffffff;
+        uint32_t count = Read32(p + 4);
+        p += 8;
+        //不带data-offset时无法确定数据位置
+        if (!(flags & 0x01) || p + 4 > end)
+            return false;
+        uint64_t position = base + static_cast<int32_t>(Read32(p));
+        p += 4;
+        uint32_t first_flags = default_flags;
+        bool has_first = false;
+        if (flags & 0x04)
+        {
+            if (p + 4 > end)
+                return false;
+            first_flags = Read32(p);
+            has_first = true;
+            p += 4;
+        }
+
+        size_t entry = ((flags & 0x100) ? 4 : 0) + ((flags & 0x200) ? 4 : 0) + ((flags & 0x400) ? 4 : 0) + ((flags & 0x800) ? 4 : 0);
+        if (static_cast<uint64_t>(count) * entry > static_cast<uint64_t>(end - p))
+            return false;
+
+        samples_.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Sample &sample = samples_[i];
+            sample.duration = default_duration;
+            sample.size = default_size;
+            uint32_t sample_flags = (i == 0 && has_first) ? first_flags : default_flags;
+            if (flags & 0x100)
+            {
+                sample.duration = Read32(p);
+                p += 4;
+            }
+            if (flags & 0x200)
+            {
+                sample.size = Read32(p);
+                p += 4;
+            }
+            if (flags & 0x400)
+            {
+                sample_flags = Read32(p);
+                p += 4;
+            }
+            if (flags & 0x800)
+                p += 4;
+
+            //sample_is_non_sync_sample
+            sample.key = !(sample_flags & 0x00010000);
+            sample.offset = position;
+            sample.dts = dts;
+            position += sample.size;
+            dts += sample.duration;
+        }
+        return true;
+    }
+
+    //emsg v1:timescale,presentation_time,event_duration,id,scheme_id_uri,value,message_data
+    bool ParseEmsg(VideoFrame &frame)
+    {
+        const uint8_t *p = box_.data();
+        const uint8_t *end = p + box_.size();
+        if (box_.size() < 24 || p[0] != 1)
+            return false;
+        uint32_t timescale = Read32(p + 4);
+        uint64_t time = Read64(p + 8);
+        p += 24;
+
+        const uint8_t *scheme = p;
+        while (p < end && *p)
+            p++;
+        if (p >= end || strcmp(reinterpret_cast<const char *>(scheme), FMP4_EMSG_SCHEME) != 0 || timescale == 0)
+            return false;
+        p++;
+        while (p < end && *p)
+            p++;
+        if (p >= end)
+            return false;
+        p++;
+
+        frame.data = const_cast<uint8_t *>(p);
+        frame.len = end - p;
+        frame.ts = time * 1000000 / timescale;
+        frame.type = 0;
+        return true;
+    }
+
+private:
+    int fd_;
+    uint64_t size_;
+    uint64_t pos_;
+    uint64_t first_;
+    std::vector<Sample> samples_;
+    size_t sample_index_;
+    std::vector<uint8_t> box_;
+    uint32_t timescale_;
+    int width_;
+    int height_;
+    int frame_rate_;
+};
+
+static ClipSource *OpenSource(const std::string &filename)
+{
+    std::unique_ptr<ClipSource> source;
+    if (HasSuffix(filename, RECORD_ES_SUFFIX))
+    {
+        source.reset(new EsSource());
+    }
+    else
+    {
+        //fmp4和mp4v2录像后缀相同,按文件结构区分
+        source.reset(new FMP4Source());
+        if (KSuccess == static_cast<err_code>(source->Open(filename)))
+            return source.release();
+        source.reset(new MP4Source());
+    }
+
+    if (KSuccess != static_cast<err_code>(source->Open(filename)))
+        return nullptr;
+    return source.release();
+}
+
+//多个录像文件依次写入同一个muxer,第一帧时按源文件的参数创建
+struct ClipWriter
+{
+    ClipWriter(const std::string &output, const std::string &format, ClipExporter::Result &result)
+        : output(output), format(format), result(result), width(0), height(0)
+    {
+        memset(&result, 0, sizeof(result));
+    }
+
+    //写入source在[当前位置,end]内的帧,start为源文件起始时间,超过end时done置为true
+    int32_t Write(ClipSource &source, uint64_t start, uint64_t end, bool &done)
+    {
+        err_code code;
+        VideoFrame frame;
+        bool meta;
+        while (KSuccess == static_cast<err_code>(source.Next(frame, meta)))
+        {
+            uint64_t time = start + frame.ts;
+            bool slice = frame.type == H264Frame::NaluType::ISLICE || frame.type == H264Frame::NaluType::PSLICE;
+            if ((meta || slice) && time > end)
+            {
+                done = true;
+                break;
+            }
+
+            //fmp4的emsg在所属分片之前,写入第一帧之后再交给muxer
+            if (meta)
+            {
+                std::string data(reinterpret_cast<const char *>(frame.data), frame.len);
+                if (result.frames)
+                    muxer->WriteMetadata(time, data);
+                else
+                    pending.push_back(std::make_pair(time, data));
+                continue;
+            }
+
+            if (!muxer)
+            {
+                //导出失败可以重做,不需要每个分片落盘,Close时同步一次
+                if (format == "fmp4")
+                    muxer.reset(new FMP4Muxer(FileWriter::Params{1024 * 1024, 0, FILE_WRITER_NO_SYNC, 0}));
+                else
+                    muxer.reset(new MP4Muxer());
+                code = static_cast<err_code>(muxer->Initialize(output, source.Width(), source.Height(), source.FrameRate()));
+                if (KSuccess != code)
+                {
+                    muxer.reset();
+                    return static_cast<int>(code);
+                }
+                width = source.Width();
+                height = source.Height();
+            }
+
+            if (slice)
+            {
+                if (result.frames == 0)
+                    result.begin = time;
+                result.end = time;
+                result.frames++;
+                result.bytes += frame.len;
+            }
+
+            frame.ts = time;
+            code = static_cast<err_code>(muxer->WriteVideoFrame(frame));
+            if (KSuccess != code)
+            {
+                log_e("write %s failed,error:%s", output.c_str(), make_error_code(code).message().c_str());
+                muxer->Close();
+                muxer.reset();
+                unlink(output.c_str());
+                return static_cast<int>(code);
+            }
+
+            if (result.frames)
+            {
+                for (auto &item : pending)
+                    muxer->WriteMetadata(item.first, item.second);
+                pending.clear();
+            }
+        }
+        return static_cast<int>(KSuccess);
+    }
+
+    const std::string &output;
+    const std::string &format;
+    ClipExporter::Result &result;
+    std::unique_ptr<Muxer> muxer;
+    std::vector<std::pair<uint64_t, std::string>> pending;
+    int width;
+    int height;
+};
+
+int32_t ClipExporter::Export(const Params &params, Result &result)
+{
+    memset(&result, 0, sizeof(result));
+
+    if (params.begin >= params.end || params.end - params.begin > static_cast<uint64_t>(CLIP_MAX_DURATION) * 1000000)
+    {
+        log_e("invalid clip range %llu-%llu", (unsigned long long)params.begin, (unsigned long long)params.end);
+        return static_cast<int>(KNotFound);
+    }
+
+    err_code code;
+    std::vector<RecordIndex::Segment> segments;
+    code = static_cast<err_code>(RecordIndex::List(params.path, params.begin, params.end, segments));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+    if (segments.empty())
+    {
+        log_w("no record between %llu-%llu", (unsigned long long)params.begin, (unsigned long long)params.end);
+        return static_cast<int>(KNotFound);
+    }
+
+    ClipWriter writer(params.output, params.format, result);
+    bool done = false;
+    for (auto &segment : segments)
+    {
+        if (done)
+            break;
+
+        std::string filename = params.path + '/' + segment.path;
+        std::unique_ptr<ClipSource> source(OpenSource(filename));
+        if (!source)
+        {
+            log_w("open %s failed,skip", filename.c_str());
+            continue;
+        }
+
+        //一个mp4只能有一种分辨率,分辨率变化时导出到此为止
+        if (writer.muxer && (source->Width() != writer.width || source->Height() != writer.height))
+        {
+            log_w("%s resolution changed to %dx%d,clip stops here", filename.c_str(), source->Width(), source->Height());
+            break;
+        }
+
+        source->Seek(segment.start < params.begin ? params.begin - segment.start : 0);
+        result.files++;
+
+        code = static_cast<err_code>(writer.Write(*source, segment.start, params.end, done));
+        if (KSuccess != code)
+            return static_cast<int>(code);
+    }
+
+    if (!writer.muxer)
+    {
+        log_w("no frame between %llu-%llu", (unsigned long long)params.begin, (unsigned long long)params.end);
+        return static_cast<int>(KNotFound);
+    }
+    writer.muxer->Close();
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t ClipExporter::ExportFile(const std::string &input, const std::string &output, const std::string &format, Result &result)
+{
+    ClipWriter writer(output, format, result);
+    std::unique_ptr<ClipSource> source(OpenSource(input));
+    if (!source)
+    {
+        log_w("open %s failed", input.c_str());
+        return static_cast<int>(KNotFound);
+    }
+    result.files = 1;
+
+    err_code code;
+    bool done = false;
+    source->Seek(0);
+    code = static_cast<err_code>(writer.Write(*source, 0, UINT64_MAX, done));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    if (!writer.muxer)
+    {
+        log_w("no frame in %s", input.c_str());
+        return static_cast<int>(KNotFound);
+    }
+    writer.muxer->Close();
+
+    return static_cast<int>(KSuccess);
+}
+} // namespace nvr
@@ -0,0 +1,41 @@
+#ifndef CLIP_EXPORT_H_
+#define CLIP_EXPORT_H_
+
+#include "global.h"
+
+#include <string>
+
+namespace nvr
+{
+
+//按时间段导出录像:跨文件读取,从begin之前最近的关键帧开始,sample直接复制封装为单个文件,不解码不编码
+//支持mp4v2录像,fmp4录像和裸码流录像,每次只缓存一个sample,内存占用与导出时长无关
+class ClipExporter
+{
+public:
+    struct Params
+    {
+        std::string path;   //录像根目录
+        uint64_t begin;     //墙上时间(us)
+        uint64_t end;
+        std::string output;
+        std::string format; //输出格式mp4/fmp4
+    };
+
+    struct Result
+    {
+        uint32_t files;
+        uint32_t frames;
+        uint64_t bytes;
+        uint64_t begin; //实际导出的第一帧时间
+        uint64_t end;   //实际导出的最后一帧时间
+    };
+
+    static int32_t Export(const Params &params, Result &result);
+
+    //导出单个录像文件的全部内容,时间相对文件第一帧,用于回放时把裸码流录像封装为mp4
+    static int32_t ExportFile(const std::string &input, const std::string &output, const std::string &format, Result &result);
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef ES_FORMAT_H_
+#define ES_FORMAT_H_
+
+#include <stdint.h>
+
+#define ES_FILE_MAGIC 0x5345564e  //"NVES"
+#define ES_INDEX_MAGIC 0x494b564e //"NVKI"
+#define ES_FRAME_SYNC 0x3155414e  //"NAU1",视频帧
+#define ES_META_SYNC 0x31444d4e   //"NMD1",移动侦测元数据
+#define ES_VERSION 1
+#define ES_MAX_RECORD (4 * 1024 * 1024)
+
+namespace nvr
+{
+
+//裸码流录像:文件头之后顺序追加记录,每条记录为记录头+数据,视频帧数据为4字节长度前缀的NALU(AVCC)
+//掉电后从头按记录头遍历即可恢复,文件尾写了一半的记录直接丢弃
+struct EsFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frame_rate;
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved;
+};
+
+struct EsRecordHeader
+{
+    uint32_t sync;
+    uint32_t len; //数据长度
+    uint64_t ts;  //相对第一帧的时间(us)
+};
+
+//关键帧索引:索引头之后为定长记录,每个GOP一条
+struct EsIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t reserved[2];
+};
+
+struct EsIndexEntry
+{
+    uint64_t ts;     //相对第一帧的时间(us)
+    uint64_t offset; //GOP第一条记录(SPS)的文件偏移
+};
+
+} // namespace nvr
+
+#endif
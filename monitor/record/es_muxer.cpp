@@ -0,0 +1,193 @@
+#include "record/es_muxer.h"
+#include "record/es_format.h"
+#include "common/res_code.h"
+
+namespace nvr
+{
+
+int32_t EsMuxer::Initialize(const std::string &filename, int width, int height, int frame_rate)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+    code = static_cast<err_code>(writer_.Initialize(filename, params_));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    std::string index_file = filename + RECORD_ES_INDEX_SUFFIX;
+    index_fd_ = open(index_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (index_fd_ < 0)
+    {
+        log_e("open %s failed,%s", index_file.c_str(), strerror(errno));
+        writer_.Close();
+        return static_cast<int>(KSystemError);
+    }
+
+    EsIndexHeader index_header;
+    memset(&index_header, 0, sizeof(index_header));
+    index_header.magic = ES_INDEX_MAGIC;
+    index_header.version = ES_VERSION;
+    index_header.entry_size = sizeof(EsIndexEntry);
+    if (write(index_fd_, &index_header, sizeof(index_header)) != sizeof(index_header))
+        log_w("write %s failed,%s", index_file.c_str(), strerror(errno));
+
+    EsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ES_FILE_MAGIC;
+    header.version = ES_VERSION;
+    header.frame_rate = frame_rate;
+    header.width = width;
+    header.height = height;
+    code = static_cast<err_code>(writer_.Write(&header, sizeof(header)));
+    if (KSuccess != code)
+    {
+        close(index_fd_);
+        index_fd_ = -1;
+        writer_.Close();
+        return static_cast<int>(code);
+    }
+
+    has_base_ = false;
+    last_type_ = 0;
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EsMuxer::WriteRecord(uint32_t sync, uint64_t ts, const uint8_t *data, uint32_t len, bool avcc)
+{
+    EsRecordHeader header;
+    header.sync = sync;
+    header.len = len;
+    header.ts = ts;
+
+    err_code code;
+    code = static_cast<err_code>(writer_.Write(&header, sizeof(header)));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    //起始码替换为长度前缀,导出时可直接作为mp4 sample
+    if (avcc)
+    {
+        uint8_t prefix[4];
+        prefix[0] = ((len - 4) >> 24) & 0xff;
+        prefix[1] = ((len - 4) >> 16) & 0xff;
+        prefix[2] = ((len - 4) >> 8) & 0xff;
+        prefix[3] = (len - 4) & 0xff;
+        code = static_cast<err_code>(writer_.Write(prefix, sizeof(prefix)));
+        if (KSuccess != code)
+            return static_cast<int>(code);
+        data += 4;
+        len -= 4;
+    }
+    return writer_.Write(data, len);
+}
+
+int32_t EsMuxer::WriteIndex(uint64_t ts, uint64_t offset)
+{
+    EsIndexEntry entry;
+    entry.ts = ts;
+    entry.offset = offset;
+    if (write(index_fd_, &entry, sizeof(entry)) != sizeof(entry))
+    {
+        //索引丢失时导出退化为顺序扫描,不影响录像
+        log_w("write es index failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EsMuxer::WriteVideoFrame(const VideoFrame &frame)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (frame.len <= 4 || frame.len > ES_MAX_RECORD)
+        return static_cast<int>(KSuccess);
+
+    err_code code;
+
+    //GOP从SPS开始,编码器不输出SPS时以P帧之后的I帧为准
+    bool key = frame.type == H264Frame::NaluType::SPS ||
+               (frame.type == H264Frame::NaluType::ISLICE && last_type_ == H264Frame::NaluType::PSLICE);
+    last_type_ = frame.type;
+
+    if (!has_base_)
+    {
+        if (!key)
+            return static_cast<int>(KSuccess);
+        base_ts_ = frame.ts;
+        has_base_ = true;
+    }
+
+    uint64_t ts = frame.ts > base_ts_ ? frame.ts - base_ts_ : 0;
+    if (key)
+    {
+        //上一个GOP写完后按同步周期落盘
+        code = static_cast<err_code>(writer_.Commit());
+        if (KSuccess != code)
+            return static_cast<int>(code);
+        WriteIndex(ts, writer_.Position());
+    }
+
+    return WriteRecord(ES_FRAME_SYNC, ts, frame.data, frame.len, true);
+}
+
+int32_t EsMuxer::WriteMetadata(uint64_t ts, const std::string &data)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (!has_base_ || ts < base_ts_ || data.size() > ES_MAX_RECORD)
+        return static_cast<int>(KSuccess);
+
+    return WriteRecord(ES_META_SYNC, ts - base_ts_, reinterpret_cast<const uint8_t *>(data.data()), data.size(), false);
+}
+
+uint64_t EsMuxer::Position()
+{
+    return writer_.Position();
+}
+
+int32_t EsMuxer::Rename(const std::string &from, const std::string &to)
+{
+    int ret = rename(from.c_str(), to.c_str());
+    if (ret != 0)
+        return ret;
+    if (rename((from + RECORD_ES_INDEX_SUFFIX).c_str(), (to + RECORD_ES_INDEX_SUFFIX).c_str()) != 0)
+        log_w("rename %s failed,%s", (from + RECORD_ES_INDEX_SUFFIX).c_str(), strerror(errno));
+    return 0;
+}
+
+void EsMuxer::Close()
+{
+    if (!init_)
+        return;
+
+    writer_.Close();
+    if (index_fd_ >= 0)
+        close(index_fd_);
+    index_fd_ = -1;
+    has_base_ = false;
+    base_ts_ = 0;
+    last_type_ = 0;
+
+    init_ = false;
+}
+
+EsMuxer::EsMuxer(const FileWriter::Params &params) : params_(params),
+                                                     index_fd_(-1),
+                                                     base_ts_(0),
+                                                     has_base_(false),
+                                                     last_type_(0),
+                                                     init_(false)
+{
+}
+
+EsMuxer::~EsMuxer()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,48 @@
+#ifndef ES_MUXER_H_
+#define ES_MUXER_H_
+
+#include "record/muxer.h"
+#include "record/file_writer.h"
+
+#include <string>
+
+namespace nvr
+{
+
+//裸码流录像:录像线程只做顺序追加,不维护mp4的sample表,导出或回放时再封装为mp4
+class EsMuxer : public Muxer
+{
+public:
+    explicit EsMuxer(const FileWriter::Params &params);
+
+    ~EsMuxer() override;
+
+    int32_t Initialize(const std::string &filename, int width, int height, int frame_rate) override;
+
+    int32_t WriteVideoFrame(const VideoFrame &frame) override;
+
+    void Close() override;
+
+    int32_t WriteMetadata(uint64_t ts, const std::string &data) override;
+
+    uint64_t Position() override;
+
+    //索引文件随录像文件一起重命名
+    int32_t Rename(const std::string &from, const std::string &to) override;
+
+private:
+    int32_t WriteRecord(uint32_t sync, uint64_t ts, const uint8_t *data, uint32_t len, bool avcc);
+
+    int32_t WriteIndex(uint64_t ts, uint64_t offset);
+
+private:
+    FileWriter writer_;
+    FileWriter::Params params_;
+    int index_fd_;
+    uint64_t base_ts_;
+    bool has_base_;
+    int last_type_;
+    bool init_;
+};
+} // namespace nvr
+#endif
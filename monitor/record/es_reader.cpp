@@ -0,0 +1,220 @@
+#include "record/es_reader.h"
+#include "common/res_code.h"
+
+#define ES_RESYNC_WINDOW (1024 * 1024) //记录头损坏时向后查找同步字的范围
+
+namespace nvr
+{
+
+static bool ValidHeader(const EsRecordHeader &header)
+{
+    if (header.sync == ES_FRAME_SYNC)
+        return header.len > 4 && header.len <= ES_MAX_RECORD;
+    if (header.sync == ES_META_SYNC)
+        return header.len <= ES_MAX_RECORD;
+    return false;
+}
+
+int32_t EsReader::LoadIndex(const std::string &filename, std::vector<EsIndexEntry> &entries)
+{
+    std::string index_file = filename + RECORD_ES_INDEX_SUFFIX;
+    int fd = open(index_file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return static_cast<int>(KNotFound);
+
+    struct stat st;
+    EsIndexHeader header;
+    if (fstat(fd, &st) != 0 || stat(filename.c_str(), &st) != 0 ||
+        pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != ES_INDEX_MAGIC || header.version != ES_VERSION || header.entry_size != sizeof(EsIndexEntry))
+    {
+        close(fd);
+        return static_cast<int>(KNotFound);
+    }
+
+    //只保留时间递增且指向录像文件内部的记录
+    EsIndexEntry entry;
+    off_t offset = sizeof(header);
+    while (pread(fd, &entry, sizeof(entry), offset) == sizeof(entry))
+    {
+        offset += sizeof(entry);
+        if (entry.offset < sizeof(EsFileHeader) || entry.offset >= static_cast<uint64_t>(st.st_size))
+            break;
+        if (!entries.empty() && (entry.ts < entries.back().ts || entry.offset <= entries.back().offset))
+            break;
+        entries.push_back(entry);
+    }
+    close(fd);
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EsReader::Open(const std::string &filename)
+{
+    if (fd_ >= 0)
+        return static_cast<int>(KDupInitialize);
+
+    fd_ = open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+        return static_cast<int>(KNotFound);
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 ||
+        pread(fd_, &header_, sizeof(header_), 0) != sizeof(header_) ||
+        header_.magic != ES_FILE_MAGIC || header_.version != ES_VERSION)
+    {
+        log_e("%s is not es record file", filename.c_str());
+        Close();
+        return static_cast<int>(KSystemError);
+    }
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    filename_ = filename;
+    size_ = st.st_size;
+    pos_ = sizeof(header_);
+    index_.clear();
+    LoadIndex(filename, index_);
+
+    return static_cast<int>(KSuccess);
+}
+
+int EsReader::Width() const
+{
+    return header_.width;
+}
+
+int EsReader::Height() const
+{
+    return header_.height;
+}
+
+int EsReader::FrameRate() const
+{
+    return header_.frame_rate;
+}
+
+uint64_t EsReader::Position() const
+{
+    return pos_;
+}
+
+int32_t EsReader::Seek(uint64_t time)
+{
+    if (fd_ < 0)
+        return static_cast<int>(KUnInitialize);
+
+    //最后一个ts<=time的关键帧
+    size_t lo = 0, hi = index_.size();
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (index_[mid].ts <= time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    pos_ = lo ? index_[lo - 1].offset : sizeof(header_);
+
+    return static_cast<int>(KSuccess);
+}
+
+bool EsReader::Resync()
+{
+    //在之后的窗口内查找同步字,且记录头合法
+    std::vector<uint8_t> window(ES_RESYNC_WINDOW);
+    uint64_t start = pos_ + 1;
+    while (start + sizeof(EsRecordHeader) <= size_)
+    {
+        ssize_t len = pread(fd_, window.data(), window.size(), start);
+        if (len < static_cast<ssize_t>(sizeof(EsRecordHeader)))
+            return false;
+        for (ssize_t i = 0; i + static_cast<ssize_t>(sizeof(EsRecordHeader)) <= len; i++)
+        {
+            EsRecordHeader header;
+            memcpy(&header, &window[i], sizeof(header));
+            if (ValidHeader(header) && start + i + sizeof(header) + header.len <= size_)
+            {
+                log_w("%s resync at %llu,skip %llu bytes", filename_.c_str(), (unsigned long long)(start + i),
+                      (unsigned long long)(start + i - pos_));
+                pos_ = start + i;
+                return true;
+            }
+        }
+        start += len - sizeof(EsRecordHeader) + 1;
+    }
+    return false;
+}
+
+int32_t EsReader::Next(VideoFrame &frame, bool &meta)
+{
+    if (fd_ < 0)
+        return static_cast<int>(KUnInitialize);
+
+    EsRecordHeader header;
+    while (true)
+    {
+        if (pos_ + sizeof(header) > size_ ||
+            pread(fd_, &header, sizeof(header), pos_) != sizeof(header))
+            return static_cast<int>(KNotFound);
+
+        if (ValidHeader(header))
+        {
+            //文件尾写了一半的记录
+            if (pos_ + sizeof(header) + header.len > size_)
+                return static_cast<int>(KNotFound);
+            break;
+        }
+
+        if (!Resync())
+            return static_cast<int>(KNotFound);
+    }
+
+    buf_.resize(header.len);
+    if (pread(fd_, buf_.data(), header.len, pos_ + sizeof(header)) != static_cast<ssize_t>(header.len))
+        return static_cast<int>(KSystemError);
+    pos_ += sizeof(header) + header.len;
+
+    meta = header.sync == ES_META_SYNC;
+    frame.data = buf_.data();
+    frame.len = header.len;
+    frame.ts = header.ts;
+    frame.type = 0;
+    if (!meta)
+    {
+        //长度前缀恢复为起始码
+        buf_[0] = 0;
+        buf_[1] = 0;
+        buf_[2] = 0;
+        buf_[3] = 1;
+        frame.type = buf_[4] & 0x1f;
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+void EsReader::Close()
+{
+    if (fd_ >= 0)
+        close(fd_);
+    fd_ = -1;
+    size_ = 0;
+    pos_ = 0;
+    index_.clear();
+    buf_.clear();
+}
+
+EsReader::EsReader() : fd_(-1),
+                       size_(0),
+                       pos_(0)
+{
+    memset(&header_, 0, sizeof(header_));
+}
+
+EsReader::~EsReader()
+{
+    Close();
+}
+} // namespace nvr
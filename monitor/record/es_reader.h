@@ -0,0 +1,57 @@
+#ifndef ES_READER_H_
+#define ES_READER_H_
+
+#include "record/es_format.h"
+#include "video_codec/video_codec_define.h"
+
+#include <string>
+#include <vector>
+
+namespace nvr
+{
+
+//读取裸码流录像,视频帧恢复为起始码格式,可直接交给Muxer封装
+class EsReader
+{
+public:
+    EsReader();
+
+    ~EsReader();
+
+    int32_t Open(const std::string &filename);
+
+    void Close();
+
+    int Width() const;
+
+    int Height() const;
+
+    int FrameRate() const;
+
+    //定位到time(相对第一帧,us)之前最近的关键帧,没有索引时从头开始
+    int32_t Seek(uint64_t time);
+
+    //读取下一条记录,meta为true时frame为元数据,读到文件尾返回KNotFound
+    int32_t Next(VideoFrame &frame, bool &meta);
+
+    //当前读取位置之后的有效数据末尾,用于截断损坏的文件尾
+    uint64_t Position() const;
+
+    //读取关键帧索引,丢弃写了一半或越界的记录
+    static int32_t LoadIndex(const std::string &filename, std::vector<EsIndexEntry> &entries);
+
+private:
+    bool Resync();
+
+private:
+    int fd_;
+    uint64_t size_;
+    uint64_t pos_;
+    EsFileHeader header_;
+    std::vector<EsIndexEntry> index_;
+    std::vector<uint8_t> buf_;
+    std::string filename_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,228 @@
+#include "record/event_index.h"
+#include "common/res_code.h"
+#include "common/system.h"
+#include "common/crc32.h"
+
+#include <time.h>
+#include <sys/mman.h>
+
+#define EVENT_INDEX_MAGIC 0x5456454e //"NEVT"
+#define EVENT_INDEX_VERSION 1
+
+namespace nvr
+{
+
+struct EventHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t reserved;
+};
+
+static std::string GetDay(uint64_t time)
+{
+    time_t sec = time / 1000000;
+    struct tm tm;
+    localtime_r(&sec, &tm);
+    char buf[32];
+    strftime(buf, sizeof(buf), RECORD_DIR_FORMAT, &tm);
+    return buf;
+}
+
+int32_t EventIndex::Initialize(const std::string &path)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    path_ = path;
+    day_.clear();
+    fd_ = -1;
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EventIndex::OpenDay(const std::string &day)
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    err_code code;
+    std::string dir = path_ + '/' + day;
+    code = static_cast<err_code>(System::CreateDir(dir));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    std::string filename = dir + '/' + RECORD_EVENT_INDEX_FILE;
+    fd_ = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0)
+    {
+        log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    struct stat st;
+    fstat(fd_, &st);
+
+    EventHeader header;
+    if (st.st_size >= static_cast<off_t>(sizeof(header)) &&
+        pread(fd_, &header, sizeof(header), 0) == sizeof(header) &&
+        header.magic == EVENT_INDEX_MAGIC && header.version == EVENT_INDEX_VERSION && header.entry_size == sizeof(Event))
+    {
+        //丢弃掉电时写了一半的记录
+        off_t tail = (st.st_size - sizeof(header)) % sizeof(Event);
+        if (tail != 0 && ftruncate(fd_, st.st_size - tail) != 0)
+            log_w("ftruncate %s failed,%s", filename.c_str(), strerror(errno));
+    }
+    else
+    {
+        if (st.st_size != 0)
+            log_w("%s corrupted,recreate", filename.c_str());
+        if (ftruncate(fd_, 0) != 0)
+            log_w("ftruncate %s failed,%s", filename.c_str(), strerror(errno));
+
+        header.magic = EVENT_INDEX_MAGIC;
+        header.version = EVENT_INDEX_VERSION;
+        header.entry_size = sizeof(Event);
+        header.reserved = 0;
+        if (write(fd_, &header, sizeof(header)) != sizeof(header))
+        {
+            log_e("write %s failed,%s", filename.c_str(), strerror(errno));
+            close(fd_);
+            fd_ = -1;
+            return static_cast<int>(KSystemError);
+        }
+    }
+
+    day_ = day;
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EventIndex::Append(Event &event)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    std::string day = GetDay(event.time);
+    if (fd_ < 0 || day != day_)
+    {
+        err_code code;
+        code = static_cast<err_code>(OpenDay(day));
+        if (KSuccess != code)
+            return static_cast<int>(code);
+    }
+
+    event.reserved = 0;
+    event.crc = 0;
+    event.crc = Crc32(&event, sizeof(event));
+    if (write(fd_, &event, sizeof(event)) != sizeof(event))
+    {
+        log_e("write event index failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    return static_cast<int>(KSuccess);
+}
+
+int32_t EventIndex::Query(const std::string &path, uint64_t begin, uint64_t end, std::vector<Event> &events)
+{
+    if (begin > end)
+        return static_cast<int>(KSuccess);
+
+    //按本地时间逐天查找
+    time_t sec = begin / 1000000;
+    while (static_cast<uint64_t>(sec) * 1000000 <= end)
+    {
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        char day[32];
+        strftime(day, sizeof(day), RECORD_DIR_FORMAT, &tm);
+
+        tm.tm_mday += 1;
+        tm.tm_hour = 0;
+        tm.tm_min = 0;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        sec = mktime(&tm);
+
+        std::string filename = path + '/' + day + '/' + RECORD_EVENT_INDEX_FILE;
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(EventHeader) + sizeof(Event)))
+        {
+            close(fd);
+            continue;
+        }
+
+        size_t size = st.st_size;
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED)
+            continue;
+
+        const EventHeader *header = static_cast<const EventHeader *>(addr);
+        if (header->magic != EVENT_INDEX_MAGIC || header->version != EVENT_INDEX_VERSION || header->entry_size != sizeof(Event))
+        {
+            munmap(addr, size);
+            continue;
+        }
+
+        const Event *entries = reinterpret_cast<const Event *>(static_cast<const uint8_t *>(addr) + sizeof(EventHeader));
+        size_t count = (size - sizeof(EventHeader)) / sizeof(Event);
+
+        //第一个time>=begin的记录
+        size_t lo = 0, hi = count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (entries[mid].time < begin)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        for (size_t i = lo; i < count && entries[i].time <= end; i++)
+        {
+            Event event = entries[i];
+            event.crc = 0;
+            if (Crc32(&event, sizeof(event)) != entries[i].crc)
+                continue;
+            event.crc = entries[i].crc;
+            events.push_back(event);
+        }
+        munmap(addr, size);
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+void EventIndex::Close()
+{
+    if (!init_)
+        return;
+
+    if (fd_ >= 0)
+        close(fd_);
+    fd_ = -1;
+    day_.clear();
+
+    init_ = false;
+}
+
+EventIndex::EventIndex() : fd_(-1),
+                           init_(false)
+{
+}
+
+EventIndex::~EventIndex()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,63 @@
+#ifndef EVENT_INDEX_H_
+#define EVENT_INDEX_H_
+
+#include "global.h"
+
+#include <string>
+#include <vector>
+
+#define RECORD_EVENT_INDEX_FILE ".events.idx" //每天一个,保存在日期目录下
+#define RECORD_EVENT_MAX_RECTS 8
+
+namespace nvr
+{
+
+//移动侦测事件索引:按天追加定长记录,按时间段查询时只需二分查找当天的索引文件
+class EventIndex
+{
+public:
+    struct Rect
+    {
+        uint16_t left;
+        uint16_t top;
+        uint16_t right;
+        uint16_t bottom;
+    };
+
+    struct Event
+    {
+        uint64_t time; //墙上时间(us)
+        uint16_t num;  //运动区域总数
+        uint16_t count;
+        uint16_t width; //坐标对应的分辨率
+        uint16_t height;
+        Rect rects[RECORD_EVENT_MAX_RECTS];
+        uint32_t reserved;
+        uint32_t crc;
+    };
+
+    EventIndex();
+
+    ~EventIndex();
+
+    int32_t Initialize(const std::string &path);
+
+    void Close();
+
+    int32_t Append(Event &event);
+
+    //查询[begin,end]内的事件
+    static int32_t Query(const std::string &path, uint64_t begin, uint64_t end, std::vector<Event> &events);
+
+private:
+    int32_t OpenDay(const std::string &day);
+
+private:
+    std::string path_;
+    std::string day_;
+    int fd_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
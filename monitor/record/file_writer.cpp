@@ -0,0 +1,378 @@
+#include "record/file_writer.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#include <algorithm>
+
+#include <linux/falloc.h>
+
+#define FILE_WRITER_CHUNKS 4      //缓存块数量,IO线程最多落后3个块
+#define FILE_WRITER_ALIGN 4096    //缓存块和写入偏移按页对齐
+#define FILE_WRITER_HIST_BASE 256 //直方图第一个桶上限(us)
+
+namespace nvr
+{
+
+int32_t FileWriter::Initialize(const std::string &filename, const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    params_ = params;
+    params_.align_size = (params_.align_size + FILE_WRITER_ALIGN - 1) / FILE_WRITER_ALIGN * FILE_WRITER_ALIGN;
+    if (params_.align_size == 0)
+        params_.align_size = FILE_WRITER_ALIGN;
+    params_.chunk_size = (params_.chunk_size + params_.align_size - 1) / params_.align_size * params_.align_size;
+    if (params_.chunk_size == 0)
+        params_.chunk_size = params_.align_size;
+
+    for (int i = 0; i < FILE_WRITER_CHUNKS; i++)
+    {
+        void *buf = nullptr;
+        if (posix_memalign(&buf, FILE_WRITER_ALIGN, params_.chunk_size) != 0)
+        {
+            log_e("posix_memalign failed");
+            for (auto chunk : chunks_)
+                free(chunk);
+            chunks_.clear();
+            return static_cast<int>(KSystemError);
+        }
+        chunks_.push_back(static_cast<uint8_t *>(buf));
+    }
+
+    fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+        for (auto chunk : chunks_)
+            free(chunk);
+        chunks_.clear();
+        return static_cast<int>(KSystemError);
+    }
+
+    filename_ = filename;
+    free_.assign(chunks_.begin() + 1, chunks_.end());
+    cur_ = chunks_[0];
+    used_ = 0;
+    flushed_ = 0;
+    base_ = 0;
+    allocated_ = 0;
+    last_sync_ = System::GetSteadyMilliSeconds();
+    error_ = static_cast<int>(KSuccess);
+    memset(write_hist_, 0, sizeof(write_hist_));
+    memset(sync_hist_, 0, sizeof(sync_hist_));
+    write_bytes_ = 0;
+    write_us_ = 0;
+    write_max_us_ = 0;
+    unaligned_ = 0;
+    sync_max_us_ = 0;
+    stalls_ = 0;
+
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() { IOThread(); }));
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+uint8_t *FileWriter::GetChunk()
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    if (free_.empty())
+    {
+        stalls_++;
+        free_cond_.wait(lock, [this]() { return !free_.empty(); });
+    }
+    uint8_t *buf = free_.back();
+    free_.pop_back();
+    return buf;
+}
+
+void FileWriter::Submit(uint8_t *buf, const uint8_t *data, uint64_t offset, uint32_t len, bool sync)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    requests_.push_back(Request{buf, data, offset, len, sync});
+    cond_.notify_one();
+}
+
+int32_t FileWriter::Write(const void *data, size_t len)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (KSuccess != error_)
+        return error_;
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (len > 0)
+    {
+        uint32_t n = std::min<size_t>(len, params_.chunk_size - used_);
+        memcpy(cur_ + used_, p, n);
+        used_ += n;
+        p += n;
+        len -= n;
+
+        //块写满后只写入Commit时还未提交的部分
+        if (used_ == params_.chunk_size)
+        {
+            Submit(cur_, cur_ + flushed_, base_ + flushed_, used_ - flushed_, false);
+            base_ += used_;
+            used_ = 0;
+            flushed_ = 0;
+            cur_ = GetChunk();
+        }
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t FileWriter::Commit()
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (KSuccess != error_)
+        return error_;
+
+    uint64_t now = System::GetSteadyMilliSeconds();
+    if (params_.sync_interval == FILE_WRITER_NO_SYNC || now - last_sync_ < params_.sync_interval)
+        return static_cast<int>(KSuccess);
+    last_sync_ = now;
+
+    //只写入当前块中已对齐的部分,IO线程读取的范围与之后追加的范围不重叠,无需拷贝
+    //不足一个对齐单位的尾部留在缓存中,掉电时最多多丢失align_size字节
+    uint32_t aligned = used_ / params_.align_size * params_.align_size;
+    if (aligned > flushed_)
+    {
+        Submit(nullptr, cur_ + flushed_, base_ + flushed_, aligned - flushed_, true);
+        flushed_ = aligned;
+    }
+    else
+    {
+        Submit(nullptr, nullptr, base_, 0, true);
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t FileWriter::Sync()
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (KSuccess != error_)
+        return error_;
+
+    last_sync_ = System::GetSteadyMilliSeconds();
+
+    //写到当前位置,IO线程读取的范围之后只会追加,不会修改;flushed_只推进到对齐处,不对齐的尾部留到下次按对齐单位重写
+    Submit(nullptr, cur_ + flushed_, base_ + flushed_, used_ - flushed_, true);
+    flushed_ = used_ / params_.align_size * params_.align_size;
+
+    return static_cast<int>(KSuccess);
+}
+
+uint64_t FileWriter::Position() const
+{
+    return base_ + used_;
+}
+
+uint32_t FileWriter::AlignSize() const
+{
+    return params_.align_size;
+}
+
+void FileWriter::Preallocate(uint64_t end)
+{
+    if (params_.prealloc_size == 0 || end <= allocated_)
+        return;
+
+    //KEEP_SIZE:文件大小不变,掉电后文件尾部不会出现空洞数据
+    uint64_t len = (end - allocated_ + params_.prealloc_size - 1) / params_.prealloc_size * params_.prealloc_size;
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_, len) != 0)
+    {
+        log_w("fallocate %s failed,%s,disable preallocation", filename_.c_str(), strerror(errno));
+        params_.prealloc_size = 0;
+        return;
+    }
+    allocated_ += len;
+}
+
+void FileWriter::IOThread()
+{
+    while (true)
+    {
+        Request req;
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            cond_.wait(lock, [this]() { return !requests_.empty() || !run_; });
+            if (requests_.empty())
+                break;
+            req = requests_.front();
+            requests_.pop_front();
+        }
+
+        if (req.len > 0 && KSuccess == error_)
+        {
+            Preallocate(req.offset + req.len);
+
+            if (req.offset % params_.align_size != 0 || req.len % params_.align_size != 0)
+                unaligned_++;
+
+            uint64_t start = System::GetSteadyMicroSeconds();
+            uint32_t done = 0;
+            while (done < req.len)
+            {
+                ssize_t ret = pwrite(fd_, req.data + done, req.len - done, req.offset + done);
+                if (ret < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    log_e("pwrite %s failed,%s", filename_.c_str(), strerror(errno));
+                    error_ = static_cast<int>(KSystemError);
+                    break;
+                }
+                done += ret;
+            }
+            uint64_t cost = System::GetSteadyMicroSeconds() - start;
+
+            int i = 0;
+            while (i < KHistBuckets && cost >= (static_cast<uint64_t>(FILE_WRITER_HIST_BASE) << i))
+                i++;
+            write_hist_[i]++;
+            write_bytes_ += done;
+            write_us_ += cost;
+            write_max_us_ = std::max(write_max_us_, cost);
+        }
+
+        if (req.sync && KSuccess == error_)
+        {
+            uint64_t start = System::GetSteadyMicroSeconds();
+            if (fdatasync(fd_) != 0)
+                log_w("fdatasync %s failed,%s", filename_.c_str(), strerror(errno));
+            uint64_t cost = System::GetSteadyMicroSeconds() - start;
+
+            int i = 0;
+            while (i < KHistBuckets && cost >= (static_cast<uint64_t>(FILE_WRITER_HIST_BASE) << i))
+                i++;
+            sync_hist_[i]++;
+            sync_max_us_ = std::max(sync_max_us_, cost);
+
+            //已落盘的数据不再需要留在页缓存
+            posix_fadvise(fd_, 0, req.offset + req.len, POSIX_FADV_DONTNEED);
+        }
+
+        if (req.buf)
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            free_.push_back(req.buf);
+            free_cond_.notify_one();
+        }
+    }
+}
+
+static uint64_t Percentile(const uint32_t *hist, int buckets, double ratio)
+{
+    uint64_t total = 0;
+    for (int i = 0; i <= buckets; i++)
+        total += hist[i];
+    if (total == 0)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(total * ratio + 0.5);
+    uint64_t count = 0;
+    for (int i = 0; i < buckets; i++)
+    {
+        count += hist[i];
+        if (count >= target)
+            return static_cast<uint64_t>(FILE_WRITER_HIST_BASE) << i;
+    }
+    return static_cast<uint64_t>(FILE_WRITER_HIST_BASE) << buckets;
+}
+
+void FileWriter::LogStats()
+{
+    uint32_t writes = 0;
+    uint32_t syncs = 0;
+    for (int i = 0; i <= KHistBuckets; i++)
+    {
+        writes += write_hist_[i];
+        syncs += sync_hist_[i];
+    }
+
+    //写放大:实际写入字节数/文件大小,只统计本进程发出的写入
+    uint64_t size = base_ + used_;
+    double mbps = write_us_ ? write_bytes_ / (double)write_us_ : 0; // bytes/us = MB/s
+    double amplification = size ? write_bytes_ / (double)size : 0;
+    log_i("%s:%llu bytes,%u writes,%u unaligned,amplification %.3f,%.1f MB/s,write p50<%llu us,p99<%llu us,max %llu us,%u syncs,sync p99<%llu us,max %llu us,%u stalls",
+          filename_.c_str(), (unsigned long long)write_bytes_, writes, unaligned_, amplification, mbps,
+          (unsigned long long)Percentile(write_hist_, KHistBuckets, 0.5),
+          (unsigned long long)Percentile(write_hist_, KHistBuckets, 0.99),
+          (unsigned long long)write_max_us_, syncs,
+          (unsigned long long)Percentile(sync_hist_, KHistBuckets, 0.99),
+          (unsigned long long)sync_max_us_, stalls_);
+}
+
+void FileWriter::Close()
+{
+    if (!init_)
+        return;
+
+    //最后一块剩余部分和同步请求,文件尾是唯一可能不对齐的写入
+    Submit(cur_, cur_ + flushed_, base_ + flushed_, used_ - flushed_, true);
+    cur_ = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        run_ = false;
+        cond_.notify_one();
+    }
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+
+    //释放文件尾之后多余的预分配空间
+    uint64_t size = base_ + used_;
+    if (allocated_ > size)
+        fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, size, allocated_ - size);
+
+    close(fd_);
+    fd_ = -1;
+
+    LogStats();
+
+    for (auto chunk : chunks_)
+        free(chunk);
+    chunks_.clear();
+    free_.clear();
+    requests_.clear();
+
+    init_ = false;
+}
+
+FileWriter::FileWriter() : fd_(-1),
+                           cur_(nullptr),
+                           used_(0),
+                           flushed_(0),
+                           base_(0),
+                           last_sync_(0),
+                           allocated_(0),
+                           error_(0),
+                           write_bytes_(0),
+                           write_us_(0),
+                           write_max_us_(0),
+                           unaligned_(0),
+                           sync_max_us_(0),
+                           stalls_(0),
+                           run_(false),
+                           thread_(nullptr),
+                           init_(false)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,112 @@
+#ifndef FILE_WRITER_H_
+#define FILE_WRITER_H_
+
+#include "global.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define FILE_WRITER_NO_SYNC UINT32_MAX //不按周期同步,只在Close时同步一次,用于导出等掉电后可以重做的写入
+
+namespace nvr
+{
+
+//后写式文件写入:调用方只拷贝到对齐的大块缓存,IO线程用pwrite整块写入,按周期fdatasync
+//Write/Commit的写入按align_size对齐并顺序追加(文件尾除外),每个字节只写一次,SD卡不会因为重写同一页产生额外擦除
+//Sync会写入不对齐的尾部,调用方需要先补齐到对齐单位(见AlignSize)才能保持每个字节只写一次
+class FileWriter
+{
+public:
+    struct Params
+    {
+        uint32_t chunk_size;    //单次写入大小(字节)
+        uint64_t prealloc_size; //每次预分配的extent大小(字节),0为关闭
+        uint32_t sync_interval; //fdatasync周期(ms),0为每次Commit都同步,FILE_WRITER_NO_SYNC为只在Close时同步
+        uint32_t align_size;    //写入对齐单位(字节),Commit时不足一个单位的尾部留到下次写入,0为页大小
+    };
+
+    FileWriter();
+
+    ~FileWriter();
+
+    int32_t Initialize(const std::string &filename, const Params &params);
+
+    //拷贝到当前块,块写满后交给IO线程,缓存块用完时阻塞
+    int32_t Write(const void *data, size_t len);
+
+    //一段完整的数据写完(例如一个分片),到达同步周期时提交当前块中已对齐的部分并同步
+    int32_t Commit();
+
+    //立即提交当前块中所有未写入的数据并同步,用于每个分片的边界
+    //Position不在对齐单位上时,尾部所在的单位之后会随下一次写入再写一次
+    int32_t Sync();
+
+    uint64_t Position() const;
+
+    //实际使用的对齐单位,Initialize时按页大小向上取整
+    uint32_t AlignSize() const;
+
+    void Close();
+
+private:
+    struct Request
+    {
+        uint8_t *buf;        //写完后归还的缓存块,部分写入时为空
+        const uint8_t *data;
+        uint64_t offset;
+        uint32_t len;
+        bool sync;
+    };
+
+    uint8_t *GetChunk();
+
+    void Submit(uint8_t *buf, const uint8_t *data, uint64_t offset, uint32_t len, bool sync);
+
+    void IOThread();
+
+    void Preallocate(uint64_t end);
+
+    void LogStats();
+
+private:
+    int fd_;
+    std::string filename_;
+    Params params_;
+    std::vector<uint8_t *> chunks_;
+    std::vector<uint8_t *> free_;
+    std::deque<Request> requests_;
+    std::mutex mux_;
+    std::condition_variable cond_;
+    std::condition_variable free_cond_;
+    uint8_t *cur_;
+    uint32_t used_;
+    uint32_t flushed_; //当前块已提交写入的长度
+    uint64_t base_;
+    uint64_t last_sync_;
+    uint64_t allocated_;
+    std::atomic<int32_t> error_;
+
+    //延迟直方图,第i个桶统计小于(256us<<i)的次数,最后一个桶为溢出
+    static const int KHistBuckets = 14;
+    uint32_t write_hist_[KHistBuckets + 1];
+    uint32_t sync_hist_[KHistBuckets + 1];
+    uint64_t write_bytes_;
+    uint64_t write_us_;
+    uint64_t write_max_us_;
+    uint32_t unaligned_; //偏移或长度未对齐的写入次数
+    uint64_t sync_max_us_;
+    uint32_t stalls_;
+
+    bool run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
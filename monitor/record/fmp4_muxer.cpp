@@ -0,0 +1,233 @@
+#include "record/fmp4_muxer.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#define FMP4_MAX_FRAGMENT_SIZE (4 * 1024 * 1024) //单个分片最大4MB,限制内存占用
+
+namespace nvr
+{
+
+int32_t FMP4Muxer::Initialize(const std::string &filename, int width, int height, int frame_rate)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+    code = static_cast<err_code>(writer_.Initialize(filename, params_));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    packager_.Initialize(width, height, frame_rate);
+    gop_buf_.reserve(FMP4_MAX_FRAGMENT_SIZE);
+    last_sync_ = System::GetSteadyMilliSeconds();
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t FMP4Muxer::WriteInitSegment()
+{
+    std::string init;
+    packager_.BuildInitSegment(init);
+    write_init_ = true;
+    return writer_.Write(init.data(), init.size());
+}
+
+int32_t FMP4Muxer::Flush()
+{
+    if (pending_.empty())
+        return static_cast<int>(KSuccess);
+
+    samples_.resize(pending_.size());
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+        FMP4Packager::Sample &sample = samples_[i];
+        sample.data = reinterpret_cast<const uint8_t *>(gop_buf_.data()) + pending_[i].offset;
+        sample.len = pending_[i].len;
+        sample.dts = (pending_[i].ts - base_ts_) * FMP4Packager::KTimeScale / 1000000;
+        sample.key = pending_[i].key;
+        if (i > 0)
+            samples_[i - 1].duration = static_cast<uint32_t>(sample.dts - samples_[i - 1].dts);
+    }
+    samples_.back().duration = packager_.SampleDuration();
+
+    header_.clear();
+    packager_.BuildFragmentHeader(&samples_[0], samples_.size(), header_);
+
+    err_code code = KSuccess;
+    if (!emsg_.empty())
+    {
+        code = static_cast<err_code>(writer_.Write(emsg_.data(), emsg_.size()));
+        emsg_.clear();
+    }
+    if (KSuccess == code)
+        code = static_cast<err_code>(writer_.Write(header_.data(), header_.size()));
+    if (KSuccess == code)
+        code = static_cast<err_code>(writer_.Write(gop_buf_.data(), gop_buf_.size()));
+
+    pending_.clear();
+    gop_buf_.clear();
+
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    //到达同步周期时落盘到当前分片结束,掉电后文件可以播放到最后一个同步的分片,sync_interval为0时每个分片都同步
+    //先用free box补齐到对齐单位,同步的范围以整单位结束,下一个分片不会重写同一单位
+    uint64_t now = System::GetSteadyMilliSeconds();
+    if (params_.sync_interval == FILE_WRITER_NO_SYNC || now - last_sync_ < params_.sync_interval)
+        return static_cast<int>(KSuccess);
+    last_sync_ = now;
+
+    code = static_cast<err_code>(Pad());
+    if (KSuccess != code)
+        return static_cast<int>(code);
+    return writer_.Sync();
+}
+
+int32_t FMP4Muxer::Pad()
+{
+    uint32_t align = writer_.AlignSize();
+    uint32_t pad = (align - writer_.Position() % align) % align;
+    if (pad == 0)
+        return static_cast<int>(KSuccess);
+    //free box至少8字节
+    if (pad < 8)
+        pad += align;
+
+    pad_.assign(pad, '\0');
+    pad_[0] = (pad >> 24) & 0xff;
+    pad_[1] = (pad >> 16) & 0xff;
+    pad_[2] = (pad >> 8) & 0xff;
+    pad_[3] = pad & 0xff;
+    memcpy(&pad_[4], "free", 4);
+    return writer_.Write(pad_.data(), pad_.size());
+}
+
+int32_t FMP4Muxer::WriteVideoFrame(const VideoFrame &frame)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (frame.len <= 4)
+        return static_cast<int>(KSuccess);
+
+    err_code code;
+
+    switch (frame.type)
+    {
+    case H264Frame::NaluType::SPS:
+    case H264Frame::NaluType::PPS:
+        if (!write_init_)
+            packager_.SetParameterSet(&frame.data[4], frame.len - 4);
+        break;
+
+    case H264Frame::NaluType::SEI:
+        break;
+
+    case H264Frame::NaluType::ISLICE:
+    case H264Frame::NaluType::PSLICE:
+    {
+        bool key = frame.type == H264Frame::NaluType::ISLICE;
+
+        if (!write_init_)
+        {
+            if (!key || !packager_.Ready())
+                break;
+            code = static_cast<err_code>(WriteInitSegment());
+            if (KSuccess != code)
+                return static_cast<int>(code);
+            base_ts_ = frame.ts;
+        }
+
+        if (key || gop_buf_.size() + frame.len > FMP4_MAX_FRAGMENT_SIZE)
+        {
+            code = static_cast<err_code>(Flush());
+            if (KSuccess != code)
+                return static_cast<int>(code);
+        }
+
+        uint32_t len = frame.len - 4;
+        frame.data[0] = (len >> 24) & 0xff;
+        frame.data[1] = (len >> 16) & 0xff;
+        frame.data[2] = (len >> 8) & 0xff;
+        frame.data[3] = len & 0xff;
+
+        PendingSample sample;
+        sample.offset = gop_buf_.size();
+        sample.len = frame.len;
+        sample.ts = frame.ts;
+        sample.key = key;
+        pending_.push_back(sample);
+        gop_buf_.append(reinterpret_cast<const char *>(frame.data), frame.len);
+        break;
+    }
+
+    default:
+        log_w("unknow h264 frame type:%d", frame.type);
+        break;
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t FMP4Muxer::WriteMetadata(uint64_t ts, const std::string &data)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (!write_init_ || ts < base_ts_)
+        return static_cast<int>(KSuccess);
+
+    BoxWriter w(emsg_);
+    size_t emsg = w.BeginFull("emsg", 1, 0);
+    w.U32(FMP4Packager::KTimeScale);
+    w.U64((ts - base_ts_) * FMP4Packager::KTimeScale / 1000000); //presentation_time
+    w.U32(FMP4Packager::KTimeScale);                              //event_duration
+    w.U32(emsg_id_++);
+    w.Bytes(FMP4_EMSG_SCHEME, strlen(FMP4_EMSG_SCHEME) + 1);
+    w.U8(0); //value
+    w.Bytes(data.data(), data.size());
+    w.End(emsg);
+
+    return static_cast<int>(KSuccess);
+}
+
+uint64_t FMP4Muxer::Position()
+{
+    return writer_.Position();
+}
+
+void FMP4Muxer::Close()
+{
+    if (!init_)
+        return;
+
+    Flush();
+    writer_.Close();
+    packager_.Reset();
+    pending_.clear();
+    gop_buf_.clear();
+    emsg_.clear();
+    pad_.clear();
+    emsg_id_ = 0;
+    base_ts_ = 0;
+    write_init_ = false;
+
+    init_ = false;
+}
+
+FMP4Muxer::FMP4Muxer(const FileWriter::Params &params) : params_(params),
+                                                         emsg_id_(0),
+                                                         last_sync_(0),
+                                                         base_ts_(0),
+                                                         write_init_(false),
+                                                         init_(false)
+{
+}
+
+FMP4Muxer::~FMP4Muxer()
+{
+    Close();
+}
+} // namespace nvr
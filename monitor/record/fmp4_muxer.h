@@ -0,0 +1,69 @@
+#ifndef FMP4_MUXER_H_
+#define FMP4_MUXER_H_
+
+#include "record/muxer.h"
+#include "record/file_writer.h"
+#include "common/fmp4.h"
+
+#include <string>
+#include <vector>
+
+#define FMP4_EMSG_SCHEME "urn:nvr:motion" //移动侦测事件emsg的scheme_id_uri
+
+namespace nvr
+{
+
+//每个GOP写一个moof/mdat,到达sync_interval后在分片边界补齐到对齐单位并落盘,
+//掉电最多丢失sync_interval内的分片和正在缓存的一个GOP,关闭时无需回写moov
+class FMP4Muxer : public Muxer
+{
+public:
+    explicit FMP4Muxer(const FileWriter::Params &params);
+
+    ~FMP4Muxer() override;
+
+    int32_t Initialize(const std::string &filename, int width, int height, int frame_rate) override;
+
+    int32_t WriteVideoFrame(const VideoFrame &frame) override;
+
+    void Close() override;
+
+    uint64_t Position() override;
+
+    //事件以emsg box写在所属分片之前
+    int32_t WriteMetadata(uint64_t ts, const std::string &data) override;
+
+private:
+    struct PendingSample
+    {
+        uint32_t offset;
+        uint32_t len;
+        uint64_t ts;
+        bool key;
+    };
+
+    int32_t WriteInitSegment();
+
+    int32_t Flush();
+
+    //写入free box,使文件位置落在对齐单位上
+    int32_t Pad();
+
+private:
+    FileWriter writer_;
+    FileWriter::Params params_;
+    FMP4Packager packager_;
+    std::string gop_buf_;
+    std::vector<PendingSample> pending_;
+    std::vector<FMP4Packager::Sample> samples_;
+    std::string header_;
+    std::string emsg_;
+    std::string pad_;
+    uint32_t emsg_id_;
+    uint64_t last_sync_; //上次同步的时间(ms)
+    uint64_t base_ts_;
+    bool write_init_;
+    bool init_;
+};
+} // namespace nvr
+#endif
@@ -1,6 +1,11 @@
 #include "record/mp4_muxer.h"
 #include "common/res_code.h"
 
+#include <algorithm>
+
+#define MP4_TEXT_TIMESCALE 1000 //文本轨道时间单位ms
+#define MP4_TEXT_DURATION 1000  //每个事件显示时长(ms)
+
 namespace nvr
 {
 
@@ -66,6 +71,9 @@ int32_t MP4Muxer::WriteVideoFrame(const VideoFrame &frame)
         case H264Frame::NaluType::ISLICE:
         case H264Frame::NaluType::PSLICE:
         {
+            if (first_ts_ == 0)
+                first_ts_ = frame.ts;
+
             uint32_t len = frame.len - 4;
             frame.data[0] = (len >> 24) & 0xff;
             frame.data[1] = (len >> 16) & 0xff;
@@ -90,6 +98,55 @@ int32_t MP4Muxer::WriteVideoFrame(const VideoFrame &frame)
     return static_cast<int>(KSuccess);
 }
 
+int32_t MP4Muxer::WriteMetadata(uint64_t ts, const std::string &data)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    if (!write_meta_ || first_ts_ == 0 || ts < first_ts_)
+        return static_cast<int>(KSuccess);
+
+    if (text_track_ == MP4_INVALID_TRACK_ID)
+    {
+        text_track_ = MP4AddSubtitleTrack(handle_, MP4_TEXT_TIMESCALE, width_, height_);
+        if (text_track_ == MP4_INVALID_TRACK_ID)
+        {
+            log_e("MP4AddSubtitleTrack failed");
+            return static_cast<int>(KThirdPartyError);
+        }
+    }
+
+    //文本轨道按时长连续排列,事件之间用空样本填充,与上一个事件重叠时丢弃
+    uint64_t time = (ts - first_ts_) * MP4_TEXT_TIMESCALE / 1000000;
+    if (time < text_time_)
+        return static_cast<int>(KSuccess);
+
+    uint8_t empty[2] = {0, 0};
+    if (time > text_time_)
+    {
+        if (!MP4WriteSample(handle_, text_track_, empty, sizeof(empty), time - text_time_))
+        {
+            log_e("MP4WriteSample failed");
+            return static_cast<int>(KThirdPartyError);
+        }
+    }
+
+    //tx3g样本:16位长度+UTF-8文本
+    std::string sample;
+    uint16_t len = std::min<size_t>(data.size(), 0xffff);
+    sample.push_back(static_cast<char>(len >> 8));
+    sample.push_back(static_cast<char>(len & 0xff));
+    sample.append(data, 0, len);
+    if (!MP4WriteSample(handle_, text_track_, reinterpret_cast<const uint8_t *>(sample.data()), sample.size(), MP4_TEXT_DURATION))
+    {
+        log_e("MP4WriteSample failed");
+        return static_cast<int>(KThirdPartyError);
+    }
+    text_time_ = time + MP4_TEXT_DURATION;
+
+    return static_cast<int>(KSuccess);
+}
+
 void MP4Muxer::Close()
 {
     if (!init_)
@@ -98,6 +155,9 @@ void MP4Muxer::Close()
     MP4Close(handle_);
     handle_ = MP4_INVALID_FILE_HANDLE;
     track_ = MP4_INVALID_TRACK_ID;
+    text_track_ = MP4_INVALID_TRACK_ID;
+    first_ts_ = 0;
+    text_time_ = 0;
     width_ = 0;
     height_ = 0;
     frame_rate_ = 0;
@@ -108,6 +168,9 @@ void MP4Muxer::Close()
 
 MP4Muxer::MP4Muxer() : handle_(MP4_INVALID_FILE_HANDLE),
                          track_(MP4_INVALID_TRACK_ID),
+                         text_track_(MP4_INVALID_TRACK_ID),
+                         first_ts_(0),
+                         text_time_(0),
                          width_(0),
                          height_(0),
                          frame_rate_(0),
@@ -1,7 +1,7 @@
 #ifndef MP4_MUXER_H_
 #define MP4_MUXER_H_
 
-#include "video_codec/video_codec_define.h"
+#include "record/muxer.h"
 
 #include <mp4v2/mp4v2.h>
 
@@ -10,24 +10,30 @@
 namespace nvr
 {
 
-class MP4Muxer
+class MP4Muxer : public Muxer
 {
 public:
     MP4Muxer();
 
-    ~MP4Muxer();
+    ~MP4Muxer() override;
 
-    int32_t Initialize(const std::string &filename, int width, int height, int frame_rate);
+    int32_t Initialize(const std::string &filename, int width, int height, int frame_rate) override;
 
-    int32_t WriteVideoFrame(const VideoFrame &frame);
+    int32_t WriteVideoFrame(const VideoFrame &frame) override;
+
+    void Close() override;
+
+    int32_t WriteMetadata(uint64_t ts, const std::string &data) override;
 
-    void Close();
 private:
     int32_t WriteMetaData();
 
 private:
     MP4FileHandle handle_;
     MP4TrackId track_;
+    MP4TrackId text_track_; //tx3g字幕轨道保存移动侦测事件
+    uint64_t first_ts_;
+    uint64_t text_time_;
     int width_;
     int height_;
     int frame_rate_;
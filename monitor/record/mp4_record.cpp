@@ -1,12 +1,26 @@
 #include "record/mp4_record.h"
 #include "record/mp4_muxer.h"
+#include "record/fmp4_muxer.h"
+#include "record/es_muxer.h"
+#include "record/mp4_recovery.h"
 #include "common/res_code.h"
 #include "common/system.h"
 
 #include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include <dirent.h>
 
 #include <base/ref_counted_object.h>
 
+#define RECORD_TEMP_PREFIX ".record_next_" //预先打开的文件,隐藏文件不参与空间统计
+#define RECORD_RETRY_INTERVAL 1000           //创建文件失败后重试间隔(ms)
+#define RECORD_EVENT_INTERVAL 1000           //移动侦测事件最小记录间隔(ms)
+#define RECORD_EVENT_QUEUE 64                //待写入事件队列上限
+#define RECORD_RECOVER_DAYS 2                //启动时检查最近两天的录像,跨天时掉电也能覆盖
+#define RECORD_TRIGGER_HOLD 1000             //超过此时间(ms)没有触发时进入延录
+
 namespace nvr
 {
 
@@ -27,6 +41,27 @@ rtc::scoped_refptr<RecordModule> MP4RecordImpl::Create(const Params &params)
     return implemention;
 }
 
+static Muxer *CreateMuxer(const RecordModule::Params &params)
+{
+    if (params.format == "fmp4" || params.format == "es")
+    {
+        FileWriter::Params writer_params;
+        writer_params.chunk_size = params.chunk_size * 1024;
+        writer_params.prealloc_size = static_cast<uint64_t>(params.prealloc_size) * 1024 * 1024;
+        writer_params.sync_interval = params.sync_interval;
+        writer_params.align_size = params.align_size * 1024;
+        if (params.format == "es")
+            return new EsMuxer(writer_params);
+        return new FMP4Muxer(writer_params);
+    }
+    return new MP4Muxer();
+}
+
+static const char *FileSuffix(const RecordModule::Params &params)
+{
+    return params.format == "es" ? RECORD_ES_SUFFIX : ".mp4";
+}
+
 bool MP4RecordImpl::RecordNeedToQuit()
 {
 
@@ -44,120 +79,521 @@ bool MP4RecordImpl::RecordNeedToSegment(uint64_t start_time)
 
 void MP4RecordImpl::OnTrigger(int32_t num)
 {
-    end_time_ = System::GetSteadyMilliSeconds() + (params_.md_duration * 1000);
+    //唤醒录像线程,空闲时立即开始录像,不等下一帧
+    uint64_t now = System::GetSteadyMilliSeconds();
+    uint64_t now_us = System::GetSteadyMicroSeconds();
+    std::unique_lock<std::mutex> lock(mux_);
+    //只记录空闲后的第一次触发,录像线程打开文件时取走
+    if (trigger_us_ == 0)
+        trigger_us_ = now_us;
+    trigger_time_ = now;
+    end_time_ = now + (params_.md_duration * 1000);
+    trigger_ = true;
+    cond_.notify_one();
 }
 
-void MP4RecordImpl::RecordThread()
+uint64_t MP4RecordImpl::TriggerLatency() const
 {
+    return trigger_latency_;
 }
 
-int32_t MP4RecordImpl::Initialize(const Params &params)
+void MP4RecordImpl::OnMotion(const MotionEvent &event)
 {
-    if (init_)
-        return static_cast<int>(KDupInitialize);
+    //事件按间隔抽样,避免逐帧写入
+    if (event.ts < last_event_ts_ + RECORD_EVENT_INTERVAL * 1000 && event.ts >= last_event_ts_)
+        return;
+    last_event_ts_ = event.ts;
 
-    params_ = params;
-    run_ = true;
-    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
-        err_code code;
-        MP4Muxer muxer;
-        VideoFrame frame;
-        uint64_t now;
-        uint64_t start_time;
-        bool wait_sps;
-
-        bool init = false;
-        uint8_t *temp_buf = (uint8_t *)malloc(BUFFER_LEN);
-        if (!temp_buf)
-        {
-            log_e("malloc buffer failed");
-            return;
-        }
+    std::unique_lock<std::mutex> lock(mux_);
+    if (events_.size() >= RECORD_EVENT_QUEUE)
+        events_.pop_front();
+    events_.push_back(event);
+}
+
+void MP4RecordImpl::WriteMotion(const MotionEvent &event, uint64_t time, Muxer *muxer)
+{
+    //坐标从检测分辨率换算到录像分辨率
+    EventIndex::Event entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.time = time;
+    entry.num = event.num;
+    entry.count = std::min(event.count, RECORD_EVENT_MAX_RECTS);
+    entry.width = params_.width;
+    entry.height = params_.height;
+
+    std::ostringstream oss;
+    oss << "{\"time\":" << time / 1000 << ",\"num\":" << event.num << ",\"rects\":[";
+    for (int i = 0; i < entry.count; i++)
+    {
+        const DetectRect &rect = event.rects[i];
+        entry.rects[i].left = event.width ? rect.left * params_.width / event.width : rect.left;
+        entry.rects[i].right = event.width ? rect.right * params_.width / event.width : rect.right;
+        entry.rects[i].top = event.height ? rect.top * params_.height / event.height : rect.top;
+        entry.rects[i].bottom = event.height ? rect.bottom * params_.height / event.height : rect.bottom;
+        oss << (i ? "," : "") << '[' << entry.rects[i].left << ',' << entry.rects[i].top << ','
+            << entry.rects[i].right << ',' << entry.rects[i].bottom << ']';
+    }
+    oss << "]}";
+
+    event_index_.Append(entry);
+    if (muxer)
+        muxer->WriteMetadata(event.ts, oss.str());
+}
 
-        now = System::GetSteadyMilliSeconds();
-        while (run_ && RecordNeedToQuit())
-            usleep(500000); //500ms
+void MP4RecordImpl::RecordThread()
+{
+    err_code code;
+    std::unique_ptr<Muxer> muxer;
+    std::string filename;
+    VideoFrame frame;
+    std::deque<MotionEvent> events;
+    int64_t wall_offset = 0; //帧时间戳到墙上时间的偏移
+    uint64_t last_ts = 0;
+    bool index_begin = false;
+    uint64_t start_time = 0;
+    uint64_t retry_time = 0;   //创建文件失败后下次重试的时间
+    uint64_t trigger_begin = 0; //开始录像的触发时间(us),写入第一帧实时码流后统计延迟
+    bool wait_sps = true;
+    bool segment = false;
+    int32_t last_type = H264Frame::NaluType::PSLICE;
+    std::string sps;
+    std::string pps;
+    std::string saved_sps;
+    std::string saved_pps;
+    State state = KIdle;
+
+    uint8_t *temp_buf = (uint8_t *)malloc(BUFFER_LEN);
+    if (!temp_buf)
+    {
+        log_e("malloc buffer failed");
+        return;
+    }
 
-        while (run_)
+    //关闭当前文件回到空闲,之后的码流进入预录缓存,录像期间的触发不计入下一次的延迟
+    auto stop = [&]() {
+        index_.EndSegment(last_ts + wall_offset);
+        RetireMuxer(std::move(muxer), filename);
+        SetState(state, KIdle);
+        trigger_begin = 0;
+        std::unique_lock<std::mutex> lock(mux_);
+        trigger_us_ = 0;
+    };
+
+    //记录帧类型和参数集,预录和实时码流共用,分段时据此判断IDR起始和补写参数集
+    auto track = [&](const VideoFrame &video) {
+        last_type = video.type;
+        if (video.type == H264Frame::NaluType::SPS)
+        {
+            sps.assign((const char *)video.data, video.len);
+            wait_sps = false;
+        }
+        else if (video.type == H264Frame::NaluType::PPS)
         {
-            if (!init)
+            pps.assign((const char *)video.data, video.len);
+
+            //参数集变化时保存,用于恢复掉电时未写moov的mp4
+            if (sps.size() > 4 && pps.size() > 4 && (sps != saved_sps || pps != saved_pps))
             {
-                std::string path;
-                {
-                    //创建文件夹,按日期创建
-                    std::ostringstream oss;
-                    oss << params_.path << '/' << System::GetLocalTime(RECORD_DIR_FORMAT);
-                    path = oss.str();
-                    code = static_cast<err_code>(System::CreateDir(path));
-                    if (KSuccess != code)
-                        return;
-                }
-                std::ostringstream oss;
-                oss << path << '/' << "record_" << System::GetLocalTime(RECORD_FILE_FORMAT) << ".mp4";
-                code = static_cast<err_code>(muxer.Initialize(oss.str().c_str(), params_.width, params_.height, params_.frame_rate));
-                if (KSuccess != code)
+                MP4Recovery::Codec codec{sps.substr(4), pps.substr(4), params_.width, params_.height, params_.frame_rate};
+                if (KSuccess == static_cast<err_code>(MP4Recovery::SaveCodec(params_.path, codec)))
                 {
-                    log_e("error:%s", make_error_code(code).message().c_str());
-                    return;
+                    saved_sps = sps;
+                    saved_pps = pps;
                 }
+            }
+        }
+    };
 
-                mux_.lock();
-                buffer_.Clear();
-                mux_.unlock();
+    //写入一帧并更新索引
+    auto write = [&](const VideoFrame &video) -> bool {
+        code = static_cast<err_code>(muxer->WriteVideoFrame(video));
+        if (KSuccess != code)
+        {
+            log_e("error:%s", make_error_code(code).message().c_str());
+            return false;
+        }
+        IndexFrame(video, muxer->Position(), video.ts + wall_offset, filename, index_begin);
+        last_ts = video.ts;
+        return true;
+    };
 
-                start_time = System::GetSteadyMilliSeconds();
-                wait_sps = true;
-                init = true;
-            }
+    while (run_)
+    {
+        uint64_t now = System::GetSteadyMilliSeconds();
 
+        //空闲:连续录像或者收到触发时打开文件,先写入预录数据再写实时码流
+        if (state == KIdle && !RecordNeedToQuit() && now >= retry_time)
+        {
+            muxer = OpenMuxer(filename);
+            if (!muxer)
+            {
+                //多为磁盘已满,通知空间管理立即清理后重试,期间的码流进入预录缓存
+                retention_.Notify();
+                retry_time = now + RECORD_RETRY_INTERVAL;
+            }
+            else
             {
-                std::unique_lock<std::mutex> lock(mux_);
-                if (buffer_.Get((uint8_t *)&frame, sizeof(frame)))
+                start_time = now;
+                wait_sps = true;
+                segment = false;
+                index_begin = false;
+                if (params_.use_md)
+                {
+                    std::unique_lock<std::mutex> lock(mux_);
+                    trigger_begin = trigger_us_;
+                    trigger_us_ = 0;
+                }
+                SetState(state, KPreRoll);
+
+                //预录缓存总是从SPS开始
+                uint32_t pre_frames = pre_record_.Frames();
+                uint32_t pre_bytes = pre_record_.Used();
+                uint64_t pre_duration = pre_record_.Duration();
+                while (pre_record_.Pop(frame))
                 {
-                    memcpy(temp_buf, buffer_.GetCurrentPos(), frame.len);
-                    frame.data = temp_buf;
-                    if (!buffer_.Consume(frame.len))
+                    track(frame);
+                    if (wait_sps)
+                        continue;
+                    if (!write(frame))
                     {
-                        log_e("consme data from buffer failed,rest data not enough");
-                        return;
+                        pre_record_.Clear();
+                        break;
                     }
                 }
-                else if (run_)
+                if (pre_frames)
+                    log_i("flush pre record %u frames,%u bytes,%llu ms,buffer capacity %u bytes",
+                          pre_frames, pre_bytes, (unsigned long long)(pre_duration / 1000), pre_record_.Capacity());
+                SetState(state, KRecording);
+            }
+        }
+
+        //触发停止后进入延录,到结束时间立即关闭文件,不依赖帧到达
+        if (state != KIdle && params_.use_md)
+        {
+            if (RecordNeedToQuit())
+                stop();
+            else if (state == KRecording && now > trigger_time_ + RECORD_TRIGGER_HOLD)
+                SetState(state, KPostRoll);
+            else if (state == KPostRoll && now <= trigger_time_ + RECORD_TRIGGER_HOLD)
+                SetState(state, KRecording);
+        }
+        if (state != KIdle && !segment && RecordNeedToSegment(start_time))
+            segment = true;
+
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            if (!buffer_.Get((uint8_t *)&frame, sizeof(frame)))
+            {
+                //没有码流时等待新帧,触发,关闭或者最近的截止时间
+                if (run_ && !trigger_)
                 {
-                    cond_.wait(lock);
-                    continue;
+                    uint64_t deadline = UINT64_MAX;
+                    if (state == KIdle && retry_time > now)
+                        deadline = retry_time;
+                    if (state != KIdle && params_.use_md)
+                        deadline = std::min<uint64_t>(end_time_, state == KRecording ? trigger_time_ + RECORD_TRIGGER_HOLD + 1 : UINT64_MAX);
+
+                    if (deadline == UINT64_MAX)
+                        cond_.wait(lock);
+                    else if (deadline > now)
+                        cond_.wait_for(lock, std::chrono::milliseconds(deadline - now));
                 }
+                trigger_ = false;
+                continue;
             }
 
-            if (frame.type == H264Frame::NaluType::SPS)
-                wait_sps = false;
+            memcpy(temp_buf, buffer_.GetCurrentPos(), frame.len);
+            frame.data = temp_buf;
+            if (!buffer_.Consume(frame.len))
+            {
+                log_e("consme data from buffer failed,rest data not enough");
+                break;
+            }
+            wall_offset = static_cast<int64_t>(System::GetRealMicroSeconds()) - static_cast<int64_t>(frame.ts);
+            events.swap(events_);
+        }
+
+        for (auto &event : events)
+            WriteMotion(event, event.ts + wall_offset, state != KIdle ? muxer.get() : nullptr);
+        events.clear();
+
+        //空闲时码流写入预录缓存
+        if (state == KIdle)
+        {
+            pre_record_.Push(frame);
+            continue;
+        }
 
-            if (!wait_sps)
+        //IDR起始:SPS,或前面没有参数集的I帧
+        bool idr_start = frame.type == H264Frame::NaluType::SPS ||
+                         (frame.type == H264Frame::NaluType::ISLICE && last_type == H264Frame::NaluType::PSLICE);
+
+        //分段只在IDR处切换,新文件从关键帧开始,前后文件无缝衔接
+        if (segment && idr_start)
+        {
+            index_.EndSegment(last_ts + wall_offset);
+            RetireMuxer(std::move(muxer), filename);
+            muxer = OpenMuxer(filename);
+            segment = false;
+            index_begin = false;
+            if (!muxer)
+            {
+                retention_.Notify();
+                retry_time = System::GetSteadyMilliSeconds() + RECORD_RETRY_INTERVAL;
+                SetState(state, KIdle);
+                continue;
+            }
+            start_time = System::GetSteadyMilliSeconds();
+
+            //I帧前没有参数集时,补写上一次的SPS/PPS
+            if (frame.type == H264Frame::NaluType::ISLICE && !sps.empty() && !pps.empty())
             {
-                code = static_cast<err_code>(muxer.WriteVideoFrame(frame));
-                if (KSuccess != code)
+                VideoFrame param;
+                param.ts = frame.ts;
+                for (const std::string *nalu : {&sps, &pps})
                 {
-                    log_e("error:%s", make_error_code(code).message().c_str());
-                    return;
+                    std::vector<uint8_t> data(nalu->begin(), nalu->end());
+                    param.data = data.data();
+                    param.len = data.size();
+                    param.type = nalu == &sps ? H264Frame::NaluType::SPS : H264Frame::NaluType::PPS;
+                    muxer->WriteVideoFrame(param);
                 }
             }
+        }
 
-            if (RecordNeedToQuit())
+        track(frame);
+
+        //写失败时关闭当前文件,下一轮重新创建,录像线程不退出
+        if (!wait_sps && !write(frame))
+        {
+            stop();
+            retention_.Notify();
+            continue;
+        }
+
+        //预录之后的第一帧实时码流,统计触发到写入的延迟
+        if (!wait_sps && trigger_begin)
+        {
+            trigger_latency_ = System::GetSteadyMicroSeconds() - trigger_begin;
+            trigger_begin = 0;
+            log_i("trigger to first live frame %llu us", (unsigned long long)trigger_latency_);
+        }
+    }
+    if (muxer)
+    {
+        index_.EndSegment(last_ts + wall_offset);
+        muxer->Close();
+        retention_.AddFile(filename);
+    }
+    free(temp_buf);
+}
+
+void MP4RecordImpl::SetState(State &state, State next)
+{
+    static const char *KNames[] = {"idle", "pre-roll", "recording", "post-roll"};
+    if (state == next)
+        return;
+    log_d("record state %s -> %s", KNames[state], KNames[next]);
+    state = next;
+}
+
+void MP4RecordImpl::IndexFrame(const VideoFrame &frame, uint64_t position, uint64_t time, const std::string &filename, bool &begin)
+{
+    //每个I帧记录一个GOP,文件的第一个I帧作为文件起始时间
+    if (frame.type != H264Frame::NaluType::ISLICE)
+        return;
+
+    if (!begin)
+    {
+        index_.BeginSegment(filename, time, params_.use_md);
+        begin = true;
+    }
+    index_.AddGOP(time, position);
+}
+
+void MP4RecordImpl::RemoveTempFiles()
+{
+    //异常退出时遗留的预打开文件
+    DIR *dir = opendir(params_.path.c_str());
+    if (!dir)
+        return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (strncmp(entry->d_name, RECORD_TEMP_PREFIX, strlen(RECORD_TEMP_PREFIX)) == 0)
+            unlink((params_.path + '/' + entry->d_name).c_str());
+    }
+    closedir(dir);
+}
+
+std::unique_ptr<Muxer> MP4RecordImpl::OpenMuxer(std::string &filename)
+{
+    err_code code;
+    std::unique_ptr<Muxer> muxer;
+    std::string temp;
+    {
+        std::unique_lock<std::mutex> lock(open_mux_);
+        if (next_muxer_)
+        {
+            muxer = std::move(next_muxer_);
+            temp = next_file_;
+            open_cond_.notify_one();
+        }
+    }
+
+    //创建文件夹,按日期创建,后台线程已提前创建,跨天时才会真正mkdir
+    std::ostringstream oss;
+    oss << params_.path << '/' << System::GetLocalTime(RECORD_DIR_FORMAT);
+    std::string path = oss.str();
+    code = static_cast<err_code>(System::CreateDir(path));
+    if (KSuccess != code)
+        return nullptr;
+
+    //移动侦测录像和连续录像使用不同前缀,空间管理时可区分保留期
+    filename = path + '/' + (params_.use_md ? RECORD_EVENT_PREFIX : RECORD_FILE_PREFIX) + System::GetLocalTime(RECORD_FILE_FORMAT) + FileSuffix(params_);
+    if (muxer)
+    {
+        //文件已打开,重命名不影响后续写入
+        if (muxer->Rename(temp, filename) != 0)
+            log_w("rename %s failed,%s", temp.c_str(), strerror(errno));
+        return muxer;
+    }
+
+    log_w("next record file not ready,open in record thread");
+    muxer.reset(CreateMuxer(params_));
+    code = static_cast<err_code>(muxer->Initialize(filename, params_.width, params_.height, params_.frame_rate));
+    if (KSuccess != code)
+    {
+        log_e("error:%s", make_error_code(code).message().c_str());
+        return nullptr;
+    }
+    return muxer;
+}
+
+void MP4RecordImpl::RetireMuxer(std::unique_ptr<Muxer> muxer, const std::string &filename)
+{
+    std::unique_lock<std::mutex> lock(open_mux_);
+    retired_.push_back(std::make_pair(std::move(muxer), filename));
+    open_cond_.notify_one();
+}
+
+void MP4RecordImpl::OpenThread()
+{
+    err_code code;
+    while (run_)
+    {
+        std::pair<std::unique_ptr<Muxer>, std::string> retired;
+        {
+            std::unique_lock<std::mutex> lock(open_mux_);
+            open_cond_.wait(lock, [this]() { return !run_ || !retired_.empty() || !next_muxer_; });
+            if (!run_)
+                break;
+            if (!retired_.empty())
             {
-                muxer.Close();
-                init = false;
-                while (run_ && RecordNeedToQuit())
-                    usleep(500000); //500ms
+                retired = std::move(retired_.front());
+                retired_.pop_front();
             }
-            else if (RecordNeedToSegment(start_time))
+        }
+
+        //关闭旧文件(mp4需要写moov),不阻塞录像线程
+        if (retired.first)
+        {
+            retired.first->Close();
+            retention_.AddFile(retired.second);
+            continue;
+        }
+
+        //提前创建当天目录,预先打开下一个文件
+        std::ostringstream oss;
+        oss << params_.path << '/' << System::GetLocalTime(RECORD_DIR_FORMAT);
+        code = static_cast<err_code>(System::CreateDir(oss.str()));
+        if (KSuccess == code)
+        {
+            oss.str("");
+            oss << params_.path << '/' << RECORD_TEMP_PREFIX << next_seq_++ << FileSuffix(params_);
+            std::string temp = oss.str();
+            std::unique_ptr<Muxer> muxer(CreateMuxer(params_));
+            code = static_cast<err_code>(muxer->Initialize(temp, params_.width, params_.height, params_.frame_rate));
+            if (KSuccess == code)
             {
-                muxer.Close();
-                init = false;
+                std::unique_lock<std::mutex> lock(open_mux_);
+                next_muxer_ = std::move(muxer);
+                next_file_ = temp;
+                continue;
             }
         }
-        muxer.Close();
-        free(temp_buf);
-    }));
+
+        log_e("open next record file failed,error:%s", make_error_code(code).message().c_str());
+        std::unique_lock<std::mutex> lock(open_mux_);
+        open_cond_.wait_for(lock, std::chrono::seconds(1));
+    }
+}
+
+void MP4RecordImpl::RecoverThread(const std::vector<std::string> &files)
+{
+    MP4Recovery::Codec codec;
+    if (KSuccess != static_cast<err_code>(MP4Recovery::LoadCodec(params_.path, codec)))
+    {
+        log_w("%zu record files need recover,but no codec parameter saved", files.size());
+        return;
+    }
+
+    for (const std::string &filename : files)
+    {
+        if (!run_)
+            break;
+        MP4Recovery recovery;
+        if (KSuccess == static_cast<err_code>(recovery.Open(filename)) &&
+            KSuccess == static_cast<err_code>(recovery.Recover(codec)))
+            retention_.AddFile(filename);
+    }
+}
+
+int32_t MP4RecordImpl::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    params_ = params;
+    err_code code;
+
+    RemoveTempFiles();
+
+    //索引不可用时只影响按时间查找,不影响录像
+    code = static_cast<err_code>(index_.Initialize(params_.path));
+    if (KSuccess != code)
+        log_e("record index initialize failed,error:%s", make_error_code(code).message().c_str());
+    event_index_.Initialize(params_.path);
+
+    //录像开始前找出未关闭的mp4文件,避免把正在写入的文件当作损坏
+    std::vector<std::string> broken;
+    MP4Recovery::FindBroken(params_.path, RECORD_RECOVER_DAYS, broken);
+
+    code = static_cast<err_code>(retention_.Initialize(RetentionManager::Params{params_.path,
+                                                                                 static_cast<uint64_t>(params_.quota) * 1024 * 1024,
+                                                                                 params_.high_water,
+                                                                                 params_.low_water,
+                                                                                 params_.event_keep,
+                                                                                 [this](const std::vector<std::string> &files) {
+                                                                                     index_.Remove(files);
+                                                                                 }}));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    if (params_.use_md && params_.pre_record > 0)
+    {
+        code = static_cast<err_code>(pre_record_.Initialize(params_.pre_record_size * 1024, params_.pre_record * 1000000ull));
+        if (KSuccess != code)
+            return static_cast<int>(code);
+        log_i("pre record %d s,buffer %u bytes", params_.pre_record, pre_record_.Capacity());
+    }
+
+    run_ = true;
+    open_thread_ = std::unique_ptr<std::thread>(new std::thread([this]() { OpenThread(); }));
+    if (!broken.empty())
+        recover_thread_ = std::unique_ptr<std::thread>(new std::thread([this, broken]() { RecoverThread(broken); }));
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() { RecordThread(); }));
 
     init_ = true;
     return static_cast<int>(KSuccess);
@@ -186,18 +622,66 @@ void MP4RecordImpl::Close()
     if (!init_)
         return;
 
-    run_ = false;
-    cond_.notify_all();
+    //在mux_内修改run_,录制线程判断run_和进入等待之间不会漏掉唤醒
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        run_ = false;
+        cond_.notify_all();
+    }
     thread_->join();
     thread_.reset();
     thread_ = nullptr;
 
+    {
+        std::unique_lock<std::mutex> lock(open_mux_);
+        open_cond_.notify_all();
+    }
+    open_thread_->join();
+    open_thread_.reset();
+    open_thread_ = nullptr;
+
+    if (recover_thread_)
+    {
+        recover_thread_->join();
+        recover_thread_.reset();
+        recover_thread_ = nullptr;
+    }
+
+    for (auto &retired : retired_)
+    {
+        retired.first->Close();
+        retention_.AddFile(retired.second);
+    }
+    retired_.clear();
+
+    //删除未使用的预打开文件
+    if (next_muxer_)
+    {
+        next_muxer_->Close();
+        next_muxer_.reset();
+        remove(next_file_.c_str());
+    }
+    pre_record_.Close();
+    retention_.Close();
+    index_.Close();
+    event_index_.Close();
+    events_.clear();
+    trigger_us_ = 0;
+
     init_ = false;
 }
 
 MP4RecordImpl::MP4RecordImpl() : end_time_(0),
+                                 trigger_time_(0),
+                                 trigger_(false),
+                                 trigger_us_(0),
+                                 trigger_latency_(0),
                                  run_(false),
                                  thread_(nullptr),
+                                 next_seq_(0),
+                                 last_event_ts_(0),
+                                 open_thread_(nullptr),
+                                 recover_thread_(nullptr),
                                  init_(false)
 {
 }
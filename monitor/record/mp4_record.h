@@ -2,9 +2,16 @@
 #define MP4_RECORD_H_
 
 #include "record/record.h"
+#include "record/pre_record_buffer.h"
+#include "record/muxer.h"
+#include "record/retention.h"
+#include "record/record_index.h"
+#include "record/event_index.h"
 #include "common/buffer.h"
 
 #include <memory>
+#include <deque>
+#include <vector>
 #include <thread>
 #include <mutex>
 #include <atomic>
@@ -25,24 +32,77 @@ public:
 
     void OnTrigger(int32_t num) override;
 
+    void OnMotion(const MotionEvent &event) override;
+
+    //最近一次从空闲触发录像到写入第一帧实时码流的时间(us),0为还没有统计
+    uint64_t TriggerLatency() const;
+
 protected:
     MP4RecordImpl();
 
     ~MP4RecordImpl() override;
 
 private:
+    //空闲(码流进入预录缓存) -> 写入预录 -> 录像 -> 延录(触发停止,等待结束时间) -> 空闲
+    enum State
+    {
+        KIdle,
+        KPreRoll,
+        KRecording,
+        KPostRoll
+    };
+
+    //触发,新帧,结束时间和关闭都通过cond_唤醒,不轮询
     void RecordThread();
+    void SetState(State &state, State next);
     bool RecordNeedToQuit();
     bool RecordNeedToSegment(uint64_t start_time);
 
+    //取出后台预先打开的文件并重命名,未就绪时在当前线程打开
+    std::unique_ptr<Muxer> OpenMuxer(std::string &filename);
+
+    //交给后台线程关闭,关闭后登记到空间管理
+    void RetireMuxer(std::unique_ptr<Muxer> muxer, const std::string &filename);
+
+    void RemoveTempFiles();
+
+    void IndexFrame(const VideoFrame &frame, uint64_t position, uint64_t time, const std::string &filename, bool &begin);
+
+    //写入事件索引,录像中时同时写入文件
+    void WriteMotion(const MotionEvent &event, uint64_t time, Muxer *muxer);
+
+    void OpenThread();
+
+    //补写掉电时未关闭的mp4录像的moov
+    void RecoverThread(const std::vector<std::string> &files);
+
 private:
     std::mutex mux_;
     std::condition_variable cond_;
     Buffer<> buffer_;
+    PreRecordBuffer pre_record_;
     Params params_;
     std::atomic<uint64_t> end_time_;
-    bool run_;
+    std::atomic<uint64_t> trigger_time_; //最近一次触发的时间(ms)
+    bool trigger_;                       //有未处理的触发,mux_保护
+    uint64_t trigger_us_;                //空闲后第一次触发的时间(us),mux_保护,打开文件时取走
+    std::atomic<uint64_t> trigger_latency_;
+    std::atomic<bool> run_;              //两个线程都不加锁读取,修改时持有mux_
     std::unique_ptr<std::thread> thread_;
+
+    std::mutex open_mux_;
+    std::condition_variable open_cond_;
+    std::unique_ptr<Muxer> next_muxer_;
+    std::string next_file_;
+    uint32_t next_seq_;
+    std::deque<std::pair<std::unique_ptr<Muxer>, std::string>> retired_;
+    RetentionManager retention_;
+    RecordIndex index_;
+    EventIndex event_index_;
+    std::deque<MotionEvent> events_;
+    uint64_t last_event_ts_;
+    std::unique_ptr<std::thread> open_thread_;
+    std::unique_ptr<std::thread> recover_thread_;
     bool init_;
 };
 
@@ -0,0 +1,570 @@
+#include "record/mp4_recovery.h"
+#include "common/res_code.h"
+#include "common/system.h"
+#include "common/crc32.h"
+#include "common/fmp4.h"
+#include "video_codec/video_codec_define.h"
+
+#include <map>
+#include <algorithm>
+
+#include <dirent.h>
+
+#define RECOVERY_CODEC_MAGIC 0x4443564e      //"NVCD"
+#define RECOVERY_MAX_SAMPLE (4 * 1024 * 1024) //单个sample最大长度
+#define RECOVERY_RESYNC_MAX (4 * 1024 * 1024) //sample头损坏时向后查找的最大范围
+#define RECOVERY_BLOCK_SIZE (64 * 1024)       //扫描和写入的块大小
+#define RECOVERY_TIMESCALE 90000
+
+namespace nvr
+{
+
+static const uint32_t KMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+struct CodecHeader
+{
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint16_t frame_rate;
+    uint16_t sps_len;
+    uint16_t pps_len;
+    uint16_t reserved;
+    uint32_t crc;
+};
+
+static uint32_t Read32(const uint8_t *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t Read64(const uint8_t *p)
+{
+    return (static_cast<uint64_t>(Read32(p)) << 32) | Read32(p + 4);
+}
+
+static bool WriteAll(int fd, const std::string &data, uint64_t offset)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t ret = pwrite(fd, data.data() + done, data.size() - done, offset + done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        done += ret;
+    }
+    return true;
+}
+
+int32_t MP4Recovery::SaveCodec(const std::string &path, const Codec &codec)
+{
+    std::string data;
+    CodecHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RECOVERY_CODEC_MAGIC;
+    header.width = codec.width;
+    header.height = codec.height;
+    header.frame_rate = codec.frame_rate;
+    header.sps_len = codec.sps.size();
+    header.pps_len = codec.pps.size();
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(codec.sps);
+    data.append(codec.pps);
+    header.crc = Crc32(data.data(), data.size());
+    memcpy(&data[0], &header, sizeof(header));
+
+    //先写临时文件再重命名,掉电时不会留下半个文件
+    std::string filename = path + '/' + RECORD_CODEC_FILE;
+    std::string temp = filename + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        log_e("open %s failed,%s", temp.c_str(), strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    bool ok = WriteAll(fd, data, 0) && fdatasync(fd) == 0;
+    close(fd);
+    if (!ok || rename(temp.c_str(), filename.c_str()) != 0)
+    {
+        log_e("write %s failed,%s", filename.c_str(), strerror(errno));
+        unlink(temp.c_str());
+        return static_cast<int>(KSystemError);
+    }
+    return static_cast<int>(KSuccess);
+}
+
+int32_t MP4Recovery::LoadCodec(const std::string &path, Codec &codec)
+{
+    std::string filename = path + '/' + RECORD_CODEC_FILE;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return static_cast<int>(KNotFound);
+
+    char buf[1024];
+    ssize_t len = read(fd, buf, sizeof(buf));
+    close(fd);
+
+    CodecHeader header;
+    if (len < static_cast<ssize_t>(sizeof(header)))
+        return static_cast<int>(KNotFound);
+    memcpy(&header, buf, sizeof(header));
+    if (header.magic != RECOVERY_CODEC_MAGIC || sizeof(header) + header.sps_len + header.pps_len != static_cast<size_t>(len))
+        return static_cast<int>(KNotFound);
+
+    uint32_t crc = header.crc;
+    header.crc = 0;
+    memcpy(buf, &header, sizeof(header));
+    if (Crc32(buf, len) != crc)
+        return static_cast<int>(KNotFound);
+
+    codec.width = header.width;
+    codec.height = header.height;
+    codec.frame_rate = header.frame_rate;
+    codec.sps.assign(buf + sizeof(header), header.sps_len);
+    codec.pps.assign(buf + sizeof(header) + header.sps_len, header.pps_len);
+    return static_cast<int>(KSuccess);
+}
+
+void MP4Recovery::FindBroken(const std::string &path, int days, std::vector<std::string> &files)
+{
+    //日期目录按名称倒序即按时间倒序
+    std::map<std::string, std::string, std::greater<std::string>> dirs;
+    DIR *root = opendir(path.c_str());
+    if (!root)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(root)) != nullptr)
+    {
+        if (entry->d_name[0] != '.')
+            dirs[entry->d_name] = path + '/' + entry->d_name;
+    }
+    closedir(root);
+
+    for (auto &dir : dirs)
+    {
+        if (days-- <= 0)
+            break;
+
+        DIR *sub = opendir(dir.second.c_str());
+        if (!sub)
+            continue;
+        while ((entry = readdir(sub)) != nullptr)
+        {
+            size_t len = strlen(entry->d_name);
+            if (entry->d_name[0] == '.' || len < 4 || strcmp(entry->d_name + len - 4, ".mp4") != 0)
+                continue;
+
+            MP4Recovery recovery;
+            std::string filename = dir.second + '/' + entry->d_name;
+            if (KSuccess == static_cast<err_code>(recovery.Open(filename)) && recovery.Broken())
+                files.push_back(filename);
+        }
+        closedir(sub);
+    }
+}
+
+int32_t MP4Recovery::Open(const std::string &filename)
+{
+    if (fd_ >= 0)
+        return static_cast<int>(KDupInitialize);
+
+    fd_ = open(filename.c_str(), O_RDWR);
+    if (fd_ < 0)
+    {
+        log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+        return static_cast<int>(KNotFound);
+    }
+
+    struct stat st;
+    fstat(fd_, &st);
+    filename_ = filename;
+    file_size_ = st.st_size;
+    broken_ = false;
+
+    //遍历顶层box:ftyp,free,mdat,moov;mdat长度在关闭时才回写,未关闭时一直到文件尾
+    bool has_mdat = false, has_moov = false;
+    uint64_t pos = 0;
+    while (pos + 8 <= file_size_)
+    {
+        uint8_t head[16];
+        if (pread(fd_, head, sizeof(head), pos) < 8)
+            break;
+        uint64_t size = Read32(head);
+        uint32_t header = 8;
+        if (size == 1)
+        {
+            size = Read64(&head[8]);
+            header = 16;
+        }
+
+        if (pos == 0 && memcmp(&head[4], "ftyp", 4) != 0)
+        {
+            log_w("%s is not mp4 file", filename.c_str());
+            Close();
+            return static_cast<int>(KSystemError);
+        }
+
+        if (memcmp(&head[4], "mdat", 4) == 0)
+        {
+            has_mdat = true;
+            mdat_pos_ = pos;
+            mdat_header_ = header;
+            if (size <= header || pos + size > file_size_)
+            {
+                limit_ = file_size_;
+                break;
+            }
+            limit_ = pos + size;
+        }
+        else if (memcmp(&head[4], "moov", 4) == 0)
+        {
+            has_moov = true;
+        }
+
+        if (size < 8 || pos + size > file_size_)
+            break;
+        pos += size;
+    }
+
+    broken_ = has_mdat && !has_moov;
+    return static_cast<int>(KSuccess);
+}
+
+bool MP4Recovery::Broken() const
+{
+    return broken_;
+}
+
+bool MP4Recovery::ReadSample(uint64_t pos, uint32_t &size, bool &key)
+{
+    //mp4v2写入的sample为单个I/P帧,4字节长度前缀
+    uint8_t head[5];
+    if (pos + sizeof(head) > limit_ || pread(fd_, head, sizeof(head), pos) != sizeof(head))
+        return false;
+    uint32_t len = Read32(head);
+    int type = head[4] & 0x1f;
+    if (len < 2 || len > RECOVERY_MAX_SAMPLE || (head[4] & 0x80) ||
+        (type != H264Frame::NaluType::PSLICE && type != H264Frame::NaluType::ISLICE))
+        return false;
+    if (pos + 4 + len > limit_)
+        return false;
+    size = len + 4;
+    key = type == H264Frame::NaluType::ISLICE;
+    return true;
+}
+
+bool MP4Recovery::Resync(uint64_t &pos)
+{
+    //跳过字幕轨道的chunk或损坏的数据,要求连续两个sample头合法
+    std::vector<uint8_t> block(RECOVERY_BLOCK_SIZE);
+    uint64_t start = pos + 1;
+    uint64_t stop = std::min(limit_, pos + RECOVERY_RESYNC_MAX);
+    while (start + 5 <= stop)
+    {
+        ssize_t len = pread(fd_, block.data(), block.size(), start);
+        if (len < 5)
+            return false;
+        for (ssize_t i = 0; i + 5 <= len; i++)
+        {
+            uint32_t size;
+            bool key;
+            uint32_t nalu = Read32(&block[i]);
+            if (nalu < 2 || nalu > RECOVERY_MAX_SAMPLE || (block[i + 4] & 0x80))
+                continue;
+            if (!ReadSample(start + i, size, key))
+                continue;
+            uint64_t next = start + i + size;
+            if (next + 5 > limit_ || ReadSample(next, size, key))
+            {
+                log_d("%s resync at %llu,skip %llu bytes", filename_.c_str(), (unsigned long long)(start + i),
+                      (unsigned long long)(start + i - pos));
+                pos = start + i;
+                return true;
+            }
+        }
+        start += len - 4;
+    }
+    return false;
+}
+
+uint64_t MP4Recovery::Scan(const SampleCallback &callback)
+{
+    uint64_t pos = mdat_pos_ + mdat_header_;
+    uint64_t end = pos;
+    uint32_t index = 0;
+    while (pos + 5 <= limit_)
+    {
+        uint32_t size;
+        bool key;
+        if (!ReadSample(pos, size, key))
+        {
+            if (!Resync(pos))
+                break;
+            continue;
+        }
+        if (callback)
+            callback(index, pos, size, key);
+        index++;
+        pos += size;
+        end = pos;
+    }
+    return end;
+}
+
+int32_t MP4Recovery::WriteTables(uint64_t offset, uint32_t count, uint32_t keys, bool co64, std::string &prefix)
+{
+    //moov前半部分已在prefix中,依次流式写入stss,stsz,stco/co64
+    if (!WriteAll(fd_, prefix, offset))
+        return static_cast<int>(KSystemError);
+    offset += prefix.size();
+
+    std::string buf;
+    bool ok = true;
+    auto flush = [&](bool force) {
+        if (ok && (force || buf.size() >= RECOVERY_BLOCK_SIZE))
+        {
+            ok = WriteAll(fd_, buf, offset);
+            offset += buf.size();
+            buf.clear();
+        }
+    };
+
+    BoxWriter w(buf);
+    w.U32(16 + 4 * keys);
+    w.Bytes("stss", 4);
+    w.U32(0);
+    w.U32(keys);
+    Scan([&](uint32_t index, uint64_t, uint32_t, bool key) {
+        if (key)
+            w.U32(index + 1);
+        flush(false);
+    });
+
+    w.U32(20 + 4 * count);
+    w.Bytes("stsz", 4);
+    w.U32(0);
+    w.U32(0); //sample_size
+    w.U32(count);
+    Scan([&](uint32_t, uint64_t, uint32_t size, bool) {
+        w.U32(size);
+        flush(false);
+    });
+
+    w.U32(16 + (co64 ? 8 : 4) * count);
+    w.Bytes(co64 ? "co64" : "stco", 4);
+    w.U32(0);
+    w.U32(count);
+    Scan([&](uint32_t, uint64_t pos, uint32_t, bool) {
+        if (co64)
+            w.U64(pos);
+        else
+            w.U32(static_cast<uint32_t>(pos));
+        flush(false);
+    });
+    flush(true);
+
+    return ok ? static_cast<int>(KSuccess) : static_cast<int>(KSystemError);
+}
+
+int32_t MP4Recovery::Recover(const Codec &codec)
+{
+    if (fd_ < 0)
+        return static_cast<int>(KUnInitialize);
+
+    if (!broken_)
+        return static_cast<int>(KSuccess);
+
+    if (codec.sps.size() < 4 || codec.pps.empty() || codec.frame_rate <= 0)
+    {
+        log_e("recover %s failed,no codec parameter", filename_.c_str());
+        return static_cast<int>(KSystemError);
+    }
+
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+
+    //第一遍统计sample数,确定有效数据的结束位置
+    uint32_t count = 0, keys = 0;
+    uint64_t end = Scan([&](uint32_t, uint64_t, uint32_t, bool key) {
+        count++;
+        if (key)
+            keys++;
+    });
+    if (count == 0)
+    {
+        log_w("recover %s failed,no sample found", filename_.c_str());
+        return static_cast<int>(KNotFound);
+    }
+
+    //mdat超过4GB时,占用mp4v2预留在前面的free box改为64位长度
+    if (mdat_header_ == 8 && end - mdat_pos_ > 0xffffffffull)
+    {
+        uint8_t head[8];
+        if (mdat_pos_ < 8 || pread(fd_, head, 8, mdat_pos_ - 8) != 8 || Read32(head) != 8 || memcmp(&head[4], "free", 4) != 0)
+        {
+            log_e("recover %s failed,mdat too large", filename_.c_str());
+            return static_cast<int>(KSystemError);
+        }
+        mdat_pos_ -= 8;
+        mdat_header_ = 16;
+    }
+
+    //先回写mdat长度再追加moov,中途掉电时再次恢复仍能找到全部sample
+    std::string head;
+    BoxWriter h(head);
+    if (mdat_header_ == 16)
+    {
+        h.U32(1);
+        h.Bytes("mdat", 4);
+        h.U64(end - mdat_pos_);
+    }
+    else
+    {
+        h.U32(static_cast<uint32_t>(end - mdat_pos_));
+        h.Bytes("mdat", 4);
+    }
+    if (!WriteAll(fd_, head, mdat_pos_) || ftruncate(fd_, end) != 0 || fdatasync(fd_) != 0)
+    {
+        log_e("recover %s failed,%s", filename_.c_str(), strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    limit_ = end;
+
+    FMP4Packager packager;
+    packager.Initialize(codec.width, codec.height, codec.frame_rate);
+    packager.SetParameterSet(reinterpret_cast<const uint8_t *>(codec.sps.data()), codec.sps.size());
+    packager.SetParameterSet(reinterpret_cast<const uint8_t *>(codec.pps.data()), codec.pps.size());
+
+    //mp4v2按固定帧率写入,sample时长相同
+    uint32_t delta = RECOVERY_TIMESCALE / codec.frame_rate;
+    uint64_t duration = static_cast<uint64_t>(count) * delta;
+    uint32_t movie_duration = static_cast<uint32_t>(duration * 1000 / RECOVERY_TIMESCALE);
+    bool co64 = end > 0xffffffffull;
+
+    std::string prefix;
+    BoxWriter w(prefix);
+    size_t moov = w.Begin("moov");
+    size_t mvhd = w.BeginFull("mvhd", 0, 0);
+    w.U32(0);
+    w.U32(0);
+    w.U32(1000); //timescale
+    w.U32(movie_duration);
+    w.U32(0x00010000);
+    w.U16(0x0100);
+    w.Zero(10);
+    for (int i = 0; i < 9; i++)
+        w.U32(KMatrix[i]);
+    w.Zero(24);
+    w.U32(2); //next_track_ID
+    w.End(mvhd);
+
+    size_t trak = w.Begin("trak");
+    size_t tkhd = w.BeginFull("tkhd", 0, 0x3);
+    w.U32(0);
+    w.U32(0);
+    w.U32(1); //track_ID
+    w.U32(0);
+    w.U32(movie_duration);
+    w.Zero(8);
+    w.U16(0);
+    w.U16(0);
+    w.U16(0);
+    w.U16(0);
+    for (int i = 0; i < 9; i++)
+        w.U32(KMatrix[i]);
+    w.U32(codec.width << 16);
+    w.U32(codec.height << 16);
+    w.End(tkhd);
+
+    size_t mdia = w.Begin("mdia");
+    size_t mdhd = w.BeginFull("mdhd", 0, 0);
+    w.U32(0);
+    w.U32(0);
+    w.U32(RECOVERY_TIMESCALE);
+    w.U32(static_cast<uint32_t>(duration));
+    w.U16(0x55c4); //und
+    w.U16(0);
+    w.End(mdhd);
+
+    size_t hdlr = w.BeginFull("hdlr", 0, 0);
+    w.U32(0);
+    w.Bytes("vide", 4);
+    w.Zero(12);
+    w.Bytes("VideoHandler", 13);
+    w.End(hdlr);
+
+    size_t minf = w.Begin("minf");
+    size_t vmhd = w.BeginFull("vmhd", 0, 1);
+    w.Zero(8);
+    w.End(vmhd);
+
+    size_t dinf = w.Begin("dinf");
+    size_t dref = w.BeginFull("dref", 0, 0);
+    w.U32(1);
+    size_t url = w.BeginFull("url ", 0, 1);
+    w.End(url);
+    w.End(dref);
+    w.End(dinf);
+
+    size_t stbl = w.Begin("stbl");
+    packager.BuildSampleEntry(w);
+
+    size_t stts = w.BeginFull("stts", 0, 0);
+    w.U32(1);
+    w.U32(count);
+    w.U32(delta);
+    w.End(stts);
+
+    //每个sample单独一个chunk,字幕chunk穿插在中间时偏移仍然正确
+    size_t stsc = w.BeginFull("stsc", 0, 0);
+    w.U32(1);
+    w.U32(1); //first_chunk
+    w.U32(1); //samples_per_chunk
+    w.U32(1); //sample_description_index
+    w.End(stsc);
+
+    //容器长度包含之后流式写入的表
+    uint64_t tables = (16 + 4ull * keys) + (20 + 4ull * count) + (16 + (co64 ? 8ull : 4ull) * count);
+    if (prefix.size() + tables > 0xffffffffull)
+        return static_cast<int>(KSystemError);
+    for (size_t pos : {moov, trak, mdia, minf, stbl})
+        w.Patch32(pos, static_cast<uint32_t>(prefix.size() - pos + tables));
+
+    err_code code;
+    code = static_cast<err_code>(WriteTables(end, count, keys, co64, prefix));
+    if (KSuccess != code || fdatasync(fd_) != 0)
+    {
+        log_e("recover %s failed,write moov failed,%s", filename_.c_str(), strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+
+    broken_ = false;
+    log_i("recover %s,%u samples,%u key frames,%llu s,dropped %llu bytes,%llu ms", filename_.c_str(), count, keys,
+          (unsigned long long)(duration / RECOVERY_TIMESCALE), (unsigned long long)(file_size_ - end),
+          (unsigned long long)(System::GetSteadyMilliSeconds() - start_time));
+    return static_cast<int>(KSuccess);
+}
+
+void MP4Recovery::Close()
+{
+    if (fd_ >= 0)
+        close(fd_);
+    fd_ = -1;
+    broken_ = false;
+}
+
+MP4Recovery::MP4Recovery() : fd_(-1),
+                             file_size_(0),
+                             mdat_pos_(0),
+                             mdat_header_(8),
+                             limit_(0),
+                             broken_(false)
+{
+}
+
+MP4Recovery::~MP4Recovery()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,72 @@
+#ifndef MP4_RECOVERY_H_
+#define MP4_RECOVERY_H_
+
+#include "global.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#define RECORD_CODEC_FILE ".codec" //最近一次的编码参数,保存在录像根目录,恢复mp4时使用
+
+namespace nvr
+{
+
+//恢复掉电时未关闭的mp4v2录像:mdat中的sample完整但没有moov
+//按4字节长度前缀逐个遍历sample,多遍扫描生成sample表后追加moov,内存占用与文件大小无关
+class MP4Recovery
+{
+public:
+    struct Codec
+    {
+        std::string sps; //不带起始码
+        std::string pps;
+        int32_t width;
+        int32_t height;
+        int32_t frame_rate;
+    };
+
+    MP4Recovery();
+
+    ~MP4Recovery();
+
+    //打开并检查文件结构,Broken()为true时需要恢复
+    int32_t Open(const std::string &filename);
+
+    void Close();
+
+    bool Broken() const;
+
+    int32_t Recover(const Codec &codec);
+
+    static int32_t SaveCodec(const std::string &path, const Codec &codec);
+
+    static int32_t LoadCodec(const std::string &path, Codec &codec);
+
+    //列出最近days天内缺少moov的mp4录像
+    static void FindBroken(const std::string &path, int days, std::vector<std::string> &files);
+
+private:
+    typedef std::function<void(uint32_t index, uint64_t offset, uint32_t size, bool key)> SampleCallback;
+
+    //遍历mdat中的sample,返回有效数据的结束位置
+    uint64_t Scan(const SampleCallback &callback);
+
+    bool ReadSample(uint64_t pos, uint32_t &size, bool &key);
+
+    bool Resync(uint64_t &pos);
+
+    int32_t WriteTables(uint64_t offset, uint32_t count, uint32_t keys, bool co64, std::string &prefix);
+
+private:
+    int fd_;
+    std::string filename_;
+    uint64_t file_size_;
+    uint64_t mdat_pos_;
+    uint32_t mdat_header_;
+    uint64_t limit_;
+    bool broken_;
+};
+} // namespace nvr
+
+#endif
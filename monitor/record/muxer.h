@@ -0,0 +1,32 @@
+#ifndef MUXER_H_
+#define MUXER_H_
+
+#include "video_codec/video_codec_define.h"
+
+#include <string>
+
+namespace nvr
+{
+
+class Muxer
+{
+public:
+    virtual ~Muxer() {}
+
+    virtual int32_t Initialize(const std::string &filename, int width, int height, int frame_rate) = 0;
+
+    virtual int32_t WriteVideoFrame(const VideoFrame &frame) = 0;
+
+    virtual void Close() = 0;
+
+    //写入定时元数据(移动侦测事件),ts与视频帧同一时钟,不支持时忽略
+    virtual int32_t WriteMetadata(uint64_t ts, const std::string &data) { return 0; }
+
+    //已写入的字节数,下一个分片从此处开始,不支持时返回0
+    virtual uint64_t Position() { return 0; }
+
+    //预先打开的文件重命名为正式文件名,失败时返回非0并设置errno
+    virtual int32_t Rename(const std::string &from, const std::string &to) { return rename(from.c_str(), to.c_str()); }
+};
+} // namespace nvr
+#endif
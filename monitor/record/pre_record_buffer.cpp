@@ -0,0 +1,192 @@
+#include "record/pre_record_buffer.h"
+#include "common/res_code.h"
+
+namespace nvr
+{
+
+int32_t PreRecordBuffer::Initialize(uint32_t capacity, uint64_t duration_us)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    data_ = (uint8_t *)malloc(capacity);
+    if (!data_)
+    {
+        log_e("malloc pre record buffer failed");
+        return static_cast<int>(KSystemError);
+    }
+
+    capacity_ = capacity;
+    duration_us_ = duration_us;
+    Clear();
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void PreRecordBuffer::Close()
+{
+    if (!init_)
+        return;
+
+    Clear();
+    free(data_);
+    data_ = nullptr;
+    capacity_ = 0;
+    duration_us_ = 0;
+
+    init_ = false;
+}
+
+bool PreRecordBuffer::Alloc(uint32_t len, uint32_t &offset)
+{
+    if (entries_.empty())
+        tail_ = 0;
+
+    uint32_t head = entries_.empty() ? 0 : entries_.front().offset;
+    if (entries_.empty() || tail_ > head)
+    {
+        if (capacity_ - tail_ >= len)
+            offset = tail_;
+        else if (head > len)
+            offset = 0; //回绕,尾部剩余空间不足
+        else
+            return false;
+    }
+    else
+    {
+        if (head - tail_ > len)
+            offset = tail_;
+        else
+            return false;
+    }
+
+    tail_ = offset + len;
+    return true;
+}
+
+void PreRecordBuffer::EvictGOP()
+{
+    if (gops_.empty())
+        return;
+
+    gops_.pop_front();
+    uint64_t end = gops_.empty() ? base_seq_ + entries_.size() : gops_.front();
+    while (base_seq_ < end && !entries_.empty())
+    {
+        used_ -= entries_.front().len;
+        entries_.pop_front();
+        base_seq_++;
+    }
+}
+
+void PreRecordBuffer::Push(const VideoFrame &frame)
+{
+    if (!init_ || frame.len == 0 || frame.len > capacity_ / 2)
+        return;
+
+    bool gop_start = frame.type == H264Frame::NaluType::SPS;
+
+    //第一个SPS之前的数据无法解码,直接丢弃
+    if (!gop_start && gops_.empty())
+        return;
+
+    //次老的GOP已经满足预录时长,淘汰最老的GOP
+    while (gops_.size() > 1 &&
+           frame.ts >= entries_[gops_[1] - base_seq_].ts + duration_us_)
+        EvictGOP();
+
+    uint32_t offset;
+    while (!Alloc(frame.len, offset))
+    {
+        if (gops_.size() == 1 && !gop_start)
+        {
+            //单个GOP超过缓存容量
+            log_w("gop exceeds pre record buffer capacity %u", capacity_);
+            Clear();
+            return;
+        }
+        EvictGOP();
+    }
+
+    memcpy(data_ + offset, frame.data, frame.len);
+
+    Entry entry;
+    entry.offset = offset;
+    entry.len = frame.len;
+    entry.ts = frame.ts;
+    entry.type = frame.type;
+    entries_.push_back(entry);
+    used_ += frame.len;
+
+    if (gop_start)
+        gops_.push_back(base_seq_ + entries_.size() - 1);
+}
+
+bool PreRecordBuffer::Pop(VideoFrame &frame)
+{
+    if (entries_.empty())
+        return false;
+
+    const Entry &entry = entries_.front();
+    frame.data = data_ + entry.offset;
+    frame.len = entry.len;
+    frame.ts = entry.ts;
+    frame.type = entry.type;
+
+    if (!gops_.empty() && gops_.front() == base_seq_)
+        gops_.pop_front();
+    used_ -= entry.len;
+    entries_.pop_front();
+    base_seq_++;
+
+    return true;
+}
+
+void PreRecordBuffer::Clear()
+{
+    entries_.clear();
+    gops_.clear();
+    base_seq_ = 0;
+    tail_ = 0;
+    used_ = 0;
+}
+
+uint32_t PreRecordBuffer::Capacity() const
+{
+    return capacity_;
+}
+
+uint32_t PreRecordBuffer::Used() const
+{
+    return used_;
+}
+
+uint64_t PreRecordBuffer::Duration() const
+{
+    if (entries_.empty())
+        return 0;
+    return entries_.back().ts - entries_.front().ts;
+}
+
+uint32_t PreRecordBuffer::Frames() const
+{
+    return entries_.size();
+}
+
+PreRecordBuffer::PreRecordBuffer() : data_(nullptr),
+                                     capacity_(0),
+                                     duration_us_(0),
+                                     tail_(0),
+                                     used_(0),
+                                     base_seq_(0),
+                                     init_(false)
+{
+}
+
+PreRecordBuffer::~PreRecordBuffer()
+{
+    Close();
+}
+} // namespace nvr
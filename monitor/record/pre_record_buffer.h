@@ -0,0 +1,64 @@
+#ifndef PRE_RECORD_BUFFER_H_
+#define PRE_RECORD_BUFFER_H_
+
+#include "video_codec/video_codec_define.h"
+
+#include <deque>
+
+namespace nvr
+{
+
+//预录缓存:固定大小的环形缓存,按GOP淘汰,保证第一帧总是SPS
+class PreRecordBuffer
+{
+public:
+    PreRecordBuffer();
+
+    ~PreRecordBuffer();
+
+    int32_t Initialize(uint32_t capacity, uint64_t duration_us);
+
+    void Close();
+
+    void Push(const VideoFrame &frame);
+
+    //取出最早的一帧,data指向内部缓存,在下一次Push之前有效
+    bool Pop(VideoFrame &frame);
+
+    void Clear();
+
+    uint32_t Capacity() const;
+
+    uint32_t Used() const;
+
+    uint64_t Duration() const;
+
+    uint32_t Frames() const;
+
+private:
+    struct Entry
+    {
+        uint32_t offset;
+        uint32_t len;
+        uint64_t ts;
+        int32_t type;
+    };
+
+    bool Alloc(uint32_t len, uint32_t &offset);
+
+    void EvictGOP();
+
+private:
+    uint8_t *data_;
+    uint32_t capacity_;
+    uint64_t duration_us_;
+    uint32_t tail_;
+    uint32_t used_;
+    std::deque<Entry> entries_;
+    uint64_t base_seq_;         //entries_首元素的序号
+    std::deque<uint64_t> gops_; //每个GOP首帧(SPS)的序号
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -24,6 +24,17 @@ public:
         int segment_duration;
         bool use_md;
         int md_duration;
+        std::string format;  //mp4,fmp4或es
+        int pre_record;      //预录时长(秒),0为关闭
+        int pre_record_size; //预录缓存大小(KB)
+        int chunk_size;      //fmp4单次写盘大小(KB)
+        int prealloc_size;   //fmp4预分配extent大小(MB),0为关闭
+        int sync_interval;   //fmp4 fdatasync周期(ms),0为每个分片同步
+        int align_size;      //fmp4写入对齐单位(KB),同步时只写入对齐部分
+        int quota;           //录像配额(MB),0为整个文件系统
+        int high_water;      //高水位(%)
+        int low_water;       //低水位(%)
+        int event_keep;      //事件录像保留天数,0为不区分
     };
     virtual int32_t Initialize(const Params &params) = 0;
 
@@ -33,6 +44,8 @@ public:
 
     virtual void OnTrigger(int32_t num) override = 0;
 
+    virtual void OnMotion(const MotionEvent &event) override {}
+
 protected:
     virtual ~RecordModule() override = default;
 };
@@ -0,0 +1,771 @@
+#include "record/record_index.h"
+#include "common/res_code.h"
+#include "common/system.h"
+#include "common/crc32.h"
+#include "record/es_reader.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <time.h>
+#include <dirent.h>
+#include <sys/mman.h>
+
+#define RECORD_INDEX_MAGIC 0x5844494e //"NIDX"
+#define RECORD_INDEX_VERSION 1
+#define RECORD_INDEX_MAX_MOOF (1024 * 1024) //重建时读取的moof上限
+#define RECORD_INDEX_VERIFY_TAIL 16         //启动时校验的末尾记录数
+#define RECORD_INDEX_COPY_ENTRIES 4096      //压缩时每次读取的记录数
+#define RECORD_INDEX_TEMP_SUFFIX ".tmp"     //压缩时的临时文件,完成后重命名替换
+
+namespace nvr
+{
+
+struct IndexHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t reserved;
+};
+
+template <typename T>
+static void Seal(T &entry)
+{
+    entry.crc = 0;
+    entry.crc = Crc32(&entry, sizeof(entry));
+}
+
+template <typename T>
+static bool Verify(const T &entry)
+{
+    T temp = entry;
+    temp.crc = 0;
+    return Crc32(&temp, sizeof(temp)) == entry.crc;
+}
+
+//只读映射整个索引文件,返回记录数
+template <typename T>
+static const T *MapIndex(const std::string &filename, void *&addr, size_t &size, size_t &count)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(IndexHeader) + sizeof(T)))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size = st.st_size;
+    addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return nullptr;
+
+    const IndexHeader *header = static_cast<const IndexHeader *>(addr);
+    if (header->magic != RECORD_INDEX_MAGIC || header->version != RECORD_INDEX_VERSION || header->entry_size != sizeof(T))
+    {
+        munmap(addr, size);
+        return nullptr;
+    }
+
+    count = (size - sizeof(IndexHeader)) / sizeof(T);
+    return reinterpret_cast<const T *>(static_cast<const uint8_t *>(addr) + sizeof(IndexHeader));
+}
+
+static int32_t Append(int fd, const void *data, size_t len)
+{
+    const char *p = static_cast<const char *>(data);
+    while (len > 0)
+    {
+        ssize_t ret = write(fd, p, len);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            log_e("write record index failed,%s", strerror(errno));
+            return static_cast<int>(KSystemError);
+        }
+        p += ret;
+        len -= ret;
+    }
+    return static_cast<int>(KSuccess);
+}
+
+//新建空的索引文件,只有文件头
+static int CreateIndex(const std::string &filename, uint32_t entry_size)
+{
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        log_e("create %s failed,%s", filename.c_str(), strerror(errno));
+        return -1;
+    }
+
+    IndexHeader header;
+    header.magic = RECORD_INDEX_MAGIC;
+    header.version = RECORD_INDEX_VERSION;
+    header.entry_size = entry_size;
+    header.reserved = 0;
+    if (KSuccess != Append(fd, &header, sizeof(header)))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//把src中[from,to)的记录按keep过滤后追加到dst
+template <typename T, typename Keep>
+static int32_t CopyEntries(int src, int dst, off_t from, off_t to, Keep keep)
+{
+    std::vector<T> in(RECORD_INDEX_COPY_ENTRIES);
+    std::vector<T> out;
+    out.reserve(in.size());
+    while (from < to)
+    {
+        size_t count = std::min<size_t>(in.size(), (to - from) / sizeof(T));
+        if (count == 0)
+            break;
+        if (pread(src, in.data(), count * sizeof(T), from) != static_cast<ssize_t>(count * sizeof(T)))
+        {
+            log_e("read record index failed,%s", strerror(errno));
+            return static_cast<int>(KSystemError);
+        }
+        out.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (keep(in[i]))
+                out.push_back(in[i]);
+        }
+        if (!out.empty() && KSuccess != Append(dst, out.data(), out.size() * sizeof(T)))
+            return static_cast<int>(KSystemError);
+        from += count * sizeof(T);
+    }
+    return static_cast<int>(KSuccess);
+}
+
+//打开索引文件,新建时写入文件头,丢弃掉电时写了一半的记录
+static int OpenIndex(const std::string &filename, uint32_t entry_size, bool &valid)
+{
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        log_e("open %s failed,%s", filename.c_str(), strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+
+    IndexHeader header;
+    if (st.st_size < static_cast<off_t>(sizeof(header)) ||
+        pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != RECORD_INDEX_MAGIC || header.version != RECORD_INDEX_VERSION || header.entry_size != entry_size)
+    {
+        valid = false;
+        return fd;
+    }
+
+    off_t tail = (st.st_size - sizeof(header)) % entry_size;
+    if (tail != 0)
+    {
+        log_w("%s:drop %d bytes incomplete entry", filename.c_str(), static_cast<int>(tail));
+        if (ftruncate(fd, st.st_size - tail) != 0)
+            valid = false;
+    }
+    return fd;
+}
+
+int32_t RecordIndex::Initialize(const std::string &path)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    path_ = path;
+    next_id_ = 0;
+    open_ = false;
+
+    bool valid = true;
+    err_code code;
+    code = static_cast<err_code>(Open(valid));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    if (!valid)
+    {
+        uint64_t start = System::GetSteadyMilliSeconds();
+        code = static_cast<err_code>(Rebuild());
+        if (KSuccess != code)
+            return static_cast<int>(code);
+        log_i("rebuild record index,%u segments,%llu ms", next_id_, (unsigned long long)(System::GetSteadyMilliSeconds() - start));
+    }
+    else
+    {
+        DropMissing();
+    }
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RecordIndex::Open(bool &valid)
+{
+    segment_fd_ = OpenIndex(path_ + '/' + RECORD_INDEX_SEGMENT_FILE, sizeof(Segment), valid);
+    gop_fd_ = OpenIndex(path_ + '/' + RECORD_INDEX_GOP_FILE, sizeof(GOP), valid);
+    if (segment_fd_ < 0 || gop_fd_ < 0)
+    {
+        if (segment_fd_ >= 0)
+            close(segment_fd_);
+        if (gop_fd_ >= 0)
+            close(gop_fd_);
+        segment_fd_ = -1;
+        gop_fd_ = -1;
+        return static_cast<int>(KSystemError);
+    }
+    if (!valid)
+        return static_cast<int>(KSuccess);
+
+    //只校验末尾的记录:索引只在末尾追加和改写,掉电时损坏的只可能是最后写入的记录,其余记录在查询时逐条校验
+    void *seg_addr = nullptr, *gop_addr = nullptr;
+    size_t seg_size = 0, gop_size = 0, seg_count = 0, gop_count = 0;
+    const Segment *segments = MapIndex<Segment>(path_ + '/' + RECORD_INDEX_SEGMENT_FILE, seg_addr, seg_size, seg_count);
+    const GOP *gops = MapIndex<GOP>(path_ + '/' + RECORD_INDEX_GOP_FILE, gop_addr, gop_size, gop_count);
+
+    for (size_t i = seg_count > RECORD_INDEX_VERIFY_TAIL ? seg_count - RECORD_INDEX_VERIFY_TAIL : 0; valid && i < seg_count; i++)
+        valid = Verify(segments[i]);
+    for (size_t i = gop_count > RECORD_INDEX_VERIFY_TAIL ? gop_count - RECORD_INDEX_VERIFY_TAIL : 0; valid && i < gop_count; i++)
+        valid = Verify(gops[i]);
+
+    if (valid && seg_count > 0)
+    {
+        Segment last = segments[seg_count - 1];
+        next_id_ = last.id + 1;
+
+        //异常退出时最后一个文件没有结束时间,取其最后一个GOP的时间
+        if (last.end == 0)
+        {
+            last.end = last.start;
+            for (size_t i = gop_count; i > 0 && gops[i - 1].segment == last.id; i--)
+                last.end = std::max(last.end, gops[i - 1].time);
+            Seal(last);
+            pwrite(segment_fd_, &last, sizeof(last), sizeof(IndexHeader) + (seg_count - 1) * sizeof(Segment));
+        }
+    }
+
+    if (segments)
+        munmap(seg_addr, seg_size);
+    if (gops)
+        munmap(gop_addr, gop_size);
+
+    if (!valid)
+        log_w("record index corrupted");
+
+    return static_cast<int>(KSuccess);
+}
+
+static bool HasSuffix(const std::string &name, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return name.size() >= len && name.compare(name.size() - len, len, suffix) == 0;
+}
+
+void RecordIndex::ScanFile(const std::string &day, const std::string &name)
+{
+    if (HasSuffix(name, RECORD_ES_INDEX_SUFFIX))
+        return;
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *time_part = strchr(name.c_str(), '_');
+    if (!time_part ||
+        sscanf(day.c_str(), "%d_%d_%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3 ||
+        sscanf(time_part + 1, "%d_%d_%d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 3)
+        return;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    uint64_t start = static_cast<uint64_t>(mktime(&tm)) * 1000000;
+
+    std::string filename = path_ + '/' + day + '/' + name;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    fstat(fd, &st);
+    uint64_t end = static_cast<uint64_t>(st.st_mtime) * 1000000;
+
+    if (KSuccess != BeginSegment(filename, start, name.compare(0, strlen(RECORD_EVENT_PREFIX), RECORD_EVENT_PREFIX) == 0))
+    {
+        close(fd);
+        return;
+    }
+
+    //裸码流录像直接使用关键帧索引
+    if (HasSuffix(name, RECORD_ES_SUFFIX))
+    {
+        close(fd);
+        std::vector<EsIndexEntry> entries;
+        EsReader::LoadIndex(filename, entries);
+        for (auto &entry : entries)
+            AddGOP(start + entry.ts, entry.offset);
+        EndSegment(entries.empty() ? end : start + entries.back().ts);
+        return;
+    }
+
+    //fmp4按顶层box遍历,每个moof对应一个GOP,tfdt为相对文件起始的解码时间(90kHz)
+    std::vector<uint8_t> moof;
+    uint64_t last_gop = 0;
+    uint64_t pos = 0;
+    while (pos + 8 <= static_cast<uint64_t>(st.st_size))
+    {
+        uint8_t head[16];
+        if (pread(fd, head, 16, pos) < 8)
+            break;
+        uint64_t size = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
+        if (size == 1)
+        {
+            size = 0;
+            for (int i = 8; i < 16; i++)
+                size = (size << 8) | head[i];
+        }
+        if (size < 8)
+            break;
+
+        if (memcmp(&head[4], "moof", 4) == 0 && size <= RECORD_INDEX_MAX_MOOF)
+        {
+            moof.resize(size);
+            if (pread(fd, moof.data(), size, pos) != static_cast<ssize_t>(size))
+                break;
+
+            //moof/traf/tfdt
+            for (size_t i = 8; i + 8 <= size;)
+            {
+                uint32_t box = (moof[i] << 24) | (moof[i + 1] << 16) | (moof[i + 2] << 8) | moof[i + 3];
+                if (box < 8 || i + box > size)
+                    break;
+                if (memcmp(&moof[i + 4], "traf", 4) == 0)
+                {
+                    for (size_t j = i + 8; j + 8 <= i + box;)
+                    {
+                        uint32_t sub = (moof[j] << 24) | (moof[j + 1] << 16) | (moof[j + 2] << 8) | moof[j + 3];
+                        if (sub < 8 || j + sub > i + box)
+                            break;
+                        if (memcmp(&moof[j + 4], "tfdt", 4) == 0 && sub >= 16)
+                        {
+                            uint64_t dts = 0;
+                            int bytes = moof[j + 8] == 1 ? 8 : 4;
+                            for (int k = 0; k < bytes && j + 12 + k < i + box; k++)
+                                dts = (dts << 8) | moof[j + 12 + k];
+                            uint64_t time = start + dts * 1000000 / 90000;
+                            AddGOP(time, pos);
+                            last_gop = time;
+                        }
+                        j += sub;
+                    }
+                }
+                i += box;
+            }
+        }
+        pos += size;
+    }
+    close(fd);
+
+    //fmp4以最后一个GOP为准,mp4没有GOP索引时使用修改时间
+    EndSegment(last_gop ? last_gop : end);
+}
+
+int32_t RecordIndex::Rebuild()
+{
+    close(segment_fd_);
+    close(gop_fd_);
+    segment_fd_ = CreateIndex(path_ + '/' + RECORD_INDEX_SEGMENT_FILE, sizeof(Segment));
+    gop_fd_ = CreateIndex(path_ + '/' + RECORD_INDEX_GOP_FILE, sizeof(GOP));
+    if (segment_fd_ < 0 || gop_fd_ < 0)
+        return static_cast<int>(KSystemError);
+
+    next_id_ = 0;
+
+    //目录和文件名都按时间排序
+    std::map<std::string, std::string> days;
+    DIR *root = opendir(path_.c_str());
+    if (!root)
+        return static_cast<int>(KSuccess);
+    struct dirent *entry;
+    while ((entry = readdir(root)) != nullptr)
+    {
+        if (entry->d_name[0] != '.')
+            days[entry->d_name] = entry->d_name;
+    }
+    closedir(root);
+
+    for (auto &day : days)
+    {
+        std::map<std::string, std::string> files;
+        DIR *dir = opendir((path_ + '/' + day.first).c_str());
+        if (!dir)
+            continue;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            const char *time_part = strchr(entry->d_name, '_');
+            if (entry->d_name[0] != '.' && time_part)
+                files[std::string(time_part) + entry->d_name] = entry->d_name;
+        }
+        closedir(dir);
+
+        for (auto &file : files)
+            ScanFile(day.first, file.second);
+    }
+
+    return static_cast<int>(KSuccess);
+}
+
+void RecordIndex::DropMissing()
+{
+    void *addr = nullptr;
+    size_t size = 0, count = 0;
+    const Segment *segments = MapIndex<Segment>(path_ + '/' + RECORD_INDEX_SEGMENT_FILE, addr, size, count);
+    if (!segments)
+        return;
+
+    //空间管理从最旧的文件删除,只检查开头直到第一个存在的文件
+    std::set<uint32_t> ids;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (Verify(segments[i]) && access((path_ + '/' + segments[i].path).c_str(), F_OK) == 0)
+            break;
+        ids.insert(segments[i].id);
+    }
+    munmap(addr, size);
+
+    if (!ids.empty())
+    {
+        log_i("drop %zu deleted segments from record index", ids.size());
+        Compact(ids);
+    }
+}
+
+int32_t RecordIndex::Remove(const std::vector<std::string> &files)
+{
+    if (!init_)
+        return static_cast<int>(KUnInitialize);
+
+    std::set<std::string> relative;
+    for (auto &file : files)
+    {
+        if (file.compare(0, path_.size() + 1, path_ + '/') == 0)
+            relative.insert(file.substr(path_.size() + 1));
+    }
+
+    void *addr = nullptr;
+    size_t size = 0, count = 0;
+    const Segment *segments = MapIndex<Segment>(path_ + '/' + RECORD_INDEX_SEGMENT_FILE, addr, size, count);
+    if (!segments)
+        return static_cast<int>(KNotFound);
+
+    std::set<uint32_t> ids;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (relative.find(segments[i].path) != relative.end())
+            ids.insert(segments[i].id);
+    }
+    munmap(addr, size);
+
+    if (ids.empty())
+        return static_cast<int>(KSuccess);
+    return Compact(ids);
+}
+
+int32_t RecordIndex::Compact(const std::set<uint32_t> &ids)
+{
+    uint64_t start = System::GetSteadyMilliSeconds();
+    std::string seg_file = path_ + '/' + RECORD_INDEX_SEGMENT_FILE;
+    std::string gop_file = path_ + '/' + RECORD_INDEX_GOP_FILE;
+    std::string seg_temp = seg_file + RECORD_INDEX_TEMP_SUFFIX;
+    std::string gop_temp = gop_file + RECORD_INDEX_TEMP_SUFFIX;
+
+    //损坏的记录一并去掉
+    auto keep_segment = [&ids](const Segment &segment) { return Verify(segment) && ids.find(segment.id) == ids.end(); };
+    auto keep_gop = [&ids](const GOP &gop) { return Verify(gop) && ids.find(gop.segment) == ids.end(); };
+
+    int seg_out = CreateIndex(seg_temp, sizeof(Segment));
+    int gop_out = CreateIndex(gop_temp, sizeof(GOP));
+    auto fail = [&]() {
+        if (seg_out >= 0)
+            close(seg_out);
+        if (gop_out >= 0)
+            close(gop_out);
+        unlink(seg_temp.c_str());
+        unlink(gop_temp.c_str());
+        return static_cast<int>(KSystemError);
+    };
+    if (seg_out < 0 || gop_out < 0)
+        return fail();
+
+    //GOP索引只追加,已有部分在锁外复制,不阻塞录像线程
+    off_t gop_copied;
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        gop_copied = lseek(gop_fd_, 0, SEEK_END);
+    }
+    if (KSuccess != CopyEntries<GOP>(gop_fd_, gop_out, sizeof(IndexHeader), gop_copied, keep_gop))
+        return fail();
+
+    //期间追加的GOP和会被改写的文件索引在锁内复制后替换
+    std::unique_lock<std::mutex> lock(mux_);
+    if (KSuccess != CopyEntries<GOP>(gop_fd_, gop_out, gop_copied, lseek(gop_fd_, 0, SEEK_END), keep_gop) ||
+        KSuccess != CopyEntries<Segment>(segment_fd_, seg_out, sizeof(IndexHeader), lseek(segment_fd_, 0, SEEK_END), keep_segment) ||
+        fdatasync(seg_out) != 0 || fdatasync(gop_out) != 0)
+        return fail();
+
+    //先替换文件索引,查询时读到新文件索引和旧GOP索引也能按id对应,GOP索引替换失败时保留旧的
+    if (rename(seg_temp.c_str(), seg_file.c_str()) != 0)
+    {
+        log_e("replace record index failed,%s", strerror(errno));
+        return fail();
+    }
+    close(segment_fd_);
+    segment_fd_ = seg_out;
+    seg_out = -1;
+
+    //正在录制的文件总是最后一条记录
+    if (open_)
+        current_offset_ = lseek(segment_fd_, 0, SEEK_END) - sizeof(Segment);
+
+    if (rename(gop_temp.c_str(), gop_file.c_str()) != 0)
+    {
+        log_e("replace record index failed,%s", strerror(errno));
+        return fail();
+    }
+    close(gop_fd_);
+    gop_fd_ = gop_out;
+
+    log_i("compact record index,drop %zu segments,%llu ms", ids.size(), (unsigned long long)(System::GetSteadyMilliSeconds() - start));
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RecordIndex::BeginSegment(const std::string &filename, uint64_t start, bool event)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    if (segment_fd_ < 0)
+        return static_cast<int>(KUnInitialize);
+
+    if (open_)
+        Finish(start);
+
+    //路径保存为相对录像根目录
+    std::string relative = filename;
+    if (relative.compare(0, path_.size() + 1, path_ + '/') == 0)
+        relative = relative.substr(path_.size() + 1);
+    if (relative.size() >= RECORD_INDEX_PATH_LEN)
+    {
+        log_e("record path too long:%s", relative.c_str());
+        return static_cast<int>(KSystemError);
+    }
+
+    memset(&current_, 0, sizeof(current_));
+    current_.id = next_id_++;
+    current_.event = event ? 1 : 0;
+    current_.start = start;
+    current_.end = 0;
+    strncpy(current_.path, relative.c_str(), sizeof(current_.path) - 1);
+    Seal(current_);
+
+    current_offset_ = lseek(segment_fd_, 0, SEEK_END);
+    err_code code;
+    code = static_cast<err_code>(Append(segment_fd_, &current_, sizeof(current_)));
+    if (KSuccess != code)
+        return static_cast<int>(code);
+
+    open_ = true;
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RecordIndex::AddGOP(uint64_t time, uint64_t offset)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    if (!open_)
+        return static_cast<int>(KUnInitialize);
+
+    GOP gop;
+    gop.segment = current_.id;
+    gop.time = time;
+    gop.offset = offset;
+    Seal(gop);
+    return Append(gop_fd_, &gop, sizeof(gop));
+}
+
+int32_t RecordIndex::EndSegment(uint64_t end)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    return Finish(end);
+}
+
+int32_t RecordIndex::Finish(uint64_t end)
+{
+    if (!open_)
+        return static_cast<int>(KUnInitialize);
+
+    open_ = false;
+    current_.end = std::max(end, current_.start);
+    Seal(current_);
+    if (pwrite(segment_fd_, &current_, sizeof(current_), current_offset_) != sizeof(current_))
+    {
+        log_e("write record index failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RecordIndex::Lookup(const std::string &path, uint64_t time, Result &result)
+{
+    void *addr = nullptr;
+    size_t size = 0, count = 0;
+    const Segment *segments = MapIndex<Segment>(path + '/' + RECORD_INDEX_SEGMENT_FILE, addr, size, count);
+    if (!segments)
+        return static_cast<int>(KNotFound);
+
+    //最后一个start<=time的文件
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (segments[mid].start <= time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    //time不在该文件内时取之后的文件,索引随删除压缩,只有删除后压缩前掉电时才会跳过已删除的文件
+    bool found = false;
+    Segment segment;
+    for (size_t i = lo ? lo - 1 : 0; i < count; i++)
+    {
+        if (!Verify(segments[i]))
+            continue;
+        if (segments[i].start <= time && segments[i].end != 0 && segments[i].end < time)
+            continue;
+        if (access((path + '/' + segments[i].path).c_str(), F_OK) != 0)
+            continue;
+        segment = segments[i];
+        found = true;
+        break;
+    }
+    munmap(addr, size);
+    if (!found)
+        return static_cast<int>(KNotFound);
+
+    result.path = path + '/' + segment.path;
+    result.start = segment.start;
+    result.end = segment.end;
+    result.time = segment.start;
+    result.offset = 0;
+
+    const GOP *gops = MapIndex<GOP>(path + '/' + RECORD_INDEX_GOP_FILE, addr, size, count);
+    if (gops)
+    {
+        uint64_t target = std::max(time, segment.start);
+        lo = 0;
+        hi = count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (gops[mid].time <= target)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        //target之前最近的GOP,没有时取该文件的第一个GOP
+        if (lo > 0 && gops[lo - 1].segment == segment.id)
+        {
+            result.time = gops[lo - 1].time;
+            result.offset = gops[lo - 1].offset;
+        }
+        else
+        {
+            for (size_t i = lo; i < count && (segment.end == 0 || gops[i].time <= segment.end); i++)
+            {
+                if (gops[i].segment == segment.id)
+                {
+                    result.time = gops[i].time;
+                    result.offset = gops[i].offset;
+                    break;
+                }
+            }
+        }
+        munmap(addr, size);
+    }
+
+    result.position = result.time - segment.start;
+    return static_cast<int>(KSuccess);
+}
+
+int32_t RecordIndex::List(const std::string &path, uint64_t begin, uint64_t end, std::vector<Segment> &segments)
+{
+    void *addr = nullptr;
+    size_t size = 0, count = 0;
+    const Segment *entries = MapIndex<Segment>(path + '/' + RECORD_INDEX_SEGMENT_FILE, addr, size, count);
+    if (!entries)
+        return static_cast<int>(KNotFound);
+
+    //最后一个start<=begin的文件开始,之前的文件不会与查询区间相交
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (entries[mid].start <= begin)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (size_t i = lo ? lo - 1 : 0; i < count && entries[i].start <= end; i++)
+    {
+        if (!Verify(entries[i]))
+            continue;
+        if (entries[i].end != 0 && entries[i].end < begin)
+            continue;
+        segments.push_back(entries[i]);
+    }
+    munmap(addr, size);
+
+    return static_cast<int>(KSuccess);
+}
+
+void RecordIndex::Close()
+{
+    if (!init_)
+        return;
+
+    //未结束的文件下次启动时按最后一个GOP补全结束时间
+    std::unique_lock<std::mutex> lock(mux_);
+    open_ = false;
+    close(segment_fd_);
+    close(gop_fd_);
+    segment_fd_ = -1;
+    gop_fd_ = -1;
+
+    init_ = false;
+}
+
+RecordIndex::RecordIndex() : segment_fd_(-1),
+                             gop_fd_(-1),
+                             next_id_(0),
+                             current_offset_(0),
+                             open_(false),
+                             init_(false)
+{
+}
+
+RecordIndex::~RecordIndex()
+{
+    Close();
+}
+} // namespace nvr
@@ -0,0 +1,104 @@
+#ifndef RECORD_INDEX_H_
+#define RECORD_INDEX_H_
+
+#include "global.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+
+#define RECORD_INDEX_SEGMENT_FILE ".segment.idx" //录像文件索引
+#define RECORD_INDEX_GOP_FILE ".gop.idx"         //GOP索引
+#define RECORD_INDEX_PATH_LEN 64
+
+namespace nvr
+{
+
+//录像索引:定长记录追加写入录像根目录,查询时mmap后二分查找,时间均为墙上时间(us)
+//空间管理删除录像后压缩索引,索引中的文件与磁盘一致,查询时不再逐个检查文件是否存在
+class RecordIndex
+{
+public:
+    struct Segment
+    {
+        uint32_t id;
+        uint32_t event;
+        uint64_t start;
+        uint64_t end; //0表示正在录制
+        char path[RECORD_INDEX_PATH_LEN]; //相对录像根目录
+        uint32_t reserved;
+        uint32_t crc;
+    };
+
+    struct GOP
+    {
+        uint32_t segment;
+        uint32_t crc;
+        uint64_t time;
+        uint64_t offset; //关键帧所在分片(moof)的文件偏移,mp4文件为0
+    };
+
+    struct Result
+    {
+        std::string path;   //完整路径
+        uint64_t start;     //文件起始时间
+        uint64_t end;       //文件结束时间,0表示正在录制
+        uint64_t time;      //GOP时间
+        uint64_t position;  //GOP相对文件起始的时间
+        uint64_t offset;    //GOP文件偏移
+    };
+
+    RecordIndex();
+
+    ~RecordIndex();
+
+    //打开索引,只校验末尾的记录(掉电只影响最后写入的部分),损坏时扫描录像目录重建
+    int32_t Initialize(const std::string &path);
+
+    void Close();
+
+    int32_t BeginSegment(const std::string &filename, uint64_t start, bool event);
+
+    int32_t AddGOP(uint64_t time, uint64_t offset);
+
+    int32_t EndSegment(uint64_t end);
+
+    //录像文件(完整路径)被删除后,从索引中去掉对应的文件和GOP
+    int32_t Remove(const std::vector<std::string> &files);
+
+    //查找time所在的GOP,time落在空档时返回之后第一个文件的起始
+    static int32_t Lookup(const std::string &path, uint64_t time, Result &result);
+
+    //列出与[begin,end]有交集的录像,按起始时间排序
+    static int32_t List(const std::string &path, uint64_t begin, uint64_t end, std::vector<Segment> &segments);
+
+private:
+    int32_t Open(bool &valid);
+
+    int32_t Rebuild();
+
+    //去掉启动前已删除的最旧文件(删除后压缩前掉电)
+    void DropMissing();
+
+    //重写索引文件,去掉ids中的文件及其GOP,记录id不变
+    int32_t Compact(const std::set<uint32_t> &ids);
+
+    int32_t Finish(uint64_t end);
+
+    void ScanFile(const std::string &day, const std::string &name);
+
+private:
+    std::string path_;
+    std::mutex mux_; //录像线程追加与空间管理线程压缩互斥
+    int segment_fd_;
+    int gop_fd_;
+    uint32_t next_id_;
+    Segment current_;
+    off_t current_offset_;
+    bool open_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,282 @@
+#include "record/retention.h"
+#include "record/event_index.h"
+#include "common/res_code.h"
+
+#include <dirent.h>
+#include <sys/statvfs.h>
+
+#define RETENTION_CHECK_INTERVAL 10  //定时检查间隔(s)
+#define RETENTION_DELETE_INTERVAL 200 //两次删除之间的间隔(ms),避免删除大文件时抢占写盘带宽
+
+namespace nvr
+{
+
+int32_t RetentionManager::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    params_ = params;
+    if (params_.high_water <= 0 || params_.high_water > 100)
+        params_.high_water = 90;
+    if (params_.low_water <= 0 || params_.low_water > params_.high_water)
+        params_.low_water = params_.high_water;
+
+    used_ = 0;
+    notify_ = false;
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
+        //启动时扫描一次,之后只做增量统计
+        Scan();
+        log_i("retention %s:%zu files,%llu MB", params_.path.c_str(), files_.size(), (unsigned long long)(used_ >> 20));
+
+        while (run_)
+        {
+            Check();
+
+            std::unique_lock<std::mutex> lock(mux_);
+            cond_.wait_for(lock, std::chrono::seconds(RETENTION_CHECK_INTERVAL), [this]() { return !run_ || notify_; });
+            notify_ = false;
+        }
+    }));
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+static bool HasSuffix(const std::string &name, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return name.size() >= len && name.compare(name.size() - len, len, suffix) == 0;
+}
+
+void RetentionManager::Insert(const std::string &day, const std::string &name)
+{
+    //裸码流的关键帧索引随录像文件一起删除
+    if (HasSuffix(name, RECORD_ES_INDEX_SUFFIX))
+        return;
+
+    bool event;
+    std::string prefix;
+    if (name.compare(0, strlen(RECORD_EVENT_PREFIX), RECORD_EVENT_PREFIX) == 0)
+    {
+        event = true;
+        prefix = RECORD_EVENT_PREFIX;
+    }
+    else if (name.compare(0, strlen(RECORD_FILE_PREFIX), RECORD_FILE_PREFIX) == 0)
+    {
+        event = false;
+        prefix = RECORD_FILE_PREFIX;
+    }
+    else
+    {
+        return;
+    }
+
+    File file;
+    file.path = params_.path + '/' + day + '/' + name;
+    file.event = event;
+
+    struct stat st;
+    if (stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return;
+    file.size = st.st_size;
+    file.mtime = st.st_mtime;
+
+    //日期和时间在前,事件录像与连续录像按时间混合排序
+    std::string key = day + '/' + name.substr(prefix.size()) + '/' + prefix;
+
+    std::unique_lock<std::mutex> lock(mux_);
+    auto it = files_.find(key);
+    if (it != files_.end())
+        used_ -= it->second.size;
+    files_[key] = file;
+    used_ += file.size;
+}
+
+void RetentionManager::Scan()
+{
+    DIR *root = opendir(params_.path.c_str());
+    if (!root)
+    {
+        log_w("opendir %s failed,%s", params_.path.c_str(), strerror(errno));
+        return;
+    }
+
+    struct dirent *day;
+    while (run_ && (day = readdir(root)) != nullptr)
+    {
+        if (day->d_name[0] == '.')
+            continue;
+
+        std::string dir = params_.path + '/' + day->d_name;
+        DIR *sub = opendir(dir.c_str());
+        if (!sub)
+            continue;
+
+        struct dirent *file;
+        while ((file = readdir(sub)) != nullptr)
+        {
+            if (file->d_name[0] == '.')
+                continue;
+            Insert(day->d_name, file->d_name);
+        }
+        closedir(sub);
+    }
+    closedir(root);
+}
+
+void RetentionManager::AddFile(const std::string &filename)
+{
+    if (!init_)
+        return;
+
+    size_t pos = filename.find_last_of('/');
+    if (pos == std::string::npos || pos == 0)
+        return;
+    size_t day_pos = filename.find_last_of('/', pos - 1);
+    std::string day = filename.substr(day_pos == std::string::npos ? 0 : day_pos + 1, pos - (day_pos == std::string::npos ? 0 : day_pos + 1));
+
+    Insert(day, filename.substr(pos + 1));
+    Notify();
+}
+
+void RetentionManager::Notify()
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    notify_ = true;
+    cond_.notify_one();
+}
+
+uint64_t RetentionManager::Used() const
+{
+    return used_;
+}
+
+bool RetentionManager::OverWater(int percent)
+{
+    struct statvfs st;
+    if (statvfs(params_.path.c_str(), &st) != 0)
+    {
+        log_w("statvfs %s failed,%s", params_.path.c_str(), strerror(errno));
+        return false;
+    }
+
+    uint64_t total = static_cast<uint64_t>(st.f_blocks) * st.f_frsize;
+    uint64_t fs_used = static_cast<uint64_t>(st.f_blocks - st.f_bavail) * st.f_frsize;
+    uint64_t quota = params_.quota ? params_.quota : total;
+
+    //录像配额或者文件系统剩余空间,任一超过水位都需要删除
+    return used_ > quota / 100 * percent || fs_used > total / 100 * percent;
+}
+
+bool RetentionManager::DeleteOldest(uint64_t &size, std::string &path)
+{
+    File file;
+    bool last;
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        if (files_.empty())
+            return false;
+
+        //保留期内的事件录像跳过,没有可删除的连续录像时仍删除最旧的文件
+        auto victim = files_.begin();
+        if (params_.event_keep > 0)
+        {
+            time_t now = time(nullptr);
+            for (auto it = files_.begin(); it != files_.end(); ++it)
+            {
+                if (!it->second.event || now - it->second.mtime > params_.event_keep * 86400)
+                {
+                    victim = it;
+                    break;
+                }
+            }
+        }
+
+        file = victim->second;
+        std::string day = victim->first.substr(0, victim->first.find('/') + 1);
+        files_.erase(victim);
+        auto next = files_.lower_bound(day);
+        last = next == files_.end() || next->first.compare(0, day.size(), day) != 0;
+        used_ -= file.size;
+        size = file.size;
+        path = file.path;
+    }
+
+    if (unlink(file.path.c_str()) != 0 && errno != ENOENT)
+        log_w("unlink %s failed,%s", file.path.c_str(), strerror(errno));
+    if (HasSuffix(file.path, RECORD_ES_SUFFIX))
+        unlink((file.path + RECORD_ES_INDEX_SUFFIX).c_str());
+
+    //当天录像全部删除后,事件索引和日期目录一并删除
+    std::string dir = file.path.substr(0, file.path.find_last_of('/'));
+    if (last)
+    {
+        unlink((dir + '/' + RECORD_EVENT_INDEX_FILE).c_str());
+        rmdir(dir.c_str());
+    }
+
+    return true;
+}
+
+void RetentionManager::Check()
+{
+    if (!OverWater(params_.high_water))
+        return;
+
+    uint64_t bytes = 0;
+    std::vector<std::string> deleted;
+    while (run_ && OverWater(params_.low_water))
+    {
+        uint64_t size;
+        std::string path;
+        if (!DeleteOldest(size, path))
+            break;
+        deleted.push_back(path);
+        bytes += size;
+
+        std::unique_lock<std::mutex> lock(mux_);
+        cond_.wait_for(lock, std::chrono::milliseconds(RETENTION_DELETE_INTERVAL), [this]() { return !run_; });
+    }
+
+    log_i("retention deleted %zu files,%llu MB,used %llu MB", deleted.size(),
+          (unsigned long long)(bytes >> 20), (unsigned long long)(used_ >> 20));
+
+    //一轮删除只压缩一次索引
+    if (!deleted.empty() && params_.on_delete)
+        params_.on_delete(deleted);
+}
+
+void RetentionManager::Close()
+{
+    if (!init_)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        run_ = false;
+        cond_.notify_all();
+    }
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+    files_.clear();
+
+    init_ = false;
+}
+
+RetentionManager::RetentionManager() : used_(0),
+                                       notify_(false),
+                                       run_(false),
+                                       thread_(nullptr),
+                                       init_(false)
+{
+}
+
+RetentionManager::~RetentionManager()
+{
+    Close();
+}
+} // namespace nvr
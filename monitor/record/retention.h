@@ -0,0 +1,81 @@
+#ifndef RETENTION_H_
+#define RETENTION_H_
+
+#include "global.h"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+namespace nvr
+{
+
+//录像空间管理:启动时扫描一次,之后按文件增量统计,超过高水位时后台限速删除最旧的录像
+class RetentionManager
+{
+public:
+    struct Params
+    {
+        std::string path;
+        uint64_t quota;  //录像配额(字节),0为整个文件系统
+        int high_water;  //高水位(%),超过时开始删除
+        int low_water;   //低水位(%),删除到此为止
+        int event_keep;  //事件录像至少保留天数,期间优先删除连续录像,0为不区分
+        std::function<void(const std::vector<std::string> &)> on_delete; //每轮删除结束后回调删除的文件(完整路径)
+    };
+
+    RetentionManager();
+
+    ~RetentionManager();
+
+    int32_t Initialize(const Params &params);
+
+    void Close();
+
+    //文件关闭后登记
+    void AddFile(const std::string &filename);
+
+    //空间不足时立即检查
+    void Notify();
+
+    uint64_t Used() const;
+
+private:
+    struct File
+    {
+        std::string path;
+        uint64_t size;
+        time_t mtime;
+        bool event;
+    };
+
+    void Scan();
+
+    void Insert(const std::string &day, const std::string &name);
+
+    bool OverWater(int percent);
+
+    bool DeleteOldest(uint64_t &size, std::string &path);
+
+    void Check();
+
+private:
+    Params params_;
+    std::map<std::string, File> files_; //按"日期/时间/前缀"排序,首元素最旧
+    std::atomic<uint64_t> used_;
+    std::mutex mux_;
+    std::condition_variable cond_;
+    bool notify_;
+    bool run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,147 @@
+#include "record/clip_export.h"
+#include "record/es_muxer.h"
+#include "record/es_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <mp4v2/mp4v2.h>
+
+#include <vector>
+
+#define TEST_ES_FILE "clip_export_test.es"
+#define TEST_MP4_FILE "clip_export_test.mp4"
+#define TEST_FRAME_RATE 25
+#define TEST_FRAME_INTERVAL 40000
+#define TEST_GOP_SIZE 10
+#define TEST_FRAMES 35
+#define TEST_BASE_TS 5000000 //录像第一帧的编码器时间戳,导出后从0开始
+
+using namespace nvr;
+
+namespace
+{
+
+const uint8_t KSps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+const uint8_t KPps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+uint32_t FrameSize(int32_t i)
+{
+    return 100 + i * 7 + (i % TEST_GOP_SIZE == 0 ? 500 : 0);
+}
+
+void Write(Muxer &muxer, int32_t type, const uint8_t *data, uint32_t len, uint64_t ts)
+{
+    std::vector<uint8_t> buf(data, data + len);
+    VideoFrame frame;
+    frame.data = buf.data();
+    frame.len = buf.size();
+    frame.ts = ts;
+    frame.type = type;
+    ASSERT_EQ(0, muxer.WriteVideoFrame(frame));
+}
+
+//每个GOP前写SPS/PPS,帧大小各不相同
+void WriteEs()
+{
+    EsMuxer muxer({64 * 1024, 0, 0, 0});
+    ASSERT_EQ(0, muxer.Initialize(TEST_ES_FILE, 1280, 720, TEST_FRAME_RATE));
+    for (int32_t i = 0; i < TEST_FRAMES; i++)
+    {
+        uint64_t ts = TEST_BASE_TS + static_cast<uint64_t>(i) * TEST_FRAME_INTERVAL;
+        bool key = i % TEST_GOP_SIZE == 0;
+        if (key)
+        {
+            Write(muxer, H264Frame::NaluType::SPS, KSps, sizeof(KSps), ts);
+            Write(muxer, H264Frame::NaluType::PPS, KPps, sizeof(KPps), ts);
+        }
+        std::vector<uint8_t> nalu(FrameSize(i), static_cast<uint8_t>(0x80 | i));
+        nalu[0] = nalu[1] = nalu[2] = 0;
+        nalu[3] = 1;
+        nalu[4] = key ? 0x65 : 0x41;
+        Write(muxer, key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE, nalu.data(), nalu.size(), ts);
+    }
+    muxer.Close();
+}
+
+void Remove()
+{
+    remove(TEST_ES_FILE);
+    remove(TEST_ES_FILE RECORD_ES_INDEX_SUFFIX);
+    remove(TEST_MP4_FILE);
+}
+} // namespace
+
+//裸码流录像读取后恢复起始码,时间戳相对第一帧
+TEST(ClipExportTest, EsReaderRoundTrip)
+{
+    Remove();
+    WriteEs();
+
+    EsReader reader;
+    ASSERT_EQ(0, reader.Open(TEST_ES_FILE));
+    EXPECT_EQ(1280, reader.Width());
+    EXPECT_EQ(720, reader.Height());
+    EXPECT_EQ(TEST_FRAME_RATE, reader.FrameRate());
+
+    VideoFrame frame;
+    bool meta;
+    int32_t slices = 0, params = 0;
+    while (0 == reader.Next(frame, meta))
+    {
+        ASSERT_FALSE(meta);
+        ASSERT_GT(frame.len, 4u);
+        EXPECT_EQ(1, frame.data[3]);
+        if (frame.type == H264Frame::NaluType::SPS || frame.type == H264Frame::NaluType::PPS)
+        {
+            params++;
+            continue;
+        }
+        EXPECT_EQ(static_cast<uint64_t>(slices) * TEST_FRAME_INTERVAL, frame.ts);
+        EXPECT_EQ(FrameSize(slices), frame.len);
+        slices++;
+    }
+    reader.Close();
+    EXPECT_EQ(TEST_FRAMES, slices);
+    EXPECT_EQ((TEST_FRAMES + TEST_GOP_SIZE - 1) / TEST_GOP_SIZE * 2, params);
+    Remove();
+}
+
+//裸码流录像导出为mp4,帧数,时间和sample长度与录制时一致
+TEST(ClipExportTest, EsToMp4)
+{
+    Remove();
+    WriteEs();
+
+    ClipExporter::Result result;
+    ASSERT_EQ(0, ClipExporter::ExportFile(TEST_ES_FILE, TEST_MP4_FILE, "mp4", result));
+    EXPECT_EQ(1u, result.files);
+    EXPECT_EQ(static_cast<uint32_t>(TEST_FRAMES), result.frames);
+    EXPECT_EQ(0u, result.begin);
+    EXPECT_EQ(static_cast<uint64_t>(TEST_FRAMES - 1) * TEST_FRAME_INTERVAL, result.end);
+
+    MP4FileHandle handle = MP4Read(TEST_MP4_FILE);
+    ASSERT_NE(MP4_INVALID_FILE_HANDLE, handle);
+    MP4TrackId track = MP4FindTrackId(handle, 0, MP4_VIDEO_TRACK_TYPE);
+    ASSERT_NE(MP4_INVALID_TRACK_ID, track);
+    EXPECT_EQ(1280, MP4GetTrackVideoWidth(handle, track));
+    EXPECT_EQ(720, MP4GetTrackVideoHeight(handle, track));
+    ASSERT_EQ(static_cast<MP4SampleId>(TEST_FRAMES), MP4GetTrackNumberOfSamples(handle, track));
+
+    uint32_t timescale = MP4GetTrackTimeScale(handle, track);
+    ASSERT_GT(timescale, 0u);
+    for (MP4SampleId id = 1; id <= TEST_FRAMES; id++)
+    {
+        int32_t i = id - 1;
+        EXPECT_EQ(static_cast<uint64_t>(i) * TEST_FRAME_INTERVAL, MP4GetSampleTime(handle, track, id) * 1000000 / timescale);
+
+        //sample为长度前缀格式,长度与写入的nalu一致
+        uint8_t *data = nullptr;
+        uint32_t size = 0;
+        ASSERT_TRUE(MP4ReadSample(handle, track, id, &data, &size));
+        EXPECT_EQ(FrameSize(i), size);
+        EXPECT_EQ(FrameSize(i) - 4, static_cast<uint32_t>((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]));
+        free(data);
+    }
+    MP4Close(handle);
+    Remove();
+}
@@ -0,0 +1,50 @@
+#include "common/config.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include <jsoncpp/json/json.h>
+
+#define SHIPPED_CONFIG NVR_SOURCE_DIR "/conf/config.json"
+#define TEST_CONFIG "config_test.json"
+
+using namespace nvr;
+
+namespace
+{
+
+//在发布的配置上修改检测实现和亮度补偿后重新读取
+int32_t ReadDetectConfig(const std::string &engine, bool illum_compensate)
+{
+    Json::Value root;
+    Json::Reader reader;
+    std::ifstream ifs(SHIPPED_CONFIG);
+    EXPECT_TRUE(reader.parse(ifs, root));
+    root["detect"]["engine"] = engine;
+    root["detect"]["illum_compensate"] = illum_compensate;
+
+    std::ofstream ofs(TEST_CONFIG);
+    ofs << Json::StyledWriter().write(root);
+    ofs.close();
+    return Config::Instance()->ReadConfigFile(TEST_CONFIG);
+}
+} // namespace
+
+TEST(ConfigTest, ShippedConfig)
+{
+    ASSERT_EQ(0, Config::Instance()->ReadConfigFile(SHIPPED_CONFIG));
+    const Config::Detect &detect = Config::Instance()->detect;
+    EXPECT_FALSE(detect.illum_compensate && "software" != detect.engine);
+}
+
+//亮度补偿只有软件实现,IVE时关闭
+TEST(ConfigTest, IllumCompensateNeedsSoftware)
+{
+    ASSERT_EQ(0, ReadDetectConfig("ive", true));
+    EXPECT_FALSE(Config::Instance()->detect.illum_compensate);
+
+    ASSERT_EQ(0, ReadDetectConfig("software", true));
+    EXPECT_TRUE(Config::Instance()->detect.illum_compensate);
+    remove(TEST_CONFIG);
+}
@@ -0,0 +1,280 @@
+#include "video_detect/detect_dispatcher.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define DISPATCH_WIDTH 320
+#define DISPATCH_HEIGHT 240
+#define DISPATCH_FRAMES 100
+#define SLOW_CALLBACK 50       //慢监听者每次回调的耗时(ms)
+#define DISPATCH_WAIT_TIMEOUT 3000 //等待回调的超时(ms)
+
+using namespace nvr;
+
+namespace
+{
+
+VideoDetectModule::Params DispatchParams()
+{
+    return {1, DISPATCH_WIDTH, DISPATCH_HEIGHT, 150, 4, 4, {}, 0, 0, 0,
+            0, 1, 1, 0,
+            false, 0, 0, 0, 0, false, 0};
+}
+
+//[10,13)和[60,63)帧有运动,冷却为0,产生两次事件
+std::vector<DetectRect> Regions(int32_t frame)
+{
+    std::vector<DetectRect> regions;
+    if ((frame >= 10 && frame < 13) || (frame >= 60 && frame < 63))
+        regions.push_back({10, 10, 41, 41, 1024, DETECT_ZONE_FRAME});
+    return regions;
+}
+
+class CountListener : public DetectListener
+{
+public:
+    explicit CountListener(int32_t delay = 0) : delay(delay),
+                                               results(0),
+                                               starts(0),
+                                               ends(0),
+                                               seq(0)
+    {
+    }
+
+    void OnTrigger(int32_t num) override {}
+    void OnMotionStart(const MotionEvent &event) override { starts++; }
+    void OnMotionEnd(uint64_t ts) override { ends++; }
+    void OnResult(const DetectResult &result) override
+    {
+        if (delay > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        results++;
+        seq = result.seq;
+    }
+
+    int32_t delay;
+    std::atomic<int32_t> results;
+    std::atomic<int32_t> starts;
+    std::atomic<int32_t> ends;
+    std::atomic<uint64_t> seq;
+};
+
+bool WaitSeq(const CountListener &listener, uint64_t seq)
+{
+    uint64_t start = System::GetSteadyMilliSeconds();
+    while (listener.seq < seq && System::GetSteadyMilliSeconds() - start < DISPATCH_WAIT_TIMEOUT)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return listener.seq >= seq;
+}
+
+//在运动开始回调中移除自己并添加另一个监听者
+class ReentrantListener : public DetectListener
+{
+public:
+    ReentrantListener(DetectDispatcher &dispatcher, DetectListener *next) : dispatcher(dispatcher),
+                                                                            next(next),
+                                                                            starts(0)
+    {
+    }
+
+    void OnTrigger(int32_t num) override {}
+    void OnMotionStart(const MotionEvent &event) override
+    {
+        starts++;
+        dispatcher.AddListener(next);
+        dispatcher.RemoveListener(this);
+    }
+
+    DetectDispatcher &dispatcher;
+    DetectListener *next;
+    std::atomic<int32_t> starts;
+};
+} // namespace
+
+//慢监听者不阻塞分发,其他监听者按时收到结果;慢监听者丢弃中间结果但不丢事件开始/结束
+TEST(DetectDispatcherTest, SlowListenerDoesNotBlock)
+{
+    DetectDispatcher dispatcher;
+    ASSERT_EQ(0, dispatcher.Initialize(DispatchParams()));
+    CountListener slow(SLOW_CALLBACK), fast;
+    dispatcher.AddListener(&slow);
+    dispatcher.AddListener(&fast);
+
+    //每帧间隔1ms,快的监听者跟得上
+    uint64_t cost = 0;
+    for (int32_t i = 0; i < DISPATCH_FRAMES; i++)
+    {
+        uint64_t begin = System::GetSteadyMicroSeconds();
+        dispatcher.Dispatch(i * 40000, Regions(i), 0, i * 40);
+        cost += System::GetSteadyMicroSeconds() - begin;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    //同步回调需要DISPATCH_FRAMES*SLOW_CALLBACK=5s
+    EXPECT_LT(cost, static_cast<uint64_t>(SLOW_CALLBACK * 1000));
+
+    ASSERT_TRUE(WaitSeq(fast, DISPATCH_FRAMES));
+    EXPECT_EQ(DISPATCH_FRAMES, fast.results);
+    EXPECT_EQ(2, fast.starts);
+    EXPECT_EQ(2, fast.ends);
+
+    //队列满时丢弃中间结果,最后一帧和事件开始/结束都会回调
+    ASSERT_TRUE(WaitSeq(slow, DISPATCH_FRAMES));
+    EXPECT_LT(slow.results, DISPATCH_FRAMES);
+    EXPECT_EQ(2, slow.starts);
+    EXPECT_EQ(2, slow.ends);
+
+    dispatcher.RemoveListener(&slow);
+    dispatcher.RemoveListener(&fast);
+    dispatcher.Close();
+}
+
+TEST(DetectDispatcherTest, ListenerChangesInCallback)
+{
+    DetectDispatcher dispatcher;
+    ASSERT_EQ(0, dispatcher.Initialize(DispatchParams()));
+    CountListener next;
+    ReentrantListener listener(dispatcher, &next);
+    dispatcher.AddListener(&listener);
+
+    for (int32_t i = 0; i < 11; i++)
+        dispatcher.Dispatch(i * 40000, Regions(i), 0, i * 40);
+    uint64_t start = System::GetSteadyMilliSeconds();
+    while (listener.starts == 0 && System::GetSteadyMilliSeconds() - start < DISPATCH_WAIT_TIMEOUT)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_EQ(1, listener.starts);
+
+    //移除自己后不再回调,新添加的监听者收到之后的结果
+    for (int32_t i = 11; i < 70; i++)
+        dispatcher.Dispatch(i * 40000, Regions(i), 0, i * 40);
+    ASSERT_TRUE(WaitSeq(next, 70));
+    EXPECT_EQ(1, listener.starts);
+    EXPECT_EQ(1, next.starts);
+
+    dispatcher.RemoveListener(&next);
+    dispatcher.Close();
+}
+
+namespace
+{
+
+//在区域触发回调中移除自己,等分发器析构后再继续读取区域名称
+class OutliveListener : public DetectListener
+{
+public:
+    explicit OutliveListener(DetectDispatcher *dispatcher) : dispatcher(dispatcher),
+                                                             removed(false),
+                                                             triggers(0)
+    {
+    }
+
+    void OnTrigger(int32_t num) override { triggers++; }
+    void OnZoneTrigger(int32_t zone, const std::string &name, int32_t num) override
+    {
+        if (!removed)
+        {
+            dispatcher.load()->RemoveListener(this);
+            removed = true;
+            uint64_t start = System::GetSteadyMilliSeconds();
+            while (dispatcher && System::GetSteadyMilliSeconds() - start < DISPATCH_WAIT_TIMEOUT)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        names.push_back(name);
+    }
+
+    std::atomic<DetectDispatcher *> dispatcher;
+    std::atomic<bool> removed;
+    std::atomic<int32_t> triggers;
+    std::vector<std::string> names;
+};
+} // namespace
+
+//回调中移除自己时回调线程分离,分发器析构后回调仍使用有效的区域位图
+TEST(DetectDispatcherTest, CallbackOutlivesDispatcher)
+{
+    VideoDetectModule::Params params = DispatchParams();
+    //两个运动区域的中心分别在两个包含区域中
+    params.zones = {{"left", false, {{0, 0}, {160, 0}, {160, 240}, {0, 240}}, 0},
+                    {"all", false, {{0, 0}, {320, 0}, {320, 240}, {0, 240}}, 0}};
+    DetectDispatcher *dispatcher = new DetectDispatcher();
+    ASSERT_EQ(0, dispatcher->Initialize(params));
+    OutliveListener listener(dispatcher);
+    dispatcher->AddListener(&listener);
+    dispatcher->Dispatch(40000, {{10, 10, 41, 41, 1024, DETECT_ZONE_FRAME}, {200, 10, 231, 41, 1024, DETECT_ZONE_FRAME}}, 0, 40);
+
+    uint64_t start = System::GetSteadyMilliSeconds();
+    while (!listener.removed && System::GetSteadyMilliSeconds() - start < DISPATCH_WAIT_TIMEOUT)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(listener.removed);
+    delete dispatcher;
+    listener.dispatcher = nullptr;
+
+    start = System::GetSteadyMilliSeconds();
+    while (listener.triggers == 0 && System::GetSteadyMilliSeconds() - start < DISPATCH_WAIT_TIMEOUT)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(1, listener.triggers);
+    ASSERT_EQ(2u, listener.names.size());
+    EXPECT_EQ("left", listener.names[0]);
+    EXPECT_EQ("all", listener.names[1]);
+}
+
+namespace
+{
+
+//整体变化阈值60%的参数,最小面积400
+VideoDetectModule::Params IllumParams(const std::vector<DetectZone> &zones)
+{
+    VideoDetectModule::Params params = DispatchParams();
+    params.zones = zones;
+    params.min_area = 400;
+    params.illum_ratio = 60;
+    return params;
+}
+
+DetectResult DispatchOnce(const VideoDetectModule::Params &params, const std::vector<DetectRect> &regions)
+{
+    DetectDispatcher dispatcher;
+    DetectResult result;
+    memset(&result, 0, sizeof(result));
+    EXPECT_EQ(0, dispatcher.Initialize(params));
+    dispatcher.Dispatch(40000, regions, 0, 40);
+    EXPECT_TRUE(dispatcher.GetResult(result));
+    return result;
+}
+} // namespace
+
+//整体变化按过滤后的运动面积和检测范围计算
+TEST(DetectDispatcherTest, IlluminationSuppression)
+{
+    //大区域覆盖70%的画面
+    std::vector<DetectRect> large = {{0, 0, 319, 167, 320 * 168, DETECT_ZONE_FRAME}};
+    DetectResult result = DispatchOnce(IllumParams({}), large);
+    EXPECT_TRUE(result.suppressed);
+    EXPECT_FALSE(result.hit);
+    EXPECT_EQ(0, result.event.num);
+
+    //小于最小面积的噪点总面积超过60%也不抑制
+    std::vector<DetectRect> noise;
+    for (uint16_t y = 0; y < DISPATCH_HEIGHT; y += 16)
+    {
+        for (uint16_t x = 0; x < DISPATCH_WIDTH; x += 16)
+            noise.push_back({x, y, static_cast<uint16_t>(x + 15), static_cast<uint16_t>(y + 15), 256, DETECT_ZONE_FRAME});
+    }
+    noise.push_back({100, 100, 131, 131, 1024, DETECT_ZONE_FRAME});
+    result = DispatchOnce(IllumParams({}), noise);
+    EXPECT_FALSE(result.suppressed);
+    EXPECT_TRUE(result.hit);
+    EXPECT_EQ(1, result.event.num);
+
+    //只检测左上四分之一,整个包含区域变化时抑制,虽然只占画面的25%
+    DetectZone zone = {"corner", false, {{0, 0}, {160, 0}, {160, 120}, {0, 120}}, 0};
+    std::vector<DetectRect> corner = {{0, 0, 159, 119, 160 * 120, DETECT_ZONE_FRAME}};
+    result = DispatchOnce(IllumParams({zone}), corner);
+    EXPECT_TRUE(result.suppressed);
+    EXPECT_FALSE(result.hit);
+}
@@ -0,0 +1,248 @@
+#include "record/fmp4_muxer.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#define TEST_FMP4_FILE "fmp4_muxer_test.mp4"
+#define TEST_GOP_SIZE 25
+#define TEST_KILL_FRAGMENTS 3 //写完3个分片后在第4个GOP中途杀掉写入进程
+#define TEST_FRAME_INTERVAL 40000
+
+using namespace nvr;
+
+namespace
+{
+
+const uint8_t KSps[] = {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10, 0x00, 0x00,
+                        0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0, 0xf1, 0x83, 0x19, 0x60};
+const uint8_t KPps[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+//带起始码的一帧,负载为固定种子的伪随机数
+class FrameSource
+{
+public:
+    FrameSource() : seed_(1), ts_(0) {}
+
+    int32_t Write(Muxer &muxer, int32_t type, const uint8_t *nalu, uint32_t len)
+    {
+        buf_.assign({0, 0, 0, 1});
+        buf_.insert(buf_.end(), nalu, nalu + len);
+        return Write(muxer, type);
+    }
+
+    int32_t Write(Muxer &muxer, bool key)
+    {
+        uint32_t len = key ? 20000 + Next() % 4000 : 2000 + Next() % 3000;
+        buf_.assign({0, 0, 0, 1, static_cast<uint8_t>(key ? 0x65 : 0x41)});
+        for (uint32_t i = 0; i < len; i++)
+            buf_.push_back(static_cast<uint8_t>(Next() >> 24));
+        ts_ += TEST_FRAME_INTERVAL;
+        return Write(muxer, key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE);
+    }
+
+private:
+    int32_t Write(Muxer &muxer, int32_t type)
+    {
+        VideoFrame frame;
+        frame.data = buf_.data();
+        frame.len = buf_.size();
+        frame.ts = ts_;
+        frame.type = type;
+        return muxer.WriteVideoFrame(frame);
+    }
+
+    uint32_t Next()
+    {
+        seed_ = seed_ * 1664525 + 1013904223;
+        return seed_;
+    }
+
+private:
+    uint32_t seed_;
+    uint64_t ts_;
+    std::vector<uint8_t> buf_;
+};
+
+uint32_t Read32(const uint8_t *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+//在box内容中查找子box,返回内容的偏移
+bool FindBox(const std::string &file, size_t begin, size_t end, const char *type, size_t &content, size_t &size)
+{
+    while (begin + 8 <= end)
+    {
+        size_t box = Read32(reinterpret_cast<const uint8_t *>(&file[begin]));
+        if (box < 8 || begin + box > end)
+            return false;
+        if (memcmp(&file[begin + 4], type, 4) == 0)
+        {
+            content = begin + 8;
+            size = box - 8;
+            return true;
+        }
+        begin += box;
+    }
+    return false;
+}
+
+//按box遍历文件,返回完整的分片数:moof/trun中的sample长度之和与mdat一致,每个sample的长度前缀正确
+int32_t CountFragments(const std::string &file, bool &has_init)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(file.data());
+    size_t pos = 0;
+    int32_t fragments = 0;
+    has_init = false;
+    while (pos + 8 <= file.size())
+    {
+        size_t box = Read32(data + pos);
+        if (box < 8 || pos + box > file.size())
+            break;
+        if (memcmp(data + pos + 4, "moov", 4) == 0)
+            has_init = true;
+        if (memcmp(data + pos + 4, "moof", 4) == 0)
+        {
+            size_t traf, traf_size, trun, trun_size;
+            if (!FindBox(file, pos + 8, pos + box, "traf", traf, traf_size) ||
+                !FindBox(file, traf, traf + traf_size, "trun", trun, trun_size))
+                break;
+            //trun:version/flags,sample_count,data_offset,每个sample为duration,size,flags
+            uint32_t count = Read32(data + trun + 4);
+            std::vector<uint32_t> sizes;
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                sizes.push_back(Read32(data + trun + 12 + i * 12 + 4));
+                total += sizes.back();
+            }
+
+            size_t mdat = pos + box;
+            if (mdat + 8 > file.size() || memcmp(data + mdat + 4, "mdat", 4) != 0 ||
+                Read32(data + mdat) != total + 8 || mdat + 8 + total > file.size())
+                break;
+            size_t sample = mdat + 8;
+            for (uint32_t size : sizes)
+            {
+                if (Read32(data + sample) + 4 != size)
+                    return -1;
+                sample += size;
+            }
+            fragments++;
+            box += total + 8;
+        }
+        pos += box;
+    }
+    return fragments;
+}
+
+std::string ReadFile(const char *path)
+{
+    std::string data;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return data;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.append(buf, n);
+    fclose(fp);
+    return data;
+}
+
+//写入进程:每个GOP开始时上一个分片已经提交,等IO线程写完后通过管道报告完整的分片数,之后在GOP中途慢速写入直到被杀掉
+void WriterProcess(int fd)
+{
+    //sync_interval为0,每个分片都同步
+    FMP4Muxer muxer({64 * 1024, 0, 0, 4096});
+    if (0 != muxer.Initialize(TEST_FMP4_FILE, 1280, 720, 25))
+        _exit(1);
+
+    FrameSource source;
+    source.Write(muxer, H264Frame::NaluType::SPS, KSps, sizeof(KSps));
+    source.Write(muxer, H264Frame::NaluType::PPS, KPps, sizeof(KPps));
+    for (int32_t gop = 0;; gop++)
+    {
+        if (0 != source.Write(muxer, true))
+            _exit(1);
+        if (gop > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (write(fd, &gop, sizeof(gop)) != sizeof(gop))
+                _exit(1);
+        }
+        for (int32_t i = 1; i < TEST_GOP_SIZE; i++)
+        {
+            if (0 != source.Write(muxer, false))
+                _exit(1);
+            if (gop >= TEST_KILL_FRAGMENTS)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+} // namespace
+
+//写入过程中被杀掉(模拟掉电前最后一刻),文件可以解析到最后一个已提交的完整分片
+TEST(FMP4MuxerTest, ParsesAfterKill)
+{
+    remove(TEST_FMP4_FILE);
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        close(fds[0]);
+        WriterProcess(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    int32_t fragments = 0;
+    while (fragments < TEST_KILL_FRAGMENTS && read(fds[0], &fragments, sizeof(fragments)) == sizeof(fragments))
+        ;
+    //再写入几帧,确保停在GOP中途
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    close(fds[0]);
+    ASSERT_TRUE(WIFSIGNALED(status));
+    ASSERT_EQ(TEST_KILL_FRAGMENTS, fragments);
+
+    bool has_init;
+    std::string file = ReadFile(TEST_FMP4_FILE);
+    EXPECT_EQ(TEST_KILL_FRAGMENTS, CountFragments(file, has_init));
+    EXPECT_TRUE(has_init);
+    remove(TEST_FMP4_FILE);
+}
+
+//正常关闭时所有分片完整
+TEST(FMP4MuxerTest, CompleteFile)
+{
+    {
+        FMP4Muxer muxer({64 * 1024, 0, 2000, 4096});
+        ASSERT_EQ(0, muxer.Initialize(TEST_FMP4_FILE, 1280, 720, 25));
+        FrameSource source;
+        source.Write(muxer, H264Frame::NaluType::SPS, KSps, sizeof(KSps));
+        source.Write(muxer, H264Frame::NaluType::PPS, KPps, sizeof(KPps));
+        for (int32_t i = 0; i < TEST_GOP_SIZE * 4 + 3; i++)
+            ASSERT_EQ(0, source.Write(muxer, i % TEST_GOP_SIZE == 0));
+        muxer.Close();
+    }
+
+    bool has_init;
+    std::string file = ReadFile(TEST_FMP4_FILE);
+    EXPECT_EQ(5, CountFragments(file, has_init));
+    EXPECT_TRUE(has_init);
+    remove(TEST_FMP4_FILE);
+}
@@ -0,0 +1,209 @@
+#include "playback/http_playback.h"
+#include "record/es_muxer.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <dirent.h>
+
+#include <string>
+#include <vector>
+
+#define TEST_PLAYBACK_PATH "http_playback_test"
+#define TEST_PLAYBACK_PORT 18081
+#define TEST_PLAYBACK_TOKEN "secret"
+#define TEST_PLAYBACK_ES "/2024_01_01/event_10_05_00.es"
+#define TEST_ES_GOPS 3
+#define TEST_ES_GOP_SIZE 25
+
+using namespace nvr;
+
+namespace
+{
+
+void WriteFile(const std::string &filename, const std::string &data)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(fp != nullptr);
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+}
+
+//裸码流录像,每个GOP前写SPS/PPS
+void WriteEs(const std::string &filename)
+{
+    static const uint8_t KSps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+    static const uint8_t KPps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+    EsMuxer muxer({64 * 1024, 0, 0, 0});
+    ASSERT_EQ(0, muxer.Initialize(filename, 1280, 720, 25));
+    for (int32_t i = 0; i < TEST_ES_GOPS * TEST_ES_GOP_SIZE; i++)
+    {
+        std::vector<uint8_t> buf;
+        VideoFrame frame;
+        frame.ts = 1000000 + i * 40000;
+        bool key = i % TEST_ES_GOP_SIZE == 0;
+        if (key)
+        {
+            for (int32_t j = 0; j < 2; j++)
+            {
+                buf.assign(j ? KPps : KSps, j ? KPps + sizeof(KPps) : KSps + sizeof(KSps));
+                frame.data = buf.data();
+                frame.len = buf.size();
+                frame.type = j ? H264Frame::NaluType::PPS : H264Frame::NaluType::SPS;
+                ASSERT_EQ(0, muxer.WriteVideoFrame(frame));
+            }
+        }
+        buf.assign(key ? 2000 : 400, static_cast<uint8_t>(0x80 | i));
+        buf[0] = buf[1] = buf[2] = 0;
+        buf[3] = 1;
+        buf[4] = key ? 0x65 : 0x41;
+        frame.data = buf.data();
+        frame.len = buf.size();
+        frame.type = key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE;
+        ASSERT_EQ(0, muxer.WriteVideoFrame(frame));
+    }
+    muxer.Close();
+}
+
+//统计顶层box的个数
+int CountBoxes(const std::string &data, const char *type)
+{
+    int count = 0;
+    size_t pos = 0;
+    while (pos + 8 <= data.size())
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data() + pos);
+        size_t size = (static_cast<size_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        if (size < 8)
+            break;
+        if (data.compare(pos + 4, 4, type) == 0)
+            count++;
+        pos += size;
+    }
+    return count;
+}
+
+//发送一个请求,返回状态码,body为响应体
+int Get(const std::string &target, const std::string &headers, std::string &body)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PLAYBACK_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    std::string response;
+    char buf[4096];
+    ssize_t ret;
+    while ((ret = recv(fd, buf, sizeof(buf), 0)) > 0)
+        response.append(buf, ret);
+    close(fd);
+
+    int status = 0;
+    if (sscanf(response.c_str(), "HTTP/1.1 %d", &status) != 1)
+        return -1;
+    size_t pos = response.find("\r\n\r\n");
+    body = pos == std::string::npos ? "" : response.substr(pos + 4);
+    return status;
+}
+
+class HttpPlaybackTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        System::CreateDir(TEST_PLAYBACK_PATH "/2024_01_01");
+        WriteFile(TEST_PLAYBACK_PATH "/2024_01_01/10_00_00.mp4", "mp4 data");
+        WriteEs(TEST_PLAYBACK_PATH TEST_PLAYBACK_ES);
+        WriteFile(TEST_PLAYBACK_PATH "/2024_01_01/.record_next_1", "temp");
+        WriteFile(TEST_PLAYBACK_PATH "/2024_01_01/10_00_00.txt", "text");
+        WriteFile(TEST_PLAYBACK_PATH "/.segment.idx", "index");
+    }
+
+    void TearDown() override
+    {
+        if (playback_)
+            playback_->Close();
+        for (const char *name : {"/2024_01_01/10_00_00.mp4", TEST_PLAYBACK_ES, TEST_PLAYBACK_ES RECORD_ES_INDEX_SUFFIX, "/2024_01_01/.record_next_1",
+                                 "/2024_01_01/10_00_00.txt", "/.segment.idx"})
+            unlink((std::string(TEST_PLAYBACK_PATH) + name).c_str());
+        rmdir(TEST_PLAYBACK_PATH "/2024_01_01");
+        rmdir(TEST_PLAYBACK_PATH);
+    }
+
+    void Start(const std::string &token)
+    {
+        playback_ = HttpPlaybackImpl::Create({"http://127.0.0.1:" + std::to_string(TEST_PLAYBACK_PORT), TEST_PLAYBACK_PATH, 0, token});
+        ASSERT_TRUE(playback_);
+    }
+
+    rtc::scoped_refptr<PlaybackModule> playback_;
+};
+} // namespace
+
+TEST_F(HttpPlaybackTest, OnlyRecordFiles)
+{
+    Start("");
+    std::string body;
+    EXPECT_EQ(200, Get("/record/2024_01_01/10_00_00.mp4", "", body));
+    EXPECT_EQ("mp4 data", body);
+    EXPECT_EQ(200, Get("/record/2024_01_01/event_10_05_00.es", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01/event_10_05_00.es" RECORD_ES_INDEX_SUFFIX, "", body));
+
+    //隐藏文件,非录像后缀,目录穿越,空路径分量
+    EXPECT_EQ(404, Get("/record/2024_01_01/.record_next_1", "", body));
+    EXPECT_EQ(404, Get("/record/.segment.idx", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01/10_00_00.txt", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01/../2024_01_01/10_00_00.mp4", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01/./10_00_00.mp4", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01//10_00_00.mp4", "", body));
+    EXPECT_EQ(404, Get("/record/2024_01_01", "", body));
+}
+
+TEST_F(HttpPlaybackTest, Token)
+{
+    Start(TEST_PLAYBACK_TOKEN);
+    std::string body;
+    EXPECT_EQ(401, Get("/record/2024_01_01/10_00_00.mp4", "", body));
+    EXPECT_EQ(401, Get("/record/2024_01_01/10_00_00.mp4?token=wrong", "", body));
+    EXPECT_EQ(401, Get("/list", "Authorization: Bearer secre\r\n", body));
+    EXPECT_EQ(200, Get("/record/2024_01_01/10_00_00.mp4?token=" TEST_PLAYBACK_TOKEN, "", body));
+    EXPECT_EQ("mp4 data", body);
+    EXPECT_EQ(200, Get("/record/2024_01_01/10_00_00.mp4", "Authorization: Bearer " TEST_PLAYBACK_TOKEN "\r\n", body));
+    EXPECT_EQ(200, Get("/list?begin=0&token=" TEST_PLAYBACK_TOKEN, "", body));
+}
+
+//裸码流录像封装为fmp4发送,每个GOP一个分片,临时文件不留在录像目录
+TEST_F(HttpPlaybackTest, EsAsFmp4)
+{
+    Start("");
+    std::string body;
+    ASSERT_EQ(200, Get("/record/2024_01_01/event_10_05_00.es", "", body));
+    EXPECT_EQ(1, CountBoxes(body, "ftyp"));
+    EXPECT_EQ(1, CountBoxes(body, "moov"));
+    EXPECT_EQ(TEST_ES_GOPS, CountBoxes(body, "moof"));
+    EXPECT_EQ(TEST_ES_GOPS, CountBoxes(body, "mdat"));
+
+    //Range请求按封装后的长度计算
+    std::string part;
+    EXPECT_EQ(206, Get("/record/2024_01_01/event_10_05_00.es", "Range: bytes=0-7\r\n", part));
+    EXPECT_EQ(body.substr(0, 8), part);
+
+    DIR *dir = opendir(TEST_PLAYBACK_PATH);
+    ASSERT_TRUE(dir != nullptr);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+        EXPECT_NE(0, strncmp(entry->d_name, ".playback_", 10));
+    closedir(dir);
+}
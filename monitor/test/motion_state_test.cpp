@@ -0,0 +1,301 @@
+#include "video_detect/motion_state.h"
+#include "video_detect/detect_dispatcher.h"
+#include "video_detect/software_detect.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#define REPLAY_WIDTH 320
+#define REPLAY_HEIGHT 240
+#define REPLAY_INTERVAL 100 //10fps,帧间隔(ms)
+#define CLIP_FILE "motion_state_test.yuv"
+#define CLIP_FRAMES 40
+#define CLIP_INTERVAL 50 //20fps,按实际帧率送帧,冷却按系统时钟计时(ms)
+#define CLIP_COOLDOWN 500
+
+using namespace nvr;
+
+TEST(MotionStateTest, ConfirmsNofM)
+{
+    MotionStateMachine state;
+    state.Initialize({3, 5, 1000});
+
+    //5帧窗口内只有2帧命中不开始
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(true, 0));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(false, 100));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(false, 200));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(true, 300));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(false, 400));
+    //第一帧已经移出窗口
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(true, 500));
+    EXPECT_EQ(MotionStateMachine::KStart, state.Update(true, 600));
+    EXPECT_TRUE(state.Active());
+    EXPECT_EQ(MotionStateMachine::KUpdate, state.Update(true, 700));
+}
+
+TEST(MotionStateTest, EndsAfterCooldown)
+{
+    MotionStateMachine state;
+    state.Initialize({1, 1, 1000});
+
+    EXPECT_EQ(MotionStateMachine::KStart, state.Update(true, 0));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(false, 500));
+    //冷却期内再次命中重新计时
+    EXPECT_EQ(MotionStateMachine::KUpdate, state.Update(true, 900));
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(false, 1899));
+    EXPECT_EQ(MotionStateMachine::KEnd, state.Update(false, 1900));
+    EXPECT_FALSE(state.Active());
+    EXPECT_EQ(MotionStateMachine::KStart, state.Update(true, 2000));
+}
+
+TEST(MotionStateTest, ReconfirmsAfterEnd)
+{
+    MotionStateMachine state;
+    state.Initialize({2, 4, 0});
+
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(true, 0));
+    EXPECT_EQ(MotionStateMachine::KStart, state.Update(true, 100));
+    EXPECT_EQ(MotionStateMachine::KEnd, state.Update(false, 200));
+    //结束前的命中不计入下一次确认
+    EXPECT_EQ(MotionStateMachine::KNone, state.Update(true, 300));
+    EXPECT_EQ(MotionStateMachine::KStart, state.Update(true, 400));
+}
+
+namespace
+{
+
+//合成的检测区域序列,10fps:
+//[0,40)和[100,130)为噪声,每5帧一个大区域(树叶,光斑);[40,70)和[130,140)为行人,每帧一个大区域,其中50~52帧漏检
+//每帧都有一个面积64的小区域(雨滴,噪点);其余帧只有小区域
+bool IsNoise(int32_t frame)
+{
+    return ((frame < 40) || (frame >= 100 && frame < 130)) && frame % 5 == 0;
+}
+
+bool IsWalker(int32_t frame)
+{
+    return (frame >= 40 && frame < 70 && (frame < 50 || frame > 52)) || (frame >= 130 && frame < 140);
+}
+
+std::vector<std::vector<DetectRect>> BuildSequence()
+{
+    std::vector<std::vector<DetectRect>> sequence(160);
+    for (int32_t frame = 0; frame < static_cast<int32_t>(sequence.size()); frame++)
+    {
+        std::vector<DetectRect> &regions = sequence[frame];
+        regions.push_back({10, 10, 17, 17, 64, DETECT_ZONE_FRAME});
+        if (IsNoise(frame))
+            regions.push_back({200, 20, 239, 59, 1600, DETECT_ZONE_FRAME});
+        if (IsWalker(frame))
+        {
+            uint16_t left = static_cast<uint16_t>(frame % 40 * 6);
+            regions.push_back({left, 100, static_cast<uint16_t>(left + 31), 179, 2560, DETECT_ZONE_FRAME});
+        }
+    }
+    return sequence;
+}
+
+//回调在监听者线程中执行,按事件时间换算帧号
+class ReplayListener : public DetectListener
+{
+public:
+    ReplayListener() : seq(0) {}
+
+    void OnTrigger(int32_t num) override {}
+    void OnMotionStart(const MotionEvent &event) override { starts.push_back(event.ts / 1000 / REPLAY_INTERVAL); }
+    void OnMotionEnd(uint64_t ts) override { ends.push_back(ts / 1000 / REPLAY_INTERVAL); }
+    void OnResult(const DetectResult &result) override { seq = result.seq; }
+
+    //事件开始时不在行人片段内即为误报
+    int32_t FalsePositives() const
+    {
+        int32_t count = 0;
+        for (int32_t start : starts)
+        {
+            if (!IsWalker(start))
+                count++;
+        }
+        return count;
+    }
+
+    std::atomic<uint64_t> seq;
+    std::vector<int32_t> starts;
+    std::vector<int32_t> ends;
+};
+
+void Replay(int32_t min_area, int32_t confirm_frames, int32_t confirm_window, int32_t cooldown, ReplayListener &listener)
+{
+    VideoDetectModule::Params params = {1, REPLAY_WIDTH, REPLAY_HEIGHT, 150, 4, 4, {}, 0, 0, 0,
+                                        min_area, confirm_frames, confirm_window, cooldown,
+                                        false, 0, 0, 0, 0, false, 0};
+    DetectDispatcher dispatcher;
+    ASSERT_EQ(0, dispatcher.Initialize(params));
+    dispatcher.AddListener(&listener);
+
+    std::vector<std::vector<DetectRect>> sequence = BuildSequence();
+    //每帧等待回调完成,和实际帧率下一样不会因为队列满丢弃通知
+    for (size_t i = 0; i < sequence.size(); i++)
+    {
+        dispatcher.Dispatch(i * REPLAY_INTERVAL * 1000, sequence[i], 0, i * REPLAY_INTERVAL);
+        for (int wait = 0; wait < 1000 && listener.seq <= i; wait++)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ASSERT_EQ(i + 1, listener.seq);
+    }
+    dispatcher.RemoveListener(&listener);
+}
+} // namespace
+
+//配置的默认组合:最小面积滤掉小区域,3/5确认滤掉零星的大区域,1s冷却跨过短暂漏检
+TEST(MotionStateReplayTest, FiltersNoise)
+{
+    ReplayListener listener;
+    Replay(400, 3, 5, 1000, listener);
+
+    //第3个连续命中帧开始,最后命中后10帧(1s)结束
+    EXPECT_EQ(std::vector<int32_t>({42, 132}), listener.starts);
+    EXPECT_EQ(std::vector<int32_t>({79, 149}), listener.ends);
+    EXPECT_EQ(0, listener.FalsePositives());
+}
+
+TEST(MotionStateReplayTest, NoConfirmation)
+{
+    ReplayListener listener;
+    Replay(400, 1, 1, 0, listener);
+
+    //每个噪声区域都单独成为事件,漏检把第一个行人拆成两个事件
+    EXPECT_EQ(14, listener.FalsePositives());
+    EXPECT_EQ(17u, listener.starts.size());
+    EXPECT_EQ(17u, listener.ends.size());
+}
+
+TEST(MotionStateReplayTest, NoMinArea)
+{
+    ReplayListener listener;
+    Replay(0, 3, 5, 1000, listener);
+
+    //小区域每帧命中,第3帧开始后一直不结束
+    EXPECT_EQ(std::vector<int32_t>({2}), listener.starts);
+    EXPECT_TRUE(listener.ends.empty());
+    EXPECT_EQ(1, listener.FalsePositives());
+}
+
+namespace
+{
+
+//I420片段:固定纹理的背景,[10,20)帧有一个64x64的亮块从左向右移动
+void WriteClip()
+{
+    FILE *fp = fopen(CLIP_FILE, "wb");
+    ASSERT_NE(nullptr, fp);
+    std::vector<uint8_t> luma(REPLAY_WIDTH * REPLAY_HEIGHT);
+    std::vector<uint8_t> chroma(REPLAY_WIDTH * REPLAY_HEIGHT / 2, 128);
+    for (int32_t frame = 0; frame < CLIP_FRAMES; frame++)
+    {
+        for (int32_t y = 0; y < REPLAY_HEIGHT; y++)
+        {
+            for (int32_t x = 0; x < REPLAY_WIDTH; x++)
+                luma[y * REPLAY_WIDTH + x] = static_cast<uint8_t>(64 + ((x / 8 + y / 8) % 2) * 64 + (x * 3 + y * 5) % 32);
+        }
+        if (frame >= 10 && frame < 20)
+        {
+            int32_t left = 20 + (frame - 10) * 24;
+            for (int32_t y = 80; y < 144; y++)
+                memset(&luma[y * REPLAY_WIDTH + left], 250, 64);
+        }
+        ASSERT_EQ(luma.size(), fwrite(luma.data(), 1, luma.size(), fp));
+        ASSERT_EQ(chroma.size(), fwrite(chroma.data(), 1, chroma.size(), fp));
+    }
+    fclose(fp);
+}
+
+//回调在监听者线程中执行,记录事件开始和结束的帧时间(us)
+class ClipListener : public DetectListener
+{
+public:
+    ClipListener() : seq(0) {}
+
+    void OnTrigger(int32_t num) override {}
+    void OnMotionStart(const MotionEvent &event) override { starts.push_back(event.ts); }
+    void OnMotionEnd(uint64_t ts) override { ends.push_back(ts); }
+    void OnResult(const DetectResult &result) override
+    {
+        if (result.hit)
+            hits.push_back(result.event.ts);
+        seq = result.seq;
+    }
+
+    std::atomic<uint64_t> seq;
+    std::vector<uint64_t> starts;
+    std::vector<uint64_t> ends;
+    std::vector<uint64_t> hits;
+};
+} // namespace
+
+//从YUV文件读取检测帧送入SoftwareVideoDetectImpl,和detect_replay一样只使用亮度,
+//亮块移动的片段产生一次事件,3/5确认后开始,最后命中后冷却结束
+TEST(MotionStateReplayTest, SoftwareDetectClip)
+{
+    WriteClip();
+    FILE *fp = fopen(CLIP_FILE, "rb");
+    ASSERT_NE(nullptr, fp);
+
+    VideoDetectModule::Params params = {1, REPLAY_WIDTH, REPLAY_HEIGHT, 100, 4, 16, {}, 0, 0, 0,
+                                        400, 3, 5, CLIP_COOLDOWN,
+                                        false, 0, 0, 0, 0, false, 0};
+    rtc::scoped_refptr<VideoDetectModule> module = SoftwareVideoDetectImpl::Create(params);
+    ASSERT_TRUE(module);
+    ClipListener listener;
+    module->AddListener(&listener);
+
+    //模拟VPSS检测通道的帧,步长与行宽相同
+    VIDEO_FRAME_INFO_S info;
+    uint8_t *vir_addr = nullptr;
+    memset(&info, 0, sizeof(info));
+    info.stVFrame.u32Width = REPLAY_WIDTH;
+    info.stVFrame.u32Height = REPLAY_HEIGHT;
+    info.stVFrame.u32Stride[0] = REPLAY_WIDTH;
+    info.stVFrame.enPixelFormat = PIXEL_FORMAT_YUV_SEMIPLANAR_420;
+    ASSERT_EQ(HI_SUCCESS, HI_MPI_SYS_MmzAlloc(&info.stVFrame.u32PhyAddr[0], (void **)&vir_addr, NULL, HI_NULL,
+                                              REPLAY_WIDTH * REPLAY_HEIGHT));
+    info.stVFrame.pVirAddr[0] = vir_addr;
+
+    uint64_t next = System::GetSteadyMilliSeconds();
+    for (int32_t frame = 0; frame < CLIP_FRAMES; frame++)
+    {
+        ASSERT_EQ(static_cast<size_t>(REPLAY_WIDTH * REPLAY_HEIGHT), fread(vir_addr, 1, REPLAY_WIDTH * REPLAY_HEIGHT, fp));
+        ASSERT_EQ(0, fseek(fp, REPLAY_WIDTH * REPLAY_HEIGHT / 2, SEEK_CUR));
+        info.stVFrame.u64pts = static_cast<uint64_t>(frame) * CLIP_INTERVAL * 1000;
+        module->OnFrame(info);
+        for (int wait = 0; wait < 1000 && listener.seq <= static_cast<uint64_t>(frame); wait++)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ASSERT_EQ(static_cast<uint64_t>(frame + 1), listener.seq);
+
+        next += CLIP_INTERVAL;
+        uint64_t now = System::GetSteadyMilliSeconds();
+        if (next > now)
+            std::this_thread::sleep_for(std::chrono::milliseconds(next - now));
+    }
+    module->RemoveListener(&listener);
+    module->Close();
+    HI_MPI_SYS_MmzFree(info.stVFrame.u32PhyAddr[0], vir_addr);
+    fclose(fp);
+    remove(CLIP_FILE);
+
+    //亮块出现的帧开始命中,离开后背景按学习率逐帧恢复,残影到24帧
+    ASSERT_FALSE(listener.hits.empty());
+    EXPECT_EQ(10u * CLIP_INTERVAL * 1000, listener.hits.front());
+    EXPECT_EQ(24u * CLIP_INTERVAL * 1000, listener.hits.back());
+    ASSERT_EQ(1u, listener.starts.size());
+    ASSERT_EQ(1u, listener.ends.size());
+    EXPECT_EQ(12u * CLIP_INTERVAL * 1000, listener.starts[0]);
+    //冷却按系统时钟计时,送帧的抖动最多推迟一帧
+    EXPECT_GE(listener.ends[0], listener.hits.back() + CLIP_COOLDOWN * 1000);
+    EXPECT_LE(listener.ends[0], listener.hits.back() + (CLIP_COOLDOWN + CLIP_INTERVAL) * 1000);
+}
@@ -0,0 +1,201 @@
+#include "record/mp4_record.h"
+#include "record/es_reader.h"
+#include "record/mp4_recovery.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <dirent.h>
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define TEST_RECORD_PATH "mp4_record_test"
+#define TEST_FRAME_INTERVAL 40000
+
+using namespace nvr;
+
+namespace
+{
+
+const uint8_t KSps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+const uint8_t KPps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+class FrameFeeder
+{
+public:
+    explicit FrameFeeder(RecordModule &record) : record_(record), ts_(0) {}
+
+    void Feed(int32_t type, const uint8_t *data, uint32_t len)
+    {
+        VideoFrame frame;
+        frame.data = const_cast<uint8_t *>(data);
+        frame.len = len;
+        frame.ts = ts_;
+        frame.type = type;
+        record_.OnFrame(frame);
+    }
+
+    void Feed(bool key)
+    {
+        std::vector<uint8_t> data(1000, static_cast<uint8_t>(ts_ / TEST_FRAME_INTERVAL));
+        data[0] = data[1] = data[2] = 0;
+        data[3] = 1;
+        data[4] = key ? 0x65 : 0x41;
+        ts_ += TEST_FRAME_INTERVAL;
+        Feed(key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE, data.data(), data.size());
+        std::this_thread::sleep_for(std::chrono::microseconds(TEST_FRAME_INTERVAL));
+    }
+
+private:
+    RecordModule &record_;
+    uint64_t ts_;
+};
+
+void RemoveDir(const std::string &path)
+{
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        if (entry->d_type == DT_DIR)
+            RemoveDir(path + '/' + name);
+        else
+            unlink((path + '/' + name).c_str());
+    }
+    closedir(dir);
+    rmdir(path.c_str());
+}
+
+//日期目录下的录像文件,按文件名(时间)排序
+std::vector<std::string> ListRecords(const std::string &path)
+{
+    std::vector<std::string> files;
+    std::string day = path + '/' + System::GetLocalTime(RECORD_DIR_FORMAT);
+    DIR *dir = opendir(day.c_str());
+    if (!dir)
+        return files;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name.size() > strlen(RECORD_ES_SUFFIX) && name.compare(name.size() - strlen(RECORD_ES_SUFFIX), std::string::npos, RECORD_ES_SUFFIX) == 0)
+            files.push_back(day + '/' + name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+//文件开头的帧类型,最多count个
+std::vector<int32_t> LeadingTypes(const std::string &filename, size_t count)
+{
+    std::vector<int32_t> types;
+    EsReader reader;
+    if (0 != reader.Open(filename))
+        return types;
+    VideoFrame frame;
+    bool meta;
+    while (types.size() < count && 0 == reader.Next(frame, meta))
+    {
+        if (!meta && frame.len > 4)
+            types.push_back(frame.data[4] & 0x1f);
+    }
+    return types;
+}
+} // namespace
+
+//参数集只在预录缓存中出现:预录写入时也要记录SPS/PPS并保存编码参数,分段后新文件的I帧前补写参数集
+TEST(MP4RecordTest, PreRollParameterSets)
+{
+    RemoveDir(TEST_RECORD_PATH);
+    ASSERT_EQ(0, System::CreateDir(TEST_RECORD_PATH));
+
+    RecordModule::Params params = {25, 1280, 720, TEST_RECORD_PATH, 1, true, 10, "es", 2, 1024,
+                                   64, 0, 0, 4, 1024, 90, 80, 0};
+    rtc::scoped_refptr<RecordModule> record = MP4RecordImpl::Create(params);
+    ASSERT_TRUE(record);
+
+    //空闲时的码流进入预录缓存,之后编码器不再输出参数集
+    FrameFeeder feeder(*record);
+    feeder.Feed(H264Frame::NaluType::SPS, KSps, sizeof(KSps));
+    feeder.Feed(H264Frame::NaluType::PPS, KPps, sizeof(KPps));
+    feeder.Feed(true);
+    for (int32_t i = 0; i < 5; i++)
+        feeder.Feed(false);
+
+    //触发后超过分段时长,下一个I帧切换文件
+    record->OnTrigger(1);
+    uint64_t begin = System::GetSteadyMilliSeconds();
+    while (System::GetSteadyMilliSeconds() < begin + 1200)
+        feeder.Feed(false);
+    record->OnTrigger(1);
+    feeder.Feed(true);
+    for (int32_t i = 0; i < 5; i++)
+        feeder.Feed(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    record->Close();
+
+    std::vector<std::string> files = ListRecords(TEST_RECORD_PATH);
+    ASSERT_EQ(2u, files.size());
+    std::vector<int32_t> expect = {H264Frame::NaluType::SPS, H264Frame::NaluType::PPS, H264Frame::NaluType::ISLICE};
+    EXPECT_EQ(expect, LeadingTypes(files[0], 3));
+    EXPECT_EQ(expect, LeadingTypes(files[1], 3));
+
+    MP4Recovery::Codec codec;
+    ASSERT_EQ(0, MP4Recovery::LoadCodec(TEST_RECORD_PATH, codec));
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(KSps) + 4, sizeof(KSps) - 4), codec.sps);
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(KPps) + 4, sizeof(KPps) - 4), codec.pps);
+    RemoveDir(TEST_RECORD_PATH);
+}
+
+//触发延迟从OnTrigger开始计时,到写入第一帧实时码流为止,预录数据不计入
+TEST(MP4RecordTest, TriggerLatency)
+{
+    RemoveDir(TEST_RECORD_PATH);
+    ASSERT_EQ(0, System::CreateDir(TEST_RECORD_PATH));
+
+    RecordModule::Params params = {25, 1280, 720, TEST_RECORD_PATH, 60, true, 10, "es", 2, 1024,
+                                   64, 0, 0, 4, 1024, 90, 80, 0};
+    rtc::scoped_refptr<RecordModule> record = MP4RecordImpl::Create(params);
+    ASSERT_TRUE(record);
+    MP4RecordImpl *impl = static_cast<MP4RecordImpl *>(record.get());
+
+    FrameFeeder feeder(*record);
+    feeder.Feed(H264Frame::NaluType::SPS, KSps, sizeof(KSps));
+    feeder.Feed(H264Frame::NaluType::PPS, KPps, sizeof(KPps));
+    feeder.Feed(true);
+    for (int32_t i = 0; i < 5; i++)
+        feeder.Feed(false);
+    EXPECT_EQ(0u, impl->TriggerLatency());
+
+    //触发后等待一段时间再送下一帧,预录在触发后立即写入,延迟至少为等待的时间
+    const uint64_t wait = 100000; //us
+    uint64_t begin = System::GetSteadyMicroSeconds();
+    record->OnTrigger(1);
+    std::this_thread::sleep_for(std::chrono::microseconds(wait));
+    feeder.Feed(false);
+    uint64_t elapsed = System::GetSteadyMicroSeconds() - begin;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t latency = impl->TriggerLatency();
+    EXPECT_GE(latency, wait);
+    EXPECT_LE(latency, elapsed + 100000);
+
+    //录像期间再次触发不重新统计
+    record->OnTrigger(1);
+    feeder.Feed(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(latency, impl->TriggerLatency());
+
+    record->Close();
+    RemoveDir(TEST_RECORD_PATH);
+}
@@ -0,0 +1,163 @@
+#include "record/record_index.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#define TEST_INDEX_PATH "record_index_test"
+#define TEST_INDEX_DAY "2024_01_01"
+#define TEST_INDEX_SEGMENTS 20 //多于启动时校验的末尾记录数
+#define TEST_INDEX_GOPS 5
+#define TEST_INDEX_BASE 1704067200000000ull //2024-01-01 00:00:00(us)
+#define TEST_INDEX_SEGMENT_LEN 60000000ull  //每个文件60s,每12s一个GOP
+
+using namespace nvr;
+
+namespace
+{
+
+std::string SegmentFile(int32_t n)
+{
+    char name[64];
+    snprintf(name, sizeof(name), TEST_INDEX_PATH "/" TEST_INDEX_DAY "/record_00_%02d_00.mp4", n);
+    return name;
+}
+
+uint64_t SegmentStart(int32_t n)
+{
+    return TEST_INDEX_BASE + n * TEST_INDEX_SEGMENT_LEN;
+}
+
+off_t FileSize(const char *name)
+{
+    struct stat st;
+    return stat((std::string(TEST_INDEX_PATH) + '/' + name).c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+void AddSegment(RecordIndex &index, int32_t n)
+{
+    FILE *fp = fopen(SegmentFile(n).c_str(), "wb");
+    ASSERT_TRUE(fp != nullptr);
+    fclose(fp);
+    ASSERT_EQ(0, index.BeginSegment(SegmentFile(n), SegmentStart(n), false));
+    for (int32_t i = 0; i < TEST_INDEX_GOPS; i++)
+        ASSERT_EQ(0, index.AddGOP(SegmentStart(n) + i * TEST_INDEX_SEGMENT_LEN / TEST_INDEX_GOPS, 1000 * (i + 1)));
+}
+
+class RecordIndexTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        TearDown();
+        System::CreateDir(TEST_INDEX_PATH "/" TEST_INDEX_DAY);
+        ASSERT_EQ(0, index_.Initialize(TEST_INDEX_PATH));
+        for (int32_t n = 0; n < TEST_INDEX_SEGMENTS; n++)
+        {
+            AddSegment(index_, n);
+            ASSERT_EQ(0, index_.EndSegment(SegmentStart(n) + TEST_INDEX_SEGMENT_LEN - 1));
+        }
+    }
+
+    void TearDown() override
+    {
+        index_.Close();
+        for (int32_t n = 0; n <= TEST_INDEX_SEGMENTS; n++)
+            unlink(SegmentFile(n).c_str());
+        unlink(TEST_INDEX_PATH "/" RECORD_INDEX_SEGMENT_FILE);
+        unlink(TEST_INDEX_PATH "/" RECORD_INDEX_GOP_FILE);
+        rmdir(TEST_INDEX_PATH "/" TEST_INDEX_DAY);
+        rmdir(TEST_INDEX_PATH);
+    }
+
+    std::vector<RecordIndex::Segment> ListAll()
+    {
+        std::vector<RecordIndex::Segment> segments;
+        RecordIndex::List(TEST_INDEX_PATH, 0, UINT64_MAX, segments);
+        return segments;
+    }
+
+    RecordIndex index_;
+};
+} // namespace
+
+//空间管理删除文件后索引随之压缩,记录id不变,之后的追加和查询不受影响
+TEST_F(RecordIndexTest, RemoveCompacts)
+{
+    off_t seg_size = FileSize(RECORD_INDEX_SEGMENT_FILE);
+    off_t gop_size = FileSize(RECORD_INDEX_GOP_FILE);
+
+    //正在录制一个文件时压缩
+    AddSegment(index_, TEST_INDEX_SEGMENTS);
+    std::vector<std::string> deleted;
+    for (int32_t n = 0; n < 4; n++)
+    {
+        unlink(SegmentFile(n).c_str());
+        deleted.push_back(SegmentFile(n));
+    }
+    ASSERT_EQ(0, index_.Remove(deleted));
+    ASSERT_EQ(0, index_.AddGOP(SegmentStart(TEST_INDEX_SEGMENTS) + 55000000, 9999));
+    ASSERT_EQ(0, index_.EndSegment(SegmentStart(TEST_INDEX_SEGMENTS) + TEST_INDEX_SEGMENT_LEN - 1));
+
+    EXPECT_EQ(seg_size - 4 * static_cast<off_t>(sizeof(RecordIndex::Segment)) + static_cast<off_t>(sizeof(RecordIndex::Segment)),
+              FileSize(RECORD_INDEX_SEGMENT_FILE));
+    EXPECT_EQ(gop_size - 4 * TEST_INDEX_GOPS * static_cast<off_t>(sizeof(RecordIndex::GOP)) + (TEST_INDEX_GOPS + 1) * static_cast<off_t>(sizeof(RecordIndex::GOP)),
+              FileSize(RECORD_INDEX_GOP_FILE));
+
+    std::vector<RecordIndex::Segment> segments = ListAll();
+    ASSERT_EQ(static_cast<size_t>(TEST_INDEX_SEGMENTS - 3), segments.size());
+    EXPECT_EQ(4u, segments.front().id);
+    EXPECT_EQ(static_cast<uint32_t>(TEST_INDEX_SEGMENTS), segments.back().id);
+    EXPECT_EQ(SegmentStart(TEST_INDEX_SEGMENTS) + TEST_INDEX_SEGMENT_LEN - 1, segments.back().end);
+
+    //已删除时间段内查找返回之后第一个文件
+    RecordIndex::Result result;
+    ASSERT_EQ(0, RecordIndex::Lookup(TEST_INDEX_PATH, SegmentStart(1) + 1, result));
+    EXPECT_EQ(SegmentFile(4), result.path);
+    EXPECT_EQ(SegmentStart(4), result.time);
+
+    //压缩时正在录制的文件,之后的GOP和结束时间写入新索引
+    ASSERT_EQ(0, RecordIndex::Lookup(TEST_INDEX_PATH, SegmentStart(TEST_INDEX_SEGMENTS) + 56000000, result));
+    EXPECT_EQ(9999u, result.offset);
+
+    //重新打开不触发重建,id继续递增
+    index_.Close();
+    ASSERT_EQ(0, index_.Initialize(TEST_INDEX_PATH));
+    EXPECT_EQ(static_cast<size_t>(TEST_INDEX_SEGMENTS - 3), ListAll().size());
+    AddSegment(index_, TEST_INDEX_SEGMENTS + 1);
+    EXPECT_EQ(static_cast<uint32_t>(TEST_INDEX_SEGMENTS + 1), ListAll().back().id);
+    unlink(SegmentFile(TEST_INDEX_SEGMENTS + 1).c_str());
+}
+
+//启动时只校验末尾记录:中间损坏的记录查询时跳过,不重建索引
+TEST_F(RecordIndexTest, VerifiesTailOnly)
+{
+    index_.Close();
+    int fd = open(TEST_INDEX_PATH "/" RECORD_INDEX_SEGMENT_FILE, O_RDWR);
+    ASSERT_GE(fd, 0);
+    uint8_t byte = 0xff;
+    ASSERT_EQ(1, pwrite(fd, &byte, 1, 16 + 2 * sizeof(RecordIndex::Segment) + 8));
+    close(fd);
+
+    ASSERT_EQ(0, index_.Initialize(TEST_INDEX_PATH));
+    std::vector<RecordIndex::Segment> segments = ListAll();
+    ASSERT_EQ(static_cast<size_t>(TEST_INDEX_SEGMENTS - 1), segments.size());
+    EXPECT_EQ(3u, segments[2].id);
+}
+
+//删除后压缩前掉电:启动时去掉开头已不存在的文件
+TEST_F(RecordIndexTest, DropsMissingAtStartup)
+{
+    index_.Close();
+    unlink(SegmentFile(0).c_str());
+    unlink(SegmentFile(1).c_str());
+
+    ASSERT_EQ(0, index_.Initialize(TEST_INDEX_PATH));
+    std::vector<RecordIndex::Segment> segments = ListAll();
+    ASSERT_EQ(static_cast<size_t>(TEST_INDEX_SEGMENTS - 2), segments.size());
+    EXPECT_EQ(2u, segments.front().id);
+}
@@ -0,0 +1,150 @@
+#include "live/rtmp.h"
+#include "test/stub/rtmp_server.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#define TEST_FRAME_RATE 25
+#define TEST_GOP 25
+#define TEST_SECONDS 2
+#define TEST_WAIT_TIMEOUT 3000 //ms
+
+using namespace nvr;
+
+namespace
+{
+
+const uint8_t KSps[] = {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+const uint8_t KPps[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+//按帧率实时产生码流,每个GOP前输出SPS/PPS,I帧大小为P帧的5倍,负载不含0避免出现起始码
+class StreamSource
+{
+public:
+    StreamSource(LiveModule &live, uint32_t kbps) : live_(live), ts_(0), frames_(0), vcl_(0), vcl_bytes_(0)
+    {
+        unit_ = kbps * 1000 / 8 * TEST_GOP / TEST_FRAME_RATE / (TEST_GOP + 4);
+    }
+
+    void Run(uint32_t seconds)
+    {
+        uint64_t begin = System::GetSteadyMicroSeconds();
+        for (uint32_t i = 0; i < seconds * TEST_FRAME_RATE; i++)
+        {
+            if (i % TEST_GOP == 0)
+            {
+                Feed(H264Frame::NaluType::SPS, KSps, sizeof(KSps));
+                Feed(H264Frame::NaluType::PPS, KPps, sizeof(KPps));
+            }
+            bool key = i % TEST_GOP == 0;
+            std::vector<uint8_t> nalu(key ? unit_ * 5 : unit_, static_cast<uint8_t>(0x80 | i));
+            nalu[0] = key ? 0x65 : 0x41;
+            Feed(key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE, nalu.data(), nalu.size());
+            vcl_++;
+            vcl_bytes_ += nalu.size();
+            ts_ += 1000000 / TEST_FRAME_RATE;
+
+            uint64_t due = begin + (i + 1) * 1000000ull / TEST_FRAME_RATE;
+            uint64_t now = System::GetSteadyMicroSeconds();
+            if (due > now)
+                std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        }
+    }
+
+    uint64_t Frames() const { return frames_; }
+
+    uint64_t Vcl() const { return vcl_; }
+
+    uint64_t VclBytes() const { return vcl_bytes_; }
+
+private:
+    void Feed(int32_t type, const uint8_t *nalu, uint32_t len)
+    {
+        buf_.assign({0, 0, 0, 1});
+        buf_.insert(buf_.end(), nalu, nalu + len);
+        VideoFrame frame;
+        frame.data = buf_.data();
+        frame.len = buf_.size();
+        frame.ts = ts_;
+        frame.type = type;
+        live_.OnFrame(frame);
+        frames_++;
+    }
+
+private:
+    LiveModule &live_;
+    uint32_t unit_;
+    uint64_t ts_;
+    uint64_t frames_;
+    uint64_t vcl_;
+    uint64_t vcl_bytes_;
+    std::vector<uint8_t> buf_;
+};
+
+RtmpServer::Stats WaitNalus(RtmpServer &server, uint64_t nalus)
+{
+    uint64_t begin = System::GetSteadyMilliSeconds();
+    RtmpServer::Stats stats = server.GetStats();
+    while (stats.nalus < nalus && System::GetSteadyMilliSeconds() < begin + TEST_WAIT_TIMEOUT)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stats = server.GetStats();
+    }
+    return stats;
+}
+} // namespace
+
+//链路速率足够时所有nalu都送到接收端,SPS/PPS只在变化时以sequence header发送一次
+TEST(RtmpLiveTest, PublishesAll)
+{
+    RtmpServer server;
+    ASSERT_EQ(0, server.Initialize(0, 0));
+    rtc::scoped_refptr<LiveModule> live = RtmpLiveImpl::Create({server.Url(), TEST_FRAME_RATE, 1280, 720, "", 0});
+    ASSERT_TRUE(live);
+
+    StreamSource source(*live, 1024);
+    source.Run(TEST_SECONDS);
+    RtmpServer::Stats received = WaitNalus(server, source.Vcl());
+    RtmpLiveImpl::Stats stats = static_cast<RtmpLiveImpl *>(live.get())->TakeStats();
+    live->Close();
+    server.Close();
+
+    EXPECT_EQ(source.Frames(), stats.frames);
+    EXPECT_EQ(0u, stats.drops);
+    EXPECT_EQ(0u, stats.reconnects);
+    EXPECT_EQ(1u, received.connections);
+    EXPECT_EQ(1u, received.sequence_headers);
+    EXPECT_EQ(source.Vcl(), received.nalus);
+    EXPECT_EQ(static_cast<uint64_t>(TEST_SECONDS * TEST_FRAME_RATE / TEST_GOP), received.key_frames);
+    EXPECT_EQ(source.VclBytes(), received.nalu_bytes);
+}
+
+//码率高于链路速率:发送阻塞,延迟增加,缓存满后丢帧,接收速率不超过链路速率
+TEST(RtmpLiveTest, ThrottledLinkDrops)
+{
+    const uint32_t link_rate = 64; //KB/s
+    RtmpServer server;
+    ASSERT_EQ(0, server.Initialize(0, link_rate));
+    rtc::scoped_refptr<LiveModule> live = RtmpLiveImpl::Create({server.Url(), TEST_FRAME_RATE, 1280, 720, "", 0});
+    ASSERT_TRUE(live);
+
+    uint64_t begin = System::GetSteadyMicroSeconds();
+    StreamSource source(*live, 4096);
+    source.Run(TEST_SECONDS);
+    RtmpLiveImpl::Stats stats = static_cast<RtmpLiveImpl *>(live.get())->TakeStats();
+    RtmpServer::Stats received = server.GetStats();
+    uint64_t elapsed = System::GetSteadyMicroSeconds() - begin;
+    live->Close();
+    server.Close();
+
+    EXPECT_GT(stats.drops, 0u);
+    EXPECT_LT(stats.frames, source.Frames());
+    EXPECT_GT(stats.latency_max_us, 500000u);
+    EXPECT_GT(received.lag_max_ms, 500u);
+    //接收端按4KB读取后休眠,最多提前一次读取的量
+    EXPECT_LE(received.bytes, link_rate * 1024ull * elapsed / 1000000 + 4096);
+}
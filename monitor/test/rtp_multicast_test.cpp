@@ -0,0 +1,247 @@
+#include "live/rtp_multicast.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define TEST_RTP_GROUP "239.255.0.77"
+#define TEST_RTP_PORT 18082
+#define TEST_RTP_SDP "rtp_multicast_test.sdp"
+#define TEST_RTP_MTU 1400 //与发送端的RTP负载最大长度一致
+#define TEST_FRAME_RATE 25
+#define TEST_RECV_TIMEOUT 1000 //ms
+
+using namespace nvr;
+
+namespace
+{
+
+const uint8_t KSps[] = {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+const uint8_t KPps[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+struct Packet
+{
+    bool marker;
+    uint8_t type;
+    uint16_t seq;
+    uint32_t ts;
+    uint32_t ssrc;
+    std::string payload;
+};
+
+struct Nalu
+{
+    int32_t type;
+    std::string data; //不含起始码
+    uint64_t ts;
+};
+
+std::string Base64Decode(const std::string &in)
+{
+    static const std::string KChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : in)
+    {
+        size_t v = KChars.find(c);
+        if (v == std::string::npos)
+            break;
+        bits = (bits << 6) | v;
+        count += 6;
+        if (count >= 8)
+        {
+            count -= 8;
+            out.push_back(static_cast<char>((bits >> count) & 0xff));
+        }
+    }
+    return out;
+}
+
+//在回环网卡上加入组播组,接收发送端回环的数据
+class Receiver
+{
+public:
+    Receiver() : fd_(-1) {}
+
+    ~Receiver()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    bool Open()
+    {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0)
+            return false;
+        int opt = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        opt = 1024 * 1024;
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt));
+        timeval timeout = {0, TEST_RECV_TIMEOUT * 1000};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(TEST_RTP_PORT);
+        addr.sin_addr.s_addr = inet_addr(TEST_RTP_GROUP);
+        if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            return false;
+
+        ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = inet_addr(TEST_RTP_GROUP);
+        mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        return setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+    }
+
+    //超时返回false
+    bool Read(Packet &packet)
+    {
+        uint8_t buf[2048];
+        ssize_t len = recv(fd_, buf, sizeof(buf), 0);
+        if (len < 12)
+            return false;
+        EXPECT_EQ(0x80, buf[0]);
+        packet.marker = (buf[1] & 0x80) != 0;
+        packet.type = buf[1] & 0x7f;
+        packet.seq = (buf[2] << 8) | buf[3];
+        packet.ts = (static_cast<uint32_t>(buf[4]) << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
+        packet.ssrc = (static_cast<uint32_t>(buf[8]) << 24) | (buf[9] << 16) | (buf[10] << 8) | buf[11];
+        packet.payload.assign(reinterpret_cast<const char *>(buf) + 12, len - 12);
+        return true;
+    }
+
+private:
+    int fd_;
+};
+
+//SPS,PPS,I帧,两个P帧(大小分别跨越和不跨越MTU),负载不含0避免出现起始码
+std::vector<Nalu> MakeStream()
+{
+    std::vector<Nalu> stream;
+    stream.push_back({H264Frame::NaluType::SPS, std::string(reinterpret_cast<const char *>(KSps), sizeof(KSps)), 0});
+    stream.push_back({H264Frame::NaluType::PPS, std::string(reinterpret_cast<const char *>(KPps), sizeof(KPps)), 0});
+    const uint32_t sizes[] = {TEST_RTP_MTU * 3 + 100, 800, TEST_RTP_MTU + 1};
+    for (int i = 0; i < 3; i++)
+    {
+        Nalu nalu;
+        nalu.type = i == 0 ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE;
+        nalu.ts = i * 1000000 / TEST_FRAME_RATE;
+        nalu.data.resize(sizes[i]);
+        for (size_t j = 0; j < nalu.data.size(); j++)
+            nalu.data[j] = static_cast<char>(0x01 | (j * 7 + i));
+        nalu.data[0] = i == 0 ? 0x65 : 0x41;
+        stream.push_back(nalu);
+    }
+    return stream;
+}
+
+//按RFC6184单NALU包或FU-A分片的包数
+uint32_t PacketCount(const Nalu &nalu)
+{
+    if (nalu.data.size() <= TEST_RTP_MTU)
+        return 1;
+    return (nalu.data.size() - 1 + TEST_RTP_MTU - 3) / (TEST_RTP_MTU - 2);
+}
+} // namespace
+
+//一个NALU打包为单NALU包或FU-A分片,接收端重组后与原始NALU相同,序号连续,
+//同一帧的包时间戳相同,只有帧的最后一个包带marker,SDP中的sprop-parameter-sets为SPS/PPS
+TEST(RtpMulticastTest, PacketizeAndSdp)
+{
+    remove(TEST_RTP_SDP);
+    Receiver receiver;
+    ASSERT_TRUE(receiver.Open());
+
+    std::string url = "rtp://" TEST_RTP_GROUP ":" + std::to_string(TEST_RTP_PORT) + "?iface=127.0.0.1";
+    rtc::scoped_refptr<LiveModule> live = RtpLiveImpl::Create({url, TEST_FRAME_RATE, 1280, 720, TEST_RTP_SDP, 1});
+    ASSERT_TRUE(live);
+
+    std::vector<Nalu> stream = MakeStream();
+    uint32_t expected = 0;
+    for (const Nalu &nalu : stream)
+    {
+        std::string buf = std::string("\x00\x00\x00\x01", 4) + nalu.data;
+        VideoFrame frame;
+        frame.data = reinterpret_cast<uint8_t *>(&buf[0]);
+        frame.len = buf.size();
+        frame.ts = nalu.ts;
+        frame.type = nalu.type;
+        live->OnFrame(frame);
+        expected += PacketCount(nalu);
+    }
+
+    std::vector<Packet> packets;
+    Packet packet;
+    while (packets.size() < expected && receiver.Read(packet))
+        packets.push_back(packet);
+    live->Close();
+    ASSERT_EQ(expected, packets.size());
+
+    size_t index = 0;
+    for (const Nalu &nalu : stream)
+    {
+        bool slice = nalu.type == H264Frame::NaluType::ISLICE || nalu.type == H264Frame::NaluType::PSLICE;
+        uint32_t count = PacketCount(nalu);
+        std::string data;
+        for (uint32_t i = 0; i < count; i++, index++)
+        {
+            const Packet &p = packets[index];
+            EXPECT_EQ(96, p.type);
+            EXPECT_EQ(packets[0].ssrc, p.ssrc);
+            EXPECT_EQ(static_cast<uint16_t>(packets[0].seq + index), p.seq);
+            EXPECT_EQ(packets[0].ts + static_cast<uint32_t>(nalu.ts * 90000 / 1000000), p.ts);
+            EXPECT_EQ(slice && i == count - 1, p.marker);
+            ASSERT_LE(p.payload.size(), static_cast<size_t>(TEST_RTP_MTU));
+
+            if (count == 1)
+            {
+                data = p.payload;
+                continue;
+            }
+
+            //FU indicator:原始NRI+类型28,FU header:S/E位+原始类型
+            ASSERT_GE(p.payload.size(), 3u);
+            uint8_t indicator = p.payload[0], header = p.payload[1];
+            EXPECT_EQ(28, indicator & 0x1f);
+            EXPECT_EQ(nalu.data[0] & 0xe0, indicator & 0xe0);
+            EXPECT_EQ(nalu.data[0] & 0x1f, header & 0x1f);
+            EXPECT_EQ(i == 0, (header & 0x80) != 0);
+            EXPECT_EQ(i == count - 1, (header & 0x40) != 0);
+            if (i == 0)
+                data.push_back(static_cast<char>((indicator & 0xe0) | (header & 0x1f)));
+            data.append(p.payload, 2, std::string::npos);
+        }
+        EXPECT_EQ(nalu.data, data);
+    }
+
+    std::ifstream ifs(TEST_RTP_SDP);
+    ASSERT_TRUE(ifs.is_open());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    std::string sdp = ss.str();
+    EXPECT_NE(std::string::npos, sdp.find("m=video " + std::to_string(TEST_RTP_PORT) + " RTP/AVP 96"));
+    EXPECT_NE(std::string::npos, sdp.find("c=IN IP4 " TEST_RTP_GROUP "/1"));
+    EXPECT_NE(std::string::npos, sdp.find("profile-level-id=64001f"));
+
+    size_t pos = sdp.find("sprop-parameter-sets=");
+    ASSERT_NE(std::string::npos, pos);
+    pos += strlen("sprop-parameter-sets=");
+    size_t comma = sdp.find(',', pos);
+    size_t end = sdp.find_first_of(";\r\n", comma);
+    ASSERT_NE(std::string::npos, comma);
+    ASSERT_NE(std::string::npos, end);
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(KSps), sizeof(KSps)), Base64Decode(sdp.substr(pos, comma - pos)));
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(KPps), sizeof(KPps)), Base64Decode(sdp.substr(comma + 1, end - comma - 1)));
+    remove(TEST_RTP_SDP);
+}
@@ -0,0 +1,156 @@
+#include "video_detect/sad_kernel.h"
+#include "video_detect/motion_detector.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <algorithm>
+
+#define GOLDEN_WIDTH 720
+#define GOLDEN_HEIGHT 480
+#define GOLDEN_TAIL_WIDTH 723 //不是16的倍数,覆盖SIMD实现的尾部处理
+
+//标量实现在固定输入上的输出哈希(FNV-1a)
+#define GOLDEN_SAD4 731780274u
+#define GOLDEN_SAD8 392770611u
+#define GOLDEN_BLEND 3999651328u
+#define GOLDEN_SUM 872272494u
+#define GOLDEN_GAIN 2301691019u
+
+using namespace nvr;
+
+namespace
+{
+
+//固定输入:背景是固定种子的伪随机纹理,当前帧叠加小噪声,一块亮度偏移和一块饱和区域
+struct GoldenFrames
+{
+    GoldenFrames(int32_t width, int32_t height) : width(width),
+                                                  height(height),
+                                                  bg(width * height),
+                                                  cur(width * height)
+    {
+        uint32_t seed = 20240601;
+        for (int32_t i = 0; i < width * height; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            bg[i] = static_cast<uint8_t>(seed >> 24);
+            int32_t x = i % width, y = i / width;
+            int32_t value = bg[i] + static_cast<int32_t>((seed >> 8) & 7) - 3;
+            if (x >= 200 && x < 360 && y >= 100 && y < 260)
+                value += 90;
+            if (x >= 500 && y >= 300)
+                value = 255;
+            cur[i] = static_cast<uint8_t>(std::max(0, std::min(255, value)));
+        }
+    }
+
+    int32_t width;
+    int32_t height;
+    std::vector<uint8_t> bg;
+    std::vector<uint8_t> cur;
+};
+
+uint32_t Hash(const void *data, size_t size, uint32_t hash = 2166136261u)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+std::vector<uint16_t> SadMap(const SadKernel &kernel, const GoldenFrames &frames, int32_t block)
+{
+    int32_t cols = frames.width / block, rows = frames.height / block;
+    std::vector<uint16_t> sad(cols * rows);
+    SadRowFunc func = block == 8 ? kernel.sad8 : kernel.sad4;
+    for (int32_t r = 0; r < rows; r++)
+        func(&frames.cur[r * block * frames.width], frames.width, &frames.bg[r * block * frames.width], frames.width, cols, &sad[r * cols]);
+    return sad;
+}
+
+std::vector<uint8_t> Blend(const SadKernel &kernel, const GoldenFrames &frames, int rate)
+{
+    std::vector<uint8_t> bg = frames.bg;
+    for (int32_t y = 0; y < frames.height; y++)
+        kernel.blend(&frames.cur[y * frames.width], &bg[y * frames.width], frames.width, rate);
+    return bg;
+}
+
+std::vector<uint32_t> Sums(const SadKernel &kernel, const GoldenFrames &frames)
+{
+    std::vector<uint32_t> sums(frames.height);
+    for (int32_t y = 0; y < frames.height; y++)
+        sums[y] = kernel.sum(&frames.cur[y * frames.width], frames.width);
+    return sums;
+}
+
+std::vector<uint8_t> Gain(const SadKernel &kernel, const GoldenFrames &frames, int gain)
+{
+    std::vector<uint8_t> dst(frames.width * frames.height);
+    for (int32_t y = 0; y < frames.height; y++)
+        kernel.gain(&frames.cur[y * frames.width], &dst[y * frames.width], frames.width, gain);
+    return dst;
+}
+
+template <typename T>
+uint32_t Hash(const std::vector<T> &values)
+{
+    return Hash(values.data(), values.size() * sizeof(T));
+}
+} // namespace
+
+//标量实现的输出固定为下面的哈希值,当前编译目标选中的实现(x86为SSE2,armv7以上为NEON)必须与标量逐个相同
+//arm926没有NEON,在板上运行时两者都是标量,NEON需要在armv7目标上编译运行该测试
+class SadKernelGoldenTest : public ::testing::TestWithParam<int32_t>
+{
+};
+
+TEST_P(SadKernelGoldenTest, MatchesScalar)
+{
+    GoldenFrames frames(GetParam(), GOLDEN_HEIGHT);
+    const SadKernel &scalar = GetScalarSadKernel();
+    const SadKernel &kernel = GetSadKernel();
+    SCOPED_TRACE(kernel.name);
+
+    EXPECT_EQ(SadMap(scalar, frames, 4), SadMap(kernel, frames, 4));
+    EXPECT_EQ(SadMap(scalar, frames, 8), SadMap(kernel, frames, 8));
+    for (int rate : {1, 77, 128, 255})
+        EXPECT_EQ(Blend(scalar, frames, rate), Blend(kernel, frames, rate)) << "rate " << rate;
+    EXPECT_EQ(Sums(scalar, frames), Sums(kernel, frames));
+    for (int gain : {64, 256, 300, 1024})
+        EXPECT_EQ(Gain(scalar, frames, gain), Gain(kernel, frames, gain)) << "gain " << gain;
+}
+
+INSTANTIATE_TEST_CASE_P(Widths, SadKernelGoldenTest, ::testing::Values(GOLDEN_WIDTH, GOLDEN_TAIL_WIDTH));
+
+TEST(SadKernelTest, ScalarGolden)
+{
+    GoldenFrames frames(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    const SadKernel &scalar = GetScalarSadKernel();
+
+    EXPECT_EQ(GOLDEN_SAD4, Hash(SadMap(scalar, frames, 4)));
+    EXPECT_EQ(GOLDEN_SAD8, Hash(SadMap(scalar, frames, 8)));
+    EXPECT_EQ(GOLDEN_BLEND, Hash(Blend(scalar, frames, 77)));
+    EXPECT_EQ(GOLDEN_SUM, Hash(Sums(scalar, frames)));
+    EXPECT_EQ(GOLDEN_GAIN, Hash(Gain(scalar, frames, 300)));
+}
+
+//检测器第一帧直接作为背景,第二帧的SAD图就是两帧之间的块SAD
+TEST(SadKernelTest, DetectorSadMap)
+{
+    GoldenFrames frames(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    for (int32_t block : {4, 8})
+    {
+        MotionDetector detector;
+        ASSERT_EQ(0, detector.Initialize({GOLDEN_WIDTH, GOLDEN_HEIGHT, block, 10, 128, 4, false}));
+        std::vector<DetectRect> regions;
+        detector.Process(frames.bg.data(), GOLDEN_WIDTH, regions);
+        detector.Process(frames.cur.data(), GOLDEN_WIDTH, regions);
+
+        std::vector<uint16_t> expected = SadMap(GetScalarSadKernel(), frames, block);
+        std::vector<uint16_t> sad(detector.SadMap(), detector.SadMap() + detector.Columns() * detector.Rows());
+        EXPECT_EQ(expected, sad) << "block " << block;
+        EXPECT_FALSE(regions.empty());
+    }
+}
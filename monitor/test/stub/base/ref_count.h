@@ -0,0 +1,20 @@
+#ifndef BASE_REF_COUNT_H_
+#define BASE_REF_COUNT_H_
+
+//主机编译用的webrtc引用计数接口,与3rdparty中的base接口一致
+
+namespace rtc
+{
+
+class RefCountInterface
+{
+public:
+    virtual void AddRef() const = 0;
+    virtual int Release() const = 0;
+
+protected:
+    virtual ~RefCountInterface() {}
+};
+} // namespace rtc
+
+#endif
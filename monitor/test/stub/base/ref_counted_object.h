@@ -0,0 +1,42 @@
+#ifndef BASE_REF_COUNTED_OBJECT_H_
+#define BASE_REF_COUNTED_OBJECT_H_
+
+#include <base/ref_count.h>
+
+#include <atomic>
+#include <utility>
+
+namespace rtc
+{
+
+template <class T>
+class RefCountedObject : public T
+{
+public:
+    RefCountedObject() : ref_count_(0) {}
+
+    template <class P0>
+    explicit RefCountedObject(P0 &&p0) : T(std::forward<P0>(p0)),
+                                         ref_count_(0)
+    {
+    }
+
+    void AddRef() const override { ref_count_++; }
+
+    int Release() const override
+    {
+        int count = --ref_count_;
+        if (!count)
+            delete this;
+        return count;
+    }
+
+protected:
+    ~RefCountedObject() override {}
+
+private:
+    mutable std::atomic<int> ref_count_;
+};
+} // namespace rtc
+
+#endif
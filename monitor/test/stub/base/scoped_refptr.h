@@ -0,0 +1,90 @@
+#ifndef BASE_SCOPED_REFPTR_H_
+#define BASE_SCOPED_REFPTR_H_
+
+#include <utility>
+
+namespace rtc
+{
+
+template <class T>
+class scoped_refptr
+{
+public:
+    scoped_refptr() : ptr_(nullptr) {}
+
+    scoped_refptr(T *p) : ptr_(p)
+    {
+        if (ptr_)
+            ptr_->AddRef();
+    }
+
+    scoped_refptr(const scoped_refptr<T> &r) : ptr_(r.ptr_)
+    {
+        if (ptr_)
+            ptr_->AddRef();
+    }
+
+    template <typename U>
+    scoped_refptr(const scoped_refptr<U> &r) : ptr_(r.get())
+    {
+        if (ptr_)
+            ptr_->AddRef();
+    }
+
+    scoped_refptr(scoped_refptr<T> &&r) : ptr_(r.release()) {}
+
+    ~scoped_refptr()
+    {
+        if (ptr_)
+            ptr_->Release();
+    }
+
+    T *get() const { return ptr_; }
+    operator T *() const { return ptr_; }
+    T *operator->() const { return ptr_; }
+
+    T *release()
+    {
+        T *retVal = ptr_;
+        ptr_ = nullptr;
+        return retVal;
+    }
+
+    scoped_refptr<T> &operator=(T *p)
+    {
+        if (p)
+            p->AddRef();
+        if (ptr_)
+            ptr_->Release();
+        ptr_ = p;
+        return *this;
+    }
+
+    scoped_refptr<T> &operator=(const scoped_refptr<T> &r)
+    {
+        return *this = r.ptr_;
+    }
+
+    template <typename U>
+    scoped_refptr<T> &operator=(const scoped_refptr<U> &r)
+    {
+        return *this = r.get();
+    }
+
+    scoped_refptr<T> &operator=(scoped_refptr<T> &&r)
+    {
+        scoped_refptr<T>(std::move(r)).swap(*this);
+        return *this;
+    }
+
+    void swap(scoped_refptr<T> &r)
+    {
+        std::swap(ptr_, r.ptr_);
+    }
+
+protected:
+    T *ptr_;
+};
+} // namespace rtc
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __ELOG_H__
+#define __ELOG_H__
+
+//主机编译用的easylogger桩,日志直接输出到标准输出,错误和警告输出到标准错误
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define ELOG_LVL_ASSERT 0
+#define ELOG_LVL_ERROR 1
+#define ELOG_LVL_WARN 2
+#define ELOG_LVL_INFO 3
+#define ELOG_LVL_DEBUG 4
+#define ELOG_LVL_VERBOSE 5
+
+#define ELOG_FMT_LVL (1 << 0)
+#define ELOG_FMT_TAG (1 << 1)
+#define ELOG_FMT_TIME (1 << 2)
+#define ELOG_FMT_P_INFO (1 << 3)
+#define ELOG_FMT_T_INFO (1 << 4)
+#define ELOG_FMT_DIR (1 << 5)
+#define ELOG_FMT_FUNC (1 << 6)
+#define ELOG_FMT_LINE (1 << 7)
+#define ELOG_FMT_ALL (ELOG_FMT_LVL | ELOG_FMT_TAG | ELOG_FMT_TIME | ELOG_FMT_P_INFO | ELOG_FMT_T_INFO | \
+                      ELOG_FMT_DIR | ELOG_FMT_FUNC | ELOG_FMT_LINE)
+
+typedef enum
+{
+    ELOG_NO_ERR,
+} ElogErrCode;
+
+static inline ElogErrCode elog_init(void) { return ELOG_NO_ERR; }
+static inline void elog_start(void) {}
+static inline void elog_set_fmt(unsigned char level, size_t set) {}
+static inline void elog_set_text_color_enabled(bool enabled) {}
+
+#define ELOG_STUB_OUTPUT(stream, lvl, ...)  \
+    do                                      \
+    {                                       \
+        fprintf(stream, lvl "/ ");          \
+        fprintf(stream, __VA_ARGS__);       \
+        fprintf(stream, "\n");              \
+    } while (0)
+
+#define log_e(...) ELOG_STUB_OUTPUT(stderr, "E", __VA_ARGS__)
+#define log_w(...) ELOG_STUB_OUTPUT(stderr, "W", __VA_ARGS__)
+#define log_i(...) ELOG_STUB_OUTPUT(stdout, "I", __VA_ARGS__)
+#define log_d(...) ELOG_STUB_OUTPUT(stdout, "D", __VA_ARGS__)
+
+#endif
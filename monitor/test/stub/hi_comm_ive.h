@@ -0,0 +1,121 @@
+#ifndef __HI_COMM_IVE_H__
+#define __HI_COMM_IVE_H__
+
+#include "hi_common.h"
+
+typedef HI_S32 IVE_HANDLE;
+
+#define HI_ERR_IVE_SYS_TIMEOUT 0xA01D8040
+#define HI_ERR_IVE_QUERY_TIMEOUT 0xA01D8041
+#define HI_ERR_IVE_NOTREADY 0xA01D8010
+#define HI_ERR_IVE_ILLEGAL_PARAM 0xA01D8003
+#define HI_ERR_IVE_NOMEM 0xA01D800C
+
+#define IVE_MAX_REGION_NUM 254
+
+typedef enum
+{
+    IVE_IMAGE_TYPE_U8C1 = 0,
+} IVE_IMAGE_TYPE_E;
+
+typedef struct
+{
+    IVE_IMAGE_TYPE_E enType;
+    HI_U32 u32PhyAddr[3];
+    HI_U8 *pu8VirAddr[3];
+    HI_U16 u16Stride[3];
+    HI_U16 u16Width;
+    HI_U16 u16Height;
+    HI_U16 u16Reserved;
+} IVE_IMAGE_S;
+
+typedef IVE_IMAGE_S IVE_SRC_IMAGE_S;
+typedef IVE_IMAGE_S IVE_DST_IMAGE_S;
+
+typedef struct
+{
+    HI_U32 u32PhyAddr;
+    HI_U8 *pu8VirAddr;
+    HI_U32 u32Size;
+} IVE_MEM_INFO_S;
+
+typedef IVE_MEM_INFO_S IVE_SRC_MEM_INFO_S;
+typedef IVE_MEM_INFO_S IVE_DST_MEM_INFO_S;
+
+typedef struct
+{
+    HI_U8 *pu8VirAddr;
+    HI_U32 u32PhyAddr;
+    HI_U16 u16Stride;
+    HI_U16 u16Width;
+    HI_U16 u16Height;
+    HI_U16 u16Reserved;
+} IVE_DATA_S;
+
+typedef IVE_DATA_S IVE_SRC_DATA_S;
+typedef IVE_DATA_S IVE_DST_DATA_S;
+
+typedef enum
+{
+    IVE_DMA_MODE_DIRECT_COPY = 0,
+} IVE_DMA_MODE_E;
+
+typedef struct
+{
+    IVE_DMA_MODE_E enMode;
+    HI_U64 u64Val;
+} IVE_DMA_CTRL_S;
+
+typedef struct
+{
+    HI_U32 u32Area;
+    HI_U16 u16Left;
+    HI_U16 u16Right;
+    HI_U16 u16Top;
+    HI_U16 u16Bottom;
+} IVE_REGION_S;
+
+typedef struct
+{
+    HI_U16 u16CurAreaThr;
+    HI_S8 s8LabelStatus;
+    HI_U8 u8RegionNum;
+    IVE_REGION_S astRegion[IVE_MAX_REGION_NUM];
+} IVE_CCBLOB_S;
+
+typedef enum
+{
+    IVE_SAD_MODE_MB_4X4 = 0,
+    IVE_SAD_MODE_MB_8X8,
+    IVE_SAD_MODE_MB_16X16,
+} IVE_SAD_MODE_E;
+
+typedef enum
+{
+    IVE_SAD_OUT_CTRL_16BIT_BOTH = 0,
+    IVE_SAD_OUT_CTRL_8BIT_BOTH,
+    IVE_SAD_OUT_CTRL_16BIT_SAD,
+    IVE_SAD_OUT_CTRL_8BIT_SAD,
+    IVE_SAD_OUT_CTRL_THRESH,
+} IVE_SAD_OUT_CTRL_E;
+
+typedef enum
+{
+    IVE_CCL_MODE_4C = 0,
+    IVE_CCL_MODE_8C,
+} IVE_CCL_MODE_E;
+
+typedef struct
+{
+    IVE_CCL_MODE_E enMode;
+    HI_U16 u16InitAreaThr;
+    HI_U16 u16Step;
+} IVE_CCL_CTRL_S;
+
+typedef struct
+{
+    HI_U16 u0q16X;
+    HI_U16 u0q16Y;
+} IVE_ADD_CTRL_S;
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __HI_COMM_SYS_H__
+#define __HI_COMM_SYS_H__
+
+#include "hi_common.h"
+
+typedef struct
+{
+    HI_U32 u32AlignWidth;
+} MPP_SYS_CONF_S;
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __HI_COMM_VB_H__
+#define __HI_COMM_VB_H__
+
+#include "hi_common.h"
+
+#define VB_MAX_COMM_POOLS 16
+#define MAX_MMZ_NAME_LEN 16
+
+typedef struct
+{
+    HI_U32 u32MaxPoolCnt;
+    struct
+    {
+        HI_U32 u32BlkSize;
+        HI_U32 u32BlkCnt;
+        HI_CHAR acMmzName[MAX_MMZ_NAME_LEN];
+    } astCommPool[VB_MAX_COMM_POOLS];
+} VB_CONF_S;
+
+//桩中的图像没有压缩头
+#define VB_PIC_HEADER_SIZE(Width, Height, Type, size) \
+    do                                                \
+    {                                                 \
+        (void)(Width);                                \
+        (void)(Height);                               \
+        (void)(Type);                                 \
+        size = 0;                                     \
+    } while (0)
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __HI_COMM_VENC_H__
+#define __HI_COMM_VENC_H__
+
+//主机编译不使用该部分接口
+#include "hi_common.h"
+
+#endif
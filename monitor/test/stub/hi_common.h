@@ -0,0 +1,78 @@
+#ifndef __HI_COMMON_H__
+#define __HI_COMMON_H__
+
+//主机编译用的海思SDK桩,只声明与硬件无关模块用到的类型和接口,按SDK的头文件划分
+
+typedef unsigned char HI_U8;
+typedef unsigned short HI_U16;
+typedef unsigned int HI_U32;
+typedef unsigned long long HI_U64;
+typedef signed char HI_S8;
+typedef short HI_S16;
+typedef int HI_S32;
+typedef long long HI_S64;
+typedef char HI_CHAR;
+typedef void HI_VOID;
+
+typedef enum
+{
+    HI_FALSE = 0,
+    HI_TRUE = 1,
+} HI_BOOL;
+
+#define HI_NULL 0L
+#define HI_SUCCESS 0
+#define HI_FAILURE (-1)
+
+typedef enum
+{
+    HI_ID_CMPI = 0,
+    HI_ID_VB = 1,
+    HI_ID_SYS = 2,
+    HI_ID_VENC = 6,
+    HI_ID_VPSS = 7,
+    HI_ID_VIU = 16,
+    HI_ID_IVE = 29,
+} MOD_ID_E;
+
+typedef struct
+{
+    MOD_ID_E enModId;
+    HI_S32 s32DevId;
+    HI_S32 s32ChnId;
+} MPP_CHN_S;
+
+typedef enum
+{
+    PIXEL_FORMAT_YUV_SEMIPLANAR_422 = 22,
+    PIXEL_FORMAT_YUV_SEMIPLANAR_420 = 23,
+} PIXEL_FORMAT_E;
+
+typedef enum
+{
+    PIC_D1 = 6,
+    PIC_HD720 = 16,
+    PIC_HD1080 = 17,
+} PIC_SIZE_E;
+
+typedef struct
+{
+    HI_U32 u32Width;
+    HI_U32 u32Height;
+    HI_U32 u32Field;
+    PIXEL_FORMAT_E enPixelFormat;
+    HI_U32 u32PhyAddr[3];
+    HI_VOID *pVirAddr[3];
+    HI_U32 u32Stride[3];
+    HI_U64 u64pts;
+    HI_U32 u32TimeRef;
+    HI_U32 u32PrivateData;
+} VIDEO_FRAME_S;
+
+typedef struct
+{
+    VIDEO_FRAME_S stVFrame;
+    HI_U32 u32PoolId;
+} VIDEO_FRAME_INFO_S;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __HI_MD_H__
+#define __HI_MD_H__
+
+#include "hi_comm_ive.h"
+
+#define MD_MAX_CHN 64
+
+typedef enum
+{
+    MD_ALG_MODE_BG = 0,
+    MD_ALG_MODE_REF,
+} MD_ALG_MODE_E;
+
+typedef struct
+{
+    MD_ALG_MODE_E enAlgMode;
+    IVE_SAD_MODE_E enSadMode;
+    IVE_SAD_OUT_CTRL_E enSadOutCtrl;
+    HI_U16 u16SadThr;
+    HI_U16 u16Width;
+    HI_U16 u16Height;
+    IVE_ADD_CTRL_S stAddCtrl;
+    IVE_CCL_CTRL_S stCclCtrl;
+} MD_ATTR_S;
+
+#endif
@@ -0,0 +1,318 @@
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+//主机上的海思接口桩:MMZ用普通内存模拟,IVE DMA同步拷贝,MD用软件SAD和连通域标记实现
+//只保证与SDK相同的调用约定和输出格式,用于在主机上测试IVE检测流程,不模拟硬件的精度和耗时
+
+#define STUB_PHY_BASE 0x80000000u
+#define STUB_PHY_ALIGN 4096u
+
+namespace
+{
+struct MmzBlock
+{
+    HI_U8 *vir_addr;
+    HI_U32 size;
+};
+
+std::mutex g_mmz_mux;
+std::map<HI_U32, MmzBlock> g_mmz_blocks;
+HI_U32 g_next_phy = STUB_PHY_BASE;
+
+std::mutex g_ive_mux;
+IVE_HANDLE g_ive_handle = 0;
+
+struct MdChn
+{
+    bool created;
+    MD_ATTR_S attr;
+};
+
+bool g_md_init = false;
+MdChn g_md_chn[MD_MAX_CHN];
+
+//物理地址转换为虚拟地址,地址可以落在某个块的中间
+HI_U8 *PhyToVir(HI_U32 phy_addr, HI_U32 size)
+{
+    std::unique_lock<std::mutex> lock(g_mmz_mux);
+    auto it = g_mmz_blocks.upper_bound(phy_addr);
+    if (it == g_mmz_blocks.begin())
+        return nullptr;
+    --it;
+    if (phy_addr + size > it->first + it->second.size)
+        return nullptr;
+    return it->second.vir_addr + (phy_addr - it->first);
+}
+
+int32_t Label(std::vector<int32_t> &labels, int32_t index)
+{
+    while (labels[index] != index)
+    {
+        labels[index] = labels[labels[index]];
+        index = labels[index];
+    }
+    return index;
+}
+} // namespace
+
+HI_S32 HI_MPI_SYS_Init(HI_VOID)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_Exit(HI_VOID)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_SetConf(const MPP_SYS_CONF_S *pstSysConf)
+{
+    return pstSysConf ? HI_SUCCESS : HI_FAILURE;
+}
+
+HI_S32 HI_MPI_SYS_Bind(MPP_CHN_S *pstSrcChn, MPP_CHN_S *pstDestChn)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_UnBind(MPP_CHN_S *pstSrcChn, MPP_CHN_S *pstDestChn)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_MmzAlloc(HI_U32 *pu32PhyAddr, HI_VOID **ppVirtAddr, const HI_CHAR *strMmb, const HI_CHAR *strZone, HI_U32 u32Len)
+{
+    if (!pu32PhyAddr || !ppVirtAddr || !u32Len)
+        return HI_FAILURE;
+
+    HI_U8 *vir_addr = static_cast<HI_U8 *>(calloc(1, u32Len));
+    if (!vir_addr)
+        return HI_FAILURE;
+
+    std::unique_lock<std::mutex> lock(g_mmz_mux);
+    HI_U32 phy_addr = g_next_phy;
+    g_next_phy += (u32Len + STUB_PHY_ALIGN - 1) / STUB_PHY_ALIGN * STUB_PHY_ALIGN;
+    g_mmz_blocks[phy_addr] = {vir_addr, u32Len};
+
+    *pu32PhyAddr = phy_addr;
+    *ppVirtAddr = vir_addr;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_MmzAlloc_Cached(HI_U32 *pu32PhyAddr, HI_VOID **ppVirtAddr, const HI_CHAR *strMmb, const HI_CHAR *strZone, HI_U32 u32Len)
+{
+    return HI_MPI_SYS_MmzAlloc(pu32PhyAddr, ppVirtAddr, strMmb, strZone, u32Len);
+}
+
+HI_S32 HI_MPI_SYS_MmzFree(HI_U32 u32PhyAddr, HI_VOID *pVirtAddr)
+{
+    std::unique_lock<std::mutex> lock(g_mmz_mux);
+    auto it = g_mmz_blocks.find(u32PhyAddr);
+    if (it == g_mmz_blocks.end() || it->second.vir_addr != pVirtAddr)
+        return HI_FAILURE;
+    free(it->second.vir_addr);
+    g_mmz_blocks.erase(it);
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_SYS_MmzFlushCache(HI_U32 u32PhyAddr, HI_VOID *pVitAddr, HI_U32 u32Size)
+{
+    return HI_SUCCESS;
+}
+
+HI_VOID *HI_MPI_SYS_Mmap(HI_U32 u32PhyAddr, HI_U32 u32Size)
+{
+    return PhyToVir(u32PhyAddr, u32Size);
+}
+
+HI_S32 HI_MPI_SYS_Munmap(HI_VOID *pVirAddr, HI_U32 u32Size)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_VB_SetConf(const VB_CONF_S *pstVbConf)
+{
+    return pstVbConf ? HI_SUCCESS : HI_FAILURE;
+}
+
+HI_S32 HI_MPI_VB_Init(HI_VOID)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_VB_Exit(HI_VOID)
+{
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_IVE_DMA(IVE_HANDLE *pIveHandle, IVE_SRC_DATA_S *pstSrc, IVE_DST_DATA_S *pstDst, IVE_DMA_CTRL_S *pstDmaCtrl, HI_BOOL bInstant)
+{
+    if (!pIveHandle || !pstSrc || !pstDst || !pstDmaCtrl || IVE_DMA_MODE_DIRECT_COPY != pstDmaCtrl->enMode)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+    if (pstSrc->u16Width != pstDst->u16Width || pstSrc->u16Height != pstDst->u16Height)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+
+    //与硬件一样只按物理地址访问
+    HI_U8 *src = PhyToVir(pstSrc->u32PhyAddr, pstSrc->u16Stride * (pstSrc->u16Height - 1) + pstSrc->u16Width);
+    HI_U8 *dst = PhyToVir(pstDst->u32PhyAddr, pstDst->u16Stride * (pstDst->u16Height - 1) + pstDst->u16Width);
+    if (!src || !dst)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+
+    for (int y = 0; y < pstSrc->u16Height; y++)
+        memcpy(dst + y * pstDst->u16Stride, src + y * pstSrc->u16Stride, pstSrc->u16Width);
+
+    std::unique_lock<std::mutex> lock(g_ive_mux);
+    *pIveHandle = ++g_ive_handle;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_MPI_IVE_Query(IVE_HANDLE IveHandle, HI_BOOL *pbFinish, HI_BOOL bBlock)
+{
+    if (!pbFinish)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+    *pbFinish = HI_TRUE;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_IVS_MD_Init(HI_VOID)
+{
+    if (g_md_init)
+        return HI_FAILURE;
+    memset(g_md_chn, 0, sizeof(g_md_chn));
+    g_md_init = true;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_IVS_MD_Exit(HI_VOID)
+{
+    if (!g_md_init)
+        return HI_ERR_IVE_NOTREADY;
+    g_md_init = false;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_IVS_MD_CreateChn(HI_S32 MdChn, MD_ATTR_S *pstMdAttr)
+{
+    if (!g_md_init)
+        return HI_ERR_IVE_NOTREADY;
+    if (MdChn < 0 || MdChn >= MD_MAX_CHN || !pstMdAttr || g_md_chn[MdChn].created)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+    if (pstMdAttr->enSadMode != IVE_SAD_MODE_MB_4X4 && pstMdAttr->enSadMode != IVE_SAD_MODE_MB_8X8)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+    g_md_chn[MdChn].attr = *pstMdAttr;
+    g_md_chn[MdChn].created = true;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_IVS_MD_DestroyChn(HI_S32 MdChn)
+{
+    if (!g_md_init)
+        return HI_ERR_IVE_NOTREADY;
+    if (MdChn < 0 || MdChn >= MD_MAX_CHN || !g_md_chn[MdChn].created)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+    g_md_chn[MdChn].created = false;
+    return HI_SUCCESS;
+}
+
+HI_S32 HI_IVS_MD_Process(HI_S32 MdChn, IVE_SRC_IMAGE_S *pstCur, IVE_SRC_IMAGE_S *pstRef, IVE_DST_IMAGE_S *pstSad, IVE_DST_MEM_INFO_S *pstBlob)
+{
+    if (!g_md_init)
+        return HI_ERR_IVE_NOTREADY;
+    if (MdChn < 0 || MdChn >= MD_MAX_CHN || !g_md_chn[MdChn].created || !pstCur || !pstRef || !pstBlob)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+
+    const MD_ATTR_S &attr = g_md_chn[MdChn].attr;
+    if (pstCur->u16Width != attr.u16Width || pstCur->u16Height != attr.u16Height ||
+        pstRef->u16Width != attr.u16Width || pstRef->u16Height != attr.u16Height ||
+        pstBlob->u32Size < sizeof(IVE_CCBLOB_S))
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+
+    IVE_CCBLOB_S *blob = reinterpret_cast<IVE_CCBLOB_S *>(PhyToVir(pstBlob->u32PhyAddr, sizeof(IVE_CCBLOB_S)));
+    if (!blob)
+        return HI_ERR_IVE_ILLEGAL_PARAM;
+
+    //块SAD超过阈值的块标为前景
+    int32_t block = attr.enSadMode == IVE_SAD_MODE_MB_8X8 ? 8 : 4;
+    int32_t cols = attr.u16Width / block;
+    int32_t rows = attr.u16Height / block;
+    std::vector<uint8_t> fg(cols * rows, 0);
+    for (int32_t by = 0; by < rows; by++)
+    {
+        for (int32_t bx = 0; bx < cols; bx++)
+        {
+            uint32_t sad = 0;
+            for (int32_t y = by * block; y < (by + 1) * block; y++)
+            {
+                const HI_U8 *cur = pstCur->pu8VirAddr[0] + y * pstCur->u16Stride[0];
+                const HI_U8 *ref = pstRef->pu8VirAddr[0] + y * pstRef->u16Stride[0];
+                for (int32_t x = bx * block; x < (bx + 1) * block; x++)
+                    sad += abs(cur[x] - ref[x]);
+            }
+            //与SDK一样直接比较块的SAD和,8x8块的阈值由调用者乘4
+            if (sad > attr.u16SadThr)
+                fg[by * cols + bx] = 1;
+        }
+    }
+
+    //4连通标记,并查集合并
+    std::vector<int32_t> labels(cols * rows, -1);
+    for (int32_t i = 0; i < cols * rows; i++)
+    {
+        if (!fg[i])
+            continue;
+        labels[i] = i;
+        if (i % cols && fg[i - 1])
+            labels[Label(labels, i)] = Label(labels, i - 1);
+        if (i >= cols && fg[i - cols])
+            labels[Label(labels, i)] = Label(labels, i - cols);
+    }
+
+    std::map<int32_t, IVE_REGION_S> regions;
+    for (int32_t i = 0; i < cols * rows; i++)
+    {
+        if (!fg[i])
+            continue;
+        HI_U16 left = i % cols * block, top = i / cols * block;
+        HI_U16 right = left + block - 1, bottom = top + block - 1;
+        auto it = regions.find(Label(labels, i));
+        if (it == regions.end())
+        {
+            regions[Label(labels, i)] = {static_cast<HI_U32>(block * block), left, right, top, bottom};
+            continue;
+        }
+        IVE_REGION_S &region = it->second;
+        region.u32Area += block * block;
+        region.u16Left = std::min(region.u16Left, left);
+        region.u16Right = std::max(region.u16Right, right);
+        region.u16Top = std::min(region.u16Top, top);
+        region.u16Bottom = std::max(region.u16Bottom, bottom);
+    }
+
+    //区域数超过上限时与SDK一样逐步提高面积阈值
+    HI_U32 area_thr = attr.stCclCtrl.u16InitAreaThr;
+    size_t count;
+    while (true)
+    {
+        count = 0;
+        for (auto &it : regions)
+        {
+            if (it.second.u32Area >= area_thr)
+                count++;
+        }
+        if (count <= IVE_MAX_REGION_NUM)
+            break;
+        area_thr += std::max<HI_U16>(1, attr.stCclCtrl.u16Step);
+    }
+
+    memset(blob, 0, sizeof(IVE_CCBLOB_S));
+    blob->u16CurAreaThr = area_thr;
+    for (auto &it : regions)
+    {
+        if (it.second.u32Area >= area_thr)
+            blob->astRegion[blob->u8RegionNum++] = it.second;
+    }
+
+    return HI_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#ifndef __IVS_MD_H__
+#define __IVS_MD_H__
+
+#include "hi_md.h"
+
+//桩按块求当前帧与参考帧的SAD,阈值化后做4连通标记,与SDK输出相同格式的IVE_CCBLOB_S
+HI_S32 HI_IVS_MD_Init(HI_VOID);
+HI_S32 HI_IVS_MD_Exit(HI_VOID);
+HI_S32 HI_IVS_MD_CreateChn(HI_S32 MdChn, MD_ATTR_S *pstMdAttr);
+HI_S32 HI_IVS_MD_DestroyChn(HI_S32 MdChn);
+HI_S32 HI_IVS_MD_Process(HI_S32 MdChn, IVE_SRC_IMAGE_S *pstCur, IVE_SRC_IMAGE_S *pstRef, IVE_DST_IMAGE_S *pstSad, IVE_DST_MEM_INFO_S *pstBlob);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef MP4V2_STUB_H_
+#define MP4V2_STUB_H_
+
+//主机测试用的mp4v2桩,只声明录像模块用到的接口
+//写入与mp4v2相同:ftyp,free,mdat头部后顺序追加sample,关闭时在文件尾写入索引(自定义的stbx box代替moov)
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void *MP4FileHandle;
+typedef uint32_t MP4TrackId;
+typedef uint32_t MP4SampleId;
+typedef uint64_t MP4Timestamp;
+typedef uint64_t MP4Duration;
+
+#define MP4_INVALID_FILE_HANDLE ((MP4FileHandle)NULL)
+#define MP4_INVALID_TRACK_ID ((MP4TrackId)0)
+#define MP4_INVALID_SAMPLE_ID ((MP4SampleId)0)
+#define MP4_INVALID_DURATION ((MP4Duration)-1)
+
+#define MP4_VIDEO_TRACK_TYPE "vide"
+#define MP4_SUBTITLE_TRACK_TYPE "sbtl"
+
+MP4FileHandle MP4Create(const char *fileName, uint32_t flags = 0);
+
+MP4FileHandle MP4Read(const char *fileName);
+
+void MP4Close(MP4FileHandle hFile, uint32_t flags = 0);
+
+bool MP4SetTimeScale(MP4FileHandle hFile, uint32_t value);
+
+MP4TrackId MP4AddH264VideoTrack(MP4FileHandle hFile, uint32_t timeScale, MP4Duration sampleDuration,
+                                uint16_t width, uint16_t height, uint8_t AVCProfileIndication,
+                                uint8_t profile_compat, uint8_t AVCLevelIndication, uint8_t sampleLenFieldSizeMinusOne);
+
+void MP4AddH264SequenceParameterSet(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pSequence, uint16_t sequenceLen);
+
+void MP4AddH264PictureParameterSet(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pPict, uint16_t pictLen);
+
+MP4TrackId MP4AddSubtitleTrack(MP4FileHandle hFile, uint32_t timescale, uint16_t width, uint16_t height);
+
+bool MP4WriteSample(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pBytes, uint32_t numBytes,
+                    MP4Duration duration = MP4_INVALID_DURATION, MP4Duration renderingOffset = 0, bool isSyncSample = true);
+
+MP4TrackId MP4FindTrackId(MP4FileHandle hFile, uint16_t index, const char *type = NULL, uint8_t subType = 0);
+
+MP4SampleId MP4GetTrackNumberOfSamples(MP4FileHandle hFile, MP4TrackId trackId);
+
+uint32_t MP4GetTrackTimeScale(MP4FileHandle hFile, MP4TrackId trackId);
+
+uint16_t MP4GetTrackVideoWidth(MP4FileHandle hFile, MP4TrackId trackId);
+
+uint16_t MP4GetTrackVideoHeight(MP4FileHandle hFile, MP4TrackId trackId);
+
+uint32_t MP4GetTrackMaxSampleSize(MP4FileHandle hFile, MP4TrackId trackId);
+
+bool MP4GetTrackH264SeqPictHeaders(MP4FileHandle hFile, MP4TrackId trackId,
+                                   uint8_t ***pSeqHeaders, uint32_t **pSeqHeaderSize,
+                                   uint8_t ***pPictHeader, uint32_t **pPictHeaderSize);
+
+void MP4FreeH264SeqPictHeaders(uint8_t **pSeqHeaders, uint32_t *pSeqHeaderSize,
+                               uint8_t **pPictHeader, uint32_t *pPictHeaderSize);
+
+MP4Duration MP4GetSampleDuration(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId);
+
+MP4Timestamp MP4GetSampleTime(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId);
+
+int8_t MP4GetSampleSync(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId);
+
+MP4SampleId MP4GetSampleIdFromTime(MP4FileHandle hFile, MP4TrackId trackId, MP4Timestamp when, bool wantSyncSample = false);
+
+bool MP4ReadSample(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId,
+                   uint8_t **ppBytes, uint32_t *pNumBytes, MP4Timestamp *pStartTime = NULL,
+                   MP4Duration *pDuration = NULL, MP4Duration *pRenderingOffset = NULL, bool *pIsSyncSample = NULL);
+
+#endif
@@ -0,0 +1,479 @@
+#include <mp4v2/mp4v2.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//文件布局:ftyp,free(8),mdat头部,sample数据,关闭时写入stbx索引和8字节的索引偏移
+//写入路径与mp4v2一样经过stdio缓存,用于主机上对比各录像格式的写入开销
+
+namespace
+{
+
+struct StubSample
+{
+    uint64_t offset;
+    uint32_t size;
+    uint64_t time;
+    uint64_t duration;
+    bool sync;
+};
+
+struct StubTrack
+{
+    std::string type;
+    uint32_t timescale;
+    uint64_t duration; //固定时长,MP4_INVALID_DURATION时使用
+    uint16_t width;
+    uint16_t height;
+    std::vector<std::string> sps;
+    std::vector<std::string> pps;
+    std::vector<StubSample> samples;
+    uint64_t time;
+    uint32_t max_size;
+};
+
+struct StubFile
+{
+    FILE *fp;
+    bool write;
+    uint64_t pos;
+    uint64_t mdat;
+    std::vector<StubTrack> tracks;
+};
+
+const char KFtyp[] = {0, 0, 0, 0x18, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm', 0, 0, 0, 1, 'i', 's', 'o', 'm', 'a', 'v', 'c', '1'};
+const char KFree[] = {0, 0, 0, 8, 'f', 'r', 'e', 'e'};
+
+StubFile *File(MP4FileHandle handle)
+{
+    return static_cast<StubFile *>(handle);
+}
+
+StubTrack *Track(MP4FileHandle handle, MP4TrackId id)
+{
+    StubFile *file = File(handle);
+    if (!file || id == MP4_INVALID_TRACK_ID || id > file->tracks.size())
+        return nullptr;
+    return &file->tracks[id - 1];
+}
+
+StubSample *Sample(MP4FileHandle handle, MP4TrackId track_id, MP4SampleId id)
+{
+    StubTrack *track = Track(handle, track_id);
+    if (!track || id == MP4_INVALID_SAMPLE_ID || id > track->samples.size())
+        return nullptr;
+    return &track->samples[id - 1];
+}
+
+void Put(std::string &out, const void *data, size_t len)
+{
+    out.append(static_cast<const char *>(data), len);
+}
+
+template <typename T>
+void Put(std::string &out, T value)
+{
+    Put(out, &value, sizeof(value));
+}
+
+void PutString(std::string &out, const std::string &value)
+{
+    Put<uint32_t>(out, value.size());
+    Put(out, value.data(), value.size());
+}
+
+template <typename T>
+bool Get(const std::string &in, size_t &pos, T &value)
+{
+    if (pos + sizeof(value) > in.size())
+        return false;
+    memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+bool GetString(const std::string &in, size_t &pos, std::string &value)
+{
+    uint32_t len;
+    if (!Get(in, pos, len) || pos + len > in.size())
+        return false;
+    value.assign(in.data() + pos, len);
+    pos += len;
+    return true;
+}
+
+void WriteIndex(StubFile *file)
+{
+    //回填mdat长度
+    uint32_t mdat_size = static_cast<uint32_t>(file->pos - file->mdat);
+    uint8_t size[4] = {static_cast<uint8_t>(mdat_size >> 24), static_cast<uint8_t>(mdat_size >> 16),
+                       static_cast<uint8_t>(mdat_size >> 8), static_cast<uint8_t>(mdat_size)};
+
+    std::string index;
+    Put<uint32_t>(index, file->tracks.size());
+    for (const StubTrack &track : file->tracks)
+    {
+        PutString(index, track.type);
+        Put(index, track.timescale);
+        Put(index, track.duration);
+        Put(index, track.width);
+        Put(index, track.height);
+        Put<uint32_t>(index, track.sps.size());
+        for (const std::string &sps : track.sps)
+            PutString(index, sps);
+        Put<uint32_t>(index, track.pps.size());
+        for (const std::string &pps : track.pps)
+            PutString(index, pps);
+        Put<uint32_t>(index, track.samples.size());
+        Put(index, track.samples.data(), track.samples.size() * sizeof(StubSample));
+    }
+
+    uint32_t box = static_cast<uint32_t>(index.size() + 8);
+    uint8_t header[8] = {static_cast<uint8_t>(box >> 24), static_cast<uint8_t>(box >> 16),
+                         static_cast<uint8_t>(box >> 8), static_cast<uint8_t>(box), 's', 't', 'b', 'x'};
+    uint64_t index_pos = file->pos;
+    fwrite(header, 1, sizeof(header), file->fp);
+    fwrite(index.data(), 1, index.size(), file->fp);
+    fwrite(&index_pos, 1, sizeof(index_pos), file->fp);
+    fseek(file->fp, file->mdat, SEEK_SET);
+    fwrite(size, 1, sizeof(size), file->fp);
+}
+
+bool ReadIndex(StubFile *file)
+{
+    uint64_t index_pos;
+    if (fseek(file->fp, -static_cast<long>(sizeof(index_pos)), SEEK_END) != 0 ||
+        fread(&index_pos, 1, sizeof(index_pos), file->fp) != sizeof(index_pos))
+        return false;
+    long end = ftell(file->fp) - sizeof(index_pos);
+    if (index_pos + 8 > static_cast<uint64_t>(end))
+        return false;
+
+    std::string index(end - index_pos - 8, '\0');
+    if (fseek(file->fp, index_pos + 8, SEEK_SET) != 0 || fread(&index[0], 1, index.size(), file->fp) != index.size())
+        return false;
+
+    size_t pos = 0;
+    uint32_t tracks;
+    if (!Get(index, pos, tracks))
+        return false;
+    file->tracks.resize(tracks);
+    for (StubTrack &track : file->tracks)
+    {
+        uint32_t count;
+        if (!GetString(index, pos, track.type) || !Get(index, pos, track.timescale) || !Get(index, pos, track.duration) ||
+            !Get(index, pos, track.width) || !Get(index, pos, track.height) || !Get(index, pos, count))
+            return false;
+        track.sps.resize(count);
+        for (std::string &sps : track.sps)
+        {
+            if (!GetString(index, pos, sps))
+                return false;
+        }
+        if (!Get(index, pos, count))
+            return false;
+        track.pps.resize(count);
+        for (std::string &pps : track.pps)
+        {
+            if (!GetString(index, pos, pps))
+                return false;
+        }
+        if (!Get(index, pos, count) || pos + count * sizeof(StubSample) > index.size())
+            return false;
+        track.samples.resize(count);
+        memcpy(track.samples.data(), index.data() + pos, count * sizeof(StubSample));
+        pos += count * sizeof(StubSample);
+        track.max_size = 0;
+        for (const StubSample &sample : track.samples)
+            track.max_size = std::max(track.max_size, sample.size);
+    }
+    return true;
+}
+
+MP4TrackId AddTrack(MP4FileHandle handle, const char *type, uint32_t timescale, MP4Duration duration, uint16_t width, uint16_t height)
+{
+    StubFile *file = File(handle);
+    if (!file || !file->write)
+        return MP4_INVALID_TRACK_ID;
+    StubTrack track;
+    track.type = type;
+    track.timescale = timescale;
+    track.duration = duration;
+    track.width = width;
+    track.height = height;
+    track.time = 0;
+    track.max_size = 0;
+    file->tracks.push_back(track);
+    return file->tracks.size();
+}
+} // namespace
+
+MP4FileHandle MP4Create(const char *fileName, uint32_t flags)
+{
+    FILE *fp = fopen(fileName, "wb+");
+    if (!fp)
+        return MP4_INVALID_FILE_HANDLE;
+
+    StubFile *file = new StubFile;
+    file->fp = fp;
+    file->write = true;
+    fwrite(KFtyp, 1, sizeof(KFtyp), fp);
+    fwrite(KFree, 1, sizeof(KFree), fp);
+    file->mdat = sizeof(KFtyp) + sizeof(KFree);
+    const char mdat[] = {0, 0, 0, 8, 'm', 'd', 'a', 't'};
+    fwrite(mdat, 1, sizeof(mdat), fp);
+    file->pos = file->mdat + sizeof(mdat);
+    return file;
+}
+
+MP4FileHandle MP4Read(const char *fileName)
+{
+    FILE *fp = fopen(fileName, "rb");
+    if (!fp)
+        return MP4_INVALID_FILE_HANDLE;
+
+    StubFile *file = new StubFile;
+    file->fp = fp;
+    file->write = false;
+    file->pos = 0;
+    file->mdat = 0;
+    if (!ReadIndex(file))
+    {
+        fclose(fp);
+        delete file;
+        return MP4_INVALID_FILE_HANDLE;
+    }
+    return file;
+}
+
+void MP4Close(MP4FileHandle hFile, uint32_t flags)
+{
+    StubFile *file = File(hFile);
+    if (!file)
+        return;
+    if (file->write)
+        WriteIndex(file);
+    fclose(file->fp);
+    delete file;
+}
+
+bool MP4SetTimeScale(MP4FileHandle hFile, uint32_t value)
+{
+    return File(hFile) != nullptr;
+}
+
+MP4TrackId MP4AddH264VideoTrack(MP4FileHandle hFile, uint32_t timeScale, MP4Duration sampleDuration,
+                                uint16_t width, uint16_t height, uint8_t AVCProfileIndication,
+                                uint8_t profile_compat, uint8_t AVCLevelIndication, uint8_t sampleLenFieldSizeMinusOne)
+{
+    return AddTrack(hFile, MP4_VIDEO_TRACK_TYPE, timeScale, sampleDuration, width, height);
+}
+
+void MP4AddH264SequenceParameterSet(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pSequence, uint16_t sequenceLen)
+{
+    StubTrack *track = Track(hFile, trackId);
+    std::string sps(reinterpret_cast<const char *>(pSequence), sequenceLen);
+    for (size_t i = 0; track && i < track->sps.size(); i++)
+    {
+        if (track->sps[i] == sps)
+            return;
+    }
+    if (track)
+        track->sps.push_back(sps);
+}
+
+void MP4AddH264PictureParameterSet(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pPict, uint16_t pictLen)
+{
+    StubTrack *track = Track(hFile, trackId);
+    std::string pps(reinterpret_cast<const char *>(pPict), pictLen);
+    for (size_t i = 0; track && i < track->pps.size(); i++)
+    {
+        if (track->pps[i] == pps)
+            return;
+    }
+    if (track)
+        track->pps.push_back(pps);
+}
+
+MP4TrackId MP4AddSubtitleTrack(MP4FileHandle hFile, uint32_t timescale, uint16_t width, uint16_t height)
+{
+    return AddTrack(hFile, MP4_SUBTITLE_TRACK_TYPE, timescale, 0, width, height);
+}
+
+bool MP4WriteSample(MP4FileHandle hFile, MP4TrackId trackId, const uint8_t *pBytes, uint32_t numBytes,
+                    MP4Duration duration, MP4Duration renderingOffset, bool isSyncSample)
+{
+    StubFile *file = File(hFile);
+    StubTrack *track = Track(hFile, trackId);
+    if (!track || !file->write)
+        return false;
+    if (numBytes > 0 && fwrite(pBytes, 1, numBytes, file->fp) != numBytes)
+        return false;
+
+    StubSample sample;
+    sample.offset = file->pos;
+    sample.size = numBytes;
+    sample.time = track->time;
+    sample.duration = duration == MP4_INVALID_DURATION ? track->duration : duration;
+    sample.sync = isSyncSample;
+    track->samples.push_back(sample);
+    track->time += sample.duration;
+    track->max_size = std::max(track->max_size, numBytes);
+    file->pos += numBytes;
+    return true;
+}
+
+MP4TrackId MP4FindTrackId(MP4FileHandle hFile, uint16_t index, const char *type, uint8_t subType)
+{
+    StubFile *file = File(hFile);
+    if (!file)
+        return MP4_INVALID_TRACK_ID;
+    for (size_t i = 0; i < file->tracks.size(); i++)
+    {
+        if (type && file->tracks[i].type != type)
+            continue;
+        if (index-- == 0)
+            return i + 1;
+    }
+    return MP4_INVALID_TRACK_ID;
+}
+
+MP4SampleId MP4GetTrackNumberOfSamples(MP4FileHandle hFile, MP4TrackId trackId)
+{
+    StubTrack *track = Track(hFile, trackId);
+    return track ? track->samples.size() : 0;
+}
+
+uint32_t MP4GetTrackTimeScale(MP4FileHandle hFile, MP4TrackId trackId)
+{
+    StubTrack *track = Track(hFile, trackId);
+    return track ? track->timescale : 0;
+}
+
+uint16_t MP4GetTrackVideoWidth(MP4FileHandle hFile, MP4TrackId trackId)
+{
+    StubTrack *track = Track(hFile, trackId);
+    return track ? track->width : 0;
+}
+
+uint16_t MP4GetTrackVideoHeight(MP4FileHandle hFile, MP4TrackId trackId)
+{
+    StubTrack *track = Track(hFile, trackId);
+    return track ? track->height : 0;
+}
+
+uint32_t MP4GetTrackMaxSampleSize(MP4FileHandle hFile, MP4TrackId trackId)
+{
+    StubTrack *track = Track(hFile, trackId);
+    return track ? track->max_size : 0;
+}
+
+bool MP4GetTrackH264SeqPictHeaders(MP4FileHandle hFile, MP4TrackId trackId,
+                                   uint8_t ***pSeqHeaders, uint32_t **pSeqHeaderSize,
+                                   uint8_t ***pPictHeader, uint32_t **pPictHeaderSize)
+{
+    StubTrack *track = Track(hFile, trackId);
+    if (!track)
+        return false;
+
+    //与mp4v2相同,以NULL结尾的数组,由MP4FreeH264SeqPictHeaders释放
+    const std::vector<std::string> *sets[2] = {&track->sps, &track->pps};
+    uint8_t ***headers[2] = {pSeqHeaders, pPictHeader};
+    uint32_t **sizes[2] = {pSeqHeaderSize, pPictHeaderSize};
+    for (int n = 0; n < 2; n++)
+    {
+        *headers[n] = static_cast<uint8_t **>(calloc(sets[n]->size() + 1, sizeof(uint8_t *)));
+        *sizes[n] = static_cast<uint32_t *>(calloc(sets[n]->size() + 1, sizeof(uint32_t)));
+        for (size_t i = 0; i < sets[n]->size(); i++)
+        {
+            (*headers[n])[i] = static_cast<uint8_t *>(malloc((*sets[n])[i].size()));
+            memcpy((*headers[n])[i], (*sets[n])[i].data(), (*sets[n])[i].size());
+            (*sizes[n])[i] = (*sets[n])[i].size();
+        }
+    }
+    return true;
+}
+
+void MP4FreeH264SeqPictHeaders(uint8_t **pSeqHeaders, uint32_t *pSeqHeaderSize,
+                               uint8_t **pPictHeader, uint32_t *pPictHeaderSize)
+{
+    for (int i = 0; pSeqHeaders[i]; i++)
+        free(pSeqHeaders[i]);
+    for (int i = 0; pPictHeader[i]; i++)
+        free(pPictHeader[i]);
+    free(pSeqHeaders);
+    free(pSeqHeaderSize);
+    free(pPictHeader);
+    free(pPictHeaderSize);
+}
+
+MP4Duration MP4GetSampleDuration(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId)
+{
+    StubSample *sample = Sample(hFile, trackId, sampleId);
+    return sample ? sample->duration : MP4_INVALID_DURATION;
+}
+
+MP4Timestamp MP4GetSampleTime(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId)
+{
+    StubSample *sample = Sample(hFile, trackId, sampleId);
+    return sample ? sample->time : 0;
+}
+
+int8_t MP4GetSampleSync(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId)
+{
+    StubSample *sample = Sample(hFile, trackId, sampleId);
+    return sample ? (sample->sync ? 1 : 0) : -1;
+}
+
+MP4SampleId MP4GetSampleIdFromTime(MP4FileHandle hFile, MP4TrackId trackId, MP4Timestamp when, bool wantSyncSample)
+{
+    StubTrack *track = Track(hFile, trackId);
+    if (!track)
+        return MP4_INVALID_SAMPLE_ID;
+    for (size_t i = 0; i < track->samples.size(); i++)
+    {
+        const StubSample &sample = track->samples[i];
+        if (when < sample.time + sample.duration)
+        {
+            while (wantSyncSample && i > 0 && !track->samples[i].sync)
+                i--;
+            return i + 1;
+        }
+    }
+    return MP4_INVALID_SAMPLE_ID;
+}
+
+bool MP4ReadSample(MP4FileHandle hFile, MP4TrackId trackId, MP4SampleId sampleId,
+                   uint8_t **ppBytes, uint32_t *pNumBytes, MP4Timestamp *pStartTime,
+                   MP4Duration *pDuration, MP4Duration *pRenderingOffset, bool *pIsSyncSample)
+{
+    StubFile *file = File(hFile);
+    StubSample *sample = Sample(hFile, trackId, sampleId);
+    if (!sample)
+        return false;
+
+    //调用者提供的缓存不够时失败,没有提供时分配
+    if (*ppBytes && *pNumBytes < sample->size)
+        return false;
+    if (!*ppBytes)
+        *ppBytes = static_cast<uint8_t *>(malloc(sample->size));
+    if (fseek(file->fp, sample->offset, SEEK_SET) != 0 ||
+        fread(*ppBytes, 1, sample->size, file->fp) != sample->size)
+        return false;
+
+    *pNumBytes = sample->size;
+    if (pStartTime)
+        *pStartTime = sample->time;
+    if (pDuration)
+        *pDuration = sample->duration;
+    if (pRenderingOffset)
+        *pRenderingOffset = 0;
+    if (pIsSyncSample)
+        *pIsSyncSample = sample->sync;
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef __MPI_ISP_H__
+#define __MPI_ISP_H__
+
+//主机编译不使用该部分接口
+#include "hi_common.h"
+
+#endif
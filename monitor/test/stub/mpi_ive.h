@@ -0,0 +1,10 @@
+#ifndef __MPI_IVE_H__
+#define __MPI_IVE_H__
+
+#include "hi_comm_ive.h"
+
+//桩在提交时同步完成,查询总是返回已完成
+HI_S32 HI_MPI_IVE_DMA(IVE_HANDLE *pIveHandle, IVE_SRC_DATA_S *pstSrc, IVE_DST_DATA_S *pstDst, IVE_DMA_CTRL_S *pstDmaCtrl, HI_BOOL bInstant);
+HI_S32 HI_MPI_IVE_Query(IVE_HANDLE IveHandle, HI_BOOL *pbFinish, HI_BOOL bBlock);
+
+#endif
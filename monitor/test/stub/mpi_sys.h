@@ -0,0 +1,20 @@
+#ifndef __MPI_SYS_H__
+#define __MPI_SYS_H__
+
+#include "hi_comm_sys.h"
+
+HI_S32 HI_MPI_SYS_Init(HI_VOID);
+HI_S32 HI_MPI_SYS_Exit(HI_VOID);
+HI_S32 HI_MPI_SYS_SetConf(const MPP_SYS_CONF_S *pstSysConf);
+HI_S32 HI_MPI_SYS_Bind(MPP_CHN_S *pstSrcChn, MPP_CHN_S *pstDestChn);
+HI_S32 HI_MPI_SYS_UnBind(MPP_CHN_S *pstSrcChn, MPP_CHN_S *pstDestChn);
+
+//桩用普通内存模拟MMZ,物理地址是登记表中的编号,只能映射通过HI_MPI_SYS_MmzAlloc分配的内存
+HI_S32 HI_MPI_SYS_MmzAlloc(HI_U32 *pu32PhyAddr, HI_VOID **ppVirtAddr, const HI_CHAR *strMmb, const HI_CHAR *strZone, HI_U32 u32Len);
+HI_S32 HI_MPI_SYS_MmzAlloc_Cached(HI_U32 *pu32PhyAddr, HI_VOID **ppVirtAddr, const HI_CHAR *strMmb, const HI_CHAR *strZone, HI_U32 u32Len);
+HI_S32 HI_MPI_SYS_MmzFree(HI_U32 u32PhyAddr, HI_VOID *pVirtAddr);
+HI_S32 HI_MPI_SYS_MmzFlushCache(HI_U32 u32PhyAddr, HI_VOID *pVitAddr, HI_U32 u32Size);
+HI_VOID *HI_MPI_SYS_Mmap(HI_U32 u32PhyAddr, HI_U32 u32Size);
+HI_S32 HI_MPI_SYS_Munmap(HI_VOID *pVirAddr, HI_U32 u32Size);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __MPI_VB_H__
+#define __MPI_VB_H__
+
+#include "hi_comm_vb.h"
+
+HI_S32 HI_MPI_VB_SetConf(const VB_CONF_S *pstVbConf);
+HI_S32 HI_MPI_VB_Init(HI_VOID);
+HI_S32 HI_MPI_VB_Exit(HI_VOID);
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef RTMP_CHUNK_STUB_H_
+#define RTMP_CHUNK_STUB_H_
+
+//srs_librtmp桩和本地RTMP接收服务共用的协议部分:分块的封装和读取,AMF0命令的编解码
+//只实现推流用到的子集
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <map>
+#include <functional>
+#include <algorithm>
+
+#define RTMP_HANDSHAKE_SIZE 1536
+#define RTMP_CHUNK_SIZE 128 //协议默认分块大小
+#define RTMP_EXT_TIMESTAMP 0xffffff
+
+#define RTMP_CID_COMMAND 3
+#define RTMP_CID_STREAM 5
+#define RTMP_CID_VIDEO 6
+
+#define RTMP_MSG_SET_CHUNK_SIZE 1
+#define RTMP_MSG_VIDEO 9
+#define RTMP_MSG_AMF0_COMMAND 20
+
+#define RTMP_AMF0_NUMBER 0x00
+#define RTMP_AMF0_STRING 0x02
+#define RTMP_AMF0_OBJECT 0x03
+#define RTMP_AMF0_NULL 0x05
+
+namespace rtmp_stub
+{
+
+struct Message
+{
+    uint8_t type;
+    uint32_t stream_id;
+    uint32_t timestamp; //ms
+    std::string payload;
+};
+
+inline void Put16(std::string &out, uint32_t value)
+{
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value);
+}
+
+inline void Put24(std::string &out, uint32_t value)
+{
+    out += static_cast<char>(value >> 16);
+    Put16(out, value);
+}
+
+inline void Put32(std::string &out, uint32_t value)
+{
+    out += static_cast<char>(value >> 24);
+    Put24(out, value);
+}
+
+inline uint32_t Get24(const uint8_t *p)
+{
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+inline uint32_t Get32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | Get24(p + 1);
+}
+
+inline void AmfString(std::string &out, const std::string &value)
+{
+    out += static_cast<char>(RTMP_AMF0_STRING);
+    Put16(out, value.size());
+    out += value;
+}
+
+inline void AmfNumber(std::string &out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out += static_cast<char>(RTMP_AMF0_NUMBER);
+    Put32(out, bits >> 32);
+    Put32(out, bits);
+}
+
+inline void AmfNull(std::string &out)
+{
+    out += static_cast<char>(RTMP_AMF0_NULL);
+}
+
+inline void AmfObjectBegin(std::string &out)
+{
+    out += static_cast<char>(RTMP_AMF0_OBJECT);
+}
+
+//对象的属性名,之后写入属性值
+inline void AmfProperty(std::string &out, const std::string &name)
+{
+    Put16(out, name.size());
+    out += name;
+}
+
+inline void AmfObjectEnd(std::string &out)
+{
+    out.append("\x00\x00\x09", 3);
+}
+
+inline bool AmfReadString(const std::string &in, size_t &pos, std::string &value)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(in.data()) + pos;
+    if (pos + 3 > in.size() || p[0] != RTMP_AMF0_STRING)
+        return false;
+    size_t len = (p[1] << 8) | p[2];
+    if (pos + 3 + len > in.size())
+        return false;
+    value.assign(in, pos + 3, len);
+    pos += 3 + len;
+    return true;
+}
+
+inline bool AmfReadNumber(const std::string &in, size_t &pos, double &value)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(in.data()) + pos;
+    if (pos + 9 > in.size() || p[0] != RTMP_AMF0_NUMBER)
+        return false;
+    uint64_t bits = (static_cast<uint64_t>(Get32(p + 1)) << 32) | Get32(p + 5);
+    memcpy(&value, &bits, sizeof(value));
+    pos += 9;
+    return true;
+}
+
+inline bool AmfReadNull(const std::string &in, size_t &pos)
+{
+    if (pos >= in.size() || static_cast<uint8_t>(in[pos]) != RTMP_AMF0_NULL)
+        return false;
+    pos++;
+    return true;
+}
+
+//按分块封装一个消息追加到out,第一个分块用fmt0,之后的用fmt3,cid只支持2~63
+inline void PackMessage(std::string &out, uint32_t chunk_size, uint32_t cid, uint8_t type, uint32_t stream_id,
+                        uint32_t timestamp, const char *payload, size_t len)
+{
+    bool ext = timestamp >= RTMP_EXT_TIMESTAMP;
+    size_t pos = 0;
+    do
+    {
+        if (pos == 0)
+        {
+            out += static_cast<char>(cid & 0x3f);
+            Put24(out, ext ? RTMP_EXT_TIMESTAMP : timestamp);
+            Put24(out, len);
+            out += static_cast<char>(type);
+            //消息流id为小端
+            for (int32_t i = 0; i < 4; i++)
+                out += static_cast<char>(stream_id >> (i * 8));
+        }
+        else
+        {
+            out += static_cast<char>(0xc0 | (cid & 0x3f));
+        }
+        if (ext)
+            Put32(out, timestamp);
+        size_t n = std::min(static_cast<size_t>(chunk_size), len - pos);
+        out.append(payload + pos, n);
+        pos += n;
+    } while (pos < len);
+}
+
+//按分块读取完整的消息,read读取固定长度的数据,连接断开时返回false
+//收到Set Chunk Size时更新分块大小,消息本身也返回给调用方
+class ChunkReader
+{
+public:
+    explicit ChunkReader(const std::function<bool(char *, size_t)> &read) : read_(read),
+                                                                           chunk_size_(RTMP_CHUNK_SIZE)
+    {
+    }
+
+    bool Read(Message &msg)
+    {
+        for (;;)
+        {
+            uint8_t buf[11];
+            if (!read_(reinterpret_cast<char *>(buf), 1))
+                return false;
+            uint32_t fmt = buf[0] >> 6;
+            uint32_t cid = buf[0] & 0x3f;
+            if (cid == 0)
+            {
+                if (!read_(reinterpret_cast<char *>(buf), 1))
+                    return false;
+                cid = 64 + buf[0];
+            }
+            else if (cid == 1)
+            {
+                if (!read_(reinterpret_cast<char *>(buf), 2))
+                    return false;
+                cid = 64 + buf[0] + buf[1] * 256;
+            }
+
+            Stream &stream = streams_[cid];
+            size_t header = fmt == 0 ? 11 : fmt == 1 ? 7 : fmt == 2 ? 3 : 0;
+            if (header && !read_(reinterpret_cast<char *>(buf), header))
+                return false;
+            uint32_t timestamp = 0;
+            if (fmt <= 2)
+            {
+                timestamp = Get24(buf);
+                stream.ext = timestamp == RTMP_EXT_TIMESTAMP;
+            }
+            if (fmt <= 1)
+            {
+                stream.len = Get24(buf + 3);
+                stream.type = buf[6];
+            }
+            if (fmt == 0)
+                stream.stream_id = buf[7] | (buf[8] << 8) | (buf[9] << 16) | (static_cast<uint32_t>(buf[10]) << 24);
+            if (stream.ext)
+            {
+                if (!read_(reinterpret_cast<char *>(buf), 4))
+                    return false;
+                timestamp = Get32(buf);
+            }
+
+            //消息的第一个分块更新时间戳,fmt3沿用上一个增量
+            if (stream.payload.empty())
+            {
+                if (fmt == 0)
+                    stream.timestamp = timestamp;
+                else if (fmt <= 2)
+                    stream.timestamp += timestamp;
+                else
+                    stream.timestamp += stream.delta;
+                if (fmt <= 2)
+                    stream.delta = timestamp;
+            }
+
+            size_t pos = stream.payload.size();
+            size_t n = std::min(static_cast<size_t>(chunk_size_), stream.len - pos);
+            stream.payload.resize(pos + n);
+            if (n && !read_(&stream.payload[pos], n))
+                return false;
+            if (stream.payload.size() < stream.len)
+                continue;
+
+            msg.type = stream.type;
+            msg.stream_id = stream.stream_id;
+            msg.timestamp = stream.timestamp;
+            msg.payload.swap(stream.payload);
+            stream.payload.clear();
+            if (msg.type == RTMP_MSG_SET_CHUNK_SIZE && msg.payload.size() >= 4)
+                chunk_size_ = Get32(reinterpret_cast<const uint8_t *>(msg.payload.data())) & 0x7fffffff;
+            return true;
+        }
+    }
+
+private:
+    struct Stream
+    {
+        Stream() : timestamp(0), delta(0), len(0), type(0), stream_id(0), ext(false) {}
+
+        uint32_t timestamp;
+        uint32_t delta;
+        uint32_t len;
+        uint8_t type;
+        uint32_t stream_id;
+        bool ext;
+        std::string payload;
+    };
+
+    std::function<bool(char *, size_t)> read_;
+    uint32_t chunk_size_;
+    std::map<uint32_t, Stream> streams_;
+};
+} // namespace rtmp_stub
+
+#endif
@@ -0,0 +1,300 @@
+#include "rtmp_server.h"
+#include "rtmp_chunk.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <chrono>
+
+#define RTMP_SERVER_RCVBUF 16384   //接收缓存,限速时推流端很快阻塞
+#define RTMP_SERVER_READ_SIZE 4096 //限速时单次最多读取的字节数
+#define RTMP_SERVER_READ_BUF 65536 //不限速时单次最多读取的字节数
+#define RTMP_SERVER_POLL_TIMEOUT 100
+#define RTMP_SERVER_STREAM_ID 1
+
+using namespace rtmp_stub;
+
+namespace nvr
+{
+
+RtmpServer::RtmpServer() : listen_fd_(-1),
+                           port_(0),
+                           link_rate_(0),
+                           link_start_(0),
+                           link_bytes_(0),
+                           read_pos_(0),
+                           run_(false),
+                           thread_(nullptr),
+                           init_(false)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+RtmpServer::~RtmpServer()
+{
+    Close();
+}
+
+int32_t RtmpServer::Initialize(uint16_t port, uint32_t link_rate)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+    {
+        log_e("socket failed,%s", strerror(errno));
+        return static_cast<int>(KSystemError);
+    }
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    //接受的连接继承监听socket的接收缓存
+    opt = RTMP_SERVER_RCVBUF;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt));
+
+    sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 1) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &addr_len) != 0)
+    {
+        log_e("listen on port %d failed,%s", port, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return static_cast<int>(KSystemError);
+    }
+    port_ = ntohs(addr.sin_port);
+    link_rate_ = link_rate;
+
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() {
+        while (run_)
+        {
+            pollfd pfd = {listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, RTMP_SERVER_POLL_TIMEOUT) <= 0)
+                continue;
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            link_start_ = System::GetSteadyMicroSeconds();
+            link_bytes_ = 0;
+            read_buf_.clear();
+            read_pos_ = 0;
+            Serve(fd);
+            close(fd);
+        }
+    }));
+
+    init_ = true;
+    return static_cast<int>(KSuccess);
+}
+
+void RtmpServer::Close()
+{
+    if (!init_)
+        return;
+
+    run_ = false;
+    thread_->join();
+    thread_.reset();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    init_ = false;
+}
+
+std::string RtmpServer::Url() const
+{
+    return "rtmp://127.0.0.1:" + std::to_string(port_) + "/live/bench";
+}
+
+RtmpServer::Stats RtmpServer::GetStats()
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    return stats_;
+}
+
+bool RtmpServer::Read(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (read_pos_ < read_buf_.size())
+        {
+            size_t n = std::min(len, read_buf_.size() - read_pos_);
+            memcpy(data, read_buf_.data() + read_pos_, n);
+            read_pos_ += n;
+            data += n;
+            len -= n;
+            continue;
+        }
+
+        pollfd pfd = {fd, POLLIN, 0};
+        int ret = poll(&pfd, 1, RTMP_SERVER_POLL_TIMEOUT);
+        if (!run_)
+            return false;
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            return false;
+        if (ret == 0)
+            continue;
+
+        read_buf_.resize(link_rate_ ? RTMP_SERVER_READ_SIZE : RTMP_SERVER_READ_BUF);
+        ssize_t n = recv(fd, &read_buf_[0], read_buf_.size(), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        read_buf_.resize(n);
+        read_pos_ = 0;
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            stats_.bytes += n;
+        }
+
+        //读取后休眠到这些数据按链路速率应当到达的时间
+        link_bytes_ += n;
+        if (link_rate_)
+        {
+            uint64_t due = link_start_ + link_bytes_ * 1000000 / (link_rate_ * 1024ull);
+            uint64_t now = System::GetSteadyMicroSeconds();
+            if (due > now)
+                std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        }
+    }
+    return true;
+}
+
+bool RtmpServer::Send(int fd, const std::string &data)
+{
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        ssize_t ret = send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        pos += ret;
+    }
+    return true;
+}
+
+void RtmpServer::Serve(int fd)
+{
+    //简单握手:读取C0C1,回复S0S1S2(S2为C1原样返回),读取C2
+    std::string c0c1(1 + RTMP_HANDSHAKE_SIZE, '\0');
+    if (!Read(fd, &c0c1[0], c0c1.size()))
+        return;
+    std::string s0s1s2(1 + RTMP_HANDSHAKE_SIZE, '\0');
+    s0s1s2[0] = 0x03;
+    s0s1s2.append(c0c1, 1, RTMP_HANDSHAKE_SIZE);
+    std::string c2(RTMP_HANDSHAKE_SIZE, '\0');
+    if (!Send(fd, s0s1s2) || !Read(fd, &c2[0], c2.size()))
+        return;
+
+    ChunkReader reader([this, fd](char *data, size_t len) { return Read(fd, data, len); });
+    Message msg;
+    bool publish = false;
+    uint64_t base_time = 0;
+    uint32_t base_ts = 0;
+    bool first = true;
+    while (reader.Read(msg))
+    {
+        const uint8_t *payload = reinterpret_cast<const uint8_t *>(msg.payload.data());
+        if (msg.type == RTMP_MSG_VIDEO && publish && msg.payload.size() >= 5)
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            if (payload[1] == 0)
+            {
+                stats_.sequence_headers++;
+                continue;
+            }
+            if (msg.payload.size() < 9)
+                continue;
+            stats_.nalus++;
+            stats_.nalu_bytes += msg.payload.size() - 9;
+            if ((payload[0] >> 4) == 1)
+                stats_.key_frames++;
+
+            uint64_t now = System::GetSteadyMicroSeconds();
+            if (first)
+            {
+                base_ts = msg.timestamp;
+                first = false;
+            }
+            int64_t lag = static_cast<int64_t>((now - base_time) / 1000) - static_cast<int64_t>(msg.timestamp - base_ts);
+            if (lag > 0 && static_cast<uint64_t>(lag) > stats_.lag_max_ms)
+                stats_.lag_max_ms = lag;
+            continue;
+        }
+
+        if (msg.type != RTMP_MSG_AMF0_COMMAND)
+            continue;
+        size_t pos = 0;
+        std::string command;
+        double transaction = 0;
+        if (!AmfReadString(msg.payload, pos, command) || !AmfReadNumber(msg.payload, pos, transaction))
+            continue;
+
+        std::string response;
+        if (command == "connect")
+        {
+            AmfString(response, "_result");
+            AmfNumber(response, transaction);
+            AmfObjectBegin(response);
+            AmfProperty(response, "fmsVer");
+            AmfString(response, "FMS/3,5,3,888");
+            AmfObjectEnd(response);
+            AmfObjectBegin(response);
+            AmfProperty(response, "level");
+            AmfString(response, "status");
+            AmfProperty(response, "code");
+            AmfString(response, "NetConnection.Connect.Success");
+            AmfObjectEnd(response);
+        }
+        else if (command == "createStream")
+        {
+            AmfString(response, "_result");
+            AmfNumber(response, transaction);
+            AmfNull(response);
+            AmfNumber(response, RTMP_SERVER_STREAM_ID);
+        }
+        else if (command == "publish")
+        {
+            AmfString(response, "onStatus");
+            AmfNumber(response, 0);
+            AmfNull(response);
+            AmfObjectBegin(response);
+            AmfProperty(response, "level");
+            AmfString(response, "status");
+            AmfProperty(response, "code");
+            AmfString(response, "NetStream.Publish.Start");
+            AmfObjectEnd(response);
+            publish = true;
+            base_time = System::GetSteadyMicroSeconds();
+            std::unique_lock<std::mutex> lock(mux_);
+            stats_.connections++;
+        }
+        else
+        {
+            continue;
+        }
+
+        std::string out;
+        PackMessage(out, RTMP_CHUNK_SIZE, command == "publish" ? RTMP_CID_STREAM : RTMP_CID_COMMAND, RTMP_MSG_AMF0_COMMAND,
+                    msg.stream_id, 0, response.data(), response.size());
+        if (!Send(fd, out))
+            return;
+    }
+}
+} // namespace nvr
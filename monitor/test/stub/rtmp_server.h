@@ -0,0 +1,69 @@
+#ifndef RTMP_SERVER_STUB_H_
+#define RTMP_SERVER_STUB_H_
+
+//主机测试用的RTMP接收服务,代替SRS:在本地回环地址上接受推流,完成握手和connect/createStream/publish,统计收到的视频
+//link_rate限制接收速率,接收缓存很小,超过链路速率时推流端阻塞在发送上,模拟上行带宽不足
+
+#include <stdint.h>
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace nvr
+{
+class RtmpServer
+{
+public:
+    struct Stats
+    {
+        uint64_t connections;      //完成publish的连接数
+        uint64_t bytes;            //收到的字节数,包括握手,命令和分块头
+        uint64_t nalus;            //收到的视频nalu数,不含sequence header
+        uint64_t nalu_bytes;       //nalu的字节数,不含起始码和长度前缀
+        uint64_t key_frames;       //收到的I帧数
+        uint64_t sequence_headers; //收到的sequence header数
+        uint64_t lag_max_ms;       //nalu到达时间落后于时间戳的最大值,以publish的时刻和第一个nalu的时间戳为基准
+    };
+
+    RtmpServer();
+
+    ~RtmpServer();
+
+    //port为0时由系统分配,link_rate为接收速率(KB/s),0不限速
+    int32_t Initialize(uint16_t port, uint32_t link_rate);
+
+    void Close();
+
+    //推流地址rtmp://127.0.0.1:port/live/bench
+    std::string Url() const;
+
+    Stats GetStats();
+
+private:
+    void Serve(int fd);
+
+    //按链路速率读取len字节,连接断开或服务关闭时返回false
+    bool Read(int fd, char *data, size_t len);
+
+    bool Send(int fd, const std::string &data);
+
+private:
+    int listen_fd_;
+    uint16_t port_;
+    uint32_t link_rate_;
+    uint64_t link_start_; //当前连接开始接收的时间(us)
+    uint64_t link_bytes_; //当前连接收到的字节数
+    std::string read_buf_; //每次recv读取的数据,分块读取从中拷贝
+    size_t read_pos_;
+    std::mutex mux_;
+    Stats stats_;
+    std::atomic<bool> run_;
+    std::unique_ptr<std::thread> thread_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
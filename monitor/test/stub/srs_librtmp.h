@@ -0,0 +1,31 @@
+#ifndef SRS_LIBRTMP_STUB_H_
+#define SRS_LIBRTMP_STUB_H_
+
+//主机测试用的srs_librtmp桩,只声明直播模块用到的接口
+//推流与srs_librtmp相同:简单握手,connect/createStream/publish,H.264裸流按FLV视频tag封装,分块大小128
+//发送缓存固定为RTMP_STUB_SNDBUF,链路变慢时srs_h264_write_raw_frames像板端一样阻塞在发送上
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define RTMP_STUB_SNDBUF 65536
+
+typedef void *srs_rtmp_t;
+
+srs_rtmp_t srs_rtmp_create(const char *url);
+
+//解析url,连接服务器并完成简单握手
+int srs_rtmp_handshake(srs_rtmp_t rtmp);
+
+int srs_rtmp_connect_app(srs_rtmp_t rtmp);
+
+int srs_rtmp_publish_stream(srs_rtmp_t rtmp);
+
+//frames为起始码分隔的一个或多个nalu,dts/pts单位ms
+//SPS/PPS缓存到下一个I/P帧前以sequence header发送,未变化时返回ERROR_H264_DUPLICATED_SPS/PPS,
+//发送sequence header之前的帧丢弃并返回ERROR_H264_DROP_BEFORE_SPS_PPS
+int srs_h264_write_raw_frames(srs_rtmp_t rtmp, char *frames, int frames_size, u_int32_t dts, u_int32_t pts);
+
+void srs_rtmp_destroy(srs_rtmp_t rtmp);
+
+#endif
@@ -0,0 +1,356 @@
+#include <srs_librtmp.h>
+#include "rtmp_chunk.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <memory>
+
+//H.264相关的错误码与srs_librtmp一致,直播模块按这些值忽略重复的参数集
+#define ERROR_SOCKET_CONNECT 1011
+#define ERROR_SOCKET_READ 1007
+#define ERROR_SOCKET_WRITE 1009
+#define ERROR_RTMP_URL 2001
+#define ERROR_RTMP_COMMAND 2002
+#define ERROR_H264_DROP_BEFORE_SPS_PPS 3043
+#define ERROR_H264_DUPLICATED_SPS 3044
+#define ERROR_H264_DUPLICATED_PPS 3045
+
+using namespace rtmp_stub;
+
+namespace
+{
+
+struct Context
+{
+    Context() : port(1935), fd(-1), stream_id(0), sps_changed(false), pps_changed(false), sps_pps_sent(false) {}
+
+    std::string url;
+    std::string host;
+    uint16_t port;
+    std::string app;
+    std::string stream;
+    int fd;
+    uint32_t stream_id;
+    std::unique_ptr<ChunkReader> reader;
+    std::string sps;
+    std::string pps;
+    bool sps_changed;
+    bool pps_changed;
+    bool sps_pps_sent;
+    std::string payload; //复用的消息缓存
+    std::string out;     //复用的分块缓存
+};
+
+Context *GetContext(srs_rtmp_t rtmp)
+{
+    return static_cast<Context *>(rtmp);
+}
+
+//rtmp://host[:port]/app/stream
+bool ParseUrl(Context *ctx)
+{
+    const std::string schema = "rtmp://";
+    if (ctx->url.compare(0, schema.size(), schema) != 0)
+        return false;
+    size_t host_end = ctx->url.find('/', schema.size());
+    size_t app_end = host_end == std::string::npos ? std::string::npos : ctx->url.rfind('/');
+    if (app_end == std::string::npos || app_end <= host_end)
+        return false;
+
+    std::string host = ctx->url.substr(schema.size(), host_end - schema.size());
+    size_t colon = host.find(':');
+    if (colon != std::string::npos)
+    {
+        ctx->port = atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+    ctx->host = host;
+    ctx->app = ctx->url.substr(host_end + 1, app_end - host_end - 1);
+    ctx->stream = ctx->url.substr(app_end + 1);
+    return !ctx->host.empty() && !ctx->app.empty() && !ctx->stream.empty();
+}
+
+bool SendAll(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+bool RecvAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t ret = recv(fd, data, len, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+int SendMessage(Context *ctx, uint32_t cid, uint8_t type, uint32_t stream_id, uint32_t timestamp, const std::string &payload)
+{
+    ctx->out.clear();
+    PackMessage(ctx->out, RTMP_CHUNK_SIZE, cid, type, stream_id, timestamp, payload.data(), payload.size());
+    return SendAll(ctx->fd, ctx->out.data(), ctx->out.size()) ? 0 : ERROR_SOCKET_WRITE;
+}
+
+//等待指定命令的响应,返回命令的内容,_error视为失败
+int ExpectCommand(Context *ctx, const std::string &name, std::string &payload, size_t &pos)
+{
+    Message msg;
+    while (ctx->reader->Read(msg))
+    {
+        if (msg.type != RTMP_MSG_AMF0_COMMAND)
+            continue;
+        std::string command;
+        pos = 0;
+        if (!AmfReadString(msg.payload, pos, command))
+            return ERROR_RTMP_COMMAND;
+        if (command == "_error")
+            return ERROR_RTMP_COMMAND;
+        if (command == name)
+        {
+            payload.swap(msg.payload);
+            return 0;
+        }
+    }
+    return ERROR_SOCKET_READ;
+}
+
+int WriteSequenceHeader(Context *ctx, uint32_t dts)
+{
+    //AVCDecoderConfigurationRecord,长度前缀4字节
+    std::string &payload = ctx->payload;
+    payload.assign("\x17\x00\x00\x00\x00", 5);
+    payload += static_cast<char>(0x01);
+    payload.append(ctx->sps, 1, 3);
+    payload += static_cast<char>(0xff);
+    payload += static_cast<char>(0xe1);
+    Put16(payload, ctx->sps.size());
+    payload += ctx->sps;
+    payload += static_cast<char>(0x01);
+    Put16(payload, ctx->pps.size());
+    payload += ctx->pps;
+    return SendMessage(ctx, RTMP_CID_VIDEO, RTMP_MSG_VIDEO, ctx->stream_id, dts, payload);
+}
+
+int WriteNalu(Context *ctx, const char *nalu, size_t len, uint32_t dts, uint32_t pts)
+{
+    uint8_t type = nalu[0] & 0x1f;
+    if (type == 7 || type == 8)
+    {
+        std::string &ps = type == 7 ? ctx->sps : ctx->pps;
+        if (ps.size() == len && memcmp(ps.data(), nalu, len) == 0)
+            return type == 7 ? ERROR_H264_DUPLICATED_SPS : ERROR_H264_DUPLICATED_PPS;
+        ps.assign(nalu, len);
+        (type == 7 ? ctx->sps_changed : ctx->pps_changed) = true;
+        return 0;
+    }
+
+    //AUD和填充数据不发送
+    if (type == 9 || type == 12)
+        return 0;
+
+    //参数集变化后在下一帧之前发送sequence header
+    if ((ctx->sps_changed || ctx->pps_changed) && ctx->sps.size() >= 4 && !ctx->pps.empty())
+    {
+        int ret = WriteSequenceHeader(ctx, dts);
+        if (ret != 0)
+            return ret;
+        ctx->sps_changed = ctx->pps_changed = false;
+        ctx->sps_pps_sent = true;
+    }
+    if (!ctx->sps_pps_sent)
+        return ERROR_H264_DROP_BEFORE_SPS_PPS;
+
+    std::string &payload = ctx->payload;
+    payload.clear();
+    payload += static_cast<char>(type == 5 ? 0x17 : 0x27);
+    payload += static_cast<char>(0x01);
+    Put24(payload, pts - dts);
+    Put32(payload, len);
+    payload.append(nalu, len);
+    return SendMessage(ctx, RTMP_CID_VIDEO, RTMP_MSG_VIDEO, ctx->stream_id, dts, payload);
+}
+
+//从pos开始查找下一个nalu,跳过起始码,没有时返回nullptr
+const char *NextNalu(const char *&pos, const char *end, size_t &len)
+{
+    while (pos + 3 <= end && !(pos[0] == 0 && pos[1] == 0 && pos[2] == 1))
+        pos++;
+    if (pos + 3 > end)
+        return nullptr;
+
+    const char *nalu = pos + 3;
+    const char *next = nalu;
+    while (next + 3 <= end && !(next[0] == 0 && next[1] == 0 && next[2] == 1))
+        next++;
+    if (next + 3 > end)
+        next = end;
+    len = next - nalu;
+    //四字节起始码的第一个0属于下一个起始码
+    while (next != end && len > 0 && nalu[len - 1] == 0)
+        len--;
+    pos = next;
+    return nalu;
+}
+} // namespace
+
+srs_rtmp_t srs_rtmp_create(const char *url)
+{
+    Context *ctx = new Context();
+    ctx->url = url;
+    return ctx;
+}
+
+int srs_rtmp_handshake(srs_rtmp_t rtmp)
+{
+    Context *ctx = GetContext(rtmp);
+    if (!ParseUrl(ctx))
+        return ERROR_RTMP_URL;
+
+    struct addrinfo hints, *addr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(ctx->host.c_str(), std::to_string(ctx->port).c_str(), &hints, &addr) != 0)
+        return ERROR_SOCKET_CONNECT;
+
+    ctx->fd = socket(AF_INET, SOCK_STREAM, 0);
+    int sndbuf = RTMP_STUB_SNDBUF;
+    setsockopt(ctx->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    int ret = connect(ctx->fd, addr->ai_addr, addr->ai_addrlen);
+    freeaddrinfo(addr);
+    if (ret != 0)
+    {
+        close(ctx->fd);
+        ctx->fd = -1;
+        return ERROR_SOCKET_CONNECT;
+    }
+    ctx->reader.reset(new ChunkReader([ctx](char *data, size_t len) { return RecvAll(ctx->fd, data, len); }));
+
+    //简单握手:C0C1,读取S0S1S2,回复C2(S1原样返回)
+    std::string c0c1(1 + RTMP_HANDSHAKE_SIZE, '\0');
+    c0c1[0] = 0x03;
+    for (size_t i = 9; i < c0c1.size(); i++)
+        c0c1[i] = static_cast<char>(rand());
+    if (!SendAll(ctx->fd, c0c1.data(), c0c1.size()))
+        return ERROR_SOCKET_WRITE;
+    std::string s0s1s2(1 + 2 * RTMP_HANDSHAKE_SIZE, '\0');
+    if (!RecvAll(ctx->fd, &s0s1s2[0], s0s1s2.size()))
+        return ERROR_SOCKET_READ;
+    if (!SendAll(ctx->fd, s0s1s2.data() + 1, RTMP_HANDSHAKE_SIZE))
+        return ERROR_SOCKET_WRITE;
+    return 0;
+}
+
+int srs_rtmp_connect_app(srs_rtmp_t rtmp)
+{
+    Context *ctx = GetContext(rtmp);
+    if (ctx->fd < 0)
+        return ERROR_SOCKET_WRITE;
+
+    std::string payload;
+    AmfString(payload, "connect");
+    AmfNumber(payload, 1);
+    AmfObjectBegin(payload);
+    AmfProperty(payload, "app");
+    AmfString(payload, ctx->app);
+    AmfProperty(payload, "tcUrl");
+    AmfString(payload, "rtmp://" + ctx->host + ":" + std::to_string(ctx->port) + "/" + ctx->app);
+    AmfObjectEnd(payload);
+    int ret = SendMessage(ctx, RTMP_CID_COMMAND, RTMP_MSG_AMF0_COMMAND, 0, 0, payload);
+    if (ret != 0)
+        return ret;
+
+    size_t pos;
+    return ExpectCommand(ctx, "_result", payload, pos);
+}
+
+int srs_rtmp_publish_stream(srs_rtmp_t rtmp)
+{
+    Context *ctx = GetContext(rtmp);
+    if (ctx->fd < 0)
+        return ERROR_SOCKET_WRITE;
+
+    //createStream,响应中为消息流id
+    std::string payload;
+    AmfString(payload, "createStream");
+    AmfNumber(payload, 2);
+    AmfNull(payload);
+    int ret = SendMessage(ctx, RTMP_CID_COMMAND, RTMP_MSG_AMF0_COMMAND, 0, 0, payload);
+    if (ret != 0)
+        return ret;
+    size_t pos;
+    double transaction, stream_id;
+    if ((ret = ExpectCommand(ctx, "_result", payload, pos)) != 0)
+        return ret;
+    if (!AmfReadNumber(payload, pos, transaction) || !AmfReadNull(payload, pos) || !AmfReadNumber(payload, pos, stream_id))
+        return ERROR_RTMP_COMMAND;
+    ctx->stream_id = static_cast<uint32_t>(stream_id);
+
+    payload.clear();
+    AmfString(payload, "publish");
+    AmfNumber(payload, 3);
+    AmfNull(payload);
+    AmfString(payload, ctx->stream);
+    AmfString(payload, "live");
+    if ((ret = SendMessage(ctx, RTMP_CID_STREAM, RTMP_MSG_AMF0_COMMAND, ctx->stream_id, 0, payload)) != 0)
+        return ret;
+    return ExpectCommand(ctx, "onStatus", payload, pos);
+}
+
+int srs_h264_write_raw_frames(srs_rtmp_t rtmp, char *frames, int frames_size, u_int32_t dts, u_int32_t pts)
+{
+    Context *ctx = GetContext(rtmp);
+    if (ctx->fd < 0)
+        return ERROR_SOCKET_WRITE;
+
+    //与srs_librtmp相同:参数集重复或帧被丢弃时继续发送后面的nalu,返回最后一个错误
+    int error = 0;
+    const char *pos = frames;
+    const char *end = frames + frames_size;
+    const char *nalu;
+    size_t len;
+    while ((nalu = NextNalu(pos, end, len)) != nullptr)
+    {
+        if (len == 0)
+            continue;
+        int ret = WriteNalu(ctx, nalu, len, dts, pts);
+        if (ret == ERROR_H264_DROP_BEFORE_SPS_PPS || ret == ERROR_H264_DUPLICATED_SPS || ret == ERROR_H264_DUPLICATED_PPS)
+            error = ret;
+        else if (ret != 0)
+            return ret;
+    }
+    return error;
+}
+
+void srs_rtmp_destroy(srs_rtmp_t rtmp)
+{
+    Context *ctx = GetContext(rtmp);
+    if (!ctx)
+        return;
+    if (ctx->fd >= 0)
+        close(ctx->fd);
+    delete ctx;
+}
@@ -0,0 +1,158 @@
+#include "video_detect/tamper_detector.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#define TAMPER_WIDTH 320
+#define TAMPER_HEIGHT 240
+#define TAMPER_STRIDE 336 //按16对齐的VPSS/IVE图像步长
+
+using namespace nvr;
+
+namespace
+{
+
+TamperDetector::Params TamperParams()
+{
+    return {TAMPER_WIDTH, TAMPER_HEIGHT, 0, 12, 40, 50};
+}
+
+//纵向亮度渐变叠加细纹理和固定种子的噪声,分块亮度各不相同
+std::vector<uint8_t> Scene(uint32_t seed)
+{
+    std::vector<uint8_t> luma(TAMPER_STRIDE * TAMPER_HEIGHT);
+    for (int32_t y = 0; y < TAMPER_HEIGHT; y++)
+    {
+        for (int32_t x = 0; x < TAMPER_WIDTH; x++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            luma[y * TAMPER_STRIDE + x] = static_cast<uint8_t>(y * 160 / TAMPER_HEIGHT + x * 20 / TAMPER_WIDTH +
+                                                                (x * 7 + y * 3) % 48 + (seed >> 28));
+        }
+    }
+    return luma;
+}
+
+//5x5均值模糊
+std::vector<uint8_t> Blur(const std::vector<uint8_t> &src)
+{
+    std::vector<uint8_t> dst(src);
+    for (int32_t y = 2; y < TAMPER_HEIGHT - 2; y++)
+    {
+        for (int32_t x = 2; x < TAMPER_WIDTH - 2; x++)
+        {
+            int32_t sum = 0;
+            for (int32_t dy = -2; dy <= 2; dy++)
+            {
+                for (int32_t dx = -2; dx <= 2; dx++)
+                    sum += src[(y + dy) * TAMPER_STRIDE + x + dx];
+            }
+            dst[y * TAMPER_STRIDE + x] = static_cast<uint8_t>(sum / 25);
+        }
+    }
+    return dst;
+}
+
+//上下翻转,分块亮度的分布与原画面不相关
+std::vector<uint8_t> Flip(const std::vector<uint8_t> &src)
+{
+    std::vector<uint8_t> dst(src.size());
+    for (int32_t y = 0; y < TAMPER_HEIGHT; y++)
+        memcpy(&dst[y * TAMPER_STRIDE], &src[(TAMPER_HEIGHT - 1 - y) * TAMPER_STRIDE], TAMPER_STRIDE);
+    return dst;
+}
+
+uint32_t SecondFrame(TamperDetector &detector, const std::vector<uint8_t> &reference, const std::vector<uint8_t> &luma)
+{
+    detector.Process(reference.data(), TAMPER_STRIDE, 0);
+    return detector.Process(luma.data(), TAMPER_STRIDE, 40);
+}
+} // namespace
+
+TEST(TamperDetectorTest, Stats)
+{
+    //左半0右半200:均值100,标准差100
+    std::vector<uint8_t> luma(TAMPER_STRIDE * TAMPER_HEIGHT);
+    for (int32_t y = 0; y < TAMPER_HEIGHT; y++)
+        memset(&luma[y * TAMPER_STRIDE + TAMPER_WIDTH / 2], 200, TAMPER_WIDTH / 2);
+
+    TamperDetector detector;
+    ASSERT_EQ(0, detector.Initialize(TamperParams()));
+    EXPECT_EQ(0u, detector.Process(luma.data(), TAMPER_STRIDE, 0));
+    EXPECT_EQ(100, detector.LastStats().mean);
+    EXPECT_EQ(100, detector.LastStats().stddev);
+    EXPECT_EQ(50, detector.LastStats().peak);
+    EXPECT_EQ(100, detector.LastStats().similarity);
+    EXPECT_EQ(0, detector.LastStats().edge);
+
+    //采样点右边的像素为200:每个采样点横向梯度200
+    for (int32_t y = 0; y < TAMPER_HEIGHT; y++)
+    {
+        for (int32_t x = 0; x < TAMPER_WIDTH; x++)
+            luma[y * TAMPER_STRIDE + x] = x % 4 == 1 ? 200 : 0;
+    }
+    TamperDetector edge;
+    ASSERT_EQ(0, edge.Initialize(TamperParams()));
+    edge.Process(luma.data(), TAMPER_STRIDE, 0);
+    EXPECT_EQ(0, edge.LastStats().mean);
+    EXPECT_EQ(200 * 16, edge.LastStats().edge);
+    EXPECT_EQ(200 * 16, edge.LastStats().ref_edge);
+}
+
+//拷贝采样行后的统计与直接读取完全相同
+TEST(TamperDetectorTest, UncachedMatchesDirect)
+{
+    std::vector<uint8_t> scene = Scene(1), blurred = Blur(scene), other = Flip(scene);
+    TamperDetector direct, uncached;
+    ASSERT_EQ(0, direct.Initialize(TamperParams()));
+    ASSERT_EQ(0, uncached.Initialize(TamperParams()));
+
+    uint64_t now = 0;
+    for (const std::vector<uint8_t> *luma : {&scene, &scene, &blurred, &scene, &other, &other})
+    {
+        now += 40;
+        EXPECT_EQ(direct.Process(luma->data(), TAMPER_STRIDE, now), uncached.ProcessUncached(luma->data(), TAMPER_STRIDE, now));
+        EXPECT_EQ(0, memcmp(&direct.LastStats(), &uncached.LastStats(), sizeof(TamperDetector::Stats)));
+    }
+}
+
+TEST(TamperDetectorTest, DetectsTamper)
+{
+    std::vector<uint8_t> scene = Scene(1);
+
+    TamperDetector covered;
+    ASSERT_EQ(0, covered.Initialize(TamperParams()));
+    std::vector<uint8_t> dark(scene.size(), 20);
+    EXPECT_EQ(1u << KTamperCovered, SecondFrame(covered, scene, dark));
+
+    TamperDetector defocused;
+    ASSERT_EQ(0, defocused.Initialize(TamperParams()));
+    EXPECT_EQ(1u << KTamperDefocused, SecondFrame(defocused, scene, Blur(scene)));
+
+    TamperDetector moved;
+    ASSERT_EQ(0, moved.Initialize(TamperParams()));
+    EXPECT_EQ(1u << KTamperMoved, SecondFrame(moved, scene, Flip(scene)));
+
+    //同一场景的另一帧噪声不报警
+    TamperDetector still;
+    ASSERT_EQ(0, still.Initialize(TamperParams()));
+    EXPECT_EQ(0u, SecondFrame(still, scene, Scene(2)));
+}
+
+//报警持续hold才生效,场景恢复同样时间后解除
+TEST(TamperDetectorTest, Hold)
+{
+    std::vector<uint8_t> scene = Scene(1), dark(scene.size(), 20);
+    TamperDetector::Params params = TamperParams();
+    params.hold = 1000;
+    TamperDetector detector;
+    ASSERT_EQ(0, detector.Initialize(params));
+
+    EXPECT_EQ(0u, detector.Process(scene.data(), TAMPER_STRIDE, 0));
+    EXPECT_EQ(0u, detector.Process(dark.data(), TAMPER_STRIDE, 100));
+    EXPECT_EQ(0u, detector.Process(dark.data(), TAMPER_STRIDE, 1099));
+    EXPECT_EQ(1u << KTamperCovered, detector.Process(dark.data(), TAMPER_STRIDE, 1100));
+    EXPECT_EQ(1u << KTamperCovered, detector.Process(scene.data(), TAMPER_STRIDE, 1200));
+    EXPECT_EQ(0u, detector.Process(scene.data(), TAMPER_STRIDE, 2200));
+}
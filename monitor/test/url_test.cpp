@@ -0,0 +1,51 @@
+#include "common/url.h"
+
+#include <gtest/gtest.h>
+
+using namespace nvr;
+
+//直播,组播和回放使用的地址格式
+TEST(UrlTest, HostAndPort)
+{
+    std::string host;
+    int port = 0;
+    EXPECT_TRUE(ParseUrl("ws://0.0.0.0:8080/live", host, port));
+    EXPECT_EQ("0.0.0.0", host);
+    EXPECT_EQ(8080, port);
+
+    EXPECT_TRUE(ParseUrl("rtp://239.255.0.1:5004", host, port));
+    EXPECT_EQ("239.255.0.1", host);
+    EXPECT_EQ(5004, port);
+
+    EXPECT_TRUE(ParseUrl("rtp://239.255.0.1:5004?iface=127.0.0.1", host, port));
+    EXPECT_EQ("239.255.0.1", host);
+    EXPECT_EQ(5004, port);
+
+    EXPECT_TRUE(ParseUrl("http://0.0.0.0:8081", host, port));
+    EXPECT_EQ("0.0.0.0", host);
+    EXPECT_EQ(8081, port);
+
+    //省略scheme
+    EXPECT_TRUE(ParseUrl("127.0.0.1:1/", host, port));
+    EXPECT_EQ("127.0.0.1", host);
+    EXPECT_EQ(1, port);
+    EXPECT_TRUE(ParseUrl("localhost:65535", host, port));
+    EXPECT_EQ(65535, port);
+}
+
+TEST(UrlTest, Invalid)
+{
+    std::string host;
+    int port = 0;
+    EXPECT_FALSE(ParseUrl("", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0/live", host, port));
+    EXPECT_FALSE(ParseUrl("ws://:8080/live", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:/live", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:0", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:65536", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:4294967297", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:80x", host, port));
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0:-80", host, port));
+    //端口在路径中
+    EXPECT_FALSE(ParseUrl("ws://0.0.0.0/live:8080", host, port));
+}
@@ -0,0 +1,269 @@
+#include "video_detect/video_detect_impl.h"
+#include "video_detect/software_detect.h"
+#include "common/system.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <chrono>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 240
+#define TEST_FRAME_INTERVAL 40000 //帧间隔(us)
+#define TEST_WAIT_TIMEOUT 2000    //等待检测线程的超时(ms)
+
+using namespace nvr;
+
+namespace
+{
+
+//模拟VPSS检测通道输出的一帧,只填充亮度
+class TestFrame
+{
+public:
+    TestFrame(int32_t width, int32_t height) : vir_addr_(nullptr)
+    {
+        memset(&info_, 0, sizeof(info_));
+        info_.stVFrame.u32Width = width;
+        info_.stVFrame.u32Height = height;
+        info_.stVFrame.u32Stride[0] = System::Align(width, 16);
+        info_.stVFrame.enPixelFormat = PIXEL_FORMAT_YUV_SEMIPLANAR_420;
+        EXPECT_EQ(HI_SUCCESS, HI_MPI_SYS_MmzAlloc(&info_.stVFrame.u32PhyAddr[0], (void **)&vir_addr_, NULL, HI_NULL,
+                                                  info_.stVFrame.u32Stride[0] * height * 3 / 2));
+        info_.stVFrame.pVirAddr[0] = vir_addr_;
+    }
+
+    ~TestFrame()
+    {
+        HI_MPI_SYS_MmzFree(info_.stVFrame.u32PhyAddr[0], vir_addr_);
+    }
+
+    //固定纹理的背景
+    void Background()
+    {
+        for (uint32_t y = 0; y < info_.stVFrame.u32Height; y++)
+        {
+            for (uint32_t x = 0; x < info_.stVFrame.u32Width; x++)
+                Pixel(x, y) = static_cast<uint8_t>(64 + ((x / 8 + y / 8) % 2) * 64 + (x * 3 + y * 5) % 32);
+        }
+    }
+
+    void Fill(uint8_t value)
+    {
+        for (uint32_t y = 0; y < info_.stVFrame.u32Height; y++)
+            memset(&Pixel(0, y), value, info_.stVFrame.u32Width);
+    }
+
+    void Square(int32_t left, int32_t top, int32_t size, uint8_t value)
+    {
+        for (int32_t y = top; y < top + size; y++)
+            memset(&Pixel(left, y), value, size);
+    }
+
+    const VIDEO_FRAME_INFO_S &Info(uint64_t pts)
+    {
+        info_.stVFrame.u64pts = pts;
+        return info_;
+    }
+
+private:
+    uint8_t &Pixel(uint32_t x, uint32_t y)
+    {
+        return vir_addr_[y * info_.stVFrame.u32Stride[0] + x];
+    }
+
+private:
+    VIDEO_FRAME_INFO_S info_;
+    uint8_t *vir_addr_;
+};
+
+class TestListener : public DetectListener
+{
+public:
+    TestListener() : triggers(0),
+                     starts(0),
+                     ends(0),
+                     tampers(0),
+                     covered(false)
+    {
+    }
+
+    void OnTrigger(int32_t num) override { triggers++; }
+    void OnMotionStart(const MotionEvent &event) override { starts++; }
+    void OnMotionEnd(uint64_t ts) override { ends++; }
+    void OnTamper(int32_t type, bool active, uint64_t ts) override
+    {
+        if (KTamperCovered == type)
+            covered = active;
+        tampers++;
+    }
+
+    std::atomic<int32_t> triggers;
+    std::atomic<int32_t> starts;
+    std::atomic<int32_t> ends;
+    std::atomic<int32_t> tampers;
+    std::atomic<bool> covered;
+};
+
+VideoDetectModule::Params TestParams()
+{
+    return {1,           //trigger_thresh
+            TEST_WIDTH,  //width
+            TEST_HEIGHT, //height
+            100,         //sad_thresh
+            4,           //block_size
+            16,          //area_thresh
+            {},          //zones
+            0,           //idle_frame_rate
+            0,           //active_frame_rate
+            0,           //active_hold
+            0,           //min_area
+            1,           //confirm_frames
+            1,           //confirm_window
+            0,           //cooldown
+            true,        //tamper
+            0,           //tamper_hold
+            12,          //tamper_covered
+            40,          //tamper_defocus
+            50,          //tamper_moved
+            false,       //illum_compensate
+            0};          //illum_ratio
+}
+
+//IVE实现在检测线程中异步处理,等待第seq个结果发布
+bool WaitResult(VideoDetectModule *module, uint64_t seq, DetectResult &result)
+{
+    uint64_t start = System::GetSteadyMilliSeconds();
+    while (System::GetSteadyMilliSeconds() - start < TEST_WAIT_TIMEOUT)
+    {
+        if (module->GetResult(result) && result.seq >= seq)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+//监听者在自己的回调线程中回调,等待计数达到期望值
+bool WaitCount(const std::atomic<int32_t> &count, int32_t expected)
+{
+    uint64_t start = System::GetSteadyMilliSeconds();
+    while (count < expected && System::GetSteadyMilliSeconds() - start < TEST_WAIT_TIMEOUT)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return count == expected;
+}
+
+//参考帧没有结果可等,留出时间让检测线程取走,避免被下一帧覆盖
+void SubmitReference(VideoDetectModule *module, TestFrame &frame, uint64_t pts)
+{
+    module->OnFrame(frame.Info(pts));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
+} // namespace
+
+TEST(IveDetectTest, ReportsMovingObject)
+{
+    rtc::scoped_refptr<VideoDetectModule> module = VideoDetectImpl::Create(TestParams());
+    ASSERT_TRUE(module != nullptr);
+    TestListener listener;
+    module->AddListener(&listener);
+
+    TestFrame frame(TEST_WIDTH, TEST_HEIGHT);
+    DetectResult result;
+    uint64_t pts = 0;
+
+    //静止帧没有运动
+    frame.Background();
+    SubmitReference(module, frame, pts += TEST_FRAME_INTERVAL);
+    for (uint64_t seq = 1; seq <= 3; seq++)
+    {
+        module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+        ASSERT_TRUE(WaitResult(module, seq, result));
+        EXPECT_FALSE(result.hit);
+        EXPECT_EQ(0, result.event.num);
+    }
+
+    //方块每帧向右移动,运动区域覆盖新旧两个位置
+    for (uint64_t seq = 4; seq <= 6; seq++)
+    {
+        int32_t left = 32 + (seq - 4) * 48;
+        frame.Background();
+        frame.Square(left, 96, 48, 250);
+        module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+        ASSERT_TRUE(WaitResult(module, seq, result));
+        EXPECT_TRUE(result.hit);
+        ASSERT_GT(result.event.count, 0);
+        const DetectRect &rect = result.event.rects[0];
+        EXPECT_LE(rect.left, left);
+        EXPECT_GE(rect.right, left + 47);
+        EXPECT_LE(rect.top, 96);
+        EXPECT_GE(rect.bottom, 96 + 47);
+        EXPECT_EQ(pts, result.event.ts);
+    }
+    EXPECT_TRUE(WaitCount(listener.triggers, 3));
+    EXPECT_EQ(1, listener.starts);
+
+    module->RemoveListener(&listener);
+    module->Close();
+}
+
+TEST(IveDetectTest, DetectsCoveredCamera)
+{
+    rtc::scoped_refptr<VideoDetectModule> module = VideoDetectImpl::Create(TestParams());
+    ASSERT_TRUE(module != nullptr);
+    TestListener listener;
+    module->AddListener(&listener);
+
+    TestFrame frame(TEST_WIDTH, TEST_HEIGHT);
+    DetectResult result;
+    uint64_t pts = 0;
+    uint64_t seq = 0;
+
+    frame.Background();
+    SubmitReference(module, frame, pts += TEST_FRAME_INTERVAL);
+    module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+    ASSERT_TRUE(WaitResult(module, ++seq, result));
+    EXPECT_EQ(0u, result.tamper);
+
+    frame.Fill(20);
+    for (int i = 0; i < 3; i++)
+    {
+        module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+        ASSERT_TRUE(WaitResult(module, ++seq, result));
+    }
+    EXPECT_TRUE(WaitCount(listener.tampers, 1));
+    EXPECT_TRUE(listener.covered);
+    EXPECT_EQ(1u << KTamperCovered, result.tamper);
+
+    module->RemoveListener(&listener);
+    module->Close();
+}
+
+TEST(SoftwareDetectTest, ReportsMovingObject)
+{
+    rtc::scoped_refptr<VideoDetectModule> module = SoftwareVideoDetectImpl::Create(TestParams());
+    ASSERT_TRUE(module != nullptr);
+    TestListener listener;
+    module->AddListener(&listener);
+
+    TestFrame frame(TEST_WIDTH, TEST_HEIGHT);
+    DetectResult result;
+    uint64_t pts = 0;
+
+    frame.Background();
+    for (int i = 0; i < 3; i++)
+        module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+    ASSERT_TRUE(module->GetResult(result));
+    EXPECT_FALSE(result.hit);
+
+    frame.Square(128, 96, 48, 250);
+    module->OnFrame(frame.Info(pts += TEST_FRAME_INTERVAL));
+    ASSERT_TRUE(module->GetResult(result));
+    EXPECT_TRUE(result.hit);
+    ASSERT_GT(result.event.count, 0);
+    EXPECT_LE(result.event.rects[0].left, 128);
+    EXPECT_GE(result.event.rects[0].right, 128 + 47);
+    EXPECT_TRUE(WaitCount(listener.starts, 1));
+
+    module->RemoveListener(&listener);
+    module->Close();
+}
@@ -0,0 +1,100 @@
+#include "common/system.h"
+#include "common/res_code.h"
+#include "record/clip_export.h"
+
+#include <time.h>
+
+using namespace nvr;
+
+//按时间段从录像目录导出一个文件,自动跨越多个录像文件
+//clip_export -d /app/record -b "2026-10-18 14:02:00" -e "2026-10-18 14:07:00" -o clip.mp4 [-f mp4|fmp4]
+//时间也可以是unix时间戳(s)
+static const char *KOpts = "d:b:e:o:f:";
+struct option KLongOpts[] = {
+    {"dir", 1, NULL, 'd'},
+    {"begin", 1, NULL, 'b'},
+    {"end", 1, NULL, 'e'},
+    {"output", 1, NULL, 'o'},
+    {"format", 1, NULL, 'f'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s -d record_dir -b begin -e end -o output.mp4 [-f mp4|fmp4]\n"
+           "time format:\"%%Y-%%m-%%d %%H:%%M:%%S\"(local time) or unix seconds\n",
+           name);
+}
+
+//返回墙上时间(us),解析失败返回0
+static uint64_t ParseTime(const char *str)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(str, "%Y-%m-%d %H:%M:%S", &tm);
+    if (end && *end == '\0')
+    {
+        tm.tm_isdst = -1;
+        time_t sec = mktime(&tm);
+        return sec > 0 ? static_cast<uint64_t>(sec) * 1000000 : 0;
+    }
+
+    char *num_end;
+    double sec = strtod(str, &num_end);
+    if (*num_end != '\0' || sec <= 0)
+        return 0;
+    return static_cast<uint64_t>(sec * 1000000);
+}
+
+int main(int argc, char **argv)
+{
+    err_code code;
+    ClipExporter::Params params;
+    params.begin = 0;
+    params.end = 0;
+    params.format = "mp4";
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            params.path = optarg;
+            break;
+        case 'b':
+            params.begin = ParseTime(optarg);
+            break;
+        case 'e':
+            params.end = ParseTime(optarg);
+            break;
+        case 'o':
+            params.output = optarg;
+            break;
+        case 'f':
+            params.format = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (params.path.empty() || params.output.empty() || params.begin == 0 || params.begin >= params.end ||
+        (params.format != "mp4" && params.format != "fmp4"))
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+    ClipExporter::Result result;
+    code = static_cast<err_code>(ClipExporter::Export(params, result));
+    CHACK_ERROR(code)
+
+    uint64_t cost = System::GetSteadyMilliSeconds() - start_time;
+    log_i("export %s,%u files,%u frames,%llu KB,%.3f-%.3f,%llu ms", params.output.c_str(), result.files, result.frames,
+          (unsigned long long)(result.bytes >> 10), result.begin / 1000000.0, result.end / 1000000.0, (unsigned long long)cost);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "common/system.h"
+#include "video_detect/sad_kernel.h"
+#include "video_detect/motion_detector.h"
+#include "video_detect/tamper_detector.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace nvr;
+
+#define BENCH_LEARN_RATE 128 //与SoftwareVideoDetectImpl一致
+
+//检测内核微基准:固定的合成帧上分别测量标量和当前目标选中的SAD内核,以及完整的软件检测和破坏检测,输出每帧耗时和帧率
+//detect_bench [-s 720x480] [-n 200] [-B 4]
+static const char *KOpts = "s:n:B:";
+struct option KLongOpts[] = {
+    {"size", 1, NULL, 's'},
+    {"frames", 1, NULL, 'n'},
+    {"block-size", 1, NULL, 'B'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s [-s WxH] [-n frames] [-B block_size]\n"
+           "-s:frame size,default 720x480(detect channel)\n"
+           "-n:frames per measurement,default 200\n"
+           "-B:block size of the detector,4 or 8,default 4\n",
+           name);
+}
+
+static bool ParseSize(const char *str, int32_t &width, int32_t &height)
+{
+    return sscanf(str, "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+}
+
+//两帧交替:纹理背景和带一块移动亮块的当前帧,不同帧之间亮块位置不同
+static void MakeFrames(int32_t width, int32_t height, std::vector<std::vector<uint8_t>> &frames)
+{
+    uint32_t seed = 1;
+    std::vector<uint8_t> background(width * height);
+    for (size_t i = 0; i < background.size(); i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        background[i] = static_cast<uint8_t>(64 + (seed >> 26));
+    }
+
+    frames.resize(8);
+    for (size_t n = 0; n < frames.size(); n++)
+    {
+        frames[n] = background;
+        int32_t left = (n * width / 10) % (width - 64);
+        for (int32_t y = height / 3; y < height / 3 + 64 && y < height; y++)
+            memset(&frames[n][y * width + left], 220, 64);
+    }
+}
+
+struct BenchResult
+{
+    double us;  //每帧耗时
+    double fps;
+};
+
+template <typename Func>
+static BenchResult Measure(int32_t count, Func func)
+{
+    //先跑一帧预热缓存
+    func(0);
+    uint64_t begin = System::GetSteadyMicroSeconds();
+    for (int32_t i = 0; i < count; i++)
+        func(i);
+    uint64_t cost = std::max<uint64_t>(1, System::GetSteadyMicroSeconds() - begin);
+    return {static_cast<double>(cost) / count, count * 1000000.0 / cost};
+}
+
+static void Print(const char *kernel, const char *stage, const BenchResult &result)
+{
+    printf("%-8s %-12s %10.1f us/frame %10.1f fps\n", kernel, stage, result.us, result.fps);
+}
+
+static void BenchKernel(const SadKernel &kernel, int32_t width, int32_t height, int32_t count,
+                        const std::vector<std::vector<uint8_t>> &frames)
+{
+    std::vector<uint8_t> bg = frames[0];
+    std::vector<uint8_t> dst(width * height);
+    std::vector<uint16_t> sad(width / 4 + 1);
+    volatile uint32_t sink = 0;
+
+    Print(kernel.name, "sad4x4", Measure(count, [&](int32_t n) {
+              const std::vector<uint8_t> &cur = frames[n % frames.size()];
+              for (int32_t y = 0; y + 4 <= height; y += 4)
+                  kernel.sad4(&cur[y * width], width, &bg[y * width], width, width / 4, sad.data());
+          }));
+    Print(kernel.name, "sad8x8", Measure(count, [&](int32_t n) {
+              const std::vector<uint8_t> &cur = frames[n % frames.size()];
+              for (int32_t y = 0; y + 8 <= height; y += 8)
+                  kernel.sad8(&cur[y * width], width, &bg[y * width], width, width / 8, sad.data());
+          }));
+    Print(kernel.name, "blend", Measure(count, [&](int32_t n) {
+              const std::vector<uint8_t> &cur = frames[n % frames.size()];
+              for (int32_t y = 0; y < height; y++)
+                  kernel.blend(&cur[y * width], &bg[y * width], width, BENCH_LEARN_RATE);
+          }));
+    Print(kernel.name, "sum", Measure(count, [&](int32_t n) {
+              const std::vector<uint8_t> &cur = frames[n % frames.size()];
+              uint32_t sum = 0;
+              for (int32_t y = 0; y < height; y++)
+                  sum += kernel.sum(&cur[y * width], width);
+              sink = sum;
+          }));
+    Print(kernel.name, "gain", Measure(count, [&](int32_t n) {
+              const std::vector<uint8_t> &cur = frames[n % frames.size()];
+              for (int32_t y = 0; y < height; y++)
+                  kernel.gain(&cur[y * width], &dst[y * width], width, 300);
+          }));
+}
+
+int main(int argc, char **argv)
+{
+    int32_t width = DETECT_WIDTH, height = DETECT_HEIGHT;
+    int32_t count = 200, block_size = 4;
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            if (!ParseSize(optarg, width, height))
+            {
+                Usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'B':
+            block_size = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (count <= 0 || (block_size != 4 && block_size != 8) || width < 64 || height < 64)
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    std::vector<std::vector<uint8_t>> frames;
+    MakeFrames(width, height, frames);
+
+    printf("%dx%d,%d frames per measurement\n", width, height, count);
+    BenchKernel(GetScalarSadKernel(), width, height, count, frames);
+    if (&GetSadKernel() != &GetScalarSadKernel())
+        BenchKernel(GetSadKernel(), width, height, count, frames);
+
+    //完整的软件检测流程,使用当前目标选中的内核
+    std::vector<DetectRect> regions;
+    for (bool illum : {false, true})
+    {
+        MotionDetector detector;
+        if (0 != detector.Initialize({width, height, block_size, 150, BENCH_LEARN_RATE, 4, illum}))
+            return -1;
+        Print(detector.KernelName(), illum ? "detect+illum" : "detect", Measure(count, [&](int32_t n) {
+                  detector.Process(frames[n % frames.size()].data(), width, regions);
+              }));
+    }
+
+    TamperDetector tamper;
+    if (0 != tamper.Initialize({width, height, 10000, 12, 40, 50}))
+        return -1;
+    Print("-", "tamper", Measure(count, [&](int32_t n) {
+              tamper.Process(frames[n % frames.size()].data(), width, n * 40);
+          }));
+    //IVE实现的路径:先拷贝采样行,在板上输入是不带cache的MMZ,主机上只能测出拷贝本身的开销
+    Print("-", "tamper+copy", Measure(count, [&](int32_t n) {
+              tamper.ProcessUncached(frames[n % frames.size()].data(), width, n * 40);
+          }));
+
+    return 0;
+}
@@ -0,0 +1,609 @@
+#include "common/system.h"
+#include "common/res_code.h"
+#include "common/config.h"
+#include "video_detect/motion_detector.h"
+#include "video_detect/detect_dispatcher.h"
+#include "video_detect/tamper_detector.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+using namespace nvr;
+
+#define REPLAY_LEARN_RATE 128 //与SoftwareVideoDetectImpl一致
+
+//离线回放YUV文件做移动侦测,用于调参和性能测试,检测流程与软件检测实现相同(不调用海思接口)
+//detect_replay -i walk.y4m [-c config.json] [-o timeline.csv|timeline.json]
+//detect_replay -i walk.yuv -f nv12 -s 1920x1080 -r 25 -z 720x480 -S 150 -o timeline.json
+//-c读取配置文件中的detect参数,命令行参数覆盖配置,-t开启破坏检测,-L开启亮度补偿
+static const char *KOpts = "i:f:s:r:z:c:o:S:B:A:T:M:D:tLI:";
+struct option KLongOpts[] = {
+    {"input", 1, NULL, 'i'},
+    {"format", 1, NULL, 'f'},
+    {"size", 1, NULL, 's'},
+    {"fps", 1, NULL, 'r'},
+    {"detect-size", 1, NULL, 'z'},
+    {"config", 1, NULL, 'c'},
+    {"output", 1, NULL, 'o'},
+    {"sad-thresh", 1, NULL, 'S'},
+    {"block-size", 1, NULL, 'B'},
+    {"area-thresh", 1, NULL, 'A'},
+    {"trigger-thresh", 1, NULL, 'T'},
+    {"min-area", 1, NULL, 'M'},
+    {"detect-rate", 1, NULL, 'D'},
+    {"tamper", 0, NULL, 't'},
+    {"illum-compensate", 0, NULL, 'L'},
+    {"illum-ratio", 1, NULL, 'I'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s -i input [-f nv12|i420|y4m] [-s WxH] [-r fps] [-z WxH] [-c config.json] [-o timeline.csv|timeline.json]\n"
+           "       [-S sad_thresh] [-B block_size] [-A area_thresh] [-T trigger_thresh] [-M min_area] [-D detect_rate] [-t] [-L] [-I illum_ratio]\n"
+           "-s/-r:input size and frame rate,read from the header for y4m\n"
+           "-z:detect size,input is scaled to it,default input size(or detect size in config)\n"
+           "-D:detect frame rate,input frames are dropped down to it,0 detects every frame\n"
+           "-t:enable tamper detection(covered,defocused,moved)\n"
+           "-L:compensate global illumination change before SAD\n"
+           "-I:suppress the frame when changed area exceeds this percentage,0 disables\n",
+           name);
+}
+
+static bool ParseSize(const char *str, int32_t &width, int32_t &height)
+{
+    return 2 == sscanf(str, "%dx%d", &width, &height) && width > 0 && height > 0;
+}
+
+//只读取亮度,NV12和I420的亮度平面相同,区别只在色度
+class YUVReader
+{
+public:
+    YUVReader() : fp_(nullptr),
+                  width_(0),
+                  height_(0),
+                  fps_(0),
+                  chroma_size_(0),
+                  y4m_(false)
+    {
+    }
+
+    ~YUVReader()
+    {
+        if (fp_)
+            fclose(fp_);
+    }
+
+    int32_t Open(const std::string &path, bool y4m, int32_t width, int32_t height, double fps)
+    {
+        fp_ = fopen(path.c_str(), "rb");
+        if (!fp_)
+        {
+            log_e("open %s failed,%s", path.c_str(), strerror(errno));
+            return static_cast<int>(KSystemError);
+        }
+
+        y4m_ = y4m;
+        width_ = width;
+        height_ = height;
+        fps_ = fps;
+        chroma_size_ = width * height / 2;
+        if (y4m_ && !ReadY4MHeader())
+            return static_cast<int>(KSystemError);
+
+        if (width_ <= 0 || height_ <= 0)
+        {
+            log_e("unknown input size,use -s WxH");
+            return static_cast<int>(KSystemError);
+        }
+        return static_cast<int>(KSuccess);
+    }
+
+    //读到文件尾返回false
+    bool Read(std::vector<uint8_t> &luma)
+    {
+        if (y4m_)
+        {
+            char line[256];
+            if (!fgets(line, sizeof(line), fp_))
+                return false;
+            if (strncmp(line, "FRAME", 5) != 0)
+            {
+                log_e("bad y4m frame header");
+                return false;
+            }
+        }
+
+        luma.resize(width_ * height_);
+        if (fread(luma.data(), 1, luma.size(), fp_) != luma.size())
+            return false;
+        return chroma_size_ == 0 || 0 == fseek(fp_, chroma_size_, SEEK_CUR);
+    }
+
+    int32_t Width() const { return width_; }
+
+    int32_t Height() const { return height_; }
+
+    double Fps() const { return fps_; }
+
+private:
+    //YUV4MPEG2 W720 H480 F25:1 Ip A1:1 C420jpeg
+    bool ReadY4MHeader()
+    {
+        char line[512];
+        if (!fgets(line, sizeof(line), fp_) || strncmp(line, "YUV4MPEG2", 9) != 0)
+        {
+            log_e("not a y4m file");
+            return false;
+        }
+
+        std::string colorspace = "420";
+        char *save = nullptr;
+        for (char *token = strtok_r(line + 9, " \n", &save); token; token = strtok_r(nullptr, " \n", &save))
+        {
+            int num, den;
+            if ('W' == token[0])
+                width_ = atoi(token + 1);
+            else if ('H' == token[0])
+                height_ = atoi(token + 1);
+            else if ('F' == token[0] && 2 == sscanf(token + 1, "%d:%d", &num, &den) && den > 0)
+                fps_ = static_cast<double>(num) / den;
+            else if ('C' == token[0])
+                colorspace = token + 1;
+        }
+
+        if (0 == colorspace.compare(0, 4, "mono"))
+            chroma_size_ = 0;
+        else if (0 == colorspace.compare(0, 3, "420"))
+            chroma_size_ = (width_ + 1) / 2 * ((height_ + 1) / 2) * 2;
+        else
+        {
+            log_e("unsupported y4m colorspace %s", colorspace.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    FILE *fp_;
+    int32_t width_;
+    int32_t height_;
+    double fps_;
+    long chroma_size_;
+    bool y4m_;
+};
+
+//记录一帧的回调,回调在监听者线程中执行,主循环分发后等待该帧的OnResult再写入时间线
+class ReplayListener : public DetectListener
+{
+public:
+    ReplayListener() : start_(false),
+                       end_(false),
+                       seq_(0),
+                       events_(0),
+                       tampers_(0)
+    {
+    }
+
+    void OnResult(const DetectResult &result) override
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        result_ = result;
+        seq_ = result.seq;
+        cond_.notify_all();
+    }
+
+    void OnTrigger(int32_t num) override
+    {
+    }
+
+    void OnMotionStart(const MotionEvent &event) override
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        start_ = true;
+        events_++;
+    }
+
+    void OnMotionEnd(uint64_t ts) override
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        end_ = true;
+    }
+
+    void OnTamper(int32_t type, bool active, uint64_t ts) override
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        if (active)
+            tampers_++;
+    }
+
+    //等待第seq帧回调完成,取出结果和事件动作
+    void Wait(uint64_t seq, DetectResult &result, const char *&action)
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        cond_.wait(lock, [this, seq]() { return seq_ >= seq; });
+        result = result_;
+        action = start_ ? "start" : (end_ ? "end" : "");
+        start_ = false;
+        end_ = false;
+    }
+
+    int32_t Events()
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        return events_;
+    }
+
+    int32_t Tampers()
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        return tampers_;
+    }
+
+private:
+    std::mutex mux_;
+    std::condition_variable cond_;
+    DetectResult result_;
+    bool start_;
+    bool end_;
+    uint64_t seq_;
+    int32_t events_;
+    int32_t tampers_;
+};
+
+class TimelineWriter
+{
+public:
+    TimelineWriter() : fp_(nullptr),
+                       json_(false),
+                       rows_(0)
+    {
+    }
+
+    ~TimelineWriter()
+    {
+        Close();
+    }
+
+    int32_t Open(const std::string &path)
+    {
+        fp_ = fopen(path.c_str(), "w");
+        if (!fp_)
+        {
+            log_e("open %s failed,%s", path.c_str(), strerror(errno));
+            return static_cast<int>(KSystemError);
+        }
+
+        json_ = path.size() > 5 && 0 == path.compare(path.size() - 5, 5, ".json");
+        if (json_)
+            fprintf(fp_, "[\n");
+        else
+            fprintf(fp_, "frame,ts_ms,regions,num,zones,sad_score,motion_ratio,hit,active,event,gain,suppressed,tamper,stddev,edge,ref_edge,similarity,left,top,right,bottom\n");
+        return static_cast<int>(KSuccess);
+    }
+
+    void Write(int64_t frame, size_t regions, const DetectResult &result, const char *action, int32_t gain,
+               const TamperDetector::Stats &stats)
+    {
+        if (!fp_)
+            return;
+
+        const MotionEvent &event = result.event;
+        if (json_)
+        {
+            fprintf(fp_, "%s{\"frame\":%lld,\"ts_ms\":%llu,\"regions\":%d,\"num\":%d,\"zones\":%u,\"sad_score\":%u,"
+                         "\"motion_ratio\":%u,\"hit\":%s,\"active\":%s,\"event\":\"%s\",\"gain\":%d,\"suppressed\":%s,\"tamper\":%u,"
+                         "\"stddev\":%d,\"edge\":%d,\"ref_edge\":%d,\"similarity\":%d,\"rects\":[",
+                    rows_ ? ",\n" : "", (long long)frame, (unsigned long long)(event.ts / 1000), static_cast<int>(regions),
+                    event.num, result.zones, result.sad_score, result.motion_ratio,
+                    result.hit ? "true" : "false", result.active ? "true" : "false", action, gain, result.suppressed ? "true" : "false", result.tamper,
+                    stats.stddev, stats.edge, stats.ref_edge, stats.similarity);
+            for (int i = 0; i < event.count; i++)
+            {
+                const DetectRect &rect = event.rects[i];
+                fprintf(fp_, "%s[%d,%d,%d,%d,%u,%d]", i ? "," : "", rect.left, rect.top, rect.right, rect.bottom, rect.area, rect.zone);
+            }
+            fprintf(fp_, "]}");
+        }
+        else
+        {
+            fprintf(fp_, "%lld,%llu,%d,%d,%u,%u,%u,%d,%d,%s,%d,%d,%u,%d,%d,%d,%d", (long long)frame, (unsigned long long)(event.ts / 1000),
+                    static_cast<int>(regions), event.num, result.zones, result.sad_score, result.motion_ratio,
+                    result.hit, result.active, action, gain, result.suppressed, result.tamper,
+                    stats.stddev, stats.edge, stats.ref_edge, stats.similarity);
+            //只输出最大的区域
+            if (event.count > 0)
+                fprintf(fp_, ",%d,%d,%d,%d\n", event.rects[0].left, event.rects[0].top, event.rects[0].right, event.rects[0].bottom);
+            else
+                fprintf(fp_, ",,,,\n");
+        }
+        rows_++;
+    }
+
+    void Close()
+    {
+        if (!fp_)
+            return;
+        if (json_)
+            fprintf(fp_, "\n]\n");
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+
+private:
+    FILE *fp_;
+    bool json_;
+    int64_t rows_;
+};
+
+//最近邻缩放到检测分辨率,与VPSS的滤波缩放有差别,调参时注意
+static void Scale(const std::vector<uint8_t> &src, int32_t src_width, int32_t src_height,
+                  std::vector<uint8_t> &dst, int32_t dst_width, int32_t dst_height, const std::vector<int32_t> &xmap)
+{
+    for (int32_t y = 0; y < dst_height; y++)
+    {
+        const uint8_t *row = &src[(y * src_height / dst_height) * src_width];
+        uint8_t *out = &dst[y * dst_width];
+        for (int32_t x = 0; x < dst_width; x++)
+            out[x] = row[xmap[x]];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    err_code code;
+    std::string input, format, config, output;
+    int32_t width = 0, height = 0;
+    int32_t detect_width = 0, detect_height = 0;
+    double fps = 25;
+    //命令行参数,-1表示使用配置
+    int32_t sad_thresh = -1, block_size = -1, area_thresh = -1, trigger_thresh = -1, min_area = -1, detect_rate = -1;
+    bool tamper = false, illum_compensate = false;
+    int32_t illum_ratio = -1;
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            input = optarg;
+            break;
+        case 'f':
+            format = optarg;
+            break;
+        case 's':
+            if (!ParseSize(optarg, width, height))
+            {
+                Usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'r':
+            fps = atof(optarg);
+            break;
+        case 'z':
+            if (!ParseSize(optarg, detect_width, detect_height))
+            {
+                Usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'c':
+            config = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'S':
+            sad_thresh = atoi(optarg);
+            break;
+        case 'B':
+            block_size = atoi(optarg);
+            break;
+        case 'A':
+            area_thresh = atoi(optarg);
+            break;
+        case 'T':
+            trigger_thresh = atoi(optarg);
+            break;
+        case 'M':
+            min_area = atoi(optarg);
+            break;
+        case 'D':
+            detect_rate = atoi(optarg);
+            break;
+        case 't':
+            tamper = true;
+            break;
+        case 'L':
+            illum_compensate = true;
+            break;
+        case 'I':
+            illum_ratio = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (format.empty())
+        format = input.size() > 4 && 0 == input.compare(input.size() - 4, 4, ".y4m") ? "y4m" : "nv12";
+    if (input.empty() || fps <= 0 || (format != "nv12" && format != "i420" && format != "y4m"))
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    if (!config.empty())
+    {
+        code = static_cast<err_code>(Config::Instance()->ReadConfigFile(config));
+        CHACK_ERROR(code)
+        if (0 == detect_width)
+        {
+            detect_width = Config::Instance()->detect.width;
+            detect_height = Config::Instance()->detect.height;
+        }
+    }
+    const Config::Detect &detect = Config::Instance()->detect;
+
+    YUVReader reader;
+    code = static_cast<err_code>(reader.Open(input, "y4m" == format, width, height, fps));
+    CHACK_ERROR(code)
+    width = reader.Width();
+    height = reader.Height();
+    fps = reader.Fps();
+    if (0 == detect_width)
+    {
+        detect_width = width;
+        detect_height = height;
+    }
+    if (detect_width > width || detect_height > height)
+    {
+        log_e("detect size %dx%d larger than input %dx%d", detect_width, detect_height, width, height);
+        return -1;
+    }
+    if (detect_rate < 0)
+        detect_rate = config.empty() ? 0 : (detect.idle_frame_rate > 0 ? detect.idle_frame_rate : detect.frame_rate);
+
+    //自适应帧率需要控制VPSS,回放时固定为detect_rate
+    VideoDetectModule::Params params = {trigger_thresh >= 0 ? trigger_thresh : detect.trigger_thresh,
+                                        detect_width,
+                                        detect_height,
+                                        sad_thresh >= 0 ? sad_thresh : detect.sad_thresh,
+                                        block_size >= 0 ? block_size : detect.block_size,
+                                        area_thresh >= 0 ? area_thresh : detect.area_thresh,
+                                        {},
+                                        0,
+                                        0,
+                                        0,
+                                        min_area >= 0 ? min_area : detect.min_area,
+                                        detect.confirm_frames,
+                                        detect.confirm_window,
+                                        detect.cooldown,
+                                        tamper || detect.tamper,
+                                        detect.tamper_hold,
+                                        detect.tamper_covered,
+                                        detect.tamper_defocus,
+                                        detect.tamper_moved,
+                                        illum_compensate || detect.illum_compensate,
+                                        illum_ratio >= 0 ? illum_ratio : detect.illum_ratio};
+    for (const Config::Detect::Zone &zone : detect.zones)
+        params.zones.push_back({zone.name, zone.exclude, zone.points, zone.trigger_thresh});
+
+    MotionDetector detector;
+    code = static_cast<err_code>(detector.Initialize({params.width,
+                                                      params.height,
+                                                      params.block_size,
+                                                      params.sad_thresh,
+                                                      REPLAY_LEARN_RATE,
+                                                      params.area_thresh,
+                                                      params.illum_compensate}));
+    CHACK_ERROR(code)
+
+    DetectDispatcher dispatcher;
+    code = static_cast<err_code>(dispatcher.Initialize(params));
+    CHACK_ERROR(code)
+    if (!dispatcher.Zones().Empty())
+        detector.SetMask(dispatcher.Zones().Bitmap());
+
+    TamperDetector tamper_detector;
+    if (params.tamper)
+    {
+        code = static_cast<err_code>(tamper_detector.Initialize({params.width,
+                                                                 params.height,
+                                                                 params.tamper_hold,
+                                                                 params.tamper_covered,
+                                                                 params.tamper_defocus,
+                                                                 params.tamper_moved}));
+        CHACK_ERROR(code)
+    }
+
+    ReplayListener listener;
+    dispatcher.AddListener(&listener);
+
+    TimelineWriter timeline;
+    if (!output.empty())
+    {
+        code = static_cast<err_code>(timeline.Open(output));
+        CHACK_ERROR(code)
+    }
+
+    log_i("replay %s %dx%d@%.2f %s,detect %dx%d@%d,sad_thresh:%d,block_size:%d,area_thresh:%d,trigger_thresh:%d,min_area:%d,"
+          "illum_compensate:%d,illum_ratio:%d,kernel:%s",
+          input.c_str(), width, height, fps, format.c_str(), detect_width, detect_height, detect_rate, params.sad_thresh,
+          params.block_size, params.area_thresh, params.trigger_thresh, params.min_area, params.illum_compensate,
+          params.illum_ratio, detector.KernelName());
+
+    std::vector<uint8_t> frame, scaled;
+    std::vector<int32_t> xmap;
+    bool scale = detect_width != width || detect_height != height;
+    if (scale)
+    {
+        scaled.resize(detect_width * detect_height);
+        xmap.resize(detect_width);
+        for (int32_t x = 0; x < detect_width; x++)
+            xmap[x] = x * width / detect_width;
+    }
+
+    std::vector<DetectRect> regions;
+    int64_t frames = 0, processed = 0, active = 0, compensated = 0, suppressed = 0;
+    uint64_t next_ts = 0, cost = 0, tamper_cost = 0;
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+    while (reader.Read(frame))
+    {
+        //帧时间(us),与VPSS帧的pts单位相同
+        uint64_t ts = static_cast<uint64_t>(frames * 1000000 / fps);
+        frames++;
+        if (detect_rate > 0)
+        {
+            if (ts < next_ts)
+                continue;
+            next_ts += 1000000 / detect_rate;
+        }
+
+        uint64_t begin = System::GetSteadyMicroSeconds();
+        if (scale)
+            Scale(frame, width, height, scaled, detect_width, detect_height, xmap);
+        const std::vector<uint8_t> &luma = scale ? scaled : frame;
+        uint64_t tamper_begin = System::GetSteadyMicroSeconds();
+        dispatcher.UpdateTamper(ts, tamper_detector.Process(luma.data(), detect_width, ts / 1000));
+        tamper_cost += System::GetSteadyMicroSeconds() - tamper_begin;
+        detector.Process(luma.data(), detect_width, regions);
+        dispatcher.Dispatch(ts, regions, detector.SadScore(), ts / 1000);
+        if (dispatcher.Suppressed())
+            detector.Reset();
+        cost += System::GetSteadyMicroSeconds() - begin;
+
+        processed++;
+        DetectResult result;
+        const char *action;
+        listener.Wait(processed, result, action);
+        timeline.Write(frames - 1, regions.size(), result, action, detector.Gain(), tamper_detector.LastStats());
+        if (result.active)
+            active++;
+        if (detector.Gain() != 256)
+            compensated++;
+        if (result.suppressed)
+            suppressed++;
+    }
+    timeline.Close();
+    dispatcher.RemoveListener(&listener);
+
+    uint64_t total = System::GetSteadyMilliSeconds() - start_time;
+    double duration = frames / fps;
+    log_i("frames:%lld,detected:%lld,active:%lld,events:%d,tamper alarms:%d,compensated:%lld,suppressed:%lld,duration:%.1f s",
+          (long long)frames, (long long)processed, (long long)active, listener.Events(), listener.Tampers(),
+          (long long)compensated, (long long)suppressed, duration);
+    log_i("detect:%.3f ms/frame,%.1f fps,total %llu ms,%.1fx realtime",
+          processed ? cost / 1000.0 / processed : 0, cost ? processed * 1000000.0 / cost : 0,
+          (unsigned long long)total, total ? duration * 1000 / total : 0);
+    if (params.tamper)
+        log_i("tamper:%.3f ms/frame,%.1f%% of detect", processed ? tamper_cost / 1000.0 / processed : 0,
+              cost ? tamper_cost * 100.0 / cost : 0);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "common/system.h"
+#include "common/res_code.h"
+#include "record/es_reader.h"
+#include "record/mp4_muxer.h"
+#include "record/fmp4_muxer.h"
+
+#include <memory>
+
+using namespace nvr;
+
+//裸码流录像导出为mp4/fmp4
+//es_export -i record_14_00_00.es -o clip.mp4 [-b 开始秒数] [-e 结束秒数] [-f mp4|fmp4]
+static const char *KOpts = "i:o:b:e:f:";
+struct option KLongOpts[] = {
+    {"input", 1, NULL, 'i'},
+    {"output", 1, NULL, 'o'},
+    {"begin", 1, NULL, 'b'},
+    {"end", 1, NULL, 'e'},
+    {"format", 1, NULL, 'f'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s -i input.es -o output.mp4 [-b begin(s)] [-e end(s)] [-f mp4|fmp4]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    err_code code;
+    std::string input, output, format = "mp4";
+    uint64_t begin = 0, end = UINT64_MAX;
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            input = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'b':
+            begin = static_cast<uint64_t>(atof(optarg) * 1000000);
+            break;
+        case 'e':
+            end = static_cast<uint64_t>(atof(optarg) * 1000000);
+            break;
+        case 'f':
+            format = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (input.empty() || output.empty() || begin >= end)
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    EsReader reader;
+    code = static_cast<err_code>(reader.Open(input));
+    CHACK_ERROR(code)
+
+    std::unique_ptr<Muxer> muxer;
+    if (format == "fmp4")
+        muxer.reset(new FMP4Muxer(FileWriter::Params{1024 * 1024, 0, FILE_WRITER_NO_SYNC, 0}));
+    else
+        muxer.reset(new MP4Muxer());
+    code = static_cast<err_code>(muxer->Initialize(output, reader.Width(), reader.Height(), reader.FrameRate()));
+    CHACK_ERROR(code)
+
+    //从begin之前最近的关键帧开始,end之后的第一个GOP结束
+    reader.Seek(begin);
+
+    uint64_t start_time = System::GetSteadyMilliSeconds();
+    uint32_t frames = 0;
+    uint64_t bytes = 0;
+    VideoFrame frame;
+    bool meta;
+    while (KSuccess == static_cast<err_code>(reader.Next(frame, meta)))
+    {
+        if (meta)
+        {
+            if (frame.ts >= begin && frame.ts <= end)
+                muxer->WriteMetadata(frame.ts, std::string(reinterpret_cast<const char *>(frame.data), frame.len));
+            continue;
+        }
+
+        if (frame.ts > end && frame.type == H264Frame::NaluType::SPS)
+            break;
+
+        bytes += frame.len;
+        frames++;
+        code = static_cast<err_code>(muxer->WriteVideoFrame(frame));
+        if (KSuccess != code)
+        {
+            log_e("write %s failed,error:%s", output.c_str(), make_error_code(code).message().c_str());
+            break;
+        }
+    }
+    muxer->Close();
+
+    log_i("export %s to %s,%u frames,%llu KB,%llu ms", input.c_str(), output.c_str(), frames,
+          (unsigned long long)(bytes >> 10), (unsigned long long)(System::GetSteadyMilliSeconds() - start_time));
+    return 0;
+}
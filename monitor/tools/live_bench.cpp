@@ -0,0 +1,249 @@
+#include "common/system.h"
+#include "live/rtmp.h"
+#include "test/stub/rtmp_server.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+using namespace nvr;
+
+//直播推流基准:在本地回环地址启动RTMP接收服务(代替SRS),按帧率回放.h264文件驱动RtmpLiveImpl,
+//依次在每个链路速率下推流固定时长,读取TakeStats统计发送的nalu/s,KB/s,入队到发送完成的延迟和丢弃数,
+//以及接收端的帧率,速率和到达时间落后于时间戳的最大值
+//每个I/P帧nalu为一帧,之前的SPS/PPS/SEI使用同一时间戳,文件不够长时循环回放
+//live_bench -i stream.h264 [-r 25] [-t 10] [-l 128,256,512,0]
+//不指定-i时合成固定码率的码流
+static const char *KOpts = "i:r:t:l:b:g:";
+struct option KLongOpts[] = {
+    {"input", 1, NULL, 'i'},
+    {"fps", 1, NULL, 'r'},
+    {"time", 1, NULL, 't'},
+    {"links", 1, NULL, 'l'},
+    {"bitrate", 1, NULL, 'b'},
+    {"gop", 1, NULL, 'g'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s [-i input.h264] [-r fps] [-t seconds] [-l KB/s,...] [-b kbps] [-g gop]\n"
+           "-i:annex b h264 file,replayed in a loop,default synthetic stream\n"
+           "-r:frame rate,default 25\n"
+           "-t:seconds of each link speed,default 10\n"
+           "-l:link speeds(KB/s),0 unlimited,default 128,256,512,1024,0\n"
+           "-b:bitrate of the synthetic stream(kbps),default 2048\n"
+           "-g:gop of the synthetic stream,default 50\n",
+           name);
+}
+
+struct Nalu
+{
+    std::vector<uint8_t> data; //带起始码
+    int32_t type;
+};
+
+static bool IsVcl(int32_t type)
+{
+    return type == H264Frame::NaluType::PSLICE || type == H264Frame::NaluType::ISLICE;
+}
+
+//按起始码切分文件,每个nalu保留四字节起始码
+static bool LoadStream(const std::string &path, std::vector<Nalu> &stream)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+
+    size_t pos = 0;
+    while (pos + 3 <= data.size())
+    {
+        if (!(data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1))
+        {
+            pos++;
+            continue;
+        }
+        size_t begin = pos + 3;
+        size_t end = begin;
+        while (end + 3 <= data.size() && !(data[end] == 0 && data[end + 1] == 0 && data[end + 2] == 1))
+            end++;
+        if (end + 3 > data.size())
+            end = data.size();
+        pos = end;
+        //四字节起始码的第一个0属于下一个起始码
+        while (end != data.size() && end > begin && data[end - 1] == 0)
+            end--;
+        if (end == begin)
+            continue;
+
+        Nalu nalu;
+        nalu.data.assign({0, 0, 0, 1});
+        nalu.data.insert(nalu.data.end(), data.begin() + begin, data.begin() + end);
+        nalu.type = data[begin] & 0x1f;
+        stream.push_back(nalu);
+    }
+    return !stream.empty();
+}
+
+//一个GOP的合成码流:SPS,PPS,I帧为P帧的8倍,负载不含0避免出现起始码
+static void SynthesizeStream(int32_t bitrate, int32_t gop, int32_t fps, std::vector<Nalu> &stream)
+{
+    static const uint8_t KSps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10};
+    static const uint8_t KPps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+    uint32_t p_size = bitrate * 1000 / 8 / fps * gop / (gop + 7);
+
+    stream.push_back({std::vector<uint8_t>(KSps, KSps + sizeof(KSps)), H264Frame::NaluType::SPS});
+    stream.push_back({std::vector<uint8_t>(KPps, KPps + sizeof(KPps)), H264Frame::NaluType::PPS});
+    uint32_t seed = 1;
+    for (int32_t i = 0; i < gop; i++)
+    {
+        bool key = i == 0;
+        Nalu nalu;
+        nalu.type = key ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE;
+        nalu.data.resize(key ? p_size * 8 : p_size);
+        for (size_t j = 0; j < nalu.data.size(); j++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            nalu.data[j] = static_cast<uint8_t>(seed >> 24) | 0x01;
+        }
+        nalu.data[0] = nalu.data[1] = nalu.data[2] = 0;
+        nalu.data[3] = 1;
+        nalu.data[4] = key ? 0x65 : 0x41;
+        stream.push_back(nalu);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string input;
+    std::string links = "128,256,512,1024,0";
+    int32_t fps = 25, seconds = 10, bitrate = 2048, gop = 50;
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            input = optarg;
+            break;
+        case 'r':
+            fps = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        case 'l':
+            links = optarg;
+            break;
+        case 'b':
+            bitrate = atoi(optarg);
+            break;
+        case 'g':
+            gop = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+    if (fps <= 0 || seconds <= 0 || bitrate <= 0 || gop <= 0)
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    std::vector<uint32_t> rates;
+    std::stringstream ss(links);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        rates.push_back(atoi(item.c_str()));
+
+    std::vector<Nalu> stream;
+    if (input.empty())
+    {
+        SynthesizeStream(bitrate, gop, fps, stream);
+    }
+    else if (!LoadStream(input, stream))
+    {
+        printf("load %s failed\n", input.c_str());
+        return -1;
+    }
+
+    uint64_t stream_bytes = 0, stream_frames = 0;
+    for (const Nalu &nalu : stream)
+    {
+        stream_bytes += nalu.data.size();
+        stream_frames += IsVcl(nalu.type) ? 1 : 0;
+    }
+    if (stream_frames == 0)
+    {
+        printf("no I/P frame in %s\n", input.c_str());
+        return -1;
+    }
+    printf("stream %s,%llu nalus,%llu frames,%d fps,%.1f KB/s\n", input.empty() ? "synthetic" : input.c_str(),
+           (unsigned long long)stream.size(), (unsigned long long)stream_frames, fps,
+           stream_bytes * fps / 1024.0 / stream_frames);
+
+    for (uint32_t rate : rates)
+    {
+        RtmpServer server;
+        if (0 != server.Initialize(0, rate))
+        {
+            printf("start rtmp server failed\n");
+            return -1;
+        }
+        rtc::scoped_refptr<LiveModule> live = RtmpLiveImpl::Create({server.Url(), fps, 0, 0, "", 0});
+        if (!live)
+        {
+            printf("create rtmp live failed\n");
+            return -1;
+        }
+
+        //按帧率送帧,落后时不等待
+        uint64_t ts = 0, frames = 0;
+        uint64_t begin = System::GetSteadyMicroSeconds();
+        uint64_t end = begin + seconds * 1000000ull;
+        for (size_t i = 0; System::GetSteadyMicroSeconds() < end; i = (i + 1) % stream.size())
+        {
+            VideoFrame frame;
+            frame.data = stream[i].data.data();
+            frame.len = stream[i].data.size();
+            frame.ts = ts;
+            frame.type = stream[i].type;
+            live->OnFrame(frame);
+            if (!IsVcl(stream[i].type))
+                continue;
+
+            frames++;
+            ts = frames * 1000000 / fps;
+            uint64_t now = System::GetSteadyMicroSeconds();
+            if (begin + ts > now)
+                std::this_thread::sleep_for(std::chrono::microseconds(begin + ts - now));
+        }
+        double elapsed = (System::GetSteadyMicroSeconds() - begin) / 1000000.0;
+        RtmpLiveImpl::Stats stats = static_cast<RtmpLiveImpl *>(live.get())->TakeStats();
+        RtmpServer::Stats received = server.GetStats();
+        live->Close();
+        server.Close();
+
+        std::string link = rate ? std::to_string(rate) + " KB/s" : std::string("unlimited");
+        printf("link %-10s sent %.1f nalu/s %.1f KB/s,latency avg %llu us max %llu us,drops %llu,reconnects %llu,"
+               "received %.1f fps %.1f KB/s,lag max %llu ms\n",
+               link.c_str(), stats.frames / elapsed, stats.bytes / 1024.0 / elapsed,
+               (unsigned long long)(stats.frames ? stats.latency_sum_us / stats.frames : 0),
+               (unsigned long long)stats.latency_max_us, (unsigned long long)stats.drops,
+               (unsigned long long)stats.reconnects, received.nalus / elapsed, received.bytes / 1024.0 / elapsed,
+               (unsigned long long)received.lag_max_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "common/system.h"
+#include "common/res_code.h"
+#include "record/mp4_recovery.h"
+
+using namespace nvr;
+
+//恢复掉电时未关闭的mp4录像
+//mp4_recover -d /app/record [-n 天数]      检查录像目录下最近n天的文件
+//mp4_recover -i record_14_00_00.mp4 -c /app/record [-r 帧率]
+static const char *KOpts = "i:d:n:c:r:";
+struct option KLongOpts[] = {
+    {"input", 1, NULL, 'i'},
+    {"dir", 1, NULL, 'd'},
+    {"days", 1, NULL, 'n'},
+    {"codec", 1, NULL, 'c'},
+    {"rate", 1, NULL, 'r'},
+    {0, 0, 0, 0}};
+
+static void Usage(const char *name)
+{
+    printf("usage:%s -d record_dir [-n days] | -i input.mp4 -c record_dir [-r frame_rate]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    err_code code;
+    std::string input, dir, codec_dir;
+    int days = 365;
+    int frame_rate = 0;
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            input = optarg;
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        case 'n':
+            days = atoi(optarg);
+            break;
+        case 'c':
+            codec_dir = optarg;
+            break;
+        case 'r':
+            frame_rate = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (input.empty() == dir.empty())
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    //编码参数默认从录像根目录读取,单个文件位于根目录/日期目录下
+    if (codec_dir.empty() && !dir.empty())
+        codec_dir = dir;
+    if (codec_dir.empty())
+    {
+        std::string parent = input.substr(0, input.find_last_of('/') + 1) + "..";
+        codec_dir = parent;
+    }
+    MP4Recovery::Codec codec;
+    code = static_cast<err_code>(MP4Recovery::LoadCodec(codec_dir, codec));
+    if (KSuccess != code)
+    {
+        log_e("load %s/%s failed", codec_dir.c_str(), RECORD_CODEC_FILE);
+        return static_cast<int>(code);
+    }
+    if (frame_rate > 0)
+        codec.frame_rate = frame_rate;
+
+    std::vector<std::string> files;
+    if (!dir.empty())
+        MP4Recovery::FindBroken(dir, days, files);
+    else
+        files.push_back(input);
+
+    int failed = 0;
+    for (const std::string &filename : files)
+    {
+        MP4Recovery recovery;
+        code = static_cast<err_code>(recovery.Open(filename));
+        if (KSuccess == code && !recovery.Broken())
+        {
+            log_i("%s is complete", filename.c_str());
+            continue;
+        }
+        if (KSuccess == code)
+            code = static_cast<err_code>(recovery.Recover(codec));
+        if (KSuccess != code)
+            failed++;
+    }
+
+    log_i("%zu files checked,%d failed", files.size(), failed);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,524 @@
+#include "common/system.h"
+#include "record/file_writer.h"
+#include "record/es_muxer.h"
+#include "record/fmp4_muxer.h"
+#include "record/mp4_muxer.h"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+using namespace nvr;
+
+//录像写入基准:合成固定码率的码流,在录像线程中逐帧写入,统计每帧耗时(p50/p99/max)和吞吐
+//慢速磁盘:本程序替换pwrite/write/fwrite/fdatasync,对普通文件的每次调用按固定延迟和带宽休眠,模拟SD卡
+//块设备模型(-P):写入只弄脏页缓存,fdatasync时按闪存页编程所有脏页,不足一页也编程整页,统计写放大(编程字节/文件大小)
+//record_bench [-m writer|direct|es|fmp4|mp4] [-n 750] [-b 2048] [-g 50] [-x 4] [-L us] [-R KB/s] [-S us] [-P KB] [-o file] [-E rewrites]
+static const char *KOpts = "m:n:b:g:x:L:R:S:P:c:a:i:o:E:";
+struct option KLongOpts[] = {
+    {"mode", 1, NULL, 'm'},
+    {"frames", 1, NULL, 'n'},
+    {"bitrate", 1, NULL, 'b'},
+    {"gop", 1, NULL, 'g'},
+    {"speed", 1, NULL, 'x'},
+    {"latency", 1, NULL, 'L'},
+    {"bandwidth", 1, NULL, 'R'},
+    {"sync-latency", 1, NULL, 'S'},
+    {"page-size", 1, NULL, 'P'},
+    {"chunk-size", 1, NULL, 'c'},
+    {"align-size", 1, NULL, 'a'},
+    {"sync-interval", 1, NULL, 'i'},
+    {"output", 1, NULL, 'o'},
+    {"max-rewrites", 1, NULL, 'E'},
+    {0, 0, 0, 0}};
+
+#define BENCH_FRAME_RATE 25
+
+static void Usage(const char *name)
+{
+    printf("usage:%s [-m mode] [-n frames] [-b kbps] [-g gop] [-x speed] [-L us] [-R KB/s] [-S us] [-P KB] [-c KB] [-a KB] [-i ms] [-o file] [-E rewrites]\n"
+           "-m:writer(FileWriter,write-behind),direct(write and fdatasync in the record thread),\n"
+           "   es,fmp4 or mp4(WriteVideoFrame of the muxer,SPS/PPS before each key frame),default writer\n"
+           "-n:frames,default 750(30s at 25fps)\n"
+           "-b:bitrate(kbps),default 2048\n"
+           "-g:gop,default 50\n"
+           "-x:speed relative to real time,0 writes as fast as possible,default 4\n"
+           "-L:slow disk,latency of each write(us),default 0\n"
+           "-R:slow disk,bandwidth(KB/s),0 unlimited,default 0\n"
+           "-S:slow disk,latency of each fdatasync(us),default 0\n"
+           "-P:block device,flash page size(KB),dirty pages are programmed on fdatasync and -R applies to programmed bytes,\n"
+           "   0 disables the model,default 0\n"
+           "-c:chunk size(KB),default 2048\n"
+           "-a:align size(KB),default 64\n"
+           "-i:sync interval(ms),default 2000\n"
+           "-o:output file,default record_bench.out\n"
+           "-E:with -P,exit with failure when more pages than this are rewritten,-1 disables,default -1\n",
+           name);
+}
+
+//慢速磁盘参数,只作用于普通文件,标准输出和标准错误除外
+struct SlowDisk
+{
+    uint32_t latency;   //us
+    uint32_t bandwidth; //KB/s
+    uint32_t sync;      //us
+    uint32_t page;      //闪存页大小(字节),0为不模拟块设备
+    std::atomic<uint64_t> writes;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> syncs;
+};
+
+//块设备模型中的一个文件
+struct DeviceFile
+{
+    DeviceFile() : size(0) {}
+
+    std::set<uint64_t> dirty;      //上次同步后写过的页
+    std::set<uint64_t> programmed; //编程过至少一次的页
+    uint64_t size;
+};
+
+struct Device
+{
+    Device() : programs(0), rewrites(0) {}
+
+    std::mutex mux;
+    std::map<ino_t, DeviceFile> files;
+    uint64_t programs; //编程的页数
+    uint64_t rewrites; //再次编程同一页的次数
+};
+
+static SlowDisk slow_disk;
+static Device device;
+
+static bool IsDiskFile(int fd, ino_t &ino)
+{
+    struct stat st;
+    if (fd <= STDERR_FILENO || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    ino = st.st_ino;
+    return true;
+}
+
+static void DiskDelay(uint64_t us)
+{
+    if (us)
+        usleep(us);
+}
+
+static uint64_t TransferTime(uint64_t bytes)
+{
+    return slow_disk.bandwidth ? bytes * 1000000ull / (slow_disk.bandwidth * 1024ull) : 0;
+}
+
+//offset为写入后的文件位置减去写入长度,stdio的写入在缓存中,按逻辑位置计
+static void DiskWrite(int fd, uint64_t offset, ssize_t bytes)
+{
+    ino_t ino;
+    if (bytes <= 0 || !IsDiskFile(fd, ino))
+        return;
+    slow_disk.writes++;
+    slow_disk.bytes += bytes;
+    if (!slow_disk.page)
+    {
+        DiskDelay(slow_disk.latency + TransferTime(bytes));
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(device.mux);
+        DeviceFile &file = device.files[ino];
+        for (uint64_t page = offset / slow_disk.page; page <= (offset + bytes - 1) / slow_disk.page; page++)
+            file.dirty.insert(page);
+        file.size = std::max<uint64_t>(file.size, offset + bytes);
+    }
+    DiskDelay(slow_disk.latency);
+}
+
+//编程文件的所有脏页,返回编程的字节数
+static uint64_t Program(DeviceFile &file)
+{
+    for (uint64_t page : file.dirty)
+    {
+        if (!file.programmed.insert(page).second)
+            device.rewrites++;
+    }
+    device.programs += file.dirty.size();
+    uint64_t bytes = file.dirty.size() * static_cast<uint64_t>(slow_disk.page);
+    file.dirty.clear();
+    return bytes;
+}
+
+extern "C" ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    static auto real = reinterpret_cast<ssize_t (*)(int, const void *, size_t, off_t)>(dlsym(RTLD_NEXT, "pwrite"));
+    ssize_t ret = real(fd, buf, count, offset);
+    DiskWrite(fd, offset, ret);
+    return ret;
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count)
+{
+    static auto real = reinterpret_cast<ssize_t (*)(int, const void *, size_t)>(dlsym(RTLD_NEXT, "write"));
+    ssize_t ret = real(fd, buf, count);
+    if (ret > 0)
+        DiskWrite(fd, lseek(fd, 0, SEEK_CUR) - ret, ret);
+    return ret;
+}
+
+//mp4v2通过stdio写文件
+extern "C" size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    static auto real = reinterpret_cast<size_t (*)(const void *, size_t, size_t, FILE *)>(dlsym(RTLD_NEXT, "fwrite"));
+    size_t ret = real(ptr, size, nmemb, stream);
+    if (ret > 0)
+        DiskWrite(fileno(stream), ftello(stream) - ret * size, ret * size);
+    return ret;
+}
+
+extern "C" int fdatasync(int fd)
+{
+    static auto real = reinterpret_cast<int (*)(int)>(dlsym(RTLD_NEXT, "fdatasync"));
+    int ret = real(fd);
+    ino_t ino;
+    if (IsDiskFile(fd, ino))
+    {
+        slow_disk.syncs++;
+        uint64_t bytes = 0;
+        if (slow_disk.page)
+        {
+            std::unique_lock<std::mutex> lock(device.mux);
+            bytes = Program(device.files[ino]);
+        }
+        DiskDelay(slow_disk.sync + TransferTime(bytes));
+    }
+    return ret;
+}
+
+//固定码率的合成帧,I帧为P帧的8倍
+class FrameSource
+{
+public:
+    FrameSource(int32_t bitrate, int32_t gop) : gop_(gop), count_(0)
+    {
+        uint32_t average = bitrate * 1000 / 8 / BENCH_FRAME_RATE;
+        p_size_ = average * gop / (gop + 7);
+        i_size_ = p_size_ * 8;
+        buf_.resize(i_size_);
+        uint32_t seed = 1;
+        for (size_t i = 0; i < buf_.size(); i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            buf_[i] = static_cast<uint8_t>(seed >> 24);
+        }
+    }
+
+    bool Key() const { return count_ % gop_ == 0; }
+
+    uint32_t Size() const { return Key() ? i_size_ : p_size_; }
+
+    const uint8_t *Data() const { return buf_.data(); }
+
+    void Next() { count_++; }
+
+private:
+    int32_t gop_;
+    uint32_t count_;
+    uint32_t i_size_;
+    uint32_t p_size_;
+    std::vector<uint8_t> buf_;
+};
+
+//录像线程的写入方式
+class Sink
+{
+public:
+    virtual ~Sink() {}
+    virtual int32_t Open(const std::string &filename) = 0;
+    virtual int32_t Write(const FrameSource &source) = 0;
+    virtual void Close() = 0;
+};
+
+//写入缓存,GOP结束时Commit,IO线程写盘
+class WriterSink : public Sink
+{
+public:
+    explicit WriterSink(const FileWriter::Params &params) : params_(params) {}
+
+    int32_t Open(const std::string &filename) override { return writer_.Initialize(filename, params_); }
+
+    int32_t Write(const FrameSource &source) override
+    {
+        if (source.Key())
+        {
+            int32_t ret = writer_.Commit();
+            if (ret != 0)
+                return ret;
+        }
+        return writer_.Write(source.Data(), source.Size());
+    }
+
+    void Close() override { writer_.Close(); }
+
+private:
+    FileWriter::Params params_;
+    FileWriter writer_;
+};
+
+//录像线程直接write,GOP结束时到达同步周期则fdatasync
+class DirectSink : public Sink
+{
+public:
+    explicit DirectSink(uint32_t sync_interval) : fd_(-1), sync_interval_(sync_interval), last_sync_(0) {}
+
+    int32_t Open(const std::string &filename) override
+    {
+        fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        last_sync_ = System::GetSteadyMilliSeconds();
+        return fd_ < 0 ? -1 : 0;
+    }
+
+    int32_t Write(const FrameSource &source) override
+    {
+        if (source.Key() && System::GetSteadyMilliSeconds() >= last_sync_ + sync_interval_)
+        {
+            fdatasync(fd_);
+            last_sync_ = System::GetSteadyMilliSeconds();
+        }
+        return write(fd_, source.Data(), source.Size()) == static_cast<ssize_t>(source.Size()) ? 0 : -1;
+    }
+
+    void Close() override
+    {
+        fdatasync(fd_);
+        close(fd_);
+    }
+
+private:
+    int fd_;
+    uint32_t sync_interval_;
+    uint64_t last_sync_;
+};
+
+//录像文件封装:与录像线程一样逐帧调用WriteVideoFrame,关键帧前写入SPS/PPS
+class MuxerSink : public Sink
+{
+public:
+    explicit MuxerSink(Muxer *muxer) : muxer_(muxer), ts_(0) {}
+
+    int32_t Open(const std::string &filename) override { return muxer_->Initialize(filename, 1280, 720, BENCH_FRAME_RATE); }
+
+    int32_t Write(const FrameSource &source) override
+    {
+        static const uint8_t KSps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10,
+                                       0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0, 0xf1, 0x83, 0x19, 0x60};
+        static const uint8_t KPps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+        int32_t ret;
+        if (source.Key())
+        {
+            if (0 != (ret = WriteNalu(H264Frame::NaluType::SPS, KSps, sizeof(KSps), sps_)) ||
+                0 != (ret = WriteNalu(H264Frame::NaluType::PPS, KPps, sizeof(KPps), pps_)))
+                return ret;
+        }
+        std::vector<uint8_t> &nalu = source.Key() ? key_ : delta_;
+        if (nalu.size() != source.Size())
+        {
+            nalu.assign(source.Data(), source.Data() + source.Size());
+            nalu[4] = source.Key() ? 0x65 : 0x41;
+        }
+        ret = WriteNalu(source.Key() ? H264Frame::NaluType::ISLICE : H264Frame::NaluType::PSLICE, nullptr, 0, nalu);
+        ts_ += 1000000 / BENCH_FRAME_RATE;
+        return ret;
+    }
+
+    void Close() override { muxer_->Close(); }
+
+private:
+    //封装时可能把起始码原地改为长度前缀,每次写入前恢复
+    int32_t WriteNalu(int32_t type, const uint8_t *data, uint32_t len, std::vector<uint8_t> &buf)
+    {
+        if (data)
+            buf.assign(data, data + len);
+        buf[0] = buf[1] = buf[2] = 0;
+        buf[3] = 1;
+
+        VideoFrame frame;
+        frame.data = buf.data();
+        frame.len = buf.size();
+        frame.ts = ts_;
+        frame.type = type;
+        return muxer_->WriteVideoFrame(frame);
+    }
+
+private:
+    std::unique_ptr<Muxer> muxer_;
+    uint64_t ts_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    std::vector<uint8_t> key_;
+    std::vector<uint8_t> delta_;
+};
+
+static uint64_t Percentile(std::vector<uint32_t> &costs, double p)
+{
+    if (costs.empty())
+        return 0;
+    size_t n = std::min(costs.size() - 1, static_cast<size_t>(costs.size() * p));
+    std::nth_element(costs.begin(), costs.begin() + n, costs.end());
+    return costs[n];
+}
+
+int main(int argc, char **argv)
+{
+    std::string mode = "writer";
+    std::string output = "record_bench.out";
+    int32_t frames = 750, bitrate = 2048, gop = 50;
+    int64_t max_rewrites = -1;
+    double speed = 4;
+    FileWriter::Params params = {2048 * 1024, 0, 2000, 64 * 1024};
+
+    System::InitLogger();
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, KOpts, KLongOpts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            mode = optarg;
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        case 'b':
+            bitrate = atoi(optarg);
+            break;
+        case 'g':
+            gop = atoi(optarg);
+            break;
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'L':
+            slow_disk.latency = atoi(optarg);
+            break;
+        case 'R':
+            slow_disk.bandwidth = atoi(optarg);
+            break;
+        case 'S':
+            slow_disk.sync = atoi(optarg);
+            break;
+        case 'P':
+            slow_disk.page = atoi(optarg) * 1024;
+            break;
+        case 'c':
+            params.chunk_size = atoi(optarg) * 1024;
+            break;
+        case 'a':
+            params.align_size = atoi(optarg) * 1024;
+            break;
+        case 'i':
+            params.sync_interval = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'E':
+            max_rewrites = atoll(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::unique_ptr<Sink> sink;
+    if (mode == "writer")
+        sink.reset(new WriterSink(params));
+    else if (mode == "direct")
+        sink.reset(new DirectSink(params.sync_interval));
+    else if (mode == "es")
+        sink.reset(new MuxerSink(new EsMuxer(params)));
+    else if (mode == "fmp4")
+        sink.reset(new MuxerSink(new FMP4Muxer(params)));
+    else if (mode == "mp4")
+        sink.reset(new MuxerSink(new MP4Muxer()));
+    if (!sink || frames <= 0 || bitrate <= 0 || gop <= 0 || speed < 0)
+    {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    if (0 != sink->Open(output))
+    {
+        printf("open %s failed\n", output.c_str());
+        return -1;
+    }
+
+    FrameSource source(bitrate, gop);
+    std::vector<uint32_t> costs;
+    costs.reserve(frames);
+    uint64_t bytes = 0;
+    uint64_t interval = speed > 0 ? static_cast<uint64_t>(1000000 / BENCH_FRAME_RATE / speed) : 0;
+    uint64_t begin = System::GetSteadyMicroSeconds();
+    for (int32_t i = 0; i < frames; i++, source.Next())
+    {
+        //按帧率送帧,落后时不等待
+        uint64_t now = System::GetSteadyMicroSeconds();
+        if (begin + i * interval > now)
+            usleep(begin + i * interval - now);
+
+        uint64_t start = System::GetSteadyMicroSeconds();
+        if (0 != sink->Write(source))
+        {
+            printf("write frame %d failed\n", i);
+            return -1;
+        }
+        costs.push_back(static_cast<uint32_t>(System::GetSteadyMicroSeconds() - start));
+        bytes += source.Size();
+    }
+    uint64_t write_end = System::GetSteadyMicroSeconds();
+    sink->Close();
+    uint64_t end = System::GetSteadyMicroSeconds();
+
+    //未同步的脏页最终由内核回写,各编程一次,不计入耗时
+    uint64_t file_size = 0;
+    for (auto &file : device.files)
+    {
+        Program(file.second);
+        file_size += file.second.size;
+    }
+    unlink(output.c_str());
+    unlink((output + RECORD_ES_INDEX_SUFFIX).c_str());
+
+    uint64_t max = *std::max_element(costs.begin(), costs.end());
+    printf("mode %s,%d frames,%d kbps,gop %d,speed %.1fx,disk latency %u us,bandwidth %u KB/s,sync %u us\n",
+           mode.c_str(), frames, bitrate, gop, speed, slow_disk.latency, slow_disk.bandwidth, slow_disk.sync);
+    printf("frame write  p50 %llu us  p99 %llu us  max %llu us\n",
+           (unsigned long long)Percentile(costs, 0.5), (unsigned long long)Percentile(costs, 0.99), (unsigned long long)max);
+    printf("throughput   %.2f MB/s(record thread) %.2f MB/s(including close),%.2f MB,%llu disk writes,%llu syncs,close %llu ms\n",
+           bytes / static_cast<double>(std::max<uint64_t>(1, write_end - begin)),
+           bytes / static_cast<double>(std::max<uint64_t>(1, end - begin)), bytes / 1048576.0,
+           (unsigned long long)slow_disk.writes, (unsigned long long)slow_disk.syncs,
+           (unsigned long long)((end - write_end) / 1000));
+    if (slow_disk.page)
+        printf("device       page %u KB,%.2f MB files,%.2f MB programmed,write amplification %.3f,%llu rewritten pages,%.2f MB/s\n",
+               slow_disk.page / 1024, file_size / 1048576.0, device.programs * static_cast<double>(slow_disk.page) / 1048576.0,
+               file_size ? device.programs * static_cast<double>(slow_disk.page) / file_size : 0,
+               (unsigned long long)device.rewrites, file_size / static_cast<double>(std::max<uint64_t>(1, end - begin)));
+    if (slow_disk.page && max_rewrites >= 0 && device.rewrites > static_cast<uint64_t>(max_rewrites))
+    {
+        printf("%llu rewritten pages exceed %lld\n", (unsigned long long)device.rewrites, (long long)max_rewrites);
+        return 1;
+    }
+    return 0;
+}
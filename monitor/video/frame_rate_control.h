@@ -0,0 +1,20 @@
+#ifndef FRAME_RATE_CONTROL_H_
+#define FRAME_RATE_CONTROL_H_
+
+#include <stdint.h>
+
+namespace nvr
+{
+
+//由帧源实现,接收端按自身状态调整送帧速率
+class FrameRateControlInterface
+{
+public:
+    virtual ~FrameRateControlInterface() = default;
+
+    virtual int32_t SetFrameRate(int32_t frame_rate) = 0;
+};
+
+} // namespace nvr
+
+#endif
@@ -0,0 +1,223 @@
+#include "video_detect/detect_dispatcher.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#include <algorithm>
+
+namespace nvr
+{
+
+DetectDispatcher::DetectDispatcher() : listeners_(new ListenerList()),
+                                       seq_(0),
+                                       tamper_(0),
+                                       zones_(new DetectZoneMap()),
+                                       width_(0),
+                                       height_(0),
+                                       min_area_(0),
+                                       illum_ratio_(0),
+                                       suppressed_(false),
+                                       init_(false)
+{
+}
+
+DetectDispatcher::~DetectDispatcher()
+{
+    Close();
+}
+
+int32_t DetectDispatcher::Initialize(const VideoDetectModule::Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+
+    std::shared_ptr<DetectZoneMap> zones = std::make_shared<DetectZoneMap>();
+    code = static_cast<err_code>(zones->Initialize(params.width, params.height, params.block_size, params.zones, params.trigger_thresh));
+    if (KSuccess != code)
+        return code;
+    zones_ = zones;
+
+    rate_.Initialize({params.idle_frame_rate, params.active_frame_rate, params.active_hold});
+    state_.Initialize({params.confirm_frames, params.confirm_window, params.cooldown});
+
+    width_ = params.width;
+    height_ = params.height;
+    min_area_ = params.min_area;
+    illum_ratio_ = params.illum_ratio;
+    suppressed_ = false;
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void DetectDispatcher::Close()
+{
+    if (!init_)
+        return;
+
+    std::shared_ptr<const ListenerList> listeners;
+    list_mux_.lock();
+    listeners = listeners_;
+    listeners_ = std::make_shared<const ListenerList>();
+    list_mux_.unlock();
+    for (const std::shared_ptr<ListenerQueue> &queue : *listeners)
+        queue->Stop();
+
+    zones_ = std::make_shared<const DetectZoneMap>();
+    state_.Reset();
+    tamper_ = 0;
+    suppressed_ = false;
+    init_ = false;
+}
+
+void DetectDispatcher::AddListener(DetectListener *listener)
+{
+    if (!listener)
+        return;
+
+    std::unique_lock<std::mutex> lock(list_mux_);
+    for (const std::shared_ptr<ListenerQueue> &queue : *listeners_)
+    {
+        if (queue->Listener() == listener)
+            return;
+    }
+    std::shared_ptr<ListenerQueue> queue = std::make_shared<ListenerQueue>(listener);
+    queue->Start();
+    std::shared_ptr<ListenerList> listeners = std::make_shared<ListenerList>(*listeners_);
+    listeners->push_back(queue);
+    listeners_ = listeners;
+}
+
+void DetectDispatcher::RemoveListener(DetectListener *listener)
+{
+    std::shared_ptr<ListenerQueue> removed;
+    {
+        std::unique_lock<std::mutex> lock(list_mux_);
+        std::shared_ptr<ListenerList> listeners = std::make_shared<ListenerList>();
+        for (const std::shared_ptr<ListenerQueue> &queue : *listeners_)
+        {
+            if (queue->Listener() == listener)
+                removed = queue;
+            else
+                listeners->push_back(queue);
+        }
+        listeners_ = listeners;
+    }
+
+    //在锁外等待进行中的回调结束,回调中移除监听者不会死锁
+    if (removed)
+        removed->Stop();
+}
+
+void DetectDispatcher::SetRateControl(FrameRateControlInterface *control)
+{
+    rate_.SetControl(control);
+}
+
+void DetectDispatcher::Dispatch(uint64_t ts, const std::vector<DetectRect> &regions, uint32_t sad_score)
+{
+    Dispatch(ts, regions, sad_score, System::GetSteadyMilliSeconds());
+}
+
+void DetectDispatcher::Dispatch(uint64_t ts, const std::vector<DetectRect> &regions, uint32_t sad_score, uint64_t now)
+{
+    DetectResult result;
+    MotionEvent &event = result.event;
+    int32_t counts[DETECT_MAX_ZONES] = {0};
+    uint64_t area = 0;
+    event.ts = ts;
+    event.width = width_;
+    event.height = height_;
+    event.num = 0;
+    event.count = 0;
+
+    for (const DetectRect &rect : regions)
+    {
+        if (rect.area < static_cast<uint32_t>(min_area_))
+            continue;
+        if (zones_->Collect(rect, event, counts))
+            area += rect.area;
+    }
+
+    //检测范围内大面积同时变化(开关灯,云遮挡)不是运动,本帧不参与触发;
+    //按过滤后的运动面积和检测范围的面积计算,排除区域和零星小区域不计入
+    uint32_t active_area = zones_->ActiveArea();
+    bool suppressed = illum_ratio_ > 0 && active_area > 0 && area * 100 >= static_cast<uint64_t>(illum_ratio_) * active_area;
+    if (suppressed != suppressed_)
+    {
+        log_i("global illumination change %s,changed area %llu/%u", suppressed ? "suppressed" : "ended",
+              (unsigned long long)area, active_area);
+        suppressed_ = suppressed;
+    }
+    if (suppressed)
+    {
+        event.num = 0;
+        event.count = 0;
+        memset(counts, 0, sizeof(counts));
+        area = 0;
+    }
+
+    uint32_t zones = 0;
+    bool hit = zones_->Evaluate(event, counts, zones);
+    MotionStateMachine::Action action = state_.Update(hit, now);
+
+    result.seq = ++seq_;
+    result.zones = zones;
+    result.sad_score = sad_score;
+    result.motion_ratio = static_cast<uint16_t>(std::min<uint64_t>(1000, area * 1000 / (width_ * height_)));
+    result.hit = hit;
+    result.active = state_.Active();
+    result.tamper = tamper_;
+    result.suppressed = suppressed;
+    snapshot_.Publish(result);
+
+    log_d("move objs num:%d,in zones:%d,hit:%d,action:%d", static_cast<int>(regions.size()), event.num, hit, action);
+
+    ListenerQueue::Notification notification;
+    notification.result = result;
+    notification.action = action;
+    memcpy(notification.counts, counts, sizeof(counts));
+    notification.tamper_changed = 0;
+    notification.zones = zones_;
+    Publish(notification);
+
+    rate_.Update(event.num > 0, now);
+}
+
+void DetectDispatcher::UpdateTamper(uint64_t ts, uint32_t state)
+{
+    static const char *KTamperNames[KTamperNum] = {"covered", "defocused", "moved"};
+
+    uint32_t changed = state ^ tamper_;
+    tamper_ = state;
+    if (0 == changed)
+        return;
+
+    for (int type = 0; type < KTamperNum; type++)
+    {
+        if (changed & (1u << type))
+            log_w("camera %s %s", KTamperNames[type], (state & (1u << type)) ? "detected" : "cleared");
+    }
+
+    ListenerQueue::Notification notification;
+    memset(&notification.result.event, 0, sizeof(notification.result.event));
+    notification.result.event.ts = ts;
+    notification.result.tamper = state;
+    notification.action = MotionStateMachine::KNone;
+    notification.tamper_changed = changed;
+    Publish(notification);
+}
+
+void DetectDispatcher::Publish(const ListenerQueue::Notification &notification)
+{
+    std::shared_ptr<const ListenerList> listeners;
+    list_mux_.lock();
+    listeners = listeners_;
+    list_mux_.unlock();
+
+    for (const std::shared_ptr<ListenerQueue> &queue : *listeners)
+        queue->Push(notification);
+}
+} // namespace nvr
@@ -0,0 +1,77 @@
+#ifndef DETECT_DISPATCHER_H_
+#define DETECT_DISPATCHER_H_
+
+#include "video_detect/video_detect.h"
+#include "video_detect/detect_zone.h"
+#include "video_detect/detect_rate.h"
+#include "video_detect/motion_state.h"
+#include "video_detect/detect_snapshot.h"
+#include "video_detect/listener_queue.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nvr
+{
+
+//检测结果的公共后处理,IVE和软件实现共用:面积和区域过滤,触发判断,事件状态机,通知监听者,调整检测帧率
+class DetectDispatcher
+{
+public:
+    DetectDispatcher();
+
+    ~DetectDispatcher();
+
+    int32_t Initialize(const VideoDetectModule::Params &params);
+
+    void Close();
+
+    const DetectZoneMap &Zones() const { return *zones_; }
+
+    void AddListener(DetectListener *listener);
+
+    void RemoveListener(DetectListener *listener);
+
+    bool GetResult(DetectResult &result) const { return snapshot_.Read(result); }
+
+    void SetRateControl(FrameRateControlInterface *control);
+
+    //处理一帧的全部运动区域,坐标为检测分辨率像素,sad_score由检测实现提供
+    void Dispatch(uint64_t ts, const std::vector<DetectRect> &regions, uint32_t sad_score);
+
+    //now为状态机和帧率控制使用的单调时间(ms),离线回放时用帧时间代替系统时钟
+    void Dispatch(uint64_t ts, const std::vector<DetectRect> &regions, uint32_t sad_score, uint64_t now);
+
+    //上一帧是否因整体亮度变化被抑制
+    bool Suppressed() const { return suppressed_; }
+
+    //更新破坏报警状态,变化的类型通知监听者,在同一帧的Dispatch之前调用
+    void UpdateTamper(uint64_t ts, uint32_t state);
+
+private:
+    typedef std::vector<std::shared_ptr<ListenerQueue>> ListenerList;
+
+    //把通知放入每个监听者的队列,list_mux_只在复制列表时持有
+    void Publish(const ListenerQueue::Notification &notification);
+
+private:
+    //监听者列表写时复制,每个监听者在自己的线程中回调,检测线程只入队
+    std::mutex list_mux_;
+    std::shared_ptr<const ListenerList> listeners_;
+    DetectSnapshot snapshot_;
+    uint64_t seq_;
+    uint32_t tamper_;
+    std::shared_ptr<const DetectZoneMap> zones_; //随通知交给监听者线程,重新初始化时替换而不修改
+    DetectRateController rate_;
+    MotionStateMachine state_;
+    int32_t width_;
+    int32_t height_;
+    int32_t min_area_;
+    int32_t illum_ratio_;
+    bool suppressed_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
@@ -0,0 +1,63 @@
+#include "video_detect/detect_rate.h"
+#include "common/res_code.h"
+
+#include <string.h>
+
+namespace nvr
+{
+
+DetectRateController::DetectRateController() : control_(nullptr),
+                                               frame_rate_(0),
+                                               last_motion_(0)
+{
+    memset(&params_, 0, sizeof(params_));
+}
+
+void DetectRateController::Initialize(const Params &params)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    params_ = params;
+    frame_rate_ = params.idle_frame_rate;
+    last_motion_ = 0;
+}
+
+void DetectRateController::SetControl(FrameRateControlInterface *control)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    control_ = control;
+    //重新挂接时帧源处于初始帧率
+    frame_rate_ = params_.idle_frame_rate;
+}
+
+void DetectRateController::Update(bool motion, uint64_t now)
+{
+    if (params_.idle_frame_rate <= 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mux_);
+    if (!control_)
+        return;
+
+    int32_t frame_rate = frame_rate_;
+    if (motion)
+    {
+        last_motion_ = now;
+        frame_rate = params_.active_frame_rate;
+    }
+    else if (now - last_motion_ >= static_cast<uint64_t>(params_.active_hold))
+    {
+        frame_rate = params_.idle_frame_rate;
+    }
+
+    if (frame_rate == frame_rate_)
+        return;
+
+    if (KSuccess != static_cast<err_code>(control_->SetFrameRate(frame_rate)))
+    {
+        log_e("set detect frame rate %d failed", frame_rate);
+        return;
+    }
+    log_i("detect frame rate %d -> %d", frame_rate_, frame_rate);
+    frame_rate_ = frame_rate;
+}
+} // namespace nvr
@@ -0,0 +1,42 @@
+#ifndef DETECT_RATE_H_
+#define DETECT_RATE_H_
+
+#include "video/frame_rate_control.h"
+
+#include <mutex>
+
+namespace nvr
+{
+
+//检测帧率自适应:空闲时低帧率,出现运动立即切到高帧率,运动停止hold时间后回到低帧率
+class DetectRateController
+{
+public:
+    struct Params
+    {
+        int32_t idle_frame_rate; //0为关闭,帧率保持不变
+        int32_t active_frame_rate;
+        int32_t active_hold; //ms
+    };
+
+    DetectRateController();
+
+    void Initialize(const Params &params);
+
+    void SetControl(FrameRateControlInterface *control);
+
+    //每处理一帧调用一次,motion为过滤后是否有运动区域
+    void Update(bool motion, uint64_t now);
+
+    int32_t FrameRate() const { return frame_rate_; }
+
+private:
+    std::mutex mux_;
+    Params params_;
+    FrameRateControlInterface *control_;
+    int32_t frame_rate_;
+    uint64_t last_motion_;
+};
+} // namespace nvr
+
+#endif
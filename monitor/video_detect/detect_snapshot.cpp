@@ -0,0 +1,39 @@
+#include "video_detect/detect_snapshot.h"
+
+#include <string.h>
+
+namespace nvr
+{
+
+DetectSnapshot::DetectSnapshot() : seq_(0)
+{
+    memset(&result_, 0, sizeof(result_));
+}
+
+void DetectSnapshot::Publish(const DetectResult &result)
+{
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&result_, &result, sizeof(result_));
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+bool DetectSnapshot::Read(DetectResult &result) const
+{
+    uint32_t begin, end;
+    do
+    {
+        begin = seq_.load(std::memory_order_acquire);
+        if (0 == begin)
+            return false;
+        if (begin & 1)
+            continue;
+        memcpy(&result, &result_, sizeof(result));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = seq_.load(std::memory_order_relaxed);
+    } while ((begin & 1) || begin != end);
+
+    return true;
+}
+} // namespace nvr
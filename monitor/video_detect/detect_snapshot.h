@@ -0,0 +1,28 @@
+#ifndef DETECT_SNAPSHOT_H_
+#define DETECT_SNAPSHOT_H_
+
+#include "video_detect/video_detect.h"
+
+#include <atomic>
+
+namespace nvr
+{
+
+//单写多读的最新检测结果,顺序锁实现:写入不等待读者,读者遇到正在写入时重读
+class DetectSnapshot
+{
+public:
+    DetectSnapshot();
+
+    void Publish(const DetectResult &result);
+
+    //还没有发布过结果时返回false
+    bool Read(DetectResult &result) const;
+
+private:
+    std::atomic<uint32_t> seq_; //奇数表示正在写入
+    DetectResult result_;
+};
+} // namespace nvr
+
+#endif
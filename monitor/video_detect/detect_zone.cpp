@@ -0,0 +1,190 @@
+#include "video_detect/detect_zone.h"
+#include "common/res_code.h"
+
+#define DETECT_ZONE_FRAME_VALUE (DETECT_MAX_ZONES + 1)
+
+namespace nvr
+{
+
+DetectZoneMap::DetectZoneMap() : width_(0),
+                                 height_(0),
+                                 block_size_(0),
+                                 cols_(0),
+                                 rows_(0),
+                                 trigger_thresh_(0),
+                                 active_(0),
+                                 empty_(true),
+                                 init_(false)
+{
+}
+
+DetectZoneMap::~DetectZoneMap()
+{
+    Close();
+}
+
+bool DetectZoneMap::Inside(const DetectZone &zone, int32_t x, int32_t y)
+{
+    //奇偶规则,从点向右的射线与边相交奇数次在多边形内
+    bool inside = false;
+    size_t count = zone.points.size();
+    for (size_t i = 0, j = count - 1; i < count; j = i++)
+    {
+        int32_t xi = zone.points[i].first, yi = zone.points[i].second;
+        int32_t xj = zone.points[j].first, yj = zone.points[j].second;
+        if ((yi > y) != (yj > y) &&
+            x < xi + static_cast<double>(y - yi) * (xj - xi) / (yj - yi))
+            inside = !inside;
+    }
+    return inside;
+}
+
+int32_t DetectZoneMap::Initialize(int32_t width, int32_t height, int32_t block_size, const std::vector<DetectZone> &zones, int32_t trigger_thresh)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    include_.clear();
+    for (const DetectZone &zone : zones)
+    {
+        if (zone.points.size() < 3)
+        {
+            log_e("detect zone %s needs at least 3 points", zone.name.c_str());
+            return static_cast<int>(KSystemError);
+        }
+        if (!zone.exclude)
+            include_.push_back(zone);
+    }
+    if (include_.size() > DETECT_MAX_ZONES)
+    {
+        log_e("too many detect zones %d,max %d", static_cast<int>(include_.size()), DETECT_MAX_ZONES);
+        return static_cast<int>(KSystemError);
+    }
+
+    width_ = width;
+    height_ = height;
+    block_size_ = block_size;
+    cols_ = width / block_size;
+    rows_ = height / block_size;
+    trigger_thresh_ = trigger_thresh;
+    empty_ = zones.empty();
+
+    //先按顺序标记包含区域,重叠时取靠前的区域,再清除排除区域
+    bitmap_.assign(cols_ * rows_, include_.empty() ? DETECT_ZONE_FRAME_VALUE : 0);
+    for (int32_t r = 0; r < rows_; r++)
+    {
+        int32_t y = r * block_size + block_size / 2;
+        for (int32_t c = 0; c < cols_; c++)
+        {
+            int32_t x = c * block_size + block_size / 2;
+            uint8_t &value = bitmap_[r * cols_ + c];
+            for (size_t i = 0; i < include_.size() && 0 == value; i++)
+            {
+                if (Inside(include_[i], x, y))
+                    value = static_cast<uint8_t>(i + 1);
+            }
+            for (const DetectZone &zone : zones)
+            {
+                if (zone.exclude && value && Inside(zone, x, y))
+                    value = 0;
+            }
+        }
+    }
+
+    active_ = 0;
+    for (uint8_t value : bitmap_)
+        active_ += value ? 1 : 0;
+    log_i("detect zones %d include,%d exclude,%u/%d blocks active",
+          static_cast<int>(include_.size()), static_cast<int>(zones.size() - include_.size()),
+          active_, cols_ * rows_);
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void DetectZoneMap::Close()
+{
+    if (!init_)
+        return;
+
+    include_.clear();
+    bitmap_.clear();
+    empty_ = true;
+    init_ = false;
+}
+
+int32_t DetectZoneMap::Classify(const DetectRect &rect) const
+{
+    if (!init_)
+        return DETECT_ZONE_FRAME;
+
+    int32_t c = (rect.left + rect.right) / 2 / block_size_;
+    int32_t r = (rect.top + rect.bottom) / 2 / block_size_;
+    if (c >= cols_)
+        c = cols_ - 1;
+    if (r >= rows_)
+        r = rows_ - 1;
+
+    uint8_t value = bitmap_[r * cols_ + c];
+    if (0 == value)
+        return DETECT_ZONE_NONE;
+    if (DETECT_ZONE_FRAME_VALUE == value)
+        return DETECT_ZONE_FRAME;
+    return value - 1;
+}
+
+bool DetectZoneMap::Collect(DetectRect rect, MotionEvent &event, int32_t *counts) const
+{
+    rect.zone = Classify(rect);
+    if (DETECT_ZONE_NONE == rect.zone)
+        return false;
+
+    event.num++;
+    if (rect.zone >= 0)
+        counts[rect.zone]++;
+
+    //按面积插入排序,只保留最大的DETECT_MAX_RECTS个
+    int pos = event.count;
+    while (pos > 0 && event.rects[pos - 1].area < rect.area)
+    {
+        if (pos < DETECT_MAX_RECTS)
+            event.rects[pos] = event.rects[pos - 1];
+        pos--;
+    }
+    if (pos >= DETECT_MAX_RECTS)
+        return true;
+
+    event.rects[pos] = rect;
+    if (event.count < DETECT_MAX_RECTS)
+        event.count++;
+
+    return true;
+}
+
+bool DetectZoneMap::Evaluate(const MotionEvent &event, const int32_t *counts, uint32_t &zones) const
+{
+    zones = 0;
+    if (include_.empty())
+        return event.num >= trigger_thresh_;
+
+    for (size_t i = 0; i < include_.size(); i++)
+    {
+        int32_t thresh = include_[i].trigger_thresh > 0 ? include_[i].trigger_thresh : trigger_thresh_;
+        if (counts[i] > 0 && counts[i] >= thresh)
+            zones |= 1u << i;
+    }
+    return zones != 0;
+}
+
+void DetectZoneMap::Notify(DetectListener *listener, const MotionEvent &event, const int32_t *counts, uint32_t zones) const
+{
+    listener->OnMotion(event);
+    for (size_t i = 0; i < include_.size(); i++)
+    {
+        if (zones & (1u << i))
+            listener->OnZoneTrigger(static_cast<int32_t>(i), include_[i].name, counts[i]);
+    }
+    listener->OnTrigger(event.num);
+}
+} // namespace nvr
@@ -0,0 +1,63 @@
+#ifndef DETECT_ZONE_H_
+#define DETECT_ZONE_H_
+
+#include "video_detect/video_detect.h"
+
+#include <vector>
+
+namespace nvr
+{
+
+//检测区域位图:初始化时把多边形按块中心栅格化,检测时只做查表
+//配置了包含区域时只检测包含区域,排除区域内的块和运动区域总是忽略
+class DetectZoneMap
+{
+public:
+    DetectZoneMap();
+
+    ~DetectZoneMap();
+
+    int32_t Initialize(int32_t width, int32_t height, int32_t block_size, const std::vector<DetectZone> &zones, int32_t trigger_thresh);
+
+    void Close();
+
+    //每个块一个字节,0为不检测,其余为检测
+    const uint8_t *Bitmap() const { return bitmap_.data(); }
+
+    //没有配置任何区域,不需要过滤
+    bool Empty() const { return empty_; }
+
+    //检测的面积(像素),不包括排除区域和包含区域以外的块
+    uint32_t ActiveArea() const { return active_ * block_size_ * block_size_; }
+
+    //按运动区域中心所在块分类,返回包含区域序号,DETECT_ZONE_FRAME或DETECT_ZONE_NONE
+    int32_t Classify(const DetectRect &rect) const;
+
+    //过滤一个运动区域,保留时按面积插入event并累加所属区域的计数,返回是否保留
+    bool Collect(DetectRect rect, MotionEvent &event, int32_t *counts) const;
+
+    //按区域阈值判断是否触发,zones返回达到阈值的包含区域位图
+    bool Evaluate(const MotionEvent &event, const int32_t *counts, uint32_t &zones) const;
+
+    //通知监听者:OnMotion,每个触发区域的OnZoneTrigger,最后OnTrigger
+    void Notify(DetectListener *listener, const MotionEvent &event, const int32_t *counts, uint32_t zones) const;
+
+private:
+    static bool Inside(const DetectZone &zone, int32_t x, int32_t y);
+
+private:
+    int32_t width_;
+    int32_t height_;
+    int32_t block_size_;
+    int32_t cols_;
+    int32_t rows_;
+    int32_t trigger_thresh_;
+    std::vector<DetectZone> include_;
+    std::vector<uint8_t> bitmap_; //包含区域序号+1,整帧为DETECT_MAX_ZONES+1
+    uint32_t active_;             //检测的块数
+    bool empty_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
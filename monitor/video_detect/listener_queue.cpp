@@ -0,0 +1,107 @@
+#include "video_detect/listener_queue.h"
+
+namespace nvr
+{
+
+ListenerQueue::ListenerQueue(DetectListener *listener) : listener_(listener),
+                                                         dropped_(0),
+                                                         run_(false)
+{
+}
+
+ListenerQueue::~ListenerQueue()
+{
+    Stop();
+}
+
+void ListenerQueue::Start()
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    if (run_)
+        return;
+    run_ = true;
+    //线程持有队列的引用,在回调中移除自己时线程分离,由线程退出时释放
+    std::shared_ptr<ListenerQueue> self = shared_from_this();
+    thread_ = std::thread([self]() { self->Run(); });
+}
+
+void ListenerQueue::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mux_);
+        run_ = false;
+        queue_.clear();
+        cond_.notify_all();
+    }
+
+    if (!thread_.joinable())
+        return;
+    if (std::this_thread::get_id() == thread_.get_id())
+        thread_.detach();
+    else
+        thread_.join();
+
+    if (dropped_ > 0)
+        log_w("detect listener dropped %llu notifications", (unsigned long long)dropped_);
+    dropped_ = 0;
+}
+
+void ListenerQueue::Push(const Notification &notification)
+{
+    std::unique_lock<std::mutex> lock(mux_);
+    if (!run_)
+        return;
+
+    //事件开始/结束和破坏状态变化不丢弃,否则监听者的状态会错乱
+    if (queue_.size() >= LISTENER_QUEUE_SIZE)
+    {
+        auto it = queue_.begin();
+        while (it != queue_.end() && (it->tamper_changed || MotionStateMachine::KStart == it->action || MotionStateMachine::KEnd == it->action))
+            ++it;
+        queue_.erase(it != queue_.end() ? it : queue_.begin());
+        dropped_++;
+    }
+    queue_.push_back(notification);
+    cond_.notify_one();
+}
+
+void ListenerQueue::Run()
+{
+    Notification notification;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            cond_.wait(lock, [this]() { return !run_ || !queue_.empty(); });
+            if (!run_)
+                break;
+            notification = queue_.front();
+            queue_.pop_front();
+        }
+        Deliver(notification);
+    }
+}
+
+void ListenerQueue::Deliver(const Notification &notification)
+{
+    const DetectResult &result = notification.result;
+
+    if (notification.tamper_changed)
+    {
+        for (int type = 0; type < KTamperNum; type++)
+        {
+            if (notification.tamper_changed & (1u << type))
+                listener_->OnTamper(type, (result.tamper & (1u << type)) != 0, result.event.ts);
+        }
+        return;
+    }
+
+    if (MotionStateMachine::KStart == notification.action)
+        listener_->OnMotionStart(result.event);
+    if ((MotionStateMachine::KStart == notification.action || MotionStateMachine::KUpdate == notification.action) && notification.zones)
+        notification.zones->Notify(listener_, result.event, notification.counts, result.zones);
+    if (MotionStateMachine::KEnd == notification.action)
+        listener_->OnMotionEnd(result.event.ts);
+    listener_->OnResult(result);
+}
+} // namespace nvr
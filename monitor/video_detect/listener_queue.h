@@ -0,0 +1,63 @@
+#ifndef LISTENER_QUEUE_H_
+#define LISTENER_QUEUE_H_
+
+#include "video_detect/video_detect.h"
+#include "video_detect/detect_zone.h"
+#include "video_detect/motion_state.h"
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define LISTENER_QUEUE_SIZE 32 //每个监听者最多缓存的通知数,超过时先丢弃只有检测结果的通知
+
+namespace nvr
+{
+
+//一个监听者的通知队列和回调线程:检测线程只入队,慢的监听者不会阻塞检测线程和其他监听者
+//回调不持有任何分发器的锁,可以在回调中添加或移除监听者(包括自己)
+class ListenerQueue : public std::enable_shared_from_this<ListenerQueue>
+{
+public:
+    //一个检测帧或一次破坏状态变化需要通知的内容
+    struct Notification
+    {
+        DetectResult result;
+        MotionStateMachine::Action action;
+        int32_t counts[DETECT_MAX_ZONES];
+        uint32_t tamper_changed; //不为0时是破坏状态变化,只通知变化的类型
+        std::shared_ptr<const DetectZoneMap> zones; //本帧使用的区域位图,回调线程可能比分发器晚退出,不引用分发器的成员
+    };
+
+    explicit ListenerQueue(DetectListener *listener);
+
+    ~ListenerQueue();
+
+    DetectListener *Listener() const { return listener_; }
+
+    void Start();
+
+    //停止回调线程,丢弃未回调的通知;在该监听者的回调中调用时不等待当前回调返回
+    void Stop();
+
+    void Push(const Notification &notification);
+
+private:
+    void Run();
+
+    void Deliver(const Notification &notification);
+
+private:
+    DetectListener *listener_;
+    std::mutex mux_;
+    std::condition_variable cond_;
+    std::deque<Notification> queue_;
+    uint64_t dropped_; //队列满时丢弃的通知数
+    bool run_;
+    std::thread thread_;
+};
+} // namespace nvr
+
+#endif
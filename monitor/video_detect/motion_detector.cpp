@@ -0,0 +1,289 @@
+#include "video_detect/motion_detector.h"
+#include "common/res_code.h"
+
+#include <string.h>
+#include <algorithm>
+
+#define ILLUM_GRID_X 16    //亮度估计的分格数
+#define ILLUM_GRID_Y 12
+#define ILLUM_ROW_STEP 4   //隔行统计
+#define ILLUM_MIN_MEAN 16  //太暗的格比值不可靠,不参与估计
+#define ILLUM_MIN_GAIN 8   //增益与256相差不超过该值时不补偿(约3%)
+#define ILLUM_UNIFORM 80   //与中值相差1/8以内的格超过该百分比才认为是整体变化
+#define ILLUM_MAX_GAIN 1024
+
+namespace nvr
+{
+
+MotionDetector::MotionDetector() : kernel_(&GetSadKernel()),
+                                   sad_row_(nullptr),
+                                   cols_(0),
+                                   rows_(0),
+                                   sad_thresh_(0),
+                                   sad_score_(0),
+                                   gain_(256),
+                                   block_mask_(nullptr),
+                                   has_background_(false),
+                                   init_(false)
+{
+    memset(&params_, 0, sizeof(params_));
+}
+
+MotionDetector::~MotionDetector()
+{
+    Close();
+}
+
+int32_t MotionDetector::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    if ((params.block_size != 4 && params.block_size != 8) ||
+        params.width < params.block_size ||
+        params.height < params.block_size ||
+        params.learn_rate <= 0 || params.learn_rate >= 256)
+    {
+        log_e("invalid motion detector params,%dx%d block %d learn rate %d",
+              params.width, params.height, params.block_size, params.learn_rate);
+        return static_cast<int>(KSystemError);
+    }
+
+    params_ = params;
+    cols_ = params.width / params.block_size;
+    rows_ = params.height / params.block_size;
+    sad_row_ = params.block_size == 8 ? kernel_->sad8 : kernel_->sad4;
+    //8x8块的和是4x4块的4倍,uint16最大255*64不会溢出
+    uint32_t thresh = params.sad_thresh * (params.block_size * params.block_size / 16);
+    sad_thresh_ = thresh > 0xffff ? 0xffff : static_cast<uint16_t>(thresh);
+
+    background_.assign(params.width * params.height, 0);
+    sad_.assign(cols_ * rows_, 0);
+    mask_.assign(cols_ * rows_, 0);
+    stack_.reserve(cols_ * rows_);
+    if (params.illum_compensate)
+    {
+        compensated_.assign(params.width * params.height, 0);
+        ratios_.reserve(ILLUM_GRID_X * ILLUM_GRID_Y);
+    }
+    gain_ = 256;
+    has_background_ = false;
+
+    log_i("motion detector %dx%d,block %d,sad thresh %d,illum compensate %d,kernel %s",
+          params.width, params.height, params.block_size, sad_thresh_, params.illum_compensate, kernel_->name);
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void MotionDetector::Close()
+{
+    if (!init_)
+        return;
+
+    background_.clear();
+    sad_.clear();
+    mask_.clear();
+    stack_.clear();
+    compensated_.clear();
+    ratios_.clear();
+    cols_ = 0;
+    rows_ = 0;
+    has_background_ = false;
+    init_ = false;
+}
+
+void MotionDetector::Reset()
+{
+    has_background_ = false;
+}
+
+int32_t MotionDetector::Process(const uint8_t *luma, int32_t stride, std::vector<DetectRect> &regions)
+{
+    regions.clear();
+    if (!init_)
+        return 0;
+
+    int32_t width = params_.width;
+    int32_t block = params_.block_size;
+
+    if (!has_background_)
+    {
+        for (int32_t y = 0; y < params_.height; y++)
+            memcpy(&background_[y * width], luma + y * stride, width);
+        memset(sad_.data(), 0, sad_.size() * sizeof(uint16_t));
+        sad_score_ = 0;
+        gain_ = 256;
+        has_background_ = true;
+        return 0;
+    }
+
+    //开关灯,云遮挡等整体亮度变化,把当前帧调整到背景的亮度再比较;背景仍融合原始帧,逐渐跟上新的亮度
+    const uint8_t *raw = luma;
+    int32_t raw_stride = stride;
+    gain_ = params_.illum_compensate ? EstimateGain(luma, stride) : 256;
+    if (gain_ != 256)
+    {
+        for (int32_t y = 0; y < params_.height; y++)
+            kernel_->gain(raw + y * raw_stride, &compensated_[y * width], width, gain_);
+        luma = compensated_.data();
+        stride = width;
+    }
+
+    //先和旧背景比较,再把当前帧融合进背景
+    uint64_t sad_sum = 0;
+    uint32_t blocks = 0;
+    for (int32_t r = 0; r < rows_; r++)
+    {
+        uint16_t *sad = &sad_[r * cols_];
+        sad_row_(luma + r * block * stride, stride, &background_[r * block * width], width, cols_, sad);
+        uint8_t *mask = &mask_[r * cols_];
+        if (block_mask_)
+        {
+            const uint8_t *block_mask = block_mask_ + r * cols_;
+            for (int32_t c = 0; c < cols_; c++)
+            {
+                mask[c] = block_mask[c] && sad[c] >= sad_thresh_ ? 1 : 0;
+                if (block_mask[c])
+                {
+                    sad_sum += sad[c];
+                    blocks++;
+                }
+            }
+        }
+        else
+        {
+            for (int32_t c = 0; c < cols_; c++)
+            {
+                mask[c] = sad[c] >= sad_thresh_ ? 1 : 0;
+                sad_sum += sad[c];
+            }
+            blocks += cols_;
+        }
+    }
+    sad_score_ = blocks ? static_cast<uint32_t>(sad_sum / blocks / (block * block / 16)) : 0;
+
+    for (int32_t y = 0; y < params_.height; y++)
+        kernel_->blend(raw + y * raw_stride, &background_[y * width], width, params_.learn_rate);
+
+    return Label(regions);
+}
+
+int32_t MotionDetector::EstimateGain(const uint8_t *luma, int32_t stride)
+{
+    uint32_t cur[ILLUM_GRID_X * ILLUM_GRID_Y] = {0};
+    uint32_t bg[ILLUM_GRID_X * ILLUM_GRID_Y] = {0};
+    uint32_t count[ILLUM_GRID_Y] = {0};
+    int32_t width = params_.width;
+    int32_t cell = width / ILLUM_GRID_X;
+
+    for (int32_t y = 0; y < params_.height; y += ILLUM_ROW_STEP)
+    {
+        int32_t cy = y * ILLUM_GRID_Y / params_.height;
+        const uint8_t *row = luma + y * stride;
+        const uint8_t *bg_row = &background_[y * width];
+        for (int32_t cx = 0; cx < ILLUM_GRID_X; cx++)
+        {
+            cur[cy * ILLUM_GRID_X + cx] += kernel_->sum(row + cx * cell, cell);
+            bg[cy * ILLUM_GRID_X + cx] += kernel_->sum(bg_row + cx * cell, cell);
+        }
+        count[cy] += cell;
+    }
+
+    ratios_.clear();
+    for (int32_t i = 0; i < ILLUM_GRID_X * ILLUM_GRID_Y; i++)
+    {
+        uint32_t min_sum = ILLUM_MIN_MEAN * count[i / ILLUM_GRID_X];
+        if (cur[i] >= min_sum && bg[i] >= min_sum)
+            ratios_.push_back(static_cast<int32_t>((static_cast<uint64_t>(bg[i]) * 256 + cur[i] / 2) / cur[i]));
+    }
+    //大部分格都太暗时不补偿
+    if (ratios_.size() < ILLUM_GRID_X * ILLUM_GRID_Y / 4)
+        return 256;
+
+    std::nth_element(ratios_.begin(), ratios_.begin() + ratios_.size() / 2, ratios_.end());
+    int32_t gain = std::min(ratios_[ratios_.size() / 2], ILLUM_MAX_GAIN);
+    if (abs(gain - 256) <= ILLUM_MIN_GAIN)
+        return 256;
+
+    //局部变化(云影只遮住一部分)按整体补偿会让其余部分变成运动,不补偿,交给整体变化抑制
+    int32_t uniform = 0;
+    for (int32_t ratio : ratios_)
+        uniform += abs(ratio - gain) <= gain / 8 ? 1 : 0;
+    return uniform * 100 >= static_cast<int32_t>(ratios_.size()) * ILLUM_UNIFORM ? gain : 256;
+}
+
+int32_t MotionDetector::Label(std::vector<DetectRect> &regions)
+{
+    int32_t num = 0;
+    int32_t block = params_.block_size;
+
+    //4连通域,mask中1为未访问的运动块,访问后置2
+    for (int32_t start = 0; start < cols_ * rows_; start++)
+    {
+        if (mask_[start] != 1)
+            continue;
+
+        int32_t left = cols_, top = rows_, right = 0, bottom = 0;
+        uint32_t area = 0;
+
+        stack_.clear();
+        stack_.push_back(start);
+        mask_[start] = 2;
+        while (!stack_.empty())
+        {
+            int32_t index = stack_.back();
+            stack_.pop_back();
+            int32_t x = index % cols_;
+            int32_t y = index / cols_;
+
+            area++;
+            if (x < left)
+                left = x;
+            if (x > right)
+                right = x;
+            if (y < top)
+                top = y;
+            if (y > bottom)
+                bottom = y;
+
+            if (x > 0 && mask_[index - 1] == 1)
+            {
+                mask_[index - 1] = 2;
+                stack_.push_back(index - 1);
+            }
+            if (x + 1 < cols_ && mask_[index + 1] == 1)
+            {
+                mask_[index + 1] = 2;
+                stack_.push_back(index + 1);
+            }
+            if (y > 0 && mask_[index - cols_] == 1)
+            {
+                mask_[index - cols_] = 2;
+                stack_.push_back(index - cols_);
+            }
+            if (y + 1 < rows_ && mask_[index + cols_] == 1)
+            {
+                mask_[index + cols_] = 2;
+                stack_.push_back(index + cols_);
+            }
+        }
+
+        if (area < static_cast<uint32_t>(params_.area_thresh))
+            continue;
+        num++;
+
+        DetectRect rect;
+        rect.left = left * block;
+        rect.top = top * block;
+        rect.right = (right + 1) * block - 1;
+        rect.bottom = (bottom + 1) * block - 1;
+        rect.area = area * block * block;
+        rect.zone = DETECT_ZONE_FRAME;
+        regions.push_back(rect);
+    }
+
+    return num;
+}
+} // namespace nvr
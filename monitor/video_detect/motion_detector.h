@@ -0,0 +1,88 @@
+#ifndef MOTION_DETECTOR_H_
+#define MOTION_DETECTOR_H_
+
+#include "video_detect/video_detect.h"
+#include "video_detect/sad_kernel.h"
+
+#include <vector>
+
+namespace nvr
+{
+
+//纯软件移动侦测,与IVE MD的背景模式相同:亮度分块SAD与背景比较,阈值化后做4连通域,背景按加权平均更新
+//不依赖海思接口,可以在主机上跑同样的数据
+class MotionDetector
+{
+public:
+    struct Params
+    {
+        int32_t width;
+        int32_t height;
+        int32_t block_size;  //分块大小,4或8
+        int32_t sad_thresh;  //块SAD阈值,按4x4块的平均值定义,8x8块按面积放大
+        int32_t learn_rate;  //背景更新权重(q8),128与IVE的0.5/0.5相同
+        int32_t area_thresh; //连通域最小面积(块数)
+        bool illum_compensate; //按背景与当前帧的整体亮度比补偿后再计算SAD
+    };
+
+    MotionDetector();
+
+    ~MotionDetector();
+
+    int32_t Initialize(const Params &params);
+
+    void Close();
+
+    //输入一帧亮度,输出所有运动区域(未排序),坐标与面积为像素,返回区域数
+    //第一帧只建立背景,返回0
+    int32_t Process(const uint8_t *luma, int32_t stride, std::vector<DetectRect> &regions);
+
+    //块掩码,每块一个字节,为0的块不参与检测,nullptr为整帧检测
+    void SetMask(const uint8_t *mask) { block_mask_ = mask; }
+
+    //丢弃背景,下一帧重新建立
+    void Reset();
+
+    int32_t Columns() const { return cols_; }
+
+    int32_t Rows() const { return rows_; }
+
+    //上一帧每个块的SAD
+    const uint16_t *SadMap() const { return sad_.data(); }
+
+    //上一帧检测块的SAD均值,按4x4块换算
+    uint32_t SadScore() const { return sad_score_; }
+
+    const char *KernelName() const { return kernel_->name; }
+
+    //上一帧的亮度补偿增益(q8),256为未补偿
+    int32_t Gain() const { return gain_; }
+
+private:
+    int32_t Label(std::vector<DetectRect> &regions);
+
+    //分格统计当前帧与背景的亮度,取各格亮度比的中值,运动物体只影响少数格
+    int32_t EstimateGain(const uint8_t *luma, int32_t stride);
+
+private:
+    Params params_;
+    const SadKernel *kernel_;
+    SadRowFunc sad_row_;
+    int32_t cols_;
+    int32_t rows_;
+    uint16_t sad_thresh_;
+    uint32_t sad_score_;
+    int32_t gain_;
+    std::vector<uint8_t> compensated_;
+    std::vector<int32_t> ratios_;
+    std::vector<uint8_t> background_;
+    std::vector<uint16_t> sad_;
+    std::vector<uint8_t> mask_;
+    const uint8_t *block_mask_;
+    std::vector<int32_t> stack_;
+    bool has_background_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
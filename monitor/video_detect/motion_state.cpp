@@ -0,0 +1,64 @@
+#include "video_detect/motion_state.h"
+
+namespace nvr
+{
+
+MotionStateMachine::MotionStateMachine() : history_(0),
+                                           window_mask_(1),
+                                           last_hit_(0),
+                                           active_(false)
+{
+    params_ = {1, 1, 0};
+}
+
+void MotionStateMachine::Initialize(const Params &params)
+{
+    params_ = params;
+    if (params_.confirm_window < 1)
+        params_.confirm_window = 1;
+    if (params_.confirm_window > MOTION_MAX_WINDOW)
+        params_.confirm_window = MOTION_MAX_WINDOW;
+    if (params_.confirm_frames < 1)
+        params_.confirm_frames = 1;
+    if (params_.confirm_frames > params_.confirm_window)
+        params_.confirm_frames = params_.confirm_window;
+
+    window_mask_ = params_.confirm_window == 32 ? 0xffffffff : (1u << params_.confirm_window) - 1;
+    Reset();
+}
+
+void MotionStateMachine::Reset()
+{
+    history_ = 0;
+    last_hit_ = 0;
+    active_ = false;
+}
+
+MotionStateMachine::Action MotionStateMachine::Update(bool hit, uint64_t now)
+{
+    history_ = ((history_ << 1) | (hit ? 1 : 0)) & window_mask_;
+
+    if (!active_)
+    {
+        if (__builtin_popcount(history_) < params_.confirm_frames)
+            return KNone;
+        active_ = true;
+        last_hit_ = now;
+        return KStart;
+    }
+
+    if (hit)
+    {
+        last_hit_ = now;
+        return KUpdate;
+    }
+
+    if (now - last_hit_ < static_cast<uint64_t>(params_.cooldown))
+        return KNone;
+
+    //结束后重新累计确认帧,避免同一段噪声立即再次开始
+    active_ = false;
+    history_ = 0;
+    return KEnd;
+}
+} // namespace nvr
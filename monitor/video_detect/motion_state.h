@@ -0,0 +1,50 @@
+#ifndef MOTION_STATE_H_
+#define MOTION_STATE_H_
+
+#include <stdint.h>
+
+#define MOTION_MAX_WINDOW 32 //确认窗口最大帧数
+
+namespace nvr
+{
+
+//运动事件状态机:最近M帧中有N帧命中才开始,开始后任意一帧命中即可维持,连续cooldown时间没有命中才结束
+class MotionStateMachine
+{
+public:
+    enum Action
+    {
+        KNone,
+        KStart,
+        KUpdate,
+        KEnd
+    };
+
+    struct Params
+    {
+        int32_t confirm_frames; //N
+        int32_t confirm_window; //M
+        int32_t cooldown;       //ms
+    };
+
+    MotionStateMachine();
+
+    void Initialize(const Params &params);
+
+    //每个检测帧调用一次,hit为该帧是否达到触发条件
+    Action Update(bool hit, uint64_t now);
+
+    bool Active() const { return active_; }
+
+    void Reset();
+
+private:
+    Params params_;
+    uint32_t history_; //最近的命中记录,最低位为当前帧
+    uint32_t window_mask_;
+    uint64_t last_hit_;
+    bool active_;
+};
+} // namespace nvr
+
+#endif
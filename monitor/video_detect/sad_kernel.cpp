@@ -0,0 +1,249 @@
+#include "video_detect/sad_kernel.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SAD_KERNEL_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SAD_KERNEL_SSE2
+#endif
+
+namespace nvr
+{
+
+template <int N>
+static void SadRowScalar(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad)
+{
+    for (int c = 0; c < cols; c++)
+    {
+        uint32_t sum = 0;
+        for (int y = 0; y < N; y++)
+        {
+            const uint8_t *a = cur + y * cur_stride + c * N;
+            const uint8_t *b = bg + y * bg_stride + c * N;
+            for (int x = 0; x < N; x++)
+                sum += a[x] > b[x] ? a[x] - b[x] : b[x] - a[x];
+        }
+        sad[c] = static_cast<uint16_t>(sum);
+    }
+}
+
+static void BlendRowScalar(const uint8_t *cur, uint8_t *bg, int width, int rate)
+{
+    int keep = 256 - rate;
+    for (int x = 0; x < width; x++)
+        bg[x] = static_cast<uint8_t>((cur[x] * rate + bg[x] * keep + 128) >> 8);
+}
+
+static uint32_t SumRowScalar(const uint8_t *src, int width)
+{
+    uint32_t sum = 0;
+    for (int x = 0; x < width; x++)
+        sum += src[x];
+    return sum;
+}
+
+static void GainRowScalar(const uint8_t *src, uint8_t *dst, int width, int gain)
+{
+    for (int x = 0; x < width; x++)
+    {
+        int value = ((src[x] << 8 | 128) * gain) >> 16;
+        dst[x] = static_cast<uint8_t>(value > 255 ? 255 : value);
+    }
+}
+
+#if defined(SAD_KERNEL_NEON)
+
+//每次处理16个像素:4个4x4块或2个8x8块
+static void Sad4RowNeon(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad)
+{
+    int c = 0;
+    for (; c + 4 <= cols; c += 4)
+    {
+        uint16x8_t acc = vdupq_n_u16(0);
+        for (int y = 0; y < 4; y++)
+            acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(cur + y * cur_stride + c * 4), vld1q_u8(bg + y * bg_stride + c * 4)));
+        vst1_u16(sad + c, vpadd_u16(vget_low_u16(acc), vget_high_u16(acc)));
+    }
+    SadRowScalar<4>(cur + c * 4, cur_stride, bg + c * 4, bg_stride, cols - c, sad + c);
+}
+
+static void Sad8RowNeon(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad)
+{
+    int c = 0;
+    for (; c + 2 <= cols; c += 2)
+    {
+        uint16x8_t acc = vdupq_n_u16(0);
+        for (int y = 0; y < 8; y++)
+            acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(cur + y * cur_stride + c * 8), vld1q_u8(bg + y * bg_stride + c * 8)));
+        uint32x2_t sum = vpaddl_u16(vpadd_u16(vget_low_u16(acc), vget_high_u16(acc)));
+        sad[c] = static_cast<uint16_t>(vget_lane_u32(sum, 0));
+        sad[c + 1] = static_cast<uint16_t>(vget_lane_u32(sum, 1));
+    }
+    SadRowScalar<8>(cur + c * 8, cur_stride, bg + c * 8, bg_stride, cols - c, sad + c);
+}
+
+static void BlendRowNeon(const uint8_t *cur, uint8_t *bg, int width, int rate)
+{
+    uint8x8_t r = vdup_n_u8(static_cast<uint8_t>(rate));
+    uint8x8_t keep = vdup_n_u8(static_cast<uint8_t>(256 - rate));
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t a = vld1q_u8(cur + x);
+        uint8x16_t b = vld1q_u8(bg + x);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), r), vget_low_u8(b), keep);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), r), vget_high_u8(b), keep);
+        vst1q_u8(bg + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+    BlendRowScalar(cur + x, bg + x, width - x, rate);
+}
+
+static uint32_t SumRowNeon(const uint8_t *src, int width)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(src + x)));
+    uint64x2_t sum = vpaddlq_u32(acc);
+    return static_cast<uint32_t>(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1)) + SumRowScalar(src + x, width - x);
+}
+
+static void GainRowNeon(const uint8_t *src, uint8_t *dst, int width, int gain)
+{
+    uint16x4_t g = vdup_n_u16(static_cast<uint16_t>(gain));
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        uint16x8_t a = vorrq_u16(vshll_n_u8(vld1_u8(src + x), 8), vdupq_n_u16(0x80));
+        uint32x4_t lo = vmull_u16(vget_low_u16(a), g);
+        uint32x4_t hi = vmull_u16(vget_high_u16(a), g);
+        //结果最大约1020,饱和到8位
+        vst1_u8(dst + x, vqmovn_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16))));
+    }
+    GainRowScalar(src + x, dst + x, width - x, gain);
+}
+
+#elif defined(SAD_KERNEL_SSE2)
+
+static inline __m128i AbsDiff(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+static void Sad4RowSse2(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    int c = 0;
+    for (; c + 4 <= cols; c += 4)
+    {
+        __m128i lo = zero, hi = zero;
+        for (int y = 0; y < 4; y++)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + y * cur_stride + c * 4));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + y * bg_stride + c * 4));
+            __m128i d = AbsDiff(a, b);
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(d, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(d, zero));
+        }
+        //相邻两列相加后每个块剩两个32位和
+        int32_t sum[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sum), _mm_madd_epi16(lo, ones));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sum + 4), _mm_madd_epi16(hi, ones));
+        for (int i = 0; i < 4; i++)
+            sad[c + i] = static_cast<uint16_t>(sum[i * 2] + sum[i * 2 + 1]);
+    }
+    SadRowScalar<4>(cur + c * 4, cur_stride, bg + c * 4, bg_stride, cols - c, sad + c);
+}
+
+static void Sad8RowSse2(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad)
+{
+    int c = 0;
+    for (; c + 2 <= cols; c += 2)
+    {
+        __m128i acc = _mm_setzero_si128();
+        for (int y = 0; y < 8; y++)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + y * cur_stride + c * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + y * bg_stride + c * 8));
+            acc = _mm_add_epi16(acc, _mm_sad_epu8(a, b));
+        }
+        sad[c] = static_cast<uint16_t>(_mm_extract_epi16(acc, 0));
+        sad[c + 1] = static_cast<uint16_t>(_mm_extract_epi16(acc, 4));
+    }
+    SadRowScalar<8>(cur + c * 8, cur_stride, bg + c * 8, bg_stride, cols - c, sad + c);
+}
+
+static void BlendRowSse2(const uint8_t *cur, uint8_t *bg, int width, int rate)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i r = _mm_set1_epi16(static_cast<int16_t>(rate));
+    const __m128i keep = _mm_set1_epi16(static_cast<int16_t>(256 - rate));
+    const __m128i round = _mm_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + x));
+        //a*rate+b*keep最大255*256,不会超过16位
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), r),
+                                                 _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), keep)),
+                                   round);
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), r),
+                                                 _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), keep)),
+                                   round);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(bg + x),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    BlendRowScalar(cur + x, bg + x, width - x, rate);
+}
+
+static uint32_t SumRowSse2(const uint8_t *src, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)), zero));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8))) + SumRowScalar(src + x, width - x);
+}
+
+static void GainRowSse2(const uint8_t *src, uint8_t *dst, int width, int gain)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i g = _mm_set1_epi16(static_cast<int16_t>(gain));
+    const __m128i round = _mm_set1_epi16(0x80);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        //mulhi取乘积高16位,结果最大约1020,打包时饱和到255
+        __m128i lo = _mm_mulhi_epu16(_mm_or_si128(_mm_slli_epi16(_mm_unpacklo_epi8(a, zero), 8), round), g);
+        __m128i hi = _mm_mulhi_epu16(_mm_or_si128(_mm_slli_epi16(_mm_unpackhi_epi8(a, zero), 8), round), g);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    GainRowScalar(src + x, dst + x, width - x, gain);
+}
+
+#endif
+
+const SadKernel &GetScalarSadKernel()
+{
+    static const SadKernel kernel = {"scalar", SadRowScalar<4>, SadRowScalar<8>, BlendRowScalar, SumRowScalar, GainRowScalar};
+    return kernel;
+}
+
+const SadKernel &GetSadKernel()
+{
+#if defined(SAD_KERNEL_NEON)
+    static const SadKernel kernel = {"neon", Sad4RowNeon, Sad8RowNeon, BlendRowNeon, SumRowNeon, GainRowNeon};
+    return kernel;
+#elif defined(SAD_KERNEL_SSE2)
+    static const SadKernel kernel = {"sse2", Sad4RowSse2, Sad8RowSse2, BlendRowSse2, SumRowSse2, GainRowSse2};
+    return kernel;
+#else
+    return GetScalarSadKernel();
+#endif
+}
+} // namespace nvr
@@ -0,0 +1,38 @@
+#ifndef SAD_KERNEL_H_
+#define SAD_KERNEL_H_
+
+#include <stdint.h>
+
+namespace nvr
+{
+
+//一行分块的SAD:cur/bg指向块行的首像素,输出cols个块的SAD
+typedef void (*SadRowFunc)(const uint8_t *cur, int cur_stride, const uint8_t *bg, int bg_stride, int cols, uint16_t *sad);
+
+//背景更新一行:bg = (cur * rate + bg * (256 - rate) + 128) >> 8,rate取值1~255
+typedef void (*BlendRowFunc)(const uint8_t *cur, uint8_t *bg, int width, int rate);
+
+//一行像素求和,用于估计整体亮度
+typedef uint32_t (*SumRowFunc)(const uint8_t *src, int width);
+
+//亮度补偿一行:dst = min(255, ((src << 8 | 128) * gain) >> 16),即src * gain / 256,gain为q8,取值不超过1024
+typedef void (*GainRowFunc)(const uint8_t *src, uint8_t *dst, int width, int gain);
+
+struct SadKernel
+{
+    const char *name;
+    SadRowFunc sad4; //4x4分块
+    SadRowFunc sad8; //8x8分块
+    BlendRowFunc blend;
+    SumRowFunc sum;
+    GainRowFunc gain;
+};
+
+//按编译目标选择:NEON(armv7及以上),SSE2(x86),其余使用标量实现
+const SadKernel &GetSadKernel();
+
+//标量实现,作为其他实现的对照
+const SadKernel &GetScalarSadKernel();
+} // namespace nvr
+
+#endif
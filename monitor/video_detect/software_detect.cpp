@@ -0,0 +1,161 @@
+#include "video_detect/software_detect.h"
+#include "common/res_code.h"
+#include "common/system.h"
+
+#include <base/ref_counted_object.h>
+
+#define DETECT_LEARN_RATE 128 //背景更新权重(q8),与IVE MD的AddCtrl 0.5/0.5一致
+
+namespace nvr
+{
+rtc::scoped_refptr<VideoDetectModule> SoftwareVideoDetectImpl::Create(const Params &params)
+{
+    err_code code;
+
+    rtc::scoped_refptr<VideoDetectModule> implemention = new rtc::RefCountedObject<SoftwareVideoDetectImpl>();
+
+    code = static_cast<err_code>(implemention->Initialize(params));
+
+    if (KSuccess != code)
+    {
+        log_e("error:%s", make_error_code(code).message().c_str());
+        return nullptr;
+    }
+
+    return implemention;
+}
+
+int32_t SoftwareVideoDetectImpl::CopyLuma(const VIDEO_FRAME_INFO_S &frame)
+{
+    const VIDEO_FRAME_S &vframe = frame.stVFrame;
+    uint32_t size = vframe.u32Stride[0] * height_;
+
+    uint8_t *addr = static_cast<uint8_t *>(HI_MPI_SYS_Mmap(vframe.u32PhyAddr[0], size));
+    if (nullptr == addr)
+    {
+        log_e("HI_MPI_SYS_Mmap failed");
+        return static_cast<int>(KMPPError);
+    }
+
+    for (int y = 0; y < height_; y++)
+        memcpy(&luma_[y * width_], addr + y * vframe.u32Stride[0], width_);
+
+    HI_MPI_SYS_Munmap(addr, size);
+
+    return static_cast<int>(KSuccess);
+}
+
+void SoftwareVideoDetectImpl::OnFrame(const VIDEO_FRAME_INFO_S &frame)
+{
+    if (!init_)
+        return;
+
+    if (static_cast<int32_t>(frame.stVFrame.u32Width) != width_ || static_cast<int32_t>(frame.stVFrame.u32Height) != height_)
+    {
+        log_e("unexpected detect frame %ux%u", frame.stVFrame.u32Width, frame.stVFrame.u32Height);
+        return;
+    }
+
+    if (KSuccess != static_cast<err_code>(CopyLuma(frame)))
+        return;
+
+    dispatcher_.UpdateTamper(frame.stVFrame.u64pts, tamper_.Process(luma_.data(), width_, System::GetSteadyMilliSeconds()));
+    detector_.Process(luma_.data(), width_, regions_);
+    dispatcher_.Dispatch(frame.stVFrame.u64pts, regions_, detector_.SadScore());
+    //整体亮度突变后直接以下一帧作为背景,不等背景慢慢融合
+    if (dispatcher_.Suppressed())
+        detector_.Reset();
+}
+
+int32_t SoftwareVideoDetectImpl::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    err_code code;
+
+    code = static_cast<err_code>(detector_.Initialize({params.width,
+                                                       params.height,
+                                                       params.block_size,
+                                                       params.sad_thresh,
+                                                       DETECT_LEARN_RATE,
+                                                       params.area_thresh,
+                                                       params.illum_compensate}));
+    if (KSuccess != code)
+        return code;
+
+    code = static_cast<err_code>(dispatcher_.Initialize(params));
+    if (KSuccess != code)
+        return code;
+
+    if (params.tamper)
+    {
+        code = static_cast<err_code>(tamper_.Initialize({params.width,
+                                                         params.height,
+                                                         params.tamper_hold,
+                                                         params.tamper_covered,
+                                                         params.tamper_defocus,
+                                                         params.tamper_moved}));
+        if (KSuccess != code)
+            return code;
+    }
+
+    //不检测的块在连通域之前清除,不会和相邻的检测块连成一个区域
+    if (!dispatcher_.Zones().Empty())
+        detector_.SetMask(dispatcher_.Zones().Bitmap());
+
+    width_ = params.width;
+    height_ = params.height;
+    luma_.resize(width_ * height_);
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void SoftwareVideoDetectImpl::Close()
+{
+    if (!init_)
+        return;
+
+    detector_.SetMask(nullptr);
+    detector_.Close();
+    tamper_.Close();
+    dispatcher_.Close();
+    luma_.clear();
+    regions_.clear();
+
+    init_ = false;
+}
+
+SoftwareVideoDetectImpl::~SoftwareVideoDetectImpl()
+{
+    Close();
+}
+
+SoftwareVideoDetectImpl::SoftwareVideoDetectImpl() : width_(0),
+                                                     height_(0),
+                                                     init_(false)
+{
+}
+
+void SoftwareVideoDetectImpl::AddListener(DetectListener *listener)
+{
+    dispatcher_.AddListener(listener);
+}
+
+void SoftwareVideoDetectImpl::RemoveListener(DetectListener *listener)
+{
+    dispatcher_.RemoveListener(listener);
+}
+
+bool SoftwareVideoDetectImpl::GetResult(DetectResult &result)
+{
+    return dispatcher_.GetResult(result);
+}
+
+void SoftwareVideoDetectImpl::SetRateControl(FrameRateControlInterface *control)
+{
+    dispatcher_.SetRateControl(control);
+}
+} // namespace nvr
@@ -0,0 +1,55 @@
+#ifndef SOFTWARE_DETECT_H_
+#define SOFTWARE_DETECT_H_
+
+#include "video_detect/video_detect.h"
+#include "video_detect/motion_detector.h"
+#include "video_detect/detect_dispatcher.h"
+#include "video_detect/tamper_detector.h"
+
+#include <vector>
+
+namespace nvr
+{
+
+//不使用IVE的移动侦测,在CPU上处理检测通道的亮度,接口和上报与VideoDetectImpl一致
+class SoftwareVideoDetectImpl : public VideoDetectModule
+{
+public:
+    static rtc::scoped_refptr<VideoDetectModule> Create(const Params &params);
+
+    int32_t Initialize(const Params &params) override;
+
+    void Close() override;
+
+    void OnFrame(const VIDEO_FRAME_INFO_S &frame) override;
+
+    void AddListener(DetectListener *listener) override;
+
+    void RemoveListener(DetectListener *listener) override;
+
+    bool GetResult(DetectResult &result) override;
+
+    void SetRateControl(FrameRateControlInterface *control) override;
+
+protected:
+    SoftwareVideoDetectImpl();
+
+    ~SoftwareVideoDetectImpl() override;
+
+private:
+    //把检测帧的亮度拷贝到普通内存,VPSS的帧不带cache,直接逐像素读很慢
+    int32_t CopyLuma(const VIDEO_FRAME_INFO_S &frame);
+
+private:
+    MotionDetector detector_;
+    TamperDetector tamper_;
+    DetectDispatcher dispatcher_;
+    std::vector<uint8_t> luma_;
+    std::vector<DetectRect> regions_;
+    int32_t width_;
+    int32_t height_;
+    bool init_;
+};
+}; // namespace nvr
+
+#endif
@@ -0,0 +1,257 @@
+#include "video_detect/tamper_detector.h"
+#include "common/res_code.h"
+
+#include <algorithm>
+
+#define TAMPER_STEP 4        //隔点采样间隔,720x480每帧约2万个点
+#define TAMPER_PEAK_RATIO 90 //相邻两个直方图格占比超过该值也视为遮挡
+#define TAMPER_MIN_EDGE 32   //参考平均梯度(x16)低于该值的场景不判断失焦
+#define TAMPER_LEARN_RATE 8  //参考更新权重(/256,约3%),没有任何条件时每帧更新
+#define TAMPER_CELLS (TAMPER_GRID_X * TAMPER_GRID_Y)
+
+namespace nvr
+{
+
+//整数平方根,向下取整
+static uint64_t ISqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > value)
+        bit >>= 2;
+    while (bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+TamperDetector::TamperDetector() : ref_edge_(0),
+                                   ref_stddev_(0),
+                                   edge_(0),
+                                   stddev_(0),
+                                   state_(0),
+                                   has_reference_(false),
+                                   init_(false)
+{
+    memset(&params_, 0, sizeof(params_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+TamperDetector::~TamperDetector()
+{
+    Close();
+}
+
+int32_t TamperDetector::Initialize(const Params &params)
+{
+    if (init_)
+        return static_cast<int>(KDupInitialize);
+
+    if (params.width <= TAMPER_STEP * TAMPER_GRID_X || params.height <= TAMPER_STEP * TAMPER_GRID_Y || params.hold < 0)
+    {
+        log_e("invalid tamper params,size %dx%d,hold %d", params.width, params.height, params.hold);
+        return static_cast<int>(KSystemError);
+    }
+
+    params_ = params;
+
+    //每个采样列所属的分块,以及每个分块的采样点数
+    memset(cell_count_, 0, sizeof(cell_count_));
+    xcell_.clear();
+    for (int32_t x = 0; x < params_.width - 1; x += TAMPER_STEP)
+        xcell_.push_back(static_cast<uint8_t>(x * TAMPER_GRID_X / params_.width));
+    int32_t rows = 0;
+    for (int32_t y = 0; y < params_.height - 1; y += TAMPER_STEP)
+    {
+        int32_t cy = y * TAMPER_GRID_Y / params_.height;
+        for (uint8_t cx : xcell_)
+            cell_count_[cy * TAMPER_GRID_X + cx] += 1;
+        rows++;
+    }
+    rows_.resize(rows * 2 * params_.width);
+
+    Reset();
+
+    log_i("tamper detector %dx%d,hold %d ms,covered %d,defocus %d%%,moved %d",
+          params_.width, params_.height, params_.hold, params_.covered_thresh, params_.defocus_ratio, params_.moved_thresh);
+
+    init_ = true;
+
+    return static_cast<int>(KSuccess);
+}
+
+void TamperDetector::Close()
+{
+    if (!init_)
+        return;
+
+    xcell_.clear();
+    rows_.clear();
+    init_ = false;
+}
+
+void TamperDetector::Reset()
+{
+    has_reference_ = false;
+    state_ = 0;
+    memset(changing_, 0, sizeof(changing_));
+    memset(since_, 0, sizeof(since_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+void TamperDetector::Learn(int32_t rate)
+{
+    for (int i = 0; i < TAMPER_CELLS; i++)
+        ref_cells_[i] += ((cells_[i] << 8) - ref_cells_[i]) * rate / 256;
+    ref_edge_ += ((edge_ << 8) - ref_edge_) * rate / 256;
+    ref_stddev_ += ((stddev_ << 8) - ref_stddev_) * rate / 256;
+}
+
+uint32_t TamperDetector::Process(const uint8_t *luma, int32_t stride, uint64_t now)
+{
+    if (!init_)
+        return 0;
+
+    return Analyze(luma, stride * TAMPER_STEP, stride, now);
+}
+
+uint32_t TamperDetector::ProcessUncached(const uint8_t *luma, int32_t stride, uint64_t now)
+{
+    if (!init_)
+        return 0;
+
+    //每个采样行和它的下一行(计算纵向梯度)连续存放,只拷贝一半的行
+    uint8_t *dst = rows_.data();
+    for (int32_t y = 0; y < params_.height - 1; y += TAMPER_STEP)
+    {
+        memcpy(dst, luma + y * stride, params_.width);
+        memcpy(dst + params_.width, luma + (y + 1) * stride, params_.width);
+        dst += params_.width * 2;
+    }
+    return Analyze(rows_.data(), params_.width * 2, params_.width, now);
+}
+
+uint32_t TamperDetector::Analyze(const uint8_t *first, int32_t pitch, int32_t below, uint64_t now)
+{
+    //一次遍历采样点,累计直方图,亮度和,平方和,与右/下相邻点的梯度,分块亮度
+    uint32_t hist[16] = {0};
+    uint64_t sum = 0, sum_sq = 0, edge = 0;
+    uint32_t count = 0;
+    uint32_t cells[TAMPER_CELLS] = {0};
+    for (int32_t y = 0, n = 0; y < params_.height - 1; y += TAMPER_STEP, n++)
+    {
+        const uint8_t *row = first + n * pitch;
+        uint32_t *cell_row = &cells[y * TAMPER_GRID_Y / params_.height * TAMPER_GRID_X];
+        uint32_t row_sum = 0, row_sq = 0, row_edge = 0;
+        for (size_t i = 0; i < xcell_.size(); i++)
+        {
+            const uint8_t *p = row + i * TAMPER_STEP;
+            uint32_t value = p[0];
+            hist[value >> 4]++;
+            row_sum += value;
+            row_sq += value * value;
+            row_edge += abs(p[1] - p[0]) + abs(p[below] - p[0]);
+            cell_row[xcell_[i]] += value;
+        }
+        sum += row_sum;
+        sum_sq += row_sq;
+        edge += row_edge;
+        count += xcell_.size();
+    }
+
+    //方差x256开方得到x16的标准差
+    uint32_t mean = static_cast<uint32_t>(sum / count);
+    stddev_ = static_cast<int32_t>(ISqrt((sum_sq * count - sum * sum) * 256 / (static_cast<uint64_t>(count) * count)));
+    edge_ = static_cast<int32_t>(edge * 16 / count);
+    uint32_t peak = 0;
+    for (int i = 0; i < 15; i++)
+        peak = std::max(peak, hist[i] + hist[i + 1]);
+    for (int i = 0; i < TAMPER_CELLS; i++)
+        cells_[i] = cells[i] * 16 / cell_count_[i];
+
+    if (!has_reference_)
+    {
+        for (int i = 0; i < TAMPER_CELLS; i++)
+            ref_cells_[i] = cells_[i] << 8;
+        ref_edge_ = edge_ << 8;
+        ref_stddev_ = stddev_ << 8;
+        has_reference_ = true;
+    }
+
+    //分块亮度去均值后的相关系数,对整体亮度和对比度变化不敏感;每块乘以块数代替除以块数求均值
+    int64_t cur_total = 0, ref_total = 0;
+    for (int i = 0; i < TAMPER_CELLS; i++)
+    {
+        cur_total += cells_[i];
+        ref_total += ref_cells_[i] >> 8;
+    }
+    int64_t cross = 0, cur_var = 0, ref_var = 0;
+    for (int i = 0; i < TAMPER_CELLS; i++)
+    {
+        int64_t a = cells_[i] * TAMPER_CELLS - cur_total, b = (ref_cells_[i] >> 8) * TAMPER_CELLS - ref_total;
+        cross += a * b;
+        cur_var += a * a;
+        ref_var += b * b;
+    }
+    int64_t norm = static_cast<int64_t>(ISqrt(cur_var)) * static_cast<int64_t>(ISqrt(ref_var));
+    int32_t similarity = norm > 0 ? static_cast<int32_t>(cross * 100 / norm) : 100;
+
+    //遮挡时边缘和签名也会变化,只报遮挡;参考本身就是低对比度的场景不判断遮挡
+    uint32_t raw = 0;
+    bool uniform = stddev_ < params_.covered_thresh * 16 || peak * 100 >= count * TAMPER_PEAK_RATIO;
+    if (uniform && ref_stddev_ >= (params_.covered_thresh * 16 << 8))
+        raw |= 1u << KTamperCovered;
+    else
+    {
+        if (ref_edge_ >= (TAMPER_MIN_EDGE << 8) && static_cast<int64_t>(edge_) * 100 * 256 < static_cast<int64_t>(ref_edge_) * params_.defocus_ratio)
+            raw |= 1u << KTamperDefocused;
+        if (similarity < params_.moved_thresh)
+            raw |= 1u << KTamperMoved;
+    }
+
+    //条件持续hold才改变状态
+    for (int type = 0; type < KTamperNum; type++)
+    {
+        uint32_t bit = 1u << type;
+        if ((raw & bit) == (state_ & bit))
+        {
+            changing_[type] = false;
+            continue;
+        }
+        if (!changing_[type])
+        {
+            changing_[type] = true;
+            since_[type] = now;
+        }
+        if (now - since_[type] >= static_cast<uint64_t>(params_.hold))
+        {
+            state_ ^= bit;
+            changing_[type] = false;
+        }
+    }
+
+    //没有任何条件时跟随场景缓慢变化;确认移位后以新画面作为参考,报警在hold后自动解除
+    if (0 == raw)
+        Learn(TAMPER_LEARN_RATE);
+    else if ((state_ & (1u << KTamperMoved)) && (raw & (1u << KTamperMoved)))
+        Learn(256);
+
+    stats_.mean = static_cast<int32_t>(mean);
+    stats_.stddev = stddev_ / 16;
+    stats_.peak = peak * 100 / count;
+    stats_.edge = edge_;
+    stats_.ref_edge = ref_edge_ >> 8;
+    stats_.similarity = similarity;
+    stats_.raw = raw;
+
+    return state_;
+}
+} // namespace nvr
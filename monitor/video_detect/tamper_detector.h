@@ -0,0 +1,89 @@
+#ifndef TAMPER_DETECTOR_H_
+#define TAMPER_DETECTOR_H_
+
+#include "video_detect/video_detect.h"
+
+#include <vector>
+
+#define TAMPER_GRID_X 8 //场景签名的分块数
+#define TAMPER_GRID_Y 6
+
+namespace nvr
+{
+
+//遮挡/失焦/移位检测,隔点采样亮度统计直方图,边缘能量和分块亮度签名,与缓慢更新的参考比较
+//只用整数运算(arm926没有浮点单元),不依赖海思接口,可以在主机上用回放数据测试
+class TamperDetector
+{
+public:
+    struct Params
+    {
+        int32_t width;
+        int32_t height;
+        int32_t hold;           //条件持续hold(ms)才报警,消失同样时间才解除
+        int32_t covered_thresh; //亮度标准差低于该值视为遮挡
+        int32_t defocus_ratio;  //边缘能量低于参考的百分比视为失焦
+        int32_t moved_thresh;   //场景签名与参考的相关系数(x100)低于该值视为移位
+    };
+
+    //上一帧的统计,用于回放调参
+    struct Stats
+    {
+        int32_t mean;
+        int32_t stddev;
+        int32_t peak;       //相邻两个直方图格的最大占比(%)
+        int32_t edge;       //平均梯度(x16)
+        int32_t ref_edge;   //参考的平均梯度(x16)
+        int32_t similarity; //与参考签名的相关系数(x100)
+        uint32_t raw;       //本帧满足的条件,未经过hold
+    };
+
+    TamperDetector();
+
+    ~TamperDetector();
+
+    int32_t Initialize(const Params &params);
+
+    void Close();
+
+    //输入一帧亮度,now为单调时间(ms),返回报警状态,每种类型一位(1 << TamperType)
+    uint32_t Process(const uint8_t *luma, int32_t stride, uint64_t now);
+
+    //luma在不带cache的MMZ中(IVE DMA的输出)时使用:先把采样用到的行整行拷贝到带cache的缓存再统计,
+    //整行拷贝按突发读取,逐点读取每个像素都要单独访问总线
+    uint32_t ProcessUncached(const uint8_t *luma, int32_t stride, uint64_t now);
+
+    //丢弃参考,下一帧重新建立
+    void Reset();
+
+    const Stats &LastStats() const { return stats_; }
+
+private:
+    //统计采样行,第n个采样行从first + n * pitch开始,它的下一行在below字节之后
+    uint32_t Analyze(const uint8_t *first, int32_t pitch, int32_t below, uint64_t now);
+
+    //参考向当前帧靠近rate/256
+    void Learn(int32_t rate);
+
+private:
+    Params params_;
+    std::vector<uint8_t> xcell_;
+    std::vector<uint8_t> rows_; //ProcessUncached拷贝的采样行,每个采样行连同下一行
+    uint32_t cell_count_[TAMPER_GRID_X * TAMPER_GRID_Y];
+    //当前帧的统计都是x16的定点数,参考再多8位小数
+    int32_t cells_[TAMPER_GRID_X * TAMPER_GRID_Y];
+    int32_t ref_cells_[TAMPER_GRID_X * TAMPER_GRID_Y];
+    int32_t ref_edge_;
+    int32_t ref_stddev_;
+    int32_t edge_;
+    int32_t stddev_;
+    Stats stats_;
+    uint32_t state_;
+    bool changing_[KTamperNum];
+    uint64_t since_[KTamperNum];
+    bool has_reference_;
+    bool init_;
+};
+} // namespace nvr
+
+#endif
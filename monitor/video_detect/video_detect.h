@@ -3,17 +3,91 @@
 
 #include "video/video_sink_interface.h"
 #include "video/video_frame.h"
+#include "video/frame_rate_control.h"
 
 #include <base/scoped_refptr.h>
 #include <base/ref_count.h>
 
+#include <string>
+#include <vector>
+
+#define DETECT_MAX_RECTS 16 //每次检测上报的最大区域数,按面积从大到小
+#define DETECT_MAX_ZONES 8  //最大包含区域数
+#define DETECT_ZONE_FRAME -1 //未配置包含区域时整帧作为一个区域
+#define DETECT_ZONE_NONE -2  //不检测的区域
+
 namespace nvr
 {
+//画面被破坏的类型,状态位图中每种类型一位(1 << type)
+enum TamperType
+{
+    KTamperCovered = 0, //遮挡,喷涂
+    KTamperDefocused,   //失焦
+    KTamperMoved,       //镜头被转动
+    KTamperNum
+};
+
+struct DetectRect
+{
+    uint16_t left;
+    uint16_t top;
+    uint16_t right;
+    uint16_t bottom;
+    uint32_t area;
+    int32_t zone; //所属包含区域序号,DETECT_ZONE_FRAME为整帧
+};
+
+//检测区域,多边形顶点为检测分辨率坐标
+struct DetectZone
+{
+    std::string name;
+    bool exclude;         //排除区域,优先于包含区域
+    std::vector<std::pair<int32_t, int32_t>> points;
+    int32_t trigger_thresh; //该区域触发所需的运动区域数,0使用全局阈值
+};
+
+//一次触发的检测结果,坐标为检测通道分辨率
+struct MotionEvent
+{
+    uint64_t ts; //检测帧时间戳(us),与编码帧同一时钟
+    uint16_t width;
+    uint16_t height;
+    int32_t num;   //按区域过滤后的运动区域总数
+    int32_t count; //rects中有效的区域数
+    DetectRect rects[DETECT_MAX_RECTS];
+};
+
+//每个检测帧的完整结果,没有运动时也会发布
+struct DetectResult
+{
+    uint64_t seq;          //检测帧序号,从1开始
+    MotionEvent event;     //过滤后的运动区域
+    uint32_t zones;        //达到阈值的包含区域位图
+    uint32_t sad_score;    //检测区域内4x4块SAD均值,IVE实现为0
+    uint16_t motion_ratio; //运动区域面积占画面的千分比
+    bool hit;              //本帧是否达到触发条件
+    bool active;           //运动事件是否进行中
+    uint32_t tamper;       //破坏报警状态位图,未开启时为0
+    bool suppressed;       //画面整体变化(开关灯等)超过illum_ratio,本帧不触发
+};
+
+//运动事件经过确认后依次回调:OnMotionStart,每个命中帧的OnMotion/OnZoneTrigger/OnTrigger,冷却后OnMotionEnd
+//每个监听者在自己的回调线程中按顺序回调,慢的监听者只会丢弃自己的中间结果,不会阻塞检测线程;
+//只需要最新结果的模块(OSD,统计等)应使用VideoDetectModule::GetResult轮询
 class DetectListener
 {
 public:
     virtual ~DetectListener() {}
     virtual void OnTrigger(int32_t num) = 0;
+    virtual void OnMotionStart(const MotionEvent &event) {}
+    virtual void OnMotionEnd(uint64_t ts) {}
+    virtual void OnMotion(const MotionEvent &event) {}
+    //配置了包含区域时,每个达到阈值的区域单独通知,之后再调用OnTrigger
+    virtual void OnZoneTrigger(int32_t zone, const std::string &name, int32_t num) {}
+    //每个检测帧调用一次,在该帧的其他回调之后
+    virtual void OnResult(const DetectResult &result) {}
+    //破坏报警开始(active为true)或解除
+    virtual void OnTamper(int32_t type, bool active, uint64_t ts) {}
 };
 
 class VideoDetectModule : public rtc::RefCountInterface, public VideoSinkInterface<VIDEO_FRAME_INFO_S>
@@ -22,6 +96,26 @@ public:
     struct Params
     {
         int32_t trigger_thresh;
+        int32_t width; //检测通道分辨率
+        int32_t height;
+        int32_t sad_thresh;  //4x4块SAD阈值,8x8块按面积放大
+        int32_t block_size;  //SAD分块大小,4或8
+        int32_t area_thresh; //连通域最小面积(块数)
+        std::vector<DetectZone> zones;
+        int32_t idle_frame_rate;   //空闲检测帧率,0为不调整
+        int32_t active_frame_rate; //有运动时的检测帧率
+        int32_t active_hold;       //运动停止后保持高帧率的时间(ms)
+        int32_t min_area;          //参与触发的最小区域面积(像素)
+        int32_t confirm_frames;    //最近confirm_window帧中命中confirm_frames帧才开始事件
+        int32_t confirm_window;
+        int32_t cooldown;          //连续cooldown时间没有命中才结束事件(ms)
+        bool tamper;               //开启遮挡/失焦/移位检测
+        int32_t tamper_hold;       //条件持续时间(ms)才报警
+        int32_t tamper_covered;    //亮度标准差低于该值视为遮挡
+        int32_t tamper_defocus;    //边缘能量低于参考的百分比视为失焦
+        int32_t tamper_moved;      //场景与参考的相关系数(x100)低于该值视为移位
+        bool illum_compensate;     //补偿整体亮度变化后再计算SAD,仅软件实现
+        int32_t illum_ratio;       //过滤后的运动面积超过检测范围的该百分比视为整体亮度变化,不触发,0为关闭
     };
 
     virtual int32_t Initialize(const Params &params) = 0;
@@ -30,8 +124,18 @@ public:
 
     virtual void OnFrame(const VIDEO_FRAME_INFO_S &frame) = 0;
 
+    //可以添加多个监听者,RemoveListener返回后不会再有该监听者的回调,未回调的通知被丢弃;
+    //可以在回调中添加或移除监听者,在自己的回调中移除自己时当前回调返回后停止
     virtual void AddListener(DetectListener *listener) = 0;
 
+    virtual void RemoveListener(DetectListener *listener) = 0;
+
+    //读取最新的检测结果,不加锁,不会阻塞检测线程,还没有结果时返回false
+    virtual bool GetResult(DetectResult &result) = 0;
+
+    //检测帧源的帧率控制,用于自适应检测帧率
+    virtual void SetRateControl(FrameRateControlInterface *control) = 0;
+
 protected:
     ~VideoDetectModule() override {}
 };
@@ -4,6 +4,8 @@
 
 #include <base/ref_counted_object.h>
 
+#include <algorithm>
+
 namespace nvr
 {
 rtc::scoped_refptr<VideoDetectModule> VideoDetectImpl::Create(const Params &params)
@@ -23,7 +25,7 @@ rtc::scoped_refptr<VideoDetectModule> VideoDetectImpl::Create(const Params &para
     return implemention;
 }
 
-int32_t VideoDetectImpl::StartMD()
+int32_t VideoDetectImpl::StartMD(const Params &params)
 {
     int32_t ret;
 
@@ -36,15 +38,15 @@ int32_t VideoDetectImpl::StartMD()
     MD_ATTR_S attr;
 
     attr.enAlgMode = MD_ALG_MODE_BG;
-    attr.enSadMode = IVE_SAD_MODE_MB_4X4;
+    attr.enSadMode = params.block_size == 8 ? IVE_SAD_MODE_MB_8X8 : IVE_SAD_MODE_MB_4X4;
     attr.enSadOutCtrl = IVE_SAD_OUT_CTRL_THRESH;
-    attr.u16SadThr = 200;
-    attr.u16Width = DETECT_WIDTH;
-    attr.u16Height = DETECT_HEIGHT;
+    attr.u16SadThr = params.block_size == 8 ? params.sad_thresh * 4 : params.sad_thresh;
+    attr.u16Width = params.width;
+    attr.u16Height = params.height;
     attr.stAddCtrl.u0q16X = 32768;
     attr.stAddCtrl.u0q16Y = 32768;
     attr.stCclCtrl.enMode = IVE_CCL_MODE_4C;
-    attr.stCclCtrl.u16InitAreaThr = 16;
+    attr.stCclCtrl.u16InitAreaThr = params.area_thresh;
     attr.stCclCtrl.u16Step = 4;
 
     ret = HI_IVS_MD_CreateChn(NVR_MD_CHN, &attr);
@@ -61,7 +63,7 @@ void VideoDetectImpl::StopMD()
     int32_t ret;
 
     ret = HI_IVS_MD_DestroyChn(NVR_MD_CHN);
-    if (HI_SUCCESS != ret && HI_ERR_IVE_NOTREADY != ret)
+    if (HI_SUCCESS != ret && static_cast<int32_t>(HI_ERR_IVE_NOTREADY) != ret)
         log_e("HI_IVS_MD_DestroyChn failed,code %#x", ret);
 
     ret = HI_IVS_MD_Exit();
@@ -69,15 +71,13 @@ void VideoDetectImpl::StopMD()
         log_e("HI_IVS_MD_Exit failed,code %#x", ret);
 }
 
-int32_t VideoDetectImpl::IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const IVE_DST_IMAGE_S &dst_image, HI_BOOL instant)
+int32_t VideoDetectImpl::IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const IVE_DST_IMAGE_S &dst_image, IVE_HANDLE &handle)
 {
     int32_t ret;
 
-    IVE_HANDLE handle;
     IVE_SRC_DATA_S src_data;
     IVE_DST_DATA_S dst_data;
     IVE_DMA_CTRL_S dma_ctrl = {IVE_DMA_MODE_DIRECT_COPY, 0};
-    HI_BOOL finish = HI_FALSE;
 
     //fill src
     src_data.pu8VirAddr = (HI_U8 *)frame_info.stVFrame.pVirAddr[0];
@@ -93,26 +93,32 @@ int32_t VideoDetectImpl::IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const
     dst_data.u16Height = dst_image.u16Height;
     dst_data.u16Stride = dst_image.u16Stride[0];
 
-    ret = HI_MPI_IVE_DMA(&handle, &src_data, &dst_data, &dma_ctrl, instant);
+    //instant为真时任务完成会产生中断,可以用阻塞查询等待
+    ret = HI_MPI_IVE_DMA(&handle, &src_data, &dst_data, &dma_ctrl, HI_TRUE);
     if (HI_SUCCESS != ret)
     {
         log_e("HI_MPI_IVE_DMA failed,code %#x", ret);
         return static_cast<int>(KMPPError);
     }
 
-    if (HI_TRUE == instant)
-    {
+    return static_cast<int>(KSuccess);
+}
+
+int32_t VideoDetectImpl::IVEWait(IVE_HANDLE handle)
+{
+    int32_t ret;
+    HI_BOOL finish = HI_FALSE;
+
+    //IVE任务按提交顺序完成,查询最后一个句柄即可确认之前提交的任务都已完成
+    //阻塞查询在内核中等待完成中断,超时只是返回重查,不需要sleep轮询
+    ret = HI_MPI_IVE_Query(handle, &finish, HI_TRUE);
+    while (static_cast<int32_t>(HI_ERR_IVE_QUERY_TIMEOUT) == ret)
         ret = HI_MPI_IVE_Query(handle, &finish, HI_TRUE);
-        while (!finish && HI_ERR_IVE_QUERY_TIMEOUT == ret)
-        {
-            usleep(100);
-            ret = HI_MPI_IVE_Query(handle, &finish, HI_TRUE);
-        }
-        if (HI_SUCCESS != ret)
-        {
-            log_e("HI_MPI_IVE_Query failed,code %#x", ret);
-            return static_cast<int>(KMPPError);
-        }
+
+    if (HI_SUCCESS != ret || !finish)
+    {
+        log_e("HI_MPI_IVE_Query failed,code %#x", ret);
+        return static_cast<int>(KMPPError);
     }
 
     return static_cast<int>(KSuccess);
@@ -121,17 +127,17 @@ int32_t VideoDetectImpl::IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const
 int32_t VideoDetectImpl::AllocMemory()
 {
     int32_t ret;
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < DETECT_SLOTS; i++)
     {
         memset(&src_image_[i], 0, sizeof(src_image_[i]));
         src_image_[i].enType = IVE_IMAGE_TYPE_U8C1;
-        src_image_[i].u16Width = DETECT_WIDTH;
-        src_image_[i].u16Height = DETECT_HEIGHT;
-        src_image_[i].u16Stride[0] = System::Align(DETECT_WIDTH, 16);
-        ret = HI_MPI_SYS_MmzAlloc(&src_image_[i].u32PhyAddr[0], (void **)&src_image_[i].pu8VirAddr[0], NULL, HI_NULL, src_image_[i].u16Stride[0] * DETECT_HEIGHT);
+        src_image_[i].u16Width = width_;
+        src_image_[i].u16Height = height_;
+        src_image_[i].u16Stride[0] = System::Align(width_, 16);
+        ret = HI_MPI_SYS_MmzAlloc(&src_image_[i].u32PhyAddr[0], (void **)&src_image_[i].pu8VirAddr[0], NULL, HI_NULL, src_image_[i].u16Stride[0] * height_);
         if (HI_SUCCESS != ret)
         {
-            log_e("HI_MPI_SYS_MmzAlloc failed,code %#x,ret");
+            log_e("HI_MPI_SYS_MmzAlloc failed,code %#x", ret);
             return static_cast<int>(KMPPError);
         }
     }
@@ -141,7 +147,7 @@ int32_t VideoDetectImpl::AllocMemory()
     ret = HI_MPI_SYS_MmzAlloc(&dst_mem_info_.u32PhyAddr, (void **)&dst_mem_info_.pu8VirAddr, NULL, HI_NULL, dst_mem_info_.u32Size);
     if (HI_SUCCESS != ret)
     {
-        log_e("HI_MPI_SYS_MmzAlloc failed,code %#x,ret");
+        log_e("HI_MPI_SYS_MmzAlloc failed,code %#x", ret);
         return static_cast<int>(KMPPError);
     }
 
@@ -155,7 +161,7 @@ void VideoDetectImpl::FreeMemory()
     if (HI_SUCCESS != ret)
         log_e("HI_MPI_SYS_MmzFree failed,code %#x", ret);
 
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < DETECT_SLOTS; i++)
     {
         ret = HI_MPI_SYS_MmzFree(src_image_[i].u32PhyAddr[0], src_image_[i].pu8VirAddr[0]);
         if (HI_SUCCESS != ret)
@@ -163,50 +169,144 @@ void VideoDetectImpl::FreeMemory()
     }
 }
 
+int VideoDetectImpl::AcquireSlot()
+{
+    std::unique_lock<std::mutex> lock(slot_mux_);
+
+    for (int i = 0; i < DETECT_SLOTS; i++)
+    {
+        if (i != pending_ && i != current_ && i != reference_)
+            return i;
+    }
+
+    //检测线程跟不上,丢弃还在等待的帧
+    int slot = pending_;
+    pending_ = -1;
+    dropped_++;
+    return slot;
+}
+
 void VideoDetectImpl::OnFrame(const VIDEO_FRAME_INFO_S &frame)
 {
     if (!init_)
         return;
 
+    IVE_HANDLE handle;
+    int slot = AcquireSlot();
+
+    //只等待DMA完成,检测在检测线程中与下一帧的DMA并行
+    //DMA必须在这里等完:返回后VPSS立即释放该帧,检测通道只有DETECT_MEM_BLK_NUM个VB块,
+    //把帧交给检测线程释放会让VPSS拿不到下一块;阻塞查询睡在内核里等完成中断,不占CPU,
+    //等待时间就是一帧亮度的DMA耗时,Close时输出统计
+    uint64_t start = System::GetSteadyMicroSeconds();
+    if (KSuccess != static_cast<err_code>(IVEDMAImage(frame, src_image_[slot], handle)) ||
+        KSuccess != static_cast<err_code>(IVEWait(handle)))
+    {
+        log_e("ive dma image failed");
+        return;
+    }
+    uint64_t wait = System::GetSteadyMicroSeconds() - start;
+
+    std::unique_lock<std::mutex> lock(slot_mux_);
+    //上一帧还没被检测线程取走,直接替换
+    if (pending_ >= 0)
+        dropped_++;
+    pts_[slot] = frame.stVFrame.u64pts;
+    pending_ = slot;
+    frames_++;
+    dma_wait_us_ += wait;
+    dma_wait_max_us_ = std::max(dma_wait_max_us_, wait);
+    slot_cond_.notify_one();
+}
+
+void VideoDetectImpl::Detect(int current, int reference)
+{
     int32_t ret;
     IVE_CCBLOB_S *ccbloc;
 
-    if (first_frame_)
+    ret = HI_IVS_MD_Process(NVR_MD_CHN, &src_image_[current], &src_image_[reference], nullptr, &dst_mem_info_);
+    if (HI_SUCCESS != ret)
     {
-        if (KSuccess != static_cast<err_code>(IVEDMAImage(frame, src_image_[index_], HI_TRUE)))
-        {
-            log_e("ive dma image failed");
-            return;
-        }
-        index_ = 1 - index_;
-        first_frame_ = false;
+        log_e("HI_IVS_MD_Process failed,code %#x", ret);
         return;
     }
-    else
+
+    ccbloc = (IVE_CCBLOB_S *)(dst_mem_info_.pu8VirAddr);
+
+    //DMA输出的MMZ不带cache,破坏检测先整行拷贝采样用到的行再统计
+    dispatcher_.UpdateTamper(pts_[current], tamper_.ProcessUncached(src_image_[current].pu8VirAddr[0], src_image_[current].u16Stride[0], System::GetSteadyMilliSeconds()));
+
+    GetRegions(ccbloc, regions_);
+    dispatcher_.Dispatch(pts_[current], regions_, 0);
+}
+
+void VideoDetectImpl::DetectThread()
+{
+    while (run_)
     {
-        if (KSuccess != static_cast<err_code>(IVEDMAImage(frame, src_image_[index_], HI_TRUE)))
+        int current;
+        int reference;
         {
-            log_e("ive dma image failed");
-            return;
+            std::unique_lock<std::mutex> lock(slot_mux_);
+            slot_cond_.wait(lock, [this]() { return !run_ || pending_ >= 0; });
+            if (!run_)
+                break;
+            current = pending_;
+            reference = reference_;
+            current_ = current;
+            pending_ = -1;
         }
+
+        //第一帧只作为参考帧
+        if (reference >= 0)
+            Detect(current, reference);
+
+        std::unique_lock<std::mutex> lock(slot_mux_);
+        reference_ = current;
+        current_ = -1;
     }
+}
 
-    ret = HI_IVS_MD_Process(NVR_MD_CHN, &src_image_[index_], &src_image_[1 - index_], nullptr, &dst_mem_info_);
-    if (HI_SUCCESS != ret)
+void VideoDetectImpl::StartDetectThread()
+{
+    run_ = true;
+    thread_ = std::unique_ptr<std::thread>(new std::thread([this]() { DetectThread(); }));
+}
+
+void VideoDetectImpl::StopDetectThread()
+{
     {
-        log_e("HI_IVS_MD_Process failed,code %#x", ret);
-        return;
+        std::unique_lock<std::mutex> lock(slot_mux_);
+        run_ = false;
+        slot_cond_.notify_all();
     }
+    thread_->join();
+    thread_.reset();
+    thread_ = nullptr;
+}
 
-    ccbloc = (IVE_CCBLOB_S *)(dst_mem_info_.pu8VirAddr);
-
-    log_d("move objs num:%d,trigger thresh:%d", ccbloc->u8RegionNum, trigger_thresh_);
-    mux_.lock();
-    if (ccbloc->u8RegionNum >= trigger_thresh_ && listener_)
-        listener_->OnTrigger(ccbloc->u8RegionNum);
-    mux_.unlock();
+void VideoDetectImpl::GetRegions(const IVE_CCBLOB_S *ccblob, std::vector<DetectRect> &regions)
+{
+    regions.clear();
 
-    index_ = 1 - index_;
+    //面积为0的是无效区域
+    int found = 0;
+    for (int i = 0; i < IVE_MAX_REGION_NUM && found < ccblob->u8RegionNum; i++)
+    {
+        const IVE_REGION_S &region = ccblob->astRegion[i];
+        if (region.u32Area == 0)
+            continue;
+        found++;
+
+        DetectRect rect;
+        rect.left = region.u16Left;
+        rect.top = region.u16Top;
+        rect.right = region.u16Right;
+        rect.bottom = region.u16Bottom;
+        rect.area = region.u32Area;
+        rect.zone = DETECT_ZONE_FRAME;
+        regions.push_back(rect);
+    }
 }
 
 int32_t VideoDetectImpl::Initialize(const Params &params)
@@ -216,7 +316,26 @@ int32_t VideoDetectImpl::Initialize(const Params &params)
 
     err_code code;
 
-    code = static_cast<err_code>(StartMD());
+    code = static_cast<err_code>(dispatcher_.Initialize(params));
+    if (KSuccess != code)
+        return code;
+
+    if (params.tamper)
+    {
+        code = static_cast<err_code>(tamper_.Initialize({params.width,
+                                                         params.height,
+                                                         params.tamper_hold,
+                                                         params.tamper_covered,
+                                                         params.tamper_defocus,
+                                                         params.tamper_moved}));
+        if (KSuccess != code)
+            return code;
+    }
+
+    width_ = params.width;
+    height_ = params.height;
+
+    code = static_cast<err_code>(StartMD(params));
     if (KSuccess != code)
         return code;
 
@@ -224,7 +343,9 @@ int32_t VideoDetectImpl::Initialize(const Params &params)
     if (KSuccess != code)
         return code;
 
-    trigger_thresh_ = params.trigger_thresh;
+    regions_.reserve(IVE_MAX_REGION_NUM);
+
+    StartDetectThread();
 
     init_ = true;
 
@@ -236,14 +357,26 @@ void VideoDetectImpl::Close()
     if (!init_)
         return;
 
+    StopDetectThread();
+
+    log_i("video detect frames %u,dropped %u,dma wait avg %llu us max %llu us", frames_, dropped_,
+          (unsigned long long)(frames_ ? dma_wait_us_ / frames_ : 0), (unsigned long long)dma_wait_max_us_);
+
     FreeMemory();
 
     StopMD();
 
-    trigger_thresh_ = 0;
-    listener_ = nullptr;
-    first_frame_ = true;
-    index_ = 0;
+    tamper_.Close();
+    dispatcher_.Close();
+    regions_.clear();
+
+    pending_ = -1;
+    current_ = -1;
+    reference_ = -1;
+    frames_ = 0;
+    dropped_ = 0;
+    dma_wait_us_ = 0;
+    dma_wait_max_us_ = 0;
     init_ = false;
 }
 
@@ -251,18 +384,38 @@ VideoDetectImpl::~VideoDetectImpl()
 {
     Close();
 }
-VideoDetectImpl::VideoDetectImpl() : trigger_thresh_(0),
-                                     listener_(nullptr),
-                                     first_frame_(true),
-                                     index_(0),
+VideoDetectImpl::VideoDetectImpl() : width_(0),
+                                     height_(0),
+                                     pending_(-1),
+                                     current_(-1),
+                                     reference_(-1),
+                                     frames_(0),
+                                     dropped_(0),
+                                     dma_wait_us_(0),
+                                     dma_wait_max_us_(0),
+                                     run_(false),
+                                     thread_(nullptr),
                                      init_(false)
 {
 }
 
 void VideoDetectImpl::AddListener(DetectListener *listener)
 {
-    mux_.lock();
-    listener_ = listener;
-    mux_.unlock();
+    dispatcher_.AddListener(listener);
+}
+
+void VideoDetectImpl::RemoveListener(DetectListener *listener)
+{
+    dispatcher_.RemoveListener(listener);
+}
+
+bool VideoDetectImpl::GetResult(DetectResult &result)
+{
+    return dispatcher_.GetResult(result);
+}
+
+void VideoDetectImpl::SetRateControl(FrameRateControlInterface *control)
+{
+    dispatcher_.SetRateControl(control);
 }
-} // namespace nvr
\ No newline at end of file
+} // namespace nvr
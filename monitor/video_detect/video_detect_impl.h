@@ -2,11 +2,17 @@
 #define VIDEO_DETECT_IMPL_H_
 
 #include "video_detect/video_detect.h"
+#include "video_detect/detect_dispatcher.h"
+#include "video_detect/tamper_detector.h"
 
 #include <memory>
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define DETECT_SLOTS 3 //检测图像环形缓存:参考帧,处理中的帧,DMA写入的帧
 
 namespace nvr
 {
@@ -24,13 +30,19 @@ public:
 
     void AddListener(DetectListener *listener) override;
 
+    void RemoveListener(DetectListener *listener) override;
+
+    bool GetResult(DetectResult &result) override;
+
+    void SetRateControl(FrameRateControlInterface *control) override;
+
 protected:
     VideoDetectImpl();
 
     ~VideoDetectImpl() override;
 
 private:
-    int32_t StartMD();
+    int32_t StartMD(const Params &params);
 
     void StopMD();
 
@@ -38,16 +50,44 @@ private:
 
     void FreeMemory();
 
-    int32_t IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const IVE_DST_IMAGE_S &dst_image, HI_BOOL instant);
+    int32_t IVEDMAImage(const VIDEO_FRAME_INFO_S &frame_info, const IVE_DST_IMAGE_S &dst_image, IVE_HANDLE &handle);
+
+    int32_t IVEWait(IVE_HANDLE handle);
+
+    //取一个空闲槽写入新帧,全部占用时覆盖还没处理的帧
+    int AcquireSlot();
+
+    void StartDetectThread();
+
+    void StopDetectThread();
+
+    void DetectThread();
+
+    void Detect(int current, int reference);
+
+    void GetRegions(const IVE_CCBLOB_S *ccblob, std::vector<DetectRect> &regions);
 
 private:
-    std::mutex mux_;
-    IVE_SRC_IMAGE_S src_image_[2];
+    IVE_SRC_IMAGE_S src_image_[DETECT_SLOTS];
+    uint64_t pts_[DETECT_SLOTS];
     IVE_DST_MEM_INFO_S dst_mem_info_;
-    int32_t trigger_thresh_;
-    DetectListener *listener_;
-    bool first_frame_;
-    int index_;
+    DetectDispatcher dispatcher_;
+    TamperDetector tamper_;
+    std::vector<DetectRect> regions_;
+    int32_t width_;
+    int32_t height_;
+    //环形缓存状态,由slot_mux_保护,-1表示没有
+    std::mutex slot_mux_;
+    std::condition_variable slot_cond_;
+    int pending_;
+    int current_;
+    int reference_;
+    uint32_t frames_;
+    uint32_t dropped_;
+    uint64_t dma_wait_us_; //VPSS线程等待DMA完成的总耗时
+    uint64_t dma_wait_max_us_;
+    std::atomic<bool> run_;
+    std::unique_ptr<std::thread> thread_;
     bool init_;
 };
 }; // namespace nvr
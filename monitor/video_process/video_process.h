@@ -2,13 +2,15 @@
 #define VIDEO_PROCESS_MODULE_H_
 
 #include "video/video_sink_interface.h"
+#include "video/frame_rate_control.h"
 
 #include <base/scoped_refptr.h>
 #include <base/ref_count.h>
 
 namespace nvr
 {
-class VideoProcessModule : public rtc::RefCountInterface
+//SetFrameRate调整送给VideoSink的检测通道帧率,可在运行中调用
+class VideoProcessModule : public rtc::RefCountInterface, public FrameRateControlInterface
 {
 public:
     struct Params
@@ -16,6 +18,9 @@ public:
         int32_t frame_rate;
         int32_t encode_width;
         int32_t encode_height;
+        int32_t detect_frame_rate; //检测通道初始帧率
+        int32_t detect_width;      //检测通道分辨率,不超过DETECT_WIDTH x DETECT_HEIGHT
+        int32_t detect_height;
     };
 
     virtual int32_t Initialize(const Params &params) = 0;
@@ -24,6 +29,8 @@ public:
 
     virtual void SetVideoSink(VideoSinkInterface<VIDEO_FRAME_INFO_S> *video_sink) = 0;
 
+    virtual int32_t SetFrameRate(int32_t frame_rate) override = 0;
+
 protected:
     ~VideoProcessModule() override{};
 };
@@ -3,6 +3,8 @@
 
 #include <base/ref_counted_object.h>
 
+#include <algorithm>
+
 namespace nvr
 {
 
@@ -26,6 +28,7 @@ rtc::scoped_refptr<VideoProcessModule> VideoProcessImpl::Create(const Params &pa
 VideoProcessImpl::VideoProcessImpl() : run_(false),
                                        thread_(nullptr),
                                        video_sink_(nullptr),
+                                       detect_frame_rate_(0),
                                        init_(false)
 {
 }
@@ -137,10 +140,18 @@ int32_t VideoProcessImpl::StartVPSSDetectChn(const Params &params)
 {
     int32_t ret;
 
+    //VB按最大检测分辨率分配
+    if (params.detect_width <= 0 || params.detect_width > DETECT_WIDTH ||
+        params.detect_height <= 0 || params.detect_height > DETECT_HEIGHT)
+    {
+        log_e("invalid detect resolution %dx%d,max %dx%d", params.detect_width, params.detect_height, DETECT_WIDTH, DETECT_HEIGHT);
+        return static_cast<int>(KSystemError);
+    }
+
     VPSS_CHN_ATTR_S chn_attr;
     memset(&chn_attr, 0, sizeof(chn_attr));
     chn_attr.s32SrcFrameRate = FRAME_RATE;
-    chn_attr.s32DstFrameRate = 5;
+    chn_attr.s32DstFrameRate = params.detect_frame_rate;
 
     ret = HI_MPI_VPSS_SetChnAttr(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &chn_attr);
     if (HI_SUCCESS != ret)
@@ -148,14 +159,15 @@ int32_t VideoProcessImpl::StartVPSSDetectChn(const Params &params)
         log_e("HI_MPI_VPSS_SetChnAttr failed,code %#x", ret);
         return static_cast<int>(KMPPError);
     }
+    detect_frame_rate_ = params.detect_frame_rate;
 
     VPSS_CHN_MODE_S chn_mode;
     memset(&chn_mode, 0, sizeof(chn_mode));
     chn_mode.enChnMode = VPSS_CHN_MODE_USER;
     chn_mode.bDouble = HI_FALSE;
     chn_mode.enPixelFormat = PIXEL_FORMAT;
-    chn_mode.u32Width = DETECT_WIDTH;
-    chn_mode.u32Height = DETECT_HEIGHT;
+    chn_mode.u32Width = params.detect_width;
+    chn_mode.u32Height = params.detect_height;
     chn_mode.enCompressMode = COMPRESS_MODE_NONE;
 
     ret = HI_MPI_VPSS_SetChnMode(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &chn_mode);
@@ -199,7 +211,9 @@ void VideoProcessImpl::StartProcessThread(const Params &params)
 
         while (run_)
         {
-            ret = HI_MPI_VPSS_GetChnFrame(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &frame_info, 500); //500ms
+            //低帧率时帧间隔可能超过1秒,超时按当前帧率放宽
+            int32_t timeout = std::max(500, 2000 / std::max(1, static_cast<int32_t>(detect_frame_rate_)));
+            ret = HI_MPI_VPSS_GetChnFrame(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &frame_info, timeout);
             if (HI_SUCCESS != ret && HI_ERR_VPSS_BUF_EMPTY != ret)
             {
                 log_e("HI_MPI_VPSS_GetChnFrame failed,code %#x", ret);
@@ -235,6 +249,37 @@ void VideoProcessImpl::StopProcessThread()
     thread_ = nullptr;
 }
 
+int32_t VideoProcessImpl::SetFrameRate(int32_t frame_rate)
+{
+    int32_t ret;
+
+    if (frame_rate <= 0 || frame_rate > FRAME_RATE)
+        return static_cast<int>(KSystemError);
+    if (frame_rate == detect_frame_rate_)
+        return static_cast<int>(KSuccess);
+
+    VPSS_CHN_ATTR_S chn_attr;
+    ret = HI_MPI_VPSS_GetChnAttr(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &chn_attr);
+    if (HI_SUCCESS != ret)
+    {
+        log_e("HI_MPI_VPSS_GetChnAttr failed,code %#x", ret);
+        return static_cast<int>(KMPPError);
+    }
+
+    chn_attr.s32DstFrameRate = frame_rate;
+    ret = HI_MPI_VPSS_SetChnAttr(NVR_VPSS_GRP, NVR_VPSS_DETECT_CHN, &chn_attr);
+    if (HI_SUCCESS != ret)
+    {
+        log_e("HI_MPI_VPSS_SetChnAttr failed,code %#x", ret);
+        return static_cast<int>(KMPPError);
+    }
+
+    log_d("detect frame rate %d -> %d", static_cast<int32_t>(detect_frame_rate_), frame_rate);
+    detect_frame_rate_ = frame_rate;
+
+    return static_cast<int>(KSuccess);
+}
+
 void VideoProcessImpl::SetVideoSink(VideoSinkInterface<VIDEO_FRAME_INFO_S> *video_sink)
 {
     std::unique_lock<std::mutex> lock(mux_);
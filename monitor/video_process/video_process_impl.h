@@ -6,6 +6,7 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 namespace nvr
 {
@@ -20,6 +21,8 @@ public:
 
     void SetVideoSink(VideoSinkInterface<VIDEO_FRAME_INFO_S> *video_sink) override;
 
+    int32_t SetFrameRate(int32_t frame_rate) override;
+
 protected:
     VideoProcessImpl();
 
@@ -47,6 +50,7 @@ private:
     bool run_;
     std::unique_ptr<std::thread> thread_;
     VideoSinkInterface<VIDEO_FRAME_INFO_S> *video_sink_;
+    std::atomic<int32_t> detect_frame_rate_;
     bool init_;
 };
 } // namespace nvr